@@ -0,0 +1,68 @@
+#include <GCGP/ArcLinearizer.h>
+#include <benchmark/benchmark.h>
+
+// Arc segments per second on one core, for a full circle with a radius of 10 mm at
+// the default tolerance of 0.002 mm (157 segments). The exact variant computes sin
+// and cos for every segment, as a baseline for the incremental rotation.
+
+static Move circle()
+{
+    Move move;
+    move.type = MotionType::ArcCCW;
+    move.feedrate = 1000.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        move.start[i] = 0.f;
+        move.target[i] = 0.f;
+    }
+    move.target[2] = -1.f; // Helical
+    move.center[0] = 10.f;
+    move.center[1] = 0.f;
+    move.radius = 10.f;
+    move.startAngle = 3.14159265f;
+    move.angularTravel = 2.f * 3.14159265f;
+    return move;
+}
+
+static void BM_ArcLinearize(benchmark::State &state)
+{
+    Move move = circle();
+    ArcLinearizer arc;
+    float point[GCGP_NUM_AXES];
+    size_t segments = 0;
+
+    for (auto _ : state) {
+        arc.begin(move, 0.002f);
+        while (arc.next(point)) {
+            benchmark::DoNotOptimize(point);
+        }
+        segments += arc.segmentCount();
+    }
+
+    state.SetItemsProcessed(segments);
+}
+BENCHMARK(BM_ArcLinearize);
+
+static void BM_ArcLinearizeExact(benchmark::State &state)
+{
+    Move move = circle();
+    ArcLinearizer arc;
+    arc.begin(move, 0.002f);
+    uint32_t count = arc.segmentCount();
+    float theta = move.angularTravel / count;
+    float point[GCGP_NUM_AXES];
+    size_t segments = 0;
+
+    for (auto _ : state) {
+        for (uint32_t segment = 1; segment <= count; segment++) {
+            float angle = move.startAngle + theta * segment;
+            point[0] = move.center[0] + move.radius * cosf(angle);
+            point[1] = move.center[1] + move.radius * sinf(angle);
+            point[2] = move.start[2] + (move.target[2] - move.start[2]) * segment / count;
+            benchmark::DoNotOptimize(point);
+        }
+        segments += count;
+    }
+
+    state.SetItemsProcessed(segments);
+}
+BENCHMARK(BM_ArcLinearizeExact);
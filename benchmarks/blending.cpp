@@ -0,0 +1,69 @@
+#include <GCGP/Planner.h>
+#include <benchmark/benchmark.h>
+
+// Cycle time of a dense 3D surfacing program with and without G64 P blending. The
+// program rasters a 40 x 4 mm patch of a wavy surface with moves of 0.2 mm. The
+// cycle time is computed from the planned trapezoids, and reported as the counter
+// "cycle_s" next to the planning cost per move. The argument is the tolerance in um,
+// 0 plans the corners with the junction deviation only.
+
+static PlannerSettings benchmarkSettings()
+{
+    PlannerSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.maxRate[i] = 6000.f;
+        settings.acceleration[i] = 500.f;
+    }
+    return settings;
+}
+
+static float blockTime(const PlannerBlock &block)
+{
+    float entry = sqrtf(block.entrySpeedSqr);
+    float peak = sqrtf(block.peakSpeedSqr);
+    float exit = sqrtf(block.exitSpeedSqr);
+    return (peak - entry) / block.acceleration +
+           (block.decelerateAfter - block.accelerateUntil) / peak +
+           (peak - exit) / block.acceleration;
+}
+
+static void BM_SurfacingCycleTime(benchmark::State &state)
+{
+    const float tolerance = state.range(0) / 1000.f;
+    const int columns = 200;
+    const int rows = 20;
+    float cycleTime = 0.f;
+    size_t moves = 0;
+
+    for (auto _ : state) {
+        Planner planner(benchmarkSettings());
+        if (tolerance > 0.f) {
+            planner.modalState.pathControlMode = PathControlMode::Blending;
+            planner.modalState.pathTolerance = tolerance;
+        }
+        cycleTime = 0.f;
+
+        for (int row = 0; row < rows; row++) {
+            for (int column = 0; column <= columns; column++) {
+                int x = row % 2 ? columns - column : column;
+                float target[GCGP_NUM_AXES] = {};
+                target[0] = x * 0.2f;
+                target[1] = row * 0.2f;
+                target[2] = 2.f * sinf(target[0] * 1.5f) * cosf(target[1] * 0.5f);
+                while (!planner.addLinearMove(target, 3000.f, false)) {
+                    cycleTime += blockTime(*planner.currentBlock());
+                    planner.discardCurrentBlock();
+                }
+                moves++;
+            }
+        }
+        while (const PlannerBlock *block = planner.currentBlock()) {
+            cycleTime += blockTime(*block);
+            planner.discardCurrentBlock();
+        }
+    }
+
+    state.SetItemsProcessed(moves);
+    state.counters["cycle_s"] = cycleTime;
+}
+BENCHMARK(BM_SurfacingCycleTime)->Arg(0)->Arg(5)->Arg(10)->Arg(25)->Arg(50);
@@ -0,0 +1,34 @@
+#include <GCGP/Feedback.h>
+#include <benchmark/benchmark.h>
+
+// The cost of the feedback channel on both sides: publish() once per servo tick, and
+// snapshot() for every status report, here without a concurrent writer.
+
+static void BM_Publish(benchmark::State &state)
+{
+    FollowingErrorMonitor monitor;
+    float set[GCGP_NUM_AXES] = {};
+    float actual[GCGP_NUM_AXES] = {};
+    for (auto _ : state) {
+        set[0] += 0.001f;
+        actual[0] = set[0] - 0.002f;
+        monitor.publish(set, actual);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Publish);
+
+static void BM_Snapshot(benchmark::State &state)
+{
+    FollowingErrorMonitor monitor;
+    float position[GCGP_NUM_AXES] = {};
+    monitor.publish(position, position);
+    for (auto _ : state) {
+        FeedbackSnapshot snapshot;
+        benchmark::DoNotOptimize(monitor.snapshot(snapshot));
+        benchmark::DoNotOptimize(snapshot);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_Snapshot);
@@ -0,0 +1,266 @@
+#include <GCGP/GrblInterface.h>
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// The paths every streamed line takes: tokenizeCommand, Command::parse and
+// GrblInterface::update, fed by the line or by the byte, plus printContent and
+// ErrorEnumToString. The input is a seeded mix of lines like a CAM job, so runs of
+// different builds are comparable. Each benchmark reports its throughput in bytes and
+// lines per second, the time per line, and the heap allocations per line, which
+// must stay 0.
+//
+// Tokenizing and parsing run with the capacity used by GrblInterface and with a
+// larger one, to see what the size of the token arrays costs.
+
+// Counts every allocation of the process, the benchmarks read the difference. GCC
+// inlines these into their callers and then takes the free of a pointer from the
+// replaced operator new for a mismatch, although both ends are malloc and free. The
+// warning exists since GCC 11.
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+static std::atomic<size_t> allocations{0};
+
+void *operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic pop
+#endif
+
+// Lines of a 2.5D milling job: mostly short feed moves, some arcs and rapids, and a
+// few modal and spindle words
+static const std::vector<std::string> &corpus()
+{
+    static std::vector<std::string> lines;
+    if (!lines.empty()) {
+        return lines;
+    }
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-100.f, 100.f);
+    std::uniform_int_distribution<int> kind(0, 99);
+    char line[GCGP_MAX_COMMAND_LENGTH];
+    for (int i = 0; i < 1000; i++) {
+        int k = kind(random);
+        float x = coordinate(random);
+        float y = coordinate(random);
+        if (k < 70) {
+            snprintf(line, sizeof(line), "G1 X%.3f Y%.3f", x, y);
+        }
+        else if (k < 80) {
+            snprintf(line, sizeof(line), "G1 X%.3f Y%.3f Z%.3f F%d", x, y,
+                     coordinate(random) / 20.f, 500 + kind(random) * 20);
+        }
+        else if (k < 90) {
+            snprintf(line, sizeof(line), "G%d X%.3f Y%.3f I%.3f J%.3f", 2 + k % 2, x,
+                     y, coordinate(random) / 10.f, coordinate(random) / 10.f);
+        }
+        else if (k < 95) {
+            snprintf(line, sizeof(line), "G0 X%.3f Y%.3f Z5", x, y);
+        }
+        else if (k < 97) {
+            snprintf(line, sizeof(line), "M3 S%d", 8000 + kind(random) * 100);
+        }
+        else {
+            snprintf(line, sizeof(line), "G17 G21 G90 G94");
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static size_t corpusBytes()
+{
+    size_t bytes = 0;
+    for (const std::string &line : corpus()) {
+        bytes += line.size();
+    }
+    return bytes;
+}
+
+// Throughput per line and per byte, and the allocations per line. The counters
+// allocate themselves, so the allocations are taken first.
+static void report(benchmark::State &state, size_t lines, size_t bytes,
+                   size_t allocationsBefore)
+{
+    size_t allocated = allocations.load() - allocationsBefore;
+    state.SetItemsProcessed(static_cast<int64_t>(lines));
+    state.SetBytesProcessed(static_cast<int64_t>(bytes));
+    state.counters["time_per_line"] = benchmark::Counter(
+        static_cast<double>(lines),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+    state.counters["allocs_per_line"] =
+        lines ? static_cast<double>(allocated) / static_cast<double>(lines) : 0.;
+}
+
+template <size_t capacity> static void BM_Tokenize(benchmark::State &state)
+{
+    const std::vector<std::string> &lines = corpus();
+    size_t count = 0;
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        for (const std::string &line : lines) {
+            CommandTokens<capacity> tokens;
+            benchmark::DoNotOptimize(tokenizeCommand(tokens, line.c_str(), line.size()));
+            benchmark::DoNotOptimize(tokens);
+        }
+        count++;
+    }
+    report(state, count * lines.size(), count * corpusBytes(), before);
+}
+BENCHMARK_TEMPLATE(BM_Tokenize, 10);
+BENCHMARK_TEMPLATE(BM_Tokenize, 32);
+
+template <size_t capacity> static void BM_Parse(benchmark::State &state)
+{
+    const std::vector<std::string> &lines = corpus();
+    size_t count = 0;
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        for (const std::string &line : lines) {
+            Command<capacity> command;
+            benchmark::DoNotOptimize(command.parse(line.c_str(), line.size()));
+            benchmark::DoNotOptimize(command);
+        }
+        count++;
+    }
+    report(state, count * lines.size(), count * corpusBytes(), before);
+}
+BENCHMARK_TEMPLATE(BM_Parse, 10);
+BENCHMARK_TEMPLATE(BM_Parse, 32);
+
+// A serial port that delivers the corpus in a loop, as many bytes as were released,
+// and throws away all answers
+struct BenchmarkSerial {
+    std::string data;
+    size_t position = 0;
+    size_t released = 0;
+    size_t written = 0;
+
+    BenchmarkSerial()
+    {
+        for (const std::string &line : corpus()) {
+            data += line + '\n';
+        }
+    }
+
+    SerialInterface serial()
+    {
+        return SerialInterface(this, available, peek, read, write);
+    }
+
+    static int available(void *instance)
+    {
+        return static_cast<int>(static_cast<BenchmarkSerial *>(instance)->released);
+    }
+
+    static int peek(void *instance)
+    {
+        BenchmarkSerial *self = static_cast<BenchmarkSerial *>(instance);
+        return self->released ? static_cast<unsigned char>(self->data[self->position])
+                              : -1;
+    }
+
+    static int read(void *instance)
+    {
+        BenchmarkSerial *self = static_cast<BenchmarkSerial *>(instance);
+        int c = peek(instance);
+        if (c != -1) {
+            self->position = (self->position + 1) % self->data.size();
+            self->released--;
+        }
+        return c;
+    }
+
+    static void write(void *instance, const char *str)
+    {
+        static_cast<BenchmarkSerial *>(instance)->written += strlen(str);
+    }
+};
+
+// By the line: every line arrives at once, like from a host that streams it. By the
+// byte: update() is called for every single byte, like from a slow serial port.
+static void BM_Update(benchmark::State &state)
+{
+    bool byByte = state.range(0) != 0;
+    BenchmarkSerial serial;
+    GrblInterface grbl(serial.serial(), &serial);
+    size_t bytes = 0;
+    size_t lines = 0;
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        if (byByte) {
+            serial.released++;
+            lines += serial.data[serial.position] == '\n';
+            bytes++;
+            grbl.update();
+            continue;
+        }
+        size_t end = serial.data.find('\n', serial.position);
+        serial.released = end - serial.position + 1;
+        bytes += serial.released;
+        lines++;
+        while (serial.released > 0) {
+            grbl.update();
+        }
+    }
+    benchmark::DoNotOptimize(serial.written);
+    report(state, lines, bytes, before);
+    state.SetLabel(byByte ? "by byte" : "by line");
+}
+BENCHMARK(BM_Update)->Arg(0)->Arg(1);
+
+static void BM_PrintContent(benchmark::State &state)
+{
+    BenchmarkSerial serial;
+    const char *line = "G1 G21 G90 X10.5 Y-3.25 Z1 F1500 S12000 M3 M8";
+    Command<10> command;
+    command.parse(line, strlen(line));
+    size_t before = allocations.load();
+    for (auto _ : state) {
+        command.printContent(serial.serial());
+    }
+    benchmark::DoNotOptimize(serial.written);
+    report(state, state.iterations(), serial.written, before);
+}
+BENCHMARK(BM_PrintContent);
+
+// Every value of the enum, including unknown ones that fall through to the default
+static void BM_ErrorEnumToString(benchmark::State &state)
+{
+    size_t characters = 0;
+    for (auto _ : state) {
+        for (int error = 0; error < 256; error++) {
+            const char *text = ErrorEnumToString(static_cast<GrblError>(error));
+            benchmark::DoNotOptimize(text);
+            characters += text[0] != '\0';
+        }
+    }
+    benchmark::DoNotOptimize(characters);
+    state.SetItemsProcessed(state.iterations() * 256);
+}
+BENCHMARK(BM_ErrorEnumToString);
@@ -0,0 +1,111 @@
+#include <GCGP/Kinematics.h>
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// Inverse kinematics of the built-in machines. The scalar benchmarks convert one
+// point per call through the callbacks, like a servo tick does. The batch benchmarks
+// convert 10000 points stored as one array per axis, like the verification of a job
+// on the host. Both report points per second.
+
+static const size_t batchSize = 10000;
+
+struct Points {
+    std::vector<float> axes[GCGP_NUM_AXES];
+    std::vector<float> joints[GCGP_NUM_AXES];
+    std::vector<AxisBits> unreachable;
+    const float *cartesian[GCGP_NUM_AXES];
+    float *jointArrays[GCGP_NUM_AXES];
+
+    Points() : unreachable(batchSize)
+    {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            for (size_t j = 0; j < batchSize; j++) {
+                axes[i].push_back(static_cast<float>((j * 7 + i * 31) % 200) - 100.f);
+            }
+            joints[i].resize(batchSize);
+            cartesian[i] = axes[i].data();
+            jointArrays[i] = joints[i].data();
+        }
+    }
+};
+
+static void runScalar(benchmark::State &state, const Kinematics &kinematics)
+{
+    Points points;
+    size_t index = 0;
+    for (auto _ : state) {
+        float point[GCGP_NUM_AXES];
+        float joints[GCGP_NUM_AXES];
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            point[i] = points.axes[i][index];
+        }
+        benchmark::DoNotOptimize(kinematics.inverse(point, joints));
+        benchmark::DoNotOptimize(joints);
+        index = index + 1 < batchSize ? index + 1 : 0;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static void runBatch(benchmark::State &state, const Kinematics &kinematics)
+{
+    Points points;
+    for (auto _ : state) {
+        size_t failed = kinematics.inverseBatch(points.cartesian, points.jointArrays,
+                                                points.unreachable.data(), batchSize);
+        benchmark::DoNotOptimize(failed);
+    }
+    state.SetItemsProcessed(state.iterations() * batchSize);
+}
+
+static void BM_CartesianScalar(benchmark::State &state)
+{
+    CartesianKinematics cartesian;
+    runScalar(state, cartesian.kinematics());
+}
+BENCHMARK(BM_CartesianScalar);
+
+static void BM_CartesianBatch(benchmark::State &state)
+{
+    CartesianKinematics cartesian;
+    runBatch(state, cartesian.kinematics());
+}
+BENCHMARK(BM_CartesianBatch);
+
+static void BM_CoreXYScalar(benchmark::State &state)
+{
+    CoreXYKinematics coreXY;
+    runScalar(state, coreXY.kinematics());
+}
+BENCHMARK(BM_CoreXYScalar);
+
+static void BM_CoreXYBatch(benchmark::State &state)
+{
+    CoreXYKinematics coreXY;
+    runBatch(state, coreXY.kinematics());
+}
+BENCHMARK(BM_CoreXYBatch);
+
+static void BM_LinearDeltaScalar(benchmark::State &state)
+{
+    LinearDeltaKinematics delta(250.f, 120.f);
+    runScalar(state, delta.kinematics());
+}
+BENCHMARK(BM_LinearDeltaScalar);
+
+static void BM_LinearDeltaBatch(benchmark::State &state)
+{
+    LinearDeltaKinematics delta(250.f, 120.f);
+    runBatch(state, delta.kinematics());
+}
+BENCHMARK(BM_LinearDeltaBatch);
+
+// The batch of a delta without its callback, i.e. per point through inverse()
+static void BM_LinearDeltaBatchFallback(benchmark::State &state)
+{
+    LinearDeltaKinematics delta(250.f, 120.f);
+    Kinematics kinematics = delta.kinematics();
+    kinematics.cbInverseBatch = nullptr;
+    runBatch(state, kinematics);
+}
+BENCHMARK(BM_LinearDeltaBatchFallback);
@@ -0,0 +1,105 @@
+#include <GCGP/GrblInterface.h>
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <string>
+
+// Latency from a real-time byte becoming available on the serial port until its
+// callback runs, for one update() call. The byte is preceded by a burst of G-Code
+// that fills the RX buffer while the planner buffer is full, which is the worst case:
+// every byte in front of it must be moved before it is seen.
+
+using Clock = std::chrono::steady_clock;
+
+struct LatencyMachine {
+    std::string rx;
+    size_t rxIndex = 0;
+    bool bufferFull = true;
+    Clock::time_point feedHoldTime;
+    GrblInterface grbl;
+
+    LatencyMachine() : grbl(SerialInterface(this, available, peek, read, write), this)
+    {
+        grbl.cbBufferIsFull = [](void *instance) {
+            return static_cast<LatencyMachine *>(instance)->bufferFull;
+        };
+        grbl.cbFeedHold = [](void *instance) {
+            static_cast<LatencyMachine *>(instance)->feedHoldTime = Clock::now();
+        };
+    }
+
+    // Empties the RX buffer of the interface, so that the next burst starts fresh
+    void drain()
+    {
+        bufferFull = false;
+        grbl.update();
+        bufferFull = true;
+        rx.clear();
+        rxIndex = 0;
+    }
+
+    static int available(void *instance)
+    {
+        LatencyMachine *self = static_cast<LatencyMachine *>(instance);
+        return static_cast<int>(self->rx.size() - self->rxIndex);
+    }
+
+    static int peek(void *instance)
+    {
+        LatencyMachine *self = static_cast<LatencyMachine *>(instance);
+        if (self->rxIndex >= self->rx.size()) {
+            return -1;
+        }
+        return static_cast<unsigned char>(self->rx[self->rxIndex]);
+    }
+
+    static int read(void *instance)
+    {
+        int c = peek(instance);
+        if (c != -1) {
+            static_cast<LatencyMachine *>(instance)->rxIndex++;
+        }
+        return c;
+    }
+
+    static void write(void *, const char *)
+    {
+    }
+};
+
+static std::string burst(size_t length)
+{
+    std::string data;
+    while (data.size() < length) {
+        data += "G1 X12.345 Y-6.789 F1500\n";
+    }
+    data.resize(length);
+    return data;
+}
+
+static void BM_RealtimeLatency(benchmark::State &state)
+{
+    LatencyMachine machine;
+    std::string data = burst(static_cast<size_t>(state.range(0))) + "!";
+    double worstNs = 0;
+    double totalNs = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        machine.drain();
+        machine.rx = data;
+        state.ResumeTiming();
+
+        Clock::time_point arrival = Clock::now();
+        machine.grbl.update();
+        double latencyNs =
+            std::chrono::duration<double, std::nano>(machine.feedHoldTime - arrival)
+                .count();
+        worstNs = std::max(worstNs, latencyNs);
+        totalNs += latencyNs;
+    }
+
+    state.counters["worst_ns"] = worstNs;
+    state.counters["mean_ns"] = totalNs / static_cast<double>(state.iterations());
+}
+BENCHMARK(BM_RealtimeLatency)->Arg(0)->Arg(32)->Arg(GCGP_RX_BUFFER_SIZE - 1);
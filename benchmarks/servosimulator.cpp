@@ -0,0 +1,62 @@
+#include <GCGP/ServoSimulator.h>
+#include <benchmark/benchmark.h>
+
+// Simulated servo ticks per second on one core: the setpoint generator, all axes with
+// their controller, plant and encoder, and the following error monitor. The
+// realtime_factor counter is how much faster than the simulated machine that runs.
+
+static Command<10> parse(const char *str)
+{
+    Command<10> command;
+    command.parse(str, strlen(str));
+    return command;
+}
+
+static ServoSimulatorSettings benchmarkSettings()
+{
+    ServoSimulatorSettings settings;
+    settings.setpoints.servoRate = 10000.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.setpoints.maxRate[i] = 6000.f;
+        settings.axes[i].ki = 2000.f;
+        settings.axes[i].velocityFeedForward = settings.axes[i].damping / 1000.f;
+        settings.axes[i].accelerationFeedForward = settings.axes[i].mass / 1000.f;
+    }
+    settings.setpoints.acceleration = 1000.f;
+    settings.setpoints.jerk = 50000.f;
+    return settings;
+}
+
+static void BM_ServoTick(benchmark::State &state)
+{
+    bool traced = state.range(0) != 0;
+    ServoSimulator simulator(benchmarkSettings());
+    float peak = 0.f;
+    if (traced) {
+        simulator.instance = &peak;
+        simulator.cbSample = [](void *instance, const ServoSample &sample) {
+            float *peak = static_cast<float *>(instance);
+            *peak = fmaxf(*peak, fabsf(sample.error[0]));
+        };
+    }
+    Command<10> out = parse("G1 X10 Y5 F3000");
+    Command<10> arc = parse("G2 X10 Y5 I0 J-2.5");
+    Command<10> back = parse("G1 X0 Y0");
+
+    int next = 0;
+    for (auto _ : state) {
+        if (!simulator.generator.isFull()) {
+            const Command<10> *commands[] = {&out, &arc, &back};
+            simulator.generator.addCommand(*commands[next]);
+            next = (next + 1) % 3;
+        }
+        simulator.tick();
+    }
+    benchmark::DoNotOptimize(peak);
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["realtime_factor"] = benchmark::Counter(
+        static_cast<double>(state.iterations()) / 10000., benchmark::Counter::kIsRate);
+    state.SetLabel(traced ? "traced" : "untraced");
+}
+BENCHMARK(BM_ServoTick)->Arg(0)->Arg(1);
@@ -0,0 +1,84 @@
+#include <GCGP/SetpointGenerator.h>
+#include <benchmark/benchmark.h>
+
+// Servo ticks per second on one core. Every benchmark keeps the generator busy with
+// moves of one kind, adding the next one whenever there is space. The rate at which
+// the servo loop can run is the inverse of the time per tick.
+
+static SetpointSettings benchmarkSettings()
+{
+    SetpointSettings settings;
+    settings.servoRate = 20000.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.maxRate[i] = 6000.f;
+    }
+    settings.acceleration = 1000.f;
+    settings.jerk = 50000.f;
+    return settings;
+}
+
+static void addMoves(SetpointGenerator &generator, bool arcs)
+{
+    while (!generator.isFull()) {
+        Move move;
+        move.type = arcs ? MotionType::ArcCCW : MotionType::Feed;
+        move.feedrate = 3000.f;
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            move.start[i] = generator.position()[i];
+            move.target[i] = move.start[i];
+        }
+        if (arcs) { // Full circle with a radius of 5 mm
+            move.center[0] = move.start[0] + 5.f;
+            move.center[1] = move.start[1];
+            move.radius = 5.f;
+            move.startAngle = 3.14159265f;
+            move.angularTravel = 2.f * 3.14159265f;
+        }
+        else {
+            move.target[0] = move.start[0] > 0.f ? 0.f : 10.f;
+            move.target[1] = move.start[1] > 0.f ? 0.f : 5.f;
+        }
+        generator.addMove(move);
+    }
+}
+
+static void BM_SetpointTick(benchmark::State &state)
+{
+    bool arcs = state.range(0) != 0;
+    SetpointGenerator generator(benchmarkSettings());
+    addMoves(generator, arcs);
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(generator.tick());
+        if (!generator.isFull()) {
+            addMoves(generator, arcs);
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(arcs ? "arcs" : "lines");
+}
+BENCHMARK(BM_SetpointTick)->Arg(0)->Arg(1);
+
+// Cost of adding a move, which includes planning its profile
+static void BM_SetpointAddMove(benchmark::State &state)
+{
+    SetpointGenerator generator(benchmarkSettings());
+    Move move;
+    move.type = MotionType::Feed;
+    move.feedrate = 3000.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        move.start[i] = 0.f;
+        move.target[i] = 1.f;
+    }
+
+    for (auto _ : state) {
+        generator.addMove(move);
+        state.PauseTiming();
+        while (!generator.isIdle()) {
+            generator.tick();
+        }
+        state.ResumeTiming();
+    }
+}
+BENCHMARK(BM_SetpointAddMove);
@@ -0,0 +1,80 @@
+#include <GCGP/SoftLimits.h>
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+// Verifying a parsed job on the host: the targets of the argument number of moves are
+// converted to machine coordinates and checked against the travel, once as a batch
+// and once move by move with check(), the way a loop over the parsed moves would.
+
+struct Job {
+    std::vector<float> axes[GCGP_NUM_AXES];
+    std::vector<float> machine[GCGP_NUM_AXES];
+    std::vector<AxisBits> violations;
+
+    Job(size_t count) : violations(count)
+    {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            for (size_t j = 0; j < count; j++) {
+                axes[i].push_back(-static_cast<float>((j * 13 + i * 5) % 997) * 0.21f);
+            }
+            machine[i].resize(count);
+        }
+    }
+};
+
+static CoordinateTransform benchmarkTransform()
+{
+    CoordinateTransform transform;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        transform.scale[i] = 1.f;
+        transform.offset[i] = -10.f;
+    }
+    return transform;
+}
+
+static void BM_TransformAndCheckBatch(benchmark::State &state)
+{
+    size_t count = static_cast<size_t>(state.range(0));
+    Job job(count);
+    SoftLimits limits;
+    CoordinateTransform transform = benchmarkTransform();
+    const float *program[GCGP_NUM_AXES];
+    float *machine[GCGP_NUM_AXES];
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        program[i] = job.axes[i].data();
+        machine[i] = job.machine[i].data();
+    }
+
+    for (auto _ : state) {
+        size_t violating = limits.transformAndCheck(transform, program, machine,
+                                                    job.violations.data(), count);
+        benchmark::DoNotOptimize(violating);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TransformAndCheckBatch)->Arg(1000)->Arg(100000);
+
+static void BM_TransformAndCheckSingle(benchmark::State &state)
+{
+    size_t count = static_cast<size_t>(state.range(0));
+    Job job(count);
+    SoftLimits limits;
+    CoordinateTransform transform = benchmarkTransform();
+
+    for (auto _ : state) {
+        size_t violating = 0;
+        for (size_t j = 0; j < count; j++) {
+            float target[GCGP_NUM_AXES];
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                target[i] = job.axes[i][j] * transform.scale[i] + transform.offset[i];
+                job.machine[i][j] = target[i];
+            }
+            job.violations[j] = limits.check(target);
+            violating += job.violations[j] != 0;
+        }
+        benchmark::DoNotOptimize(violating);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_TransformAndCheckSingle)->Arg(1000)->Arg(100000);
@@ -0,0 +1,77 @@
+#include <GCGP/StepGenerator.h>
+#include <benchmark/benchmark.h>
+
+// The step interrupt must finish within one step period, so the inverse of the time
+// per tick() is the maximum sustainable step rate of the dominant axis on this core.
+// The other axes step at most as often.
+
+static PlannerSettings benchmarkSettings()
+{
+    PlannerSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.maxRate[i] = 60000.f;
+        settings.acceleration[i] = 5000.f;
+    }
+    return settings;
+}
+
+// Back and forth moves on the given number of axes
+static void addMoves(Planner &planner, int axes)
+{
+    static bool forward = false;
+    while (!planner.isFull()) {
+        forward = !forward;
+        float target[GCGP_NUM_AXES] = {};
+        for (int i = 0; i < axes && i < GCGP_NUM_AXES; i++) {
+            target[i] = forward ? 50.f / (i + 1) : 0.f;
+        }
+        planner.addLinearMove(target, 30000.f, false);
+    }
+}
+
+static void BM_StepTick(benchmark::State &state)
+{
+    int axes = static_cast<int>(state.range(0));
+    Planner planner(benchmarkSettings());
+    StepGenerator stepper;
+    addMoves(planner, axes);
+    stepper.prepare(planner);
+
+    size_t steps = 0;
+    for (auto _ : state) {
+        AxisBits stepBits = stepper.tick();
+        steps += stepBits & 1;
+        if (!stepper.isRunning()) {
+            state.PauseTiming();
+            addMoves(planner, axes);
+            stepper.prepare(planner);
+            state.ResumeTiming();
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations());
+    state.counters["steps/s"] = benchmark::Counter(static_cast<double>(steps),
+                                                   benchmark::Counter::kIsRate);
+    state.SetLabel(axes == 1 ? "1 axis" : std::to_string(axes) + " axes");
+}
+BENCHMARK(BM_StepTick)->Arg(1)->Arg(GCGP_NUM_AXES);
+
+// Cost of prepare() per segment, which must keep up with the segment frequency
+static void BM_StepPrepare(benchmark::State &state)
+{
+    Planner planner(benchmarkSettings());
+    StepGenerator stepper;
+    size_t segments = 0;
+
+    for (auto _ : state) {
+        addMoves(planner, GCGP_NUM_AXES);
+        segments += stepper.prepare(planner);
+        state.PauseTiming();
+        stepper.reset();
+        state.ResumeTiming();
+    }
+
+    state.counters["segments/s"] = benchmark::Counter(static_cast<double>(segments),
+                                                      benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_StepPrepare);
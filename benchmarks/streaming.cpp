@@ -0,0 +1,99 @@
+#include <GCGP/Simulator.h>
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Streaming strategies over a simulated 115200 baud link with 1 ms of host latency,
+// on a machine that executes the short segments faster than they can be sent. Each
+// iteration streams the whole job on the virtual clock. The counters are what
+// matters: blocks_per_s is the effective rate in virtual time, which the machine
+// alone would allow at up to machine_blocks_per_s. Wall time only shows the cost of
+// the simulation.
+//
+// The job follows a circle of 50 mm radius in 0.2 mm segments. The compact encoding
+// leaves out spaces, trailing zeros and the repeated feed rate. G1 stays, as
+// GrblInterface needs a motion word with axis words.
+
+static const int jobLines = 2000;
+
+static std::vector<std::string> job(bool compact)
+{
+    std::vector<std::string> lines;
+    for (int i = 1; i <= jobLines; i++) {
+        char line[64];
+        float x = 50.f * cosf(i * 0.004f);
+        float y = 50.f * sinf(i * 0.004f);
+        if (!compact) {
+            snprintf(line, sizeof(line), "G1 X%.3f Y%.3f F12000", x, y);
+        }
+        else {
+            snprintf(line, sizeof(line), "G1X%gY%g%s", roundf(x * 1000.f) / 1000.f,
+                     roundf(y * 1000.f) / 1000.f, i == 1 ? "F12000" : "");
+        }
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+static SimulatorSettings linkSettings(uint32_t baudRate)
+{
+    SimulatorSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.planner.maxRate[i] = 12000.f;
+        settings.planner.acceleration[i] = 5000.f;
+    }
+    settings.uart.baudRate = baudRate;
+    settings.uart.hostLatency = baudRate ? 0.001f : 0.f;
+    return settings;
+}
+
+struct Job {
+    std::vector<std::string> lines;
+    size_t next = 0;
+
+    static const char *nextLine(void *instance)
+    {
+        Job *job = static_cast<Job *>(instance);
+        return job->next < job->lines.size() ? job->lines[job->next++].c_str() : nullptr;
+    }
+};
+
+static SimulationReport simulate(const std::vector<std::string> &lines,
+                                 StreamingMode mode, uint32_t baudRate)
+{
+    MachineSimulator simulator(linkSettings(baudRate));
+    Job job{lines};
+    simulator.instance = &job;
+    simulator.cbNextLine = Job::nextLine;
+    simulator.stream(mode);
+    simulator.finish();
+    return simulator.report();
+}
+
+// Arguments: character counting, compact encoding
+static void BM_Streaming(benchmark::State &state)
+{
+    StreamingMode mode =
+        state.range(0) ? StreamingMode::CharacterCounting : StreamingMode::SendResponse;
+    std::vector<std::string> lines = job(state.range(1) != 0);
+    size_t bytes = 0;
+    for (const std::string &line : lines) {
+        bytes += line.size() + 1;
+    }
+
+    SimulationReport report;
+    for (auto _ : state) {
+        report = simulate(lines, mode, 115200);
+        benchmark::DoNotOptimize(report);
+    }
+    SimulationReport machine = simulate(lines, StreamingMode::CharacterCounting, 0);
+
+    state.counters["blocks_per_s"] = report.blocks / report.time;
+    state.counters["machine_blocks_per_s"] = machine.blocks / machine.time;
+    state.counters["bytes_per_line"] = static_cast<double>(bytes) / lines.size();
+    state.counters["moving_pct"] = 100. * report.motionTime / report.time;
+    state.SetLabel(std::string(state.range(0) ? "character counting" : "send-response") +
+                   (state.range(1) ? ", compact" : ""));
+}
+BENCHMARK(BM_Streaming)->ArgsProduct({{0, 1}, {0, 1}})->Unit(benchmark::kMillisecond);
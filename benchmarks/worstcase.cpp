@@ -0,0 +1,55 @@
+#include "target.h"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <vector>
+
+// The lines in fuzz/worstcase.txt, the most expensive ones the worst-case search
+// found, each through the same target as the search: Command::parse() and
+// GrblInterface::update(). They are a regression benchmark for the worst case, while
+// bench_hotpaths covers the typical lines. After a change to the parser, run the
+// search again from the file, so the lines follow the new worst case.
+
+static const std::vector<Input> &worstCases()
+{
+    static std::vector<Input> inputs = loadInputs(GCGP_WORST_CASE_FILE);
+    return inputs;
+}
+
+static void BM_WorstCase(benchmark::State &state, size_t index)
+{
+    static FuzzTarget target;
+    const Input &input = worstCases()[index];
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(input.data());
+    for (auto _ : state) {
+        target.run(data, input.size());
+    }
+    benchmark::DoNotOptimize(target.written);
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(input.size()));
+    state.SetLabel(escape(input));
+}
+
+// All lines after another, the number to compare between builds
+static void BM_WorstCaseAll(benchmark::State &state)
+{
+    static FuzzTarget target;
+    const std::vector<Input> &inputs = worstCases();
+    for (auto _ : state) {
+        for (const Input &input : inputs) {
+            target.run(reinterpret_cast<const uint8_t *>(input.data()), input.size());
+        }
+    }
+    benchmark::DoNotOptimize(target.written);
+    state.SetItemsProcessed(state.iterations() * static_cast<int64_t>(inputs.size()));
+    state.counters["time_per_line"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * inputs.size()),
+        benchmark::Counter::kIsRate | benchmark::Counter::kInvert);
+}
+
+static const bool registered = [] {
+    for (size_t i = 0; i < worstCases().size(); i++) {
+        benchmark::RegisterBenchmark(("BM_WorstCase/" + std::to_string(i)).c_str(),
+                                     BM_WorstCase, i);
+    }
+    benchmark::RegisterBenchmark("BM_WorstCaseAll", BM_WorstCaseAll);
+    return true;
+}();
@@ -22,7 +22,7 @@ int arduinoRead() {
     if (GetGlobalSerialBuffer().empty()) {
         return -1;
     }
-    int c = GetGlobalSerialBuffer().front();
+    int c = (unsigned char)GetGlobalSerialBuffer().front();
     GetGlobalSerialBuffer().pop();
     return c;
 }
@@ -31,7 +31,7 @@ int arduinoPeek() {
     if (GetGlobalSerialBuffer().empty()) {
         return -1;
     }
-    return GetGlobalSerialBuffer().front();
+    return (unsigned char)GetGlobalSerialBuffer().front();
 }
 
 void arduinoWrite(const char* str) {
@@ -21,7 +21,7 @@ int arduinoRead()
     if (GetGlobalSerialBuffer().empty()) {
         return -1;
     }
-    int c = GetGlobalSerialBuffer().front();
+    int c = (unsigned char)GetGlobalSerialBuffer().front();
     GetGlobalSerialBuffer().pop();
     return c;
 }
@@ -31,7 +31,7 @@ int arduinoPeek()
     if (GetGlobalSerialBuffer().empty()) {
         return -1;
     }
-    return GetGlobalSerialBuffer().front();
+    return (unsigned char)GetGlobalSerialBuffer().front();
 }
 
 void arduinoWrite(const char *str)
@@ -102,6 +102,12 @@ class Tester {
         grbl.cbProcessCommand = [](void *instance, Command<10>* command) {
             command->printContent(((Tester*)instance)->serial);
         };
+        grbl.cbJog = [](void *instance, Command<10>* command) {
+            command->printContent(((Tester*)instance)->serial);
+        };
+        grbl.cbJogCancel = [](void *instance) {
+            std::cout << "Jog Cancel" << std::endl;
+        };
     }
 
     void processLine(const std::string &line)
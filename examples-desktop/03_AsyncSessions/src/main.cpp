@@ -0,0 +1,96 @@
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "GCGP/Async.h"
+
+// Runs many independent controller/sender pairs on one thread. Every session is two
+// coroutines: the controller awaits parsed commands, the sender streams a program
+// line by line and waits for each response (send-response protocol).
+
+const std::vector<std::string> program = {
+    "G21 G90 G94",
+    "G0 X0 Y0 Z5",
+    "M3 S12000",
+    "G1 Z-1 F300",
+    "G1 X10 F1200",
+    "G1 Y10",
+    "G1 X0",
+    "G1 Y0",
+    "G0 Z5",
+    "G2 X10 Y0 I5 J0",
+    "G3 X0 Y0 I-5 J0",
+    "M5",
+};
+
+struct Session {
+    AsyncGrblInterface grbl;
+    size_t commandsReceived = 0;
+    size_t responsesReceived = 0;
+    bool finished = false;
+
+    Session(AsyncEventLoop &loop) : grbl(loop)
+    {
+    }
+
+    AsyncTask controller()
+    {
+        while (true) {
+            Command<10> command = co_await grbl.nextCommand();
+            commandsReceived++;
+            if (command.spindleAction == SpindleAction::Stop) {
+                finished = true;
+            }
+        }
+    }
+
+    AsyncTask sender()
+    {
+        std::string welcome = co_await grbl.tx().readLine();
+        for (const std::string &line : program) {
+            grbl.rx().write(line.c_str());
+            grbl.rx().write('\n');
+            std::string response = co_await grbl.tx().readLine();
+            if (response != "ok") {
+                std::cout << "Unexpected response: " << response << std::endl;
+            }
+            responsesReceived++;
+        }
+    }
+};
+
+int main(int argc, char *argv[])
+{
+    size_t numberOfSessions = 1000;
+    if (argc == 2) {
+        numberOfSessions = std::stoul(argv[1]);
+    }
+
+    AsyncEventLoop loop;
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (size_t i = 0; i < numberOfSessions; i++) {
+        sessions.push_back(std::make_unique<Session>(loop));
+        loop.spawn(sessions.back()->controller());
+        loop.spawn(sessions.back()->sender());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    loop.run();
+    auto end = std::chrono::steady_clock::now();
+
+    size_t commands = 0;
+    size_t finished = 0;
+    for (const auto &session : sessions) {
+        commands += session->commandsReceived;
+        finished += session->finished ? 1 : 0;
+    }
+
+    double seconds = std::chrono::duration<double>(end - start).count();
+    std::cout << numberOfSessions << " sessions, " << finished << " finished, "
+              << commands << " commands in " << seconds * 1000.0 << " ms ("
+              << commands / seconds << " commands/s)" << std::endl;
+    return finished == numberOfSessions ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "GCGP/StepGenerator.h"
+
+// Runs a G-code file through the planner and the step generator on a virtual timer,
+// and prints every step as CSV: time in seconds, step bits, direction bits and the
+// machine position in steps.
+int main(int argc, char *argv[])
+{
+    if (argc != 2) {
+        printf("Usage: 04_StepTimeline <filename>\n");
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file.is_open()) {
+        printf("Could not open file %s\n", argv[1]);
+        return 1;
+    }
+
+    Planner planner;
+    StepGenerator stepper;
+    uint64_t time = 0;
+
+    auto runSteps = [&](bool untilIdle) {
+        stepper.prepare(planner);
+        while (stepper.isRunning() && (untilIdle || planner.isFull())) {
+            AxisBits stepBits = stepper.tick();
+            if (stepBits) {
+                printf("%.6f,%d,%d", double(time) / stepper.settings.timerFrequency,
+                       stepBits, stepper.directionBits());
+                for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                    printf(",%d", int(stepper.position()[i]));
+                }
+                printf("\n");
+            }
+            time += stepper.period();
+            stepper.prepare(planner);
+        }
+    };
+
+    printf("time,steps,directions");
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        printf(",position%d", i);
+    }
+    printf("\n");
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        Command<10> command;
+        GrblError error = command.parse(line.c_str(), line.size());
+        if (error == GrblError::None) {
+            runSteps(false);
+            error = planner.addCommand(command);
+        }
+        if (error != GrblError::None) {
+            fprintf(stderr, "Line %zu: %s\n", lineNumber, ErrorEnumToString(error));
+        }
+    }
+    runSteps(true);
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+#include "GCGP/Simulator.h"
+#include "GCGP/Trace.h"
+
+struct Input {
+    std::ifstream file;
+    std::string line;
+};
+
+// Streams a G-code file to a simulated machine like a sender would, without waiting
+// in real time. Prints the errors and a summary with the machining time.
+//   -v         Print everything GrblInterface writes
+//   -b <baud>  Simulate a serial link, with 1 ms of host latency. Ideal without.
+//   -c         Character counting instead of send-response
+//   -t <file>  Write the latest trace records as Chrome trace JSON, for a library
+//              built with GCGP_ENABLE_TRACE
+int main(int argc, char *argv[])
+{
+    SimulatorSettings settings;
+    StreamingMode mode = StreamingMode::SendResponse;
+    bool verbose = false;
+    const char *traceFile = nullptr;
+    int arg = 1;
+    for (; arg < argc - 1; arg++) {
+        std::string option = argv[arg];
+        if (option == "-v") {
+            verbose = true;
+        }
+        else if (option == "-t" && arg + 1 < argc - 1) {
+            traceFile = argv[++arg];
+        }
+        else if (option == "-c") {
+            mode = StreamingMode::CharacterCounting;
+        }
+        else if (option == "-b" && arg + 1 < argc - 1) {
+            settings.uart.baudRate = static_cast<uint32_t>(atol(argv[++arg]));
+            settings.uart.hostLatency = 0.001f;
+        }
+        else {
+            break;
+        }
+    }
+    if (arg != argc - 1) {
+        printf("Usage: 05_HeadlessSimulator [-v] [-b <baud>] [-c] [-t <trace.json>] "
+               "<filename>\n");
+        return 1;
+    }
+
+    Input input;
+    input.file.open(argv[arg]);
+    if (!input.file.is_open()) {
+        printf("Could not open file %s\n", argv[arg]);
+        return 1;
+    }
+
+    MachineSimulator simulator(settings);
+    simulator.instance = &input;
+    simulator.cbNextLine = [](void *instance) -> const char * {
+        Input *input = static_cast<Input *>(instance);
+        if (!std::getline(input->file, input->line)) {
+            return nullptr;
+        }
+        return input->line.c_str();
+    };
+    simulator.cbError = [](void *, uint32_t lineNumber, const char *error) {
+        fprintf(stderr, "Line %u: %s\n", lineNumber, error);
+    };
+    if (verbose) {
+        simulator.cbOutput = [](void *, const char *line) { printf("%s\n", line); };
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    simulator.stream(mode);
+    simulator.finish();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    const SimulationReport &report = simulator.report();
+    printf("Lines:         %u (%u errors, %u rejected by the planner)\n", report.lines,
+           report.errors, report.rejected);
+    printf("Blocks:        %u, %.1f mm\n", report.blocks, report.distance);
+    printf("Machine time:  %.3f s (moving %.3f s, spindle on %.3f s, dwell %.3f s)\n",
+           report.time, report.motionTime, report.spindleTime, report.dwellTime);
+    printf("Throughput:    %.0f lines/s, %u bytes lost\n",
+           report.time > 0. ? report.lines / report.time : 0.,
+           simulator.uart.lostBytes());
+    printf("Real time:     %.3f s, %.0fx faster\n", elapsed.count(),
+           elapsed.count() > 0. ? report.time / elapsed.count() : 0.);
+    printf("End position: ");
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        printf(" %.3f", report.position[i]);
+    }
+    printf("\n");
+
+    if (traceFile) {
+#if GCGP_ENABLE_TRACE
+        FILE *file = fopen(traceFile, "w");
+        if (!file) {
+            printf("Could not write %s\n", traceFile);
+            return 1;
+        }
+        writeChromeTrace(
+            traceBuffer,
+            [](void *file, const char *data, size_t length) {
+                fwrite(data, 1, length, static_cast<FILE *>(file));
+            },
+            file);
+        fclose(file);
+        printf("Trace:         %zu records in %s, %u older ones dropped\n",
+               traceBuffer.size(), traceFile, traceBuffer.dropped());
+#else
+        printf("Trace:         not compiled in, configure with -DGCGP_ENABLE_TRACE=ON\n");
+#endif
+    }
+    return report.errors == 0 ? 0 : 2;
+}
@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "GCGP/CorpusGenerator.h"
+
+// E.g. 500k, 20M or 2G
+static uint64_t parseSize(const char *text)
+{
+    char *end = nullptr;
+    double size = strtod(text, &end);
+    switch (*end) {
+        case 'k':
+        case 'K':
+            size *= 1e3;
+            break;
+        case 'm':
+        case 'M':
+            size *= 1e6;
+            break;
+        case 'g':
+        case 'G':
+            size *= 1e9;
+            break;
+        default:
+            break;
+    }
+    return static_cast<uint64_t>(size);
+}
+
+// Writes a synthetic G-code file of the given size, e.g. to run the simulator or
+// benchmarks on a production sized job. The file is streamed, so any size works.
+//   -t <style>  surfacing, pocketing, drilling, laser or mixed (default)
+//   -s <seed>   Another seed gives another corpus of the same style
+//   -m <rate>   Fraction of malformed lines, e.g. 0.001
+int main(int argc, char *argv[])
+{
+    CorpusSettings settings;
+    int arg = 1;
+    for (; arg < argc - 2; arg++) {
+        std::string option = argv[arg];
+        if (option == "-t" && arg + 1 < argc - 2) {
+            std::string style = argv[++arg];
+            if (style == "surfacing") {
+                settings.style = CorpusStyle::Surfacing;
+            }
+            else if (style == "pocketing") {
+                settings.style = CorpusStyle::Pocketing;
+            }
+            else if (style == "drilling") {
+                settings.style = CorpusStyle::Drilling;
+            }
+            else if (style == "laser") {
+                settings.style = CorpusStyle::LaserRaster;
+            }
+            else if (style != "mixed") {
+                break;
+            }
+        }
+        else if (option == "-s" && arg + 1 < argc - 2) {
+            settings.seed = strtoull(argv[++arg], nullptr, 10);
+        }
+        else if (option == "-m" && arg + 1 < argc - 2) {
+            settings.malformedRate = static_cast<float>(atof(argv[++arg]));
+        }
+        else {
+            break;
+        }
+    }
+    if (arg != argc - 2) {
+        printf("Usage: 06_CorpusGenerator [-t <style>] [-s <seed>] [-m <rate>] <size> "
+               "<filename>\n");
+        return 1;
+    }
+
+    FILE *file = fopen(argv[arg + 1], "wb");
+    if (!file) {
+        printf("Could not open file %s\n", argv[arg + 1]);
+        return 1;
+    }
+    static char buffer[1 << 16];
+    setvbuf(file, buffer, _IOFBF, sizeof(buffer));
+
+    CorpusGenerator generator(settings);
+    auto start = std::chrono::steady_clock::now();
+    uint64_t written = generator.write(
+        parseSize(argv[arg]),
+        [](void *file, const char *data, size_t length) {
+            fwrite(data, 1, length, static_cast<FILE *>(file));
+        },
+        file);
+    bool ok = fclose(file) == 0;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (!ok) {
+        printf("Could not write file %s\n", argv[arg + 1]);
+        return 1;
+    }
+
+    printf("Written:  %llu bytes, %llu lines (%llu malformed)\n",
+           static_cast<unsigned long long>(written),
+           static_cast<unsigned long long>(generator.lines()),
+           static_cast<unsigned long long>(generator.malformedLines()));
+    printf("Speed:    %.0f MB/s\n", written / elapsed.count() * 1e-6);
+    return 0;
+}
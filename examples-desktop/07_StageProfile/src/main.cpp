@@ -0,0 +1,64 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include "GCGP/CorpusGenerator.h"
+#include "GCGP/Planner.h"
+#include "GCGP/StageProfiler.h"
+
+// Prints the cost of every stage of the command pipeline per block, for a G-code file
+// or for a generated corpus:
+//   07_StageProfile <file.nc>
+//   07_StageProfile -n <lines> [-m <malformed rate>]
+// The hardware counters need Linux with access to them, e.g. after
+//   sudo sysctl kernel.perf_event_paranoid=2
+// Commands are dispatched into a planner, whose blocks are dropped right away, so the
+// Dispatch stage is the cost of planning.
+int main(int argc, char *argv[])
+{
+    Planner planner;
+    StageProfiler profiler(&planner);
+    profiler.cbProcessCommand = [](void *instance, Command<10> *command) {
+        Planner *planner = static_cast<Planner *>(instance);
+        planner->addCommand(*command);
+        while (planner->isFull() && planner->currentBlock()) {
+            planner->discardCurrentBlock();
+        }
+    };
+
+    if (argc == 2) {
+        std::ifstream file(argv[1]);
+        if (!file.is_open()) {
+            printf("Could not open file %s\n", argv[1]);
+            return 1;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            profiler.addLine(line.c_str(), strcspn(line.c_str(), "\r"));
+        }
+    }
+    else if (argc >= 3 && strcmp(argv[1], "-n") == 0) {
+        CorpusSettings settings;
+        if (argc >= 5 && strcmp(argv[3], "-m") == 0) {
+            settings.malformedRate = static_cast<float>(atof(argv[4]));
+        }
+        CorpusGenerator generator(settings);
+        long lines = atol(argv[2]);
+        for (long i = 0; i < lines; i++) {
+            const char *line = generator.nextLine();
+            profiler.addLine(line, strlen(line));
+        }
+    }
+    else {
+        printf("Usage: 07_StageProfile <file.nc>\n"
+               "       07_StageProfile -n <lines> [-m <malformed rate>]\n");
+        return 1;
+    }
+
+    SerialInterface serial;
+    serial.cbWrite = [](const char *str) { fputs(str, stdout); };
+    profiler.print(serial);
+    return 0;
+}
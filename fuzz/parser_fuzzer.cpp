@@ -0,0 +1,37 @@
+#include "target.h"
+
+// libFuzzer target, built with clang and -fsanitize=fuzzer,address,undefined. Besides
+// crashes, it searches for expensive lines: the cost of every input is sorted into
+// one of the buckets below, which libFuzzer sees as extra coverage. An input that
+// reaches a bucket no other input reached is new coverage and kept in the corpus, so
+// the corpus grows towards the slowest lines. Run it with the worst cases as seeds:
+//   fuzz_parser -max_len=128 corpus ../fuzz/seeds
+// The cost is counted by CostMeter, in instructions or else in ns. Under the sanitizers
+// it is only a guide, worstcase measures the real one.
+
+#define COST_BUCKETS 64
+
+__attribute__((section("__libfuzzer_extra_counters"))) static uint8_t
+    costCounters[COST_BUCKETS];
+
+// Buckets of 1/8 octave, so each one is about 9 % more expensive than the last
+static size_t costBucket(uint64_t cost)
+{
+    size_t bucket = 0;
+    uint64_t limit = 64;
+    while (bucket < COST_BUCKETS - 1 && cost >= limit) {
+        limit += limit / 8 > 0 ? limit / 8 : 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static FuzzTarget target;
+    static CostMeter meter;
+    uint64_t start = meter.now();
+    target.run(data, size);
+    costCounters[costBucket(meter.now() - start)] = 1;
+    return 0;
+}
@@ -0,0 +1,163 @@
+#ifndef GCGP_FUZZ_TARGET_H
+#define GCGP_FUZZ_TARGET_H
+
+#include <GCGP/GrblInterface.h>
+#include <GCGP/StageProfiler.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// The code under test for both the libFuzzer target and the worst-case search: a line
+// through Command::parse() directly, without a length limit, and the same bytes over
+// a serial port through GrblInterface, which buffers them in m_commandBuffer and
+// processes every complete line.
+struct FuzzTarget {
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    size_t position = 0;
+    size_t written = 0;
+    GrblInterface grbl;
+
+    FuzzTarget() : grbl(SerialInterface(this, available, peek, read, write), this)
+    {
+        grbl.cbProcessCommand = [](void *, Command<10> *command) {
+            volatile bool motion = command->hasAxisWords();
+            (void)motion;
+        };
+    }
+
+    // Every line is terminated, so the next run starts with an empty command buffer
+    void run(const uint8_t *bytes, size_t length)
+    {
+        Command<10> command;
+        command.parse(reinterpret_cast<const char *>(bytes), length);
+
+        static const uint8_t newline = '\n';
+        feed(bytes, length);
+        feed(&newline, 1);
+    }
+
+    void feed(const uint8_t *bytes, size_t length)
+    {
+        data = bytes;
+        size = length;
+        position = 0;
+        while (position < size) {
+            grbl.update();
+        }
+    }
+
+    static int available(void *instance)
+    {
+        FuzzTarget *self = static_cast<FuzzTarget *>(instance);
+        return static_cast<int>(self->size - self->position);
+    }
+
+    static int peek(void *instance)
+    {
+        FuzzTarget *self = static_cast<FuzzTarget *>(instance);
+        return self->position < self->size ? self->data[self->position] : -1;
+    }
+
+    static int read(void *instance)
+    {
+        FuzzTarget *self = static_cast<FuzzTarget *>(instance);
+        return self->position < self->size ? self->data[self->position++] : -1;
+    }
+
+    static void write(void *instance, const char *str)
+    {
+        static_cast<FuzzTarget *>(instance)->written += strlen(str);
+    }
+};
+
+// The cost of the code under test: the instructions it retires in user space, counted
+// by the CPU through perf_event_open(). Unlike the time, they hardly change from one
+// run to the next, so a mutant that costs more really does more work. Without the
+// counter, e.g. in a virtual machine or on other systems, the wall time in ns is used.
+class CostMeter {
+  public:
+    bool countsInstructions() const
+    {
+        return m_counters.available(PerfCounter::Instructions);
+    }
+
+    const char *unit() const
+    {
+        return countsInstructions() ? "instructions" : "ns";
+    }
+
+    // A running count, the cost of a run is the difference before and after it
+    uint64_t now() const
+    {
+        if (countsInstructions()) {
+            uint64_t values[GCGP_NUM_PERF_COUNTERS];
+            m_counters.read(values);
+            return values[static_cast<int>(PerfCounter::Instructions)];
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+  private:
+    PerfCounters m_counters;
+};
+
+// Files of inputs have one input per line. Bytes that are not printable and
+// backslashes are written as \xHH, and lines starting with # are comments.
+using Input = std::string;
+
+static inline std::string escape(const Input &input)
+{
+    std::string line;
+    for (unsigned char c : input) {
+        bool comment = line.empty() && c == '#';
+        if (c < 0x20 || c > 0x7E || c == '\\' || comment) {
+            char hex[5];
+            snprintf(hex, sizeof(hex), "\\x%02X", c);
+            line += hex;
+        }
+        else {
+            line += static_cast<char>(c);
+        }
+    }
+    return line;
+}
+
+static inline Input unescape(const std::string &line)
+{
+    Input input;
+    for (size_t i = 0; i < line.size(); i++) {
+        if (line[i] == '\\' && i + 3 < line.size() && line[i + 1] == 'x') {
+            long byte = strtol(line.substr(i + 2, 2).c_str(), nullptr, 16);
+            input += static_cast<char>(byte);
+            i += 3;
+        }
+        else {
+            input += line[i];
+        }
+    }
+    return input;
+}
+
+static inline std::vector<Input> loadInputs(const char *filename)
+{
+    std::vector<Input> inputs;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty() && line[0] != '#') {
+            inputs.push_back(unescape(line));
+        }
+    }
+    return inputs;
+}
+
+#endif // GCGP_FUZZ_TARGET_H
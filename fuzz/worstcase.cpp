@@ -0,0 +1,226 @@
+#include "target.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// Searches for the lines that take longest through the parser, with any compiler:
+//   worstcase search <file> [seconds] [seed]
+//   worstcase replay <file>
+// search starts from the lines in the file, mutates the most expensive ones, keeps
+// every mutant that is slower than the slowest kept so far, and writes the worst ones
+// back. replay runs every line once and prints its cost, e.g. as a regression test
+// with sanitizers. The file format is described in target.h.
+//
+// The cost is counted by CostMeter, in instructions or else in ns, and is the minimum
+// of several batches, which filters out interrupts and cache misses of the machine
+// rather than of the parser. Lines are limited to what fits into the command buffer of
+// GrblInterface, longer ones are discarded unparsed.
+
+#define MAX_LINE_LENGTH (GCGP_MAX_COMMAND_LENGTH - 1)
+#define KEEP 32 // Worst lines that are kept
+#define BATCHES 5
+#define RUNS_PER_BATCH 8
+
+using Clock = std::chrono::steady_clock;
+
+struct Entry {
+    Input input;
+    double cost; // In the unit of the CostMeter
+};
+
+static FuzzTarget target;
+static CostMeter meter;
+static const Input *running = nullptr; // Printed if the target crashes
+
+static void crashHandler(int signal)
+{
+    if (running) {
+        fprintf(stderr, "\nSignal %d on input: %s\n", signal, escape(*running).c_str());
+    }
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+static double measure(const Input &input)
+{
+    running = &input;
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(input.data());
+    double best = 1e30;
+    for (int batch = 0; batch < BATCHES; batch++) {
+        uint64_t start = meter.now();
+        for (int run = 0; run < RUNS_PER_BATCH; run++) {
+            target.run(data, input.size());
+        }
+        double cost = static_cast<double>(meter.now() - start) / RUNS_PER_BATCH;
+        best = std::min(best, cost);
+    }
+    running = nullptr;
+    return best;
+}
+
+// Mostly G-code, sometimes any byte
+static char randomCharacter(std::mt19937_64 &random)
+{
+    static const char alphabet[] = "GMXYZIJKFSPTL$0123456789.-+ =";
+    if (random() % 16 == 0) {
+        return static_cast<char>(random() % 256);
+    }
+    return alphabet[random() % (sizeof(alphabet) - 1)];
+}
+
+static Input mutate(const Input &parent, const std::vector<Entry> &worst,
+                    std::mt19937_64 &random)
+{
+    Input input = parent;
+    int mutations = 1 + static_cast<int>(random() % 4);
+    for (int m = 0; m < mutations; m++) {
+        size_t position = input.empty() ? 0 : random() % (input.size() + 1);
+        switch (random() % 6) {
+            case 0: // Insert a character
+                input.insert(position, 1, randomCharacter(random));
+                break;
+            case 1: // Delete one
+                if (position < input.size()) {
+                    input.erase(position, 1);
+                }
+                break;
+            case 2: // Replace one
+                if (position < input.size()) {
+                    input[position] = randomCharacter(random);
+                }
+                break;
+            case 3: { // Repeat a part
+                size_t length = random() % 12 + 1;
+                size_t start = input.empty() ? 0 : random() % input.size();
+                input.insert(position, input.substr(start, length));
+                break;
+            }
+            case 4: { // Insert a word with a long number
+                std::string word(1, "GMXYZIJKFSPTL"[random() % 13]);
+                if (random() % 2) {
+                    word += '-';
+                }
+                int digits = 1 + static_cast<int>(random() % 12);
+                for (int d = 0; d < digits; d++) {
+                    word += static_cast<char>('0' + random() % 10);
+                    if (d == digits / 2 && random() % 2) {
+                        word += '.';
+                    }
+                }
+                input.insert(position, word);
+                break;
+            }
+            default: { // Splice with another kept line
+                const Input &other = worst[random() % worst.size()].input;
+                size_t cut = other.empty() ? 0 : random() % other.size();
+                input = input.substr(0, position) + other.substr(cut);
+                break;
+            }
+        }
+    }
+    if (input.size() > MAX_LINE_LENGTH) {
+        input.resize(MAX_LINE_LENGTH);
+    }
+    return input;
+}
+
+static void insert(std::vector<Entry> &worst, const Input &input, double cost)
+{
+    for (const Entry &entry : worst) {
+        if (entry.input == input) {
+            return;
+        }
+    }
+    worst.push_back({input, cost});
+    std::sort(worst.begin(), worst.end(),
+              [](const Entry &a, const Entry &b) { return a.cost > b.cost; });
+    if (worst.size() > KEEP) {
+        worst.pop_back();
+    }
+}
+
+static int search(const char *filename, double seconds, uint64_t seed)
+{
+    std::vector<Input> inputs = loadInputs(filename);
+    if (inputs.empty()) {
+        inputs = {"G1 X10 Y20 F1000", "G2 X10 Y0 I5 J-5", "$J=G91 X1 F100"};
+    }
+    std::vector<Entry> worst;
+    for (const Input &input : inputs) {
+        Input line = input.substr(0, MAX_LINE_LENGTH);
+        insert(worst, line, measure(line));
+    }
+
+    std::mt19937_64 random(seed);
+    auto end = Clock::now() + std::chrono::duration<double>(seconds);
+    uint64_t tried = 0;
+    while (Clock::now() < end) {
+        // Biased towards the top of the list
+        size_t index = random() % (random() % worst.size() + 1);
+        Input input = mutate(worst[index].input, worst, random);
+        tried++;
+        double cost = measure(input);
+        if (worst.size() < KEEP || cost > worst.back().cost) {
+            // A second measurement, so a single slow run does not count
+            insert(worst, input, std::min(cost, measure(input)));
+        }
+    }
+
+    for (Entry &entry : worst) {
+        entry.cost = measure(entry.input);
+    }
+    std::sort(worst.begin(), worst.end(),
+              [](const Entry &a, const Entry &b) { return a.cost > b.cost; });
+    FILE *file = fopen(filename, "w");
+    if (!file) {
+        printf("Could not write %s\n", filename);
+        return 1;
+    }
+    fprintf(file, "# The most expensive lines for the parser, found by fuzz/worstcase\n");
+    for (const Entry &entry : worst) {
+        fprintf(file, "%s\n", escape(entry.input).c_str());
+    }
+    fclose(file);
+    printf("%llu inputs tried, the worst takes %.0f %s:\n%s\n",
+           static_cast<unsigned long long>(tried), worst[0].cost, meter.unit(),
+           escape(worst[0].input).c_str());
+    return 0;
+}
+
+static int replay(const char *filename)
+{
+    std::vector<Input> inputs = loadInputs(filename);
+    double worst = 0.;
+    for (const Input &input : inputs) {
+        double cost = measure(input);
+        worst = std::max(worst, cost);
+        printf("%8.0f  %s\n", cost, escape(input).c_str());
+    }
+    printf("%zu inputs, the worst takes %.0f %s\n", inputs.size(), worst, meter.unit());
+    return inputs.empty() ? 1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    std::signal(SIGSEGV, crashHandler);
+    std::signal(SIGABRT, crashHandler);
+    std::signal(SIGFPE, crashHandler);
+
+    std::string mode = argc > 2 ? argv[1] : "";
+    if (mode == "search") {
+        double seconds = argc > 3 ? atof(argv[3]) : 60.;
+        uint64_t seed = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1;
+        return search(argv[2], seconds, seed);
+    }
+    if (mode == "replay") {
+        return replay(argv[2]);
+    }
+    printf("Usage: worstcase search <file> [seconds] [seed]\n"
+           "       worstcase replay <file>\n");
+    return 1;
+}
@@ -0,0 +1,73 @@
+
+#include "GCGP/ArcLinearizer.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+void ArcLinearizer::begin(const Move &move, float tolerance)
+{
+    m_axis0 = move.axis0;
+    m_axis1 = move.axis1;
+    m_center[0] = move.center[0];
+    m_center[1] = move.center[1];
+    m_radius = move.radius;
+    m_startAngle = move.startAngle;
+    m_r0 = move.start[m_axis0] - m_center[0];
+    m_r1 = move.start[m_axis1] - m_center[1];
+
+    // A chord spanning 2 * acos(1 - tolerance / radius) deviates by the tolerance. The
+    // same angle as 4 * asin(sqrt(tolerance / (2 * radius))) does not round to 0 for a
+    // tolerance that is tiny against the radius.
+    tolerance = fmaxf(tolerance, GCGP_ARC_MIN_TOLERANCE);
+    float segmentAngle = static_cast<float>(M_PI);
+    if (tolerance < m_radius) {
+        segmentAngle = 4.f * asinf(sqrtf(tolerance / (2.f * m_radius)));
+    }
+    float segments = ceilf(fabsf(move.angularTravel) / segmentAngle);
+    m_segmentCount = segments > 1.f ? static_cast<uint32_t>(segments) : 1;
+    m_segment = 0;
+    m_correctionCountdown = GCGP_ARC_ANGULAR_CORRECTION;
+
+    m_theta = move.angularTravel / m_segmentCount;
+    m_cosTheta = cosf(m_theta);
+    m_sinTheta = sinf(m_theta);
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_start[i] = move.start[i];
+        m_target[i] = move.target[i];
+        m_increment[i] = (move.target[i] - move.start[i]) / m_segmentCount;
+    }
+}
+
+bool ArcLinearizer::next(float point[GCGP_NUM_AXES])
+{
+    if (m_segment >= m_segmentCount) {
+        return false;
+    }
+    m_segment++;
+    if (m_segment == m_segmentCount) {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            point[i] = m_target[i];
+        }
+        return true;
+    }
+
+    if (--m_correctionCountdown == 0) {
+        m_correctionCountdown = GCGP_ARC_ANGULAR_CORRECTION;
+        float angle = m_startAngle + m_theta * m_segment;
+        m_r0 = m_radius * cosf(angle);
+        m_r1 = m_radius * sinf(angle);
+    }
+    else {
+        float r0 = m_r0 * m_cosTheta - m_r1 * m_sinTheta;
+        m_r1 = m_r0 * m_sinTheta + m_r1 * m_cosTheta;
+        m_r0 = r0;
+    }
+
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        point[i] = m_start[i] + m_increment[i] * m_segment;
+    }
+    point[m_axis0] = m_center[0] + m_r0;
+    point[m_axis1] = m_center[1] + m_r1;
+    return true;
+}
@@ -0,0 +1,12 @@
+#include "GCGP/Clock.h"
+
+#if !defined(ARDUINO)
+#include <chrono>
+
+uint32_t clockMicroseconds()
+{
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+#endif
@@ -0,0 +1,551 @@
+
+#include "GCGP/CorpusGenerator.h"
+
+#if !defined(ARDUINO)
+
+#define SAFE_HEIGHT 5000 // um, for rapids between operations
+#define CLEARANCE 2000   // um, above the stock while drilling
+
+CorpusGenerator::CorpusGenerator(const CorpusSettings &settings)
+    : settings(settings), m_random(settings.seed),
+      m_malformedRandom(settings.seed ^ 0x6A09E667F3BCC908ull)
+{
+    m_line[0] = '\0';
+}
+
+// SplitMix64: fast, good enough for test data, and the same on every platform
+uint64_t CorpusGenerator::random(uint64_t &state)
+{
+    state += 0x9E3779B97F4A7C15ull;
+    uint64_t z = state;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+int32_t CorpusGenerator::random(uint64_t &state, int32_t minimum, int32_t maximum)
+{
+    uint64_t range = static_cast<uint64_t>(maximum - minimum) + 1;
+    return minimum + static_cast<int32_t>(random(state) % range);
+}
+
+const char *CorpusGenerator::nextLine()
+{
+    startLine();
+    m_lines++;
+
+    // Scaled to the full range of the random numbers, which is exact for a float
+    if (settings.malformedRate > 0.f) {
+        uint64_t threshold = UINT64_MAX;
+        if (settings.malformedRate < 1.f) {
+            threshold =
+                static_cast<uint64_t>(settings.malformedRate * 18446744073709551616.f);
+        }
+        if (random(m_malformedRandom) < threshold) {
+            malformedLine();
+            m_malformedLines++;
+            return m_line;
+        }
+    }
+
+    if (!m_preambleDone) {
+        addText("G21 G90 G17 G94");
+        m_preambleDone = true;
+        return m_line;
+    }
+    if (m_operationDone) {
+        startOperation();
+    }
+    if (m_phase < 0) {
+        toolChangeLine();
+        return m_line;
+    }
+    switch (m_operation) {
+        case CorpusStyle::Surfacing:
+            surfacingLine();
+            break;
+        case CorpusStyle::Pocketing:
+            pocketingLine();
+            break;
+        case CorpusStyle::Drilling:
+            drillingLine();
+            break;
+        default:
+            rasterLine();
+            break;
+    }
+    return m_line;
+}
+
+uint64_t CorpusGenerator::write(uint64_t bytes,
+                                void (*cbWrite)(void *, const char *, size_t),
+                                void *instance)
+{
+    uint64_t written = 0;
+    while (written < bytes) {
+        nextLine();
+        m_line[m_length] = '\n';
+        cbWrite(instance, m_line, m_length + 1);
+        m_line[m_length] = '\0';
+        written += m_length + 1;
+    }
+    return written;
+}
+
+void CorpusGenerator::startLine()
+{
+    m_length = 0;
+    m_line[0] = '\0';
+}
+
+void CorpusGenerator::addText(const char *text)
+{
+    if (m_length > 0 && m_length < GCGP_MAX_COMMAND_LENGTH) {
+        m_line[m_length++] = ' ';
+    }
+    for (; *text != '\0' && m_length < GCGP_MAX_COMMAND_LENGTH; text++) {
+        m_line[m_length++] = *text;
+    }
+    m_line[m_length] = '\0';
+}
+
+// Like a CAM post-processor, always with three decimals
+void CorpusGenerator::addWord(char letter, int32_t micrometers)
+{
+    char text[16];
+    char *end = text + sizeof(text);
+    char *p = end;
+    *--p = '\0';
+    uint32_t value = micrometers < 0 ? 0u - static_cast<uint32_t>(micrometers)
+                                     : static_cast<uint32_t>(micrometers);
+    for (int digit = 0; digit < 3; digit++) {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+    *--p = '.';
+    do {
+        *--p = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    if (micrometers < 0) {
+        *--p = '-';
+    }
+    *--p = letter;
+    addText(p);
+}
+
+void CorpusGenerator::addInteger(char letter, int32_t value)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%c%ld", letter, static_cast<long>(value));
+    addText(text);
+}
+
+// Mixed runs the styles in random order. A milling operation after another style
+// starts with a tool change.
+void CorpusGenerator::startOperation()
+{
+    CorpusStyle previous = m_operation;
+    m_operation = settings.style;
+    if (m_operation == CorpusStyle::Mixed) {
+        m_operation = static_cast<CorpusStyle>(random(m_random, 0, 3));
+    }
+    m_operationDone = false;
+    m_phase = 0;
+    m_stock = static_cast<int32_t>(settings.stockSize * 1000.f);
+    if (m_operation != CorpusStyle::LaserRaster && m_operation != previous) {
+        m_phase = -2;
+    }
+
+    switch (m_operation) {
+        case CorpusStyle::Surfacing:
+            m_surface.step = 200;
+            m_surface.stepover = 500;
+            m_surface.columns = m_stock / m_surface.step;
+            m_surface.rows = m_stock / m_surface.stepover + 1;
+            m_surface.row = 0;
+            m_surface.column = 0;
+            m_surface.direction = 1;
+            break;
+        case CorpusStyle::Pocketing: {
+            int32_t maxHalfSize = m_stock / 4;
+            m_pocket.radius = random(m_random, 1, 8) * 500;
+            m_pocket.halfWidth = random(m_random, m_pocket.radius + 2000, maxHalfSize);
+            m_pocket.halfHeight = random(m_random, m_pocket.radius + 2000, maxHalfSize);
+            m_pocket.centerX =
+                random(m_random, m_pocket.halfWidth, m_stock - m_pocket.halfWidth);
+            m_pocket.centerY =
+                random(m_random, m_pocket.halfHeight, m_stock - m_pocket.halfHeight);
+            m_pocket.stepover = 1200;
+            int32_t halfSize = m_pocket.halfWidth < m_pocket.halfHeight
+                                   ? m_pocket.halfWidth
+                                   : m_pocket.halfHeight;
+            m_pocket.rings = (halfSize - 500) / m_pocket.stepover + 1;
+            m_pocket.levels = random(m_random, 1, 3);
+            m_pocket.level = 1;
+            m_pocket.ring = m_pocket.rings - 1;
+            break;
+        }
+        case CorpusStyle::Drilling:
+            m_drill.holes = random(m_random, 4, 16);
+            m_drill.depth = random(m_random, 4, 24) * 500;
+            m_drill.peck = random(m_random, 2, 6) * 500;
+            m_drill.hole = 0;
+            break;
+        default:
+            m_raster.pixel = 100;
+            m_raster.columns = m_stock / 2 / m_raster.pixel;
+            m_raster.rows = 100;
+            m_raster.originX = m_stock / 4;
+            m_raster.originY = random(m_random, 0, m_stock - m_raster.rows * 100);
+            m_raster.row = 0;
+            m_raster.column = 0;
+            m_raster.direction = 1;
+            break;
+    }
+}
+
+void CorpusGenerator::toolChangeLine()
+{
+    if (m_phase == -2) {
+        m_tool = m_tool % 8 + 1;
+        addInteger('T', m_tool);
+        addText("M6");
+    }
+    else {
+        addText("M3");
+        addInteger('S', random(m_random, 40, 240) * 100);
+    }
+    m_phase++;
+}
+
+// A dome with a fine ripple, at most 5 mm deep
+int32_t CorpusGenerator::surfaceHeight(int32_t x, int32_t y) const
+{
+    int64_t dx = x - m_stock / 2;
+    int64_t dy = y - m_stock / 2;
+    int64_t radius = static_cast<int64_t>(m_stock) * 3 / 4;
+    int64_t height = -5000 + (dx * dx + dy * dy) * 5000 / (radius * radius);
+    height += ((x / 1000) * 7 + (y / 1000) * 13) % 5 * 20;
+    return static_cast<int32_t>(height < 0 ? height : 0);
+}
+
+// Zig-zag rows along X, a point every 0.2 mm
+void CorpusGenerator::surfacingLine()
+{
+    int32_t x = m_surface.direction > 0 ? m_surface.column * m_surface.step
+                                        : m_stock - m_surface.column * m_surface.step;
+    int32_t y = m_surface.row * m_surface.stepover;
+    switch (m_phase) {
+        case 0:
+            addText("G0");
+            addWord('Z', SAFE_HEIGHT);
+            m_phase = 1;
+            break;
+        case 1:
+            addText("G0");
+            addWord('X', x);
+            addWord('Y', y);
+            m_phase = 2;
+            break;
+        case 2:
+            addText("G1");
+            addWord('Z', surfaceHeight(x, y));
+            addInteger('F', 600);
+            m_surface.feed = true;
+            m_phase = 3;
+            break;
+        case 3:
+            if (m_surface.column < m_surface.columns) {
+                m_surface.column++;
+                x = m_surface.direction > 0 ? m_surface.column * m_surface.step
+                                            : m_stock - m_surface.column * m_surface.step;
+                addText("G1");
+                addWord('X', x);
+            }
+            else if (m_surface.row + 1 < m_surface.rows) {
+                m_surface.row++;
+                m_surface.column = 0;
+                m_surface.direction = -m_surface.direction;
+                y = m_surface.row * m_surface.stepover;
+                addText("G1");
+                addWord('Y', y);
+            }
+            else {
+                addText("G0");
+                addWord('Z', SAFE_HEIGHT);
+                m_operationDone = true;
+                break;
+            }
+            addWord('Z', surfaceHeight(x, y));
+            if (m_surface.feed) {
+                addInteger('F', 2500);
+                m_surface.feed = false;
+            }
+            break;
+    }
+}
+
+// The offset contours shrink by the stepover, their corner radius with them
+void CorpusGenerator::pocketRingSize(int32_t ring, int32_t &a, int32_t &b,
+                                     int32_t &r) const
+{
+    int32_t offset = ring * m_pocket.stepover;
+    a = m_pocket.halfWidth - offset;
+    b = m_pocket.halfHeight - offset;
+    r = m_pocket.radius - offset;
+    r = r > 250 ? r : 250;
+    r = r < a ? r : a;
+    r = r < b ? r : b;
+}
+
+void CorpusGenerator::pocketRingStart(int32_t ring, int32_t &x, int32_t &y) const
+{
+    int32_t a, b, r;
+    pocketRingSize(ring, a, b, r);
+    x = m_pocket.centerX + a;
+    y = m_pocket.centerY - b + r;
+}
+
+// Rounded rectangles from the inside out, counter-clockwise, at every depth
+void CorpusGenerator::pocketingLine()
+{
+    int32_t x, y;
+    switch (m_phase) {
+        case 0:
+            addText("G0");
+            addWord('Z', SAFE_HEIGHT);
+            m_phase = 1;
+            break;
+        case 1:
+            pocketRingStart(m_pocket.ring, x, y);
+            addText("G0");
+            addWord('X', x);
+            addWord('Y', y);
+            m_phase = 2;
+            break;
+        case 2:
+            addText("G1");
+            addWord('Z', -1000 * m_pocket.level);
+            addInteger('F', 300);
+            m_pocket.segment = 0;
+            m_pocket.feed = true;
+            m_phase = 3;
+            break;
+        case 3: {
+            // Per segment: the sign of the end point relative to the center in units
+            // of the half size and of the radius, and of the arc center for I and J
+            static const int8_t endA[8] = {1, 1, -1, -1, -1, -1, 1, 1};
+            static const int8_t endRadiusX[8] = {0, -1, 1, 0, 0, 1, -1, 0};
+            static const int8_t endB[8] = {1, 1, 1, 1, -1, -1, -1, -1};
+            static const int8_t endRadiusY[8] = {-1, 0, 0, -1, 1, 0, 0, 1};
+            static const int8_t arcI[8] = {0, -1, 0, 0, 0, 1, 0, 0};
+            static const int8_t arcJ[8] = {0, 0, 0, -1, 0, 0, 0, 1};
+            int32_t a, b, r;
+            pocketRingSize(m_pocket.ring, a, b, r);
+            int32_t segment = m_pocket.segment;
+            bool arc = segment % 2 == 1;
+            addText(arc ? "G3" : "G1");
+            addWord('X', m_pocket.centerX + endA[segment] * a + endRadiusX[segment] * r);
+            addWord('Y', m_pocket.centerY + endB[segment] * b + endRadiusY[segment] * r);
+            if (arc) {
+                addWord('I', arcI[segment] * r);
+                addWord('J', arcJ[segment] * r);
+            }
+            if (m_pocket.feed) {
+                addInteger('F', 1200);
+                m_pocket.feed = false;
+            }
+            if (++m_pocket.segment < 8) {
+                break;
+            }
+            if (m_pocket.ring > 0) {
+                m_pocket.ring--;
+                m_phase = 4;
+            }
+            else if (m_pocket.level < m_pocket.levels) {
+                m_pocket.level++;
+                m_pocket.ring = m_pocket.rings - 1;
+                m_phase = 5;
+            }
+            else {
+                m_phase = 6;
+            }
+            break;
+        }
+        case 4: // To the next contour
+        case 5: // Back to the innermost contour, for the next depth
+            pocketRingStart(m_pocket.ring, x, y);
+            addText("G1");
+            addWord('X', x);
+            addWord('Y', y);
+            m_pocket.segment = 0;
+            m_phase = m_phase == 4 ? 3 : 2;
+            break;
+        default:
+            addText("G0");
+            addWord('Z', SAFE_HEIGHT);
+            m_operationDone = true;
+            break;
+    }
+}
+
+// Like G83: every peck retracts to the clearance height and rapids back down to
+// just above the bottom of the last one
+void CorpusGenerator::drillingLine()
+{
+    switch (m_phase) {
+        case 0:
+            addText("G0");
+            addWord('Z', SAFE_HEIGHT);
+            m_phase = 1;
+            break;
+        case 1:
+            addText("G0");
+            addWord('X', random(m_random, 4, m_stock / 500 - 4) * 500);
+            addWord('Y', random(m_random, 4, m_stock / 500 - 4) * 500);
+            m_phase = 2;
+            break;
+        case 2:
+            addText("G0");
+            addWord('Z', CLEARANCE);
+            m_drill.drilled = 0;
+            m_phase = 3;
+            break;
+        case 3:
+            m_drill.drilled += m_drill.peck;
+            if (m_drill.drilled > m_drill.depth) {
+                m_drill.drilled = m_drill.depth;
+            }
+            addText("G1");
+            addWord('Z', -m_drill.drilled);
+            addInteger('F', 120);
+            m_phase = 4;
+            break;
+        case 4:
+            addText("G0");
+            addWord('Z', CLEARANCE);
+            if (m_drill.drilled < m_drill.depth) {
+                m_phase = 5;
+            }
+            else {
+                m_drill.hole++;
+                m_phase = m_drill.hole < m_drill.holes ? 1 : 6;
+            }
+            break;
+        case 5:
+            addText("G0");
+            addWord('Z', -m_drill.drilled + 500);
+            m_phase = 3;
+            break;
+        default:
+            addText("G0");
+            addWord('Z', SAFE_HEIGHT);
+            m_operationDone = true;
+            break;
+    }
+}
+
+// Bidirectional rows of 0.1 mm pixels, one line per run of equal power
+void CorpusGenerator::rasterLine()
+{
+    int32_t y = m_raster.originY + m_raster.row * m_raster.pixel;
+    switch (m_phase) {
+        case 0:
+            addText("M4");
+            addInteger('S', 0);
+            m_phase = 1;
+            break;
+        case 1:
+            addText("G0");
+            addWord('X', m_raster.originX);
+            addWord('Y', y);
+            m_raster.feed = true;
+            m_phase = 2;
+            break;
+        case 2: {
+            int32_t run = random(m_random, 1, 20);
+            int32_t left = m_raster.columns - m_raster.column;
+            m_raster.column += run < left ? run : left;
+            int32_t offset = m_raster.column * m_raster.pixel;
+            if (m_raster.direction < 0) {
+                offset = (m_raster.columns - m_raster.column) * m_raster.pixel;
+            }
+            int32_t power = random(m_random, 0, 2) == 0 ? 0 : random(m_random, 1, 10);
+            addText("G1");
+            addWord('X', m_raster.originX + offset);
+            addInteger('S', power * 100);
+            if (m_raster.feed) {
+                addInteger('F', 3000);
+                m_raster.feed = false;
+            }
+            if (m_raster.column == m_raster.columns) {
+                m_raster.row++;
+                m_phase = m_raster.row < m_raster.rows ? 3 : 4;
+            }
+            break;
+        }
+        case 3:
+            m_raster.direction = -m_raster.direction;
+            m_raster.column = 0;
+            addText("G0");
+            addWord('Y', y);
+            m_phase = 2;
+            break;
+        default:
+            addText("M5");
+            m_operationDone = true;
+            break;
+    }
+}
+
+// A line of one of the usual mistakes, at a random position
+void CorpusGenerator::malformedLine()
+{
+    int32_t stock = static_cast<int32_t>(settings.stockSize * 1000.f);
+    int32_t x = random(m_malformedRandom, 0, stock);
+    int32_t y = random(m_malformedRandom, 0, stock);
+    switch (random(m_malformedRandom, 0, 6)) {
+        case 0: // Cut off
+            addText("G1");
+            addWord('X', x);
+            addText("Y");
+            break;
+        case 1: // Two decimal points
+            addText("G1");
+            addWord('X', x);
+            addWord('Y', y);
+            m_line[m_length - 2] = '.'; // E.g. Y45.6.8
+            break;
+        case 2: // Unknown letter
+            addText("G1");
+            addWord('X', x);
+            addWord('Q', y);
+            break;
+        case 3: // Canned cycle, not supported
+            addText("G81");
+            addWord('X', x);
+            addWord('Y', y);
+            addWord('Z', -3000);
+            addWord('R', CLEARANCE);
+            addInteger('F', 100);
+            break;
+        case 4: // Repeated word
+            addText("G1");
+            addWord('X', x);
+            addWord('X', y);
+            break;
+        case 5: // Conflicting motion modes
+            addText("G0 G1");
+            addWord('X', x);
+            break;
+        default: // Stray character
+            addText("G1");
+            addWord('X', x);
+            addWord('Y', y);
+            addText("@");
+            break;
+    }
+}
+
+#endif // !defined(ARDUINO)
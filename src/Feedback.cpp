@@ -0,0 +1,76 @@
+
+#include "GCGP/Feedback.h"
+
+FollowingErrorMonitor::FollowingErrorMonitor(const FollowingErrorSettings &settings)
+    : settings(settings)
+{
+    memset(&m_state, 0, sizeof(m_state));
+    memset(&m_published, 0, sizeof(m_published));
+}
+
+void FollowingErrorMonitor::publish(const float setPosition[GCGP_NUM_AXES],
+                                    const float actualPosition[GCGP_NUM_AXES])
+{
+    uint8_t peakResets = atomicLoadAcquire(&m_peakResetRequests);
+    if (peakResets != m_peakResetsDone) {
+        m_peakResetsDone = peakResets;
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            m_state.peakError[i] = 0.f;
+        }
+    }
+    uint8_t alarmClears = atomicLoadAcquire(&m_alarmClearRequests);
+    if (alarmClears != m_alarmClearsDone) {
+        m_alarmClearsDone = alarmClears;
+        m_state.alarmAxes = 0;
+    }
+
+    // Exponential average of the squared error, the first sample starts it
+    float weight = 1.f / (settings.rmsTimeConstant * settings.servoRate);
+    weight = m_state.samples == 0 || weight > 1.f ? 1.f : weight;
+
+    AxisBits exceeded = 0;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        float error = actualPosition[i] - setPosition[i];
+        float magnitude = fabsf(error);
+        m_state.setPosition[i] = setPosition[i];
+        m_state.actualPosition[i] = actualPosition[i];
+        m_state.error[i] = error;
+        float &meanSquare = m_state.meanSquareError[i];
+        meanSquare += weight * (error * error - meanSquare);
+        if (magnitude > m_state.peakError[i]) {
+            m_state.peakError[i] = magnitude;
+        }
+        if (magnitude > settings.maxError[i]) {
+            exceeded |= 1 << i;
+        }
+    }
+    AxisBits newAxes = exceeded & ~m_state.alarmAxes;
+    m_state.alarmAxes |= exceeded;
+    m_state.samples++;
+
+    m_lock.beginWrite();
+    m_published = m_state;
+    m_lock.endWrite();
+
+    if (newAxes && cbAlarm) {
+        cbAlarm(instance, newAxes);
+    }
+}
+
+bool FollowingErrorMonitor::snapshot(FeedbackSnapshot &snapshot) const
+{
+    m_lock.read(m_published, snapshot);
+    return snapshot.samples > 0;
+}
+
+void FollowingErrorMonitor::resetPeaks()
+{
+    atomicStoreRelease(&m_peakResetRequests,
+                       static_cast<uint8_t>(m_peakResetRequests + 1));
+}
+
+void FollowingErrorMonitor::clearAlarm()
+{
+    atomicStoreRelease(&m_alarmClearRequests,
+                       static_cast<uint8_t>(m_alarmClearRequests + 1));
+}
@@ -5,8 +5,8 @@ GCGP::GCGP(const SerialInterface& serialInterface) : m_grblInterface(serialInter
     
 }
 
-void GCGP::update() {
-    m_grblInterface.update();
+bool GCGP::update(const UpdateBudget& budget) {
+    return m_grblInterface.update(budget);
 }
 
 
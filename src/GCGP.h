@@ -14,7 +14,7 @@ class GCGP {
 public:
     GCGP(const SerialInterface& serialInterface);
 
-    void update();
+    bool update(const UpdateBudget& budget = UpdateBudget());
 
 private:
     GrblInterface m_grblInterface;
@@ -0,0 +1,69 @@
+#ifdef __cplusplus
+#ifndef GCGP_ARCLINEARIZER_H
+#define GCGP_ARCLINEARIZER_H
+
+#include "GCGP/Config.h"
+#include "GCGP/Move.h"
+
+/// @brief Splits an arc into straight segments for executors that only move linearly.
+/// @details The number of segments is chosen so that no chord deviates more than the
+///          tolerance from the arc. Instead of calling sin and cos for every segment,
+///          the radius vector is rotated by a constant rotation matrix, and the error
+///          that builds up is removed with an exact sin/cos every
+///          GCGP_ARC_ANGULAR_CORRECTION segments. The axes outside of the plane move
+///          linearly, which makes helical arcs. The last segment ends exactly on the
+///          target of the move.
+///
+///          Usage:
+///              ArcLinearizer arc;
+///              arc.begin(move, 0.002f);
+///              float point[GCGP_NUM_AXES];
+///              while (arc.next(point)) {
+///                  planner.addLinearMove(point, move.feedrate, false);
+///              }
+class ArcLinearizer {
+  public:
+    // Starts the segments of an arc move, with the chord tolerance in mm. It is at least
+    // GCGP_ARC_MIN_TOLERANCE.
+    void begin(const Move &move, float tolerance);
+
+    // Writes the end point of the next segment. Returns false when all are done.
+    bool next(float point[GCGP_NUM_AXES]);
+
+    bool isDone() const
+    {
+        return m_segment >= m_segmentCount;
+    }
+
+    uint32_t segmentCount() const
+    {
+        return m_segmentCount;
+    }
+
+    // Drops the remaining segments
+    void cancel()
+    {
+        m_segment = m_segmentCount;
+    }
+
+  private:
+    float m_start[GCGP_NUM_AXES];
+    float m_target[GCGP_NUM_AXES];
+    float m_increment[GCGP_NUM_AXES]; // Per segment, of the axes outside of the plane
+    int m_axis0 = 0;
+    int m_axis1 = 1;
+    float m_center[2];
+    float m_radius = 0.f;
+    float m_startAngle = 0.f;
+    float m_theta = 0.f; // rad, per segment
+    float m_cosTheta = 1.f;
+    float m_sinTheta = 0.f;
+    float m_r0 = 0.f; // Radius vector from the center
+    float m_r1 = 0.f;
+    uint32_t m_segment = 0;
+    uint32_t m_segmentCount = 0;
+    uint32_t m_correctionCountdown = 0;
+};
+
+#endif // GCGP_ARCLINEARIZER_H
+#endif // __cplusplus
@@ -0,0 +1,503 @@
+#ifdef __cplusplus
+#ifndef GCGP_ASYNC_H
+#define GCGP_ASYNC_H
+
+// Optional awaitable API for desktop hosts such as simulators, senders and test
+// benches. It needs C++20 coroutines and the standard library, so it is never part of
+// an embedded build and only available if the including target is compiled as C++20.
+#if !defined(ARDUINO) && defined(__cpp_impl_coroutine)
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "GCGP/GrblInterface.h"
+
+/// @brief Coroutine type for everything running on an AsyncEventLoop.
+/// @details Tasks are lazy: they start when they are spawned on a loop or awaited by
+///          another task. Awaiting a task resumes the awaiter once it has finished.
+class AsyncTask {
+  public:
+    struct promise_type {
+        std::coroutine_handle<> continuation;
+        std::exception_ptr exception;
+
+        AsyncTask get_return_object()
+        {
+            return AsyncTask(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        auto final_suspend() noexcept
+        {
+            struct FinalAwaiter {
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+                std::coroutine_handle<>
+                await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    if (handle.promise().continuation) {
+                        return handle.promise().continuation;
+                    }
+                    return std::noop_coroutine();
+                }
+                void await_resume() noexcept
+                {
+                }
+            };
+            return FinalAwaiter{};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            exception = std::current_exception();
+        }
+    };
+
+    AsyncTask() = default;
+    AsyncTask(const AsyncTask &) = delete;
+    AsyncTask &operator=(const AsyncTask &) = delete;
+    AsyncTask(AsyncTask &&other) noexcept : m_handle(std::exchange(other.m_handle, {}))
+    {
+    }
+    AsyncTask &operator=(AsyncTask &&other) noexcept
+    {
+        if (this != &other) {
+            destroy();
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    ~AsyncTask()
+    {
+        destroy();
+    }
+
+    bool done() const
+    {
+        return !m_handle || m_handle.done();
+    }
+
+    std::coroutine_handle<> handle() const
+    {
+        return m_handle;
+    }
+
+    // If the task ended with an exception, it is rethrown here
+    void rethrowIfFailed() const
+    {
+        if (m_handle && m_handle.promise().exception) {
+            std::rethrow_exception(m_handle.promise().exception);
+        }
+    }
+
+    bool await_ready() const noexcept
+    {
+        return done();
+    }
+
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept
+    {
+        m_handle.promise().continuation = awaiter;
+        return m_handle;
+    }
+
+    void await_resume() const
+    {
+        rethrowIfFailed();
+    }
+
+  private:
+    explicit AsyncTask(std::coroutine_handle<promise_type> handle) : m_handle(handle)
+    {
+    }
+
+    void destroy()
+    {
+        if (m_handle) {
+            m_handle.destroy();
+            m_handle = {};
+        }
+    }
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/// @brief Single-threaded run queue for AsyncTasks.
+/// @details Nothing is ever polled: a coroutine only gets back into the run queue when
+///          the event it waits for (data, a command, a signal) has happened. run()
+///          returns as soon as every task is either finished or waiting.
+class AsyncEventLoop {
+  public:
+    AsyncEventLoop() = default;
+    AsyncEventLoop(const AsyncEventLoop &) = delete;
+    AsyncEventLoop &operator=(const AsyncEventLoop &) = delete;
+
+    // The loop takes ownership of the task and starts it on the next run()
+    void spawn(AsyncTask task)
+    {
+        schedule(task.handle());
+        m_tasks.push_back(std::move(task));
+    }
+
+    void schedule(std::coroutine_handle<> handle)
+    {
+        m_ready.push_back(handle);
+    }
+
+    void run()
+    {
+        while (!m_ready.empty()) {
+            std::coroutine_handle<> handle = m_ready.front();
+            m_ready.pop_front();
+            handle.resume();
+        }
+        collectFinishedTasks();
+    }
+
+    size_t numberOfTasks() const
+    {
+        return m_tasks.size();
+    }
+
+  private:
+    void collectFinishedTasks()
+    {
+        std::exception_ptr exception;
+        size_t kept = 0;
+        for (size_t i = 0; i < m_tasks.size(); i++) {
+            if (!m_tasks[i].done()) {
+                m_tasks[kept++] = std::move(m_tasks[i]);
+                continue;
+            }
+            try {
+                m_tasks[i].rethrowIfFailed();
+            }
+            catch (...) {
+                exception = std::current_exception();
+            }
+        }
+        m_tasks.resize(kept);
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+    std::deque<std::coroutine_handle<>> m_ready;
+    std::vector<AsyncTask> m_tasks;
+};
+
+/// @brief Auto-reset event with a single waiter.
+/// @details signal() wakes the waiting coroutine, or is remembered until the next
+///          co_await if nobody is waiting yet.
+class AsyncEvent {
+  public:
+    explicit AsyncEvent(AsyncEventLoop &loop) : m_loop(loop)
+    {
+    }
+
+    void signal()
+    {
+        if (m_waiter) {
+            m_loop.schedule(std::exchange(m_waiter, {}));
+        }
+        else {
+            m_signaled = true;
+        }
+    }
+
+    bool await_ready() noexcept
+    {
+        return std::exchange(m_signaled, false);
+    }
+
+    void await_suspend(std::coroutine_handle<> waiter) noexcept
+    {
+        m_waiter = waiter;
+    }
+
+    void await_resume() noexcept
+    {
+    }
+
+  private:
+    AsyncEventLoop &m_loop;
+    std::coroutine_handle<> m_waiter;
+    bool m_signaled = false;
+};
+
+/// @brief Unbounded byte pipe between two coroutines, e.g. one direction of a serial
+///        link. Writing never suspends, reading can be awaited byte- or line-wise.
+class AsyncChannel {
+  public:
+    // If given, onWrite is signaled on every write in addition to a waiting reader
+    explicit AsyncChannel(AsyncEventLoop &loop, AsyncEvent *onWrite = nullptr)
+        : m_loop(loop), m_onWrite(onWrite)
+    {
+    }
+
+    void write(const char *str)
+    {
+        for (const char *c = str; *c != '\0'; c++) {
+            m_buffer.push_back(*c);
+            if (*c == '\n') {
+                m_numberOfLines++;
+            }
+        }
+        notify();
+    }
+
+    void write(char c)
+    {
+        m_buffer.push_back(c);
+        if (c == '\n') {
+            m_numberOfLines++;
+        }
+        notify();
+    }
+
+    int available() const
+    {
+        return static_cast<int>(m_buffer.size());
+    }
+
+    // Returns the next byte (0-255) like Arduino's Serial.peek(), or -1 if empty
+    int peek() const
+    {
+        if (m_buffer.empty()) {
+            return -1;
+        }
+        return static_cast<unsigned char>(m_buffer.front());
+    }
+
+    // Returns the next byte (0-255) like Arduino's Serial.read(), or -1 if empty
+    int read()
+    {
+        if (m_buffer.empty()) {
+            return -1;
+        }
+        char c = m_buffer.front();
+        m_buffer.pop_front();
+        if (c == '\n') {
+            m_numberOfLines--;
+        }
+        return static_cast<unsigned char>(c);
+    }
+
+    // co_await channel.readByte() -> char
+    auto readByte()
+    {
+        struct Awaiter {
+            AsyncChannel &channel;
+            bool await_ready() const noexcept
+            {
+                return !channel.m_buffer.empty();
+            }
+            void await_suspend(std::coroutine_handle<> waiter) noexcept
+            {
+                channel.m_waiter = waiter;
+                channel.m_waitingForLine = false;
+            }
+            char await_resume()
+            {
+                return static_cast<char>(channel.read());
+            }
+        };
+        return Awaiter{*this};
+    }
+
+    // co_await channel.readLine() -> std::string without the line ending
+    auto readLine()
+    {
+        struct Awaiter {
+            AsyncChannel &channel;
+            bool await_ready() const noexcept
+            {
+                return channel.m_numberOfLines > 0;
+            }
+            void await_suspend(std::coroutine_handle<> waiter) noexcept
+            {
+                channel.m_waiter = waiter;
+                channel.m_waitingForLine = true;
+            }
+            std::string await_resume()
+            {
+                std::string line;
+                int c = channel.read();
+                while (c != '\n') {
+                    if (c != '\r') {
+                        line.push_back(static_cast<char>(c));
+                    }
+                    c = channel.read();
+                }
+                return line;
+            }
+        };
+        return Awaiter{*this};
+    }
+
+  private:
+    void notify()
+    {
+        if (m_waiter && (!m_waitingForLine || m_numberOfLines > 0)) {
+            m_loop.schedule(std::exchange(m_waiter, {}));
+        }
+        if (m_onWrite != nullptr) {
+            m_onWrite->signal();
+        }
+    }
+
+    AsyncEventLoop &m_loop;
+    AsyncEvent *m_onWrite = nullptr;
+    std::deque<char> m_buffer;
+    size_t m_numberOfLines = 0;
+    std::coroutine_handle<> m_waiter;
+    bool m_waitingForLine = false;
+};
+
+/// @brief Awaitable front-end for a GrblInterface.
+/// @details Instead of calling update() in a loop and reacting to callbacks, the
+///          application awaits nextCommand(). The interface only parses when new
+///          bytes arrived or a queued command was taken, and it reports its buffer
+///          as full once `bufferCapacity` commands are waiting, which gives the host
+///          the same flow control as a full planner buffer on the real machine.
+///          The serial link is a pair of AsyncChannels, named from the controller's
+///          point of view: the host writes into rx() and reads the responses from
+///          tx(). Only one coroutine may await nextCommand() at a time.
+class AsyncGrblInterface {
+  public:
+    AsyncGrblInterface(AsyncEventLoop &loop, size_t bufferCapacity = 16)
+        : m_loop(loop), m_wake(loop), m_rx(loop, &m_wake), m_tx(loop),
+          m_grbl(SerialInterface(this, serialAvailable, serialPeek, serialRead,
+                                 serialWrite),
+                 this),
+          m_bufferCapacity(bufferCapacity)
+    {
+        m_grbl.cbBufferIsFull = [](void *instance) {
+            AsyncGrblInterface *self = static_cast<AsyncGrblInterface *>(instance);
+            return self->m_commands.size() >= self->m_bufferCapacity;
+        };
+        m_grbl.cbProcessCommand = [](void *instance, Command<10> *command) {
+            static_cast<AsyncGrblInterface *>(instance)->pushCommand(*command);
+        };
+        loop.spawn(pump());
+    }
+
+    AsyncGrblInterface(const AsyncGrblInterface &) = delete;
+    AsyncGrblInterface &operator=(const AsyncGrblInterface &) = delete;
+
+    // co_await interface.nextCommand() -> Command<10>
+    auto nextCommand()
+    {
+        struct Awaiter {
+            AsyncGrblInterface &self;
+            bool await_ready() const noexcept
+            {
+                return !self.m_commands.empty();
+            }
+            void await_suspend(std::coroutine_handle<> waiter) noexcept
+            {
+                self.m_commandWaiter = waiter;
+            }
+            Command<10> await_resume()
+            {
+                Command<10> command = self.m_commands.front();
+                self.m_commands.pop_front();
+                self.m_wake.signal(); // There is room again, continue parsing
+                return command;
+            }
+        };
+        return Awaiter{*this};
+    }
+
+    // Host -> controller
+    AsyncChannel &rx()
+    {
+        return m_rx;
+    }
+
+    // Controller -> host
+    AsyncChannel &tx()
+    {
+        return m_tx;
+    }
+
+    // The wrapped interface, e.g. to register the remaining callbacks. cbBufferIsFull
+    // and cbProcessCommand are owned by this class and must not be replaced.
+    GrblInterface &grbl()
+    {
+        return m_grbl;
+    }
+
+    size_t numberOfQueuedCommands() const
+    {
+        return m_commands.size();
+    }
+
+  private:
+    AsyncTask pump()
+    {
+        while (true) {
+            // update() takes at most GCGP_RX_BUFFER_SIZE bytes, so it runs until the
+            // channel is empty or the commands fill the buffer
+            do {
+                m_grbl.update();
+            } while (m_rx.available() > 0 && m_commands.size() < m_bufferCapacity);
+            co_await m_wake; // New bytes or a free buffer slot
+        }
+    }
+
+    void pushCommand(const Command<10> &command)
+    {
+        m_commands.push_back(command);
+        if (m_commandWaiter) {
+            m_loop.schedule(std::exchange(m_commandWaiter, {}));
+        }
+    }
+
+    static int serialAvailable(void *instance)
+    {
+        return static_cast<AsyncGrblInterface *>(instance)->m_rx.available();
+    }
+
+    static int serialPeek(void *instance)
+    {
+        return static_cast<AsyncGrblInterface *>(instance)->m_rx.peek();
+    }
+
+    static int serialRead(void *instance)
+    {
+        return static_cast<AsyncGrblInterface *>(instance)->m_rx.read();
+    }
+
+    static void serialWrite(void *instance, const char *str)
+    {
+        static_cast<AsyncGrblInterface *>(instance)->m_tx.write(str);
+    }
+
+    AsyncEventLoop &m_loop;
+    AsyncEvent m_wake;
+    AsyncChannel m_rx;
+    AsyncChannel m_tx;
+    GrblInterface m_grbl;
+    size_t m_bufferCapacity;
+    std::deque<Command<10>> m_commands;
+    std::coroutine_handle<> m_commandWaiter;
+};
+
+#endif // !defined(ARDUINO) && defined(__cpp_impl_coroutine)
+#endif // GCGP_ASYNC_H
+#endif // __cplusplus
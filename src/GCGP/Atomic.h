@@ -0,0 +1,118 @@
+#ifdef __cplusplus
+#ifndef GCGP_ATOMIC_H
+#define GCGP_ATOMIC_H
+
+#include "GCGP/Config.h"
+
+// Acquire/release access to values that are shared between an interrupt (or another
+// thread) and the main loop. Only use them for types the target can load and store
+// in one instruction, e.g. uint8_t on AVR or uint32_t on ARM.
+#if defined(__GNUC__) || defined(__clang__)
+
+template <typename T> static inline T atomicLoadAcquire(const T *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+template <typename T> static inline void atomicStoreRelease(T *value, T newValue)
+{
+    __atomic_store_n(value, newValue, __ATOMIC_RELEASE);
+}
+
+// Keeps the loads before it from moving after the loads and stores behind it
+static inline void atomicFenceAcquire()
+{
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+}
+
+// Keeps the loads and stores before it from moving after the stores behind it
+static inline void atomicFenceRelease()
+{
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+#else // MSVC: volatile accesses are not reordered by the compiler, the fences order
+      // them for the CPU
+
+#include <atomic>
+
+template <typename T> static inline T atomicLoadAcquire(const T *value)
+{
+    T result = *static_cast<const volatile T *>(value);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return result;
+}
+
+template <typename T> static inline void atomicStoreRelease(T *value, T newValue)
+{
+    std::atomic_thread_fence(std::memory_order_release);
+    *static_cast<volatile T *>(value) = newValue;
+}
+
+static inline void atomicFenceAcquire()
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+}
+
+static inline void atomicFenceRelease()
+{
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+#endif
+
+/// @brief Sequence counter that guards a value with one writer and any number of
+///        readers, without ever blocking the writer.
+/// @details The writer changes the value between beginWrite() and endWrite(), which
+///          make the counter odd and then even again. read() copies the value and
+///          copies it again if a write overlapped. A reader must not interrupt the
+///          writer: it would wait for a write that cannot finish. The counter is as
+///          wide as the target stores atomically. A reader that is held up during its
+///          copy until the counter wraps, after 128 writes on AVR and 2^31 elsewhere,
+///          takes a torn copy for a consistent one.
+///
+///          Usage:
+///              lock.beginWrite();
+///              m_published = m_state;
+///              lock.endWrite();
+///              lock.read(m_published, snapshot); // Another thread or core
+class SequenceLock {
+  public:
+#ifdef __AVR__
+    typedef uint8_t Sequence;
+#else
+    typedef uint32_t Sequence;
+#endif
+
+    void beginWrite()
+    {
+        atomicStoreRelease(&m_sequence, static_cast<Sequence>(m_sequence + 1));
+        atomicFenceRelease();
+    }
+
+    void endWrite()
+    {
+        atomicStoreRelease(&m_sequence, static_cast<Sequence>(m_sequence + 1));
+    }
+
+    template <typename T> void read(const T &value, T &copy) const
+    {
+        for (;;) {
+            Sequence before = atomicLoadAcquire(&m_sequence);
+            if (before & 1) {
+                continue; // On another core, the writer is writing right now
+            }
+            copy = value;
+            atomicFenceAcquire();
+            if (atomicLoadAcquire(&m_sequence) == before) {
+                return;
+            }
+        }
+    }
+
+  private:
+    Sequence m_sequence = 0; // Odd while the value is written
+};
+
+#endif // GCGP_ATOMIC_H
+#endif // __cplusplus
@@ -0,0 +1,25 @@
+#ifdef __cplusplus
+#ifndef GCGP_CLOCK_H
+#define GCGP_CLOCK_H
+
+#include "GCGP/Config.h"
+
+// Microseconds for budgets and latencies. The clock may wrap around, so only the
+// differences of two readings in uint32_t are meaningful.
+#ifndef GCGP_CLOCK_US
+#ifdef ARDUINO
+#define GCGP_CLOCK_US() micros()
+#else
+uint32_t clockMicroseconds();
+#define GCGP_CLOCK_US() clockMicroseconds()
+#endif
+#endif
+
+// Whether the reading a is at or after b, across a wrap of the clock
+inline bool clockReached(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b) >= 0;
+}
+
+#endif // GCGP_CLOCK_H
+#endif // __cplusplus
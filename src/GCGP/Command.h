@@ -7,22 +7,26 @@
 #include "GCGP/Enums.h"
 #include "GCGP/Serial.h"
 #include "GCGP/String.h"
+#include "GCGP/Trace.h"
 #include "GCGP/tokenize.h"
 
-#define PRINT_FLOAT(name, text, ...)                                                     \
+#define PRINT_FLOAT(name, ...)                                                           \
     if (!isnan(name)) {                                                                  \
         char buffer[64];                                                                 \
-        snprintf(buffer, sizeof(buffer), text, __VA_ARGS__);                             \
+        snprintf(buffer, sizeof(buffer), __VA_ARGS__);                                   \
         serial.println(buffer);                                                          \
     }
-#define PRINT_BOOL(name, text, ...)                                                      \
+#define PRINT_BOOL(name, ...)                                                            \
     if (name) {                                                                          \
         char buffer[64];                                                                 \
-        snprintf(buffer, sizeof(buffer), text, __VA_ARGS__);                             \
+        snprintf(buffer, sizeof(buffer), __VA_ARGS__);                                   \
         serial.println(buffer);                                                          \
     }
 
-template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
+template <size_t capacity, int axes = GCGP_NUM_AXES>
+class Command { // https://linuxcnc.org/docs/html/
+    static_assert(axes >= 3 && axes <= 9, "Axes are X, Y, Z and up to A, B, C, U, V, W");
+
   public:
     // All actions are declared in the order they must be executed.
     FeedrateMode feedrateMode = FeedrateMode::None; // G93, G94, G95
@@ -39,10 +43,12 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
     ArcPlaneMode arcPlaneMode = ArcPlaneMode::None; // G17, G18, G19
     LengthUnits lengthUnits = LengthUnits::None;    // G20, G21
     // CutterRadiusCompMode cutterRadiusCompMode = CutterRadiusCompMode::None; G41, G42
-    // not supported, G40 is ignored CutterLengthCompMode cutterLengthCompMode =
-    // CutterLengthCompMode::None;            // G43, G49 not supported CoordinateSystem
-    // // G54-G59.3 not supported PathBlending G61.1, G64 not supported, G61 is ignored
-    DistanceMode distanceMode = DistanceMode::None; // G90, G91
+    // not supported, G40 is ignored
+    ToolLengthOffsetAction toolLengthOffsetAction =
+        ToolLengthOffsetAction::None; // G43.1, G49 (G43 with a tool table not supported)
+    int workCoordinateSystem = -1;    // G54-G59.3 -> 0 to 8
+    PathControlMode pathControlMode = PathControlMode::None; // G61, G61.1, G64
+    DistanceMode distanceMode = DistanceMode::None;          // G90, G91
     // RetractMode G98, G99 not supported
     ReferencePositionAction referencePositionAction =
         ReferencePositionAction::None; // G28, G28.1, G30, G30.1
@@ -59,28 +65,73 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
     int toolNumber = -1;
     int coordinateSystem = -1;
     float dwellTime = NAN;
-    float posX = NAN;
-    float posY = NAN;
-    float posZ = NAN;
+    float pathTolerance = NAN; // P of G64
+    float pos[axes]; // In the order of GCGP_AXIS_LETTERS, NAN if not given
     float arcI = NAN;
     float arcJ = NAN;
     float arcK = NAN;
+    bool machineCoordinates = false; // G53 (non-modal, only with G0, G1 and jogging)
     bool isGCode = false;
     bool isMCode = false;
+    bool isJog = false; // $J=<G20|G21|G53|G90|G91|axis words|F>, motionType is Feed
 
     bool isSystemCommand = false;
     SystemCommand systemCommand;
 
-    Command() = default;
+    Command()
+    {
+        for (int i = 0; i < axes; i++) {
+            pos[i] = NAN;
+        }
+    }
+
+    bool hasAxisWords() const
+    {
+        for (int i = 0; i < axes; i++) {
+            if (!isnan(pos[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
 
     GrblError parse(const char *str, size_t strLength)
     {
         *this = {};
         CommandTokens<capacity> tokens;
+        GCGP_TRACE_BEGIN(Tokenize);
         GrblError result = tokenizeCommand(tokens, str, strLength);
+        GCGP_TRACE_END(Tokenize, result);
         if (result != GrblError::None) {
             return result;
         }
+        GCGP_TRACE_BEGIN(Interpret);
+        result = interpret(tokens);
+        GCGP_TRACE_END(Interpret, result);
+        if (result != GrblError::None) {
+            return result;
+        }
+        GCGP_TRACE_BEGIN(Validate);
+        result = validate();
+        GCGP_TRACE_END(Validate, result);
+        return result;
+    }
+
+    // The steps of parse() after tokenizeCommand(), separate so they can be profiled
+    // one by one. interpret() expects a command that was reset with *this = {}.
+    GrblError interpret(const CommandTokens<capacity> &tokens)
+    {
+        // A command is a system command if it has a system letter or index
+        isSystemCommand =
+            tokens.systemCommand.letter != '\0' || tokens.systemCommand.index != -1;
+        systemCommand = tokens.systemCommand;
+        if (isSystemCommand && systemCommand.letter == 'J') {
+            GrblError result = validateJogTokens(tokens);
+            if (result != GrblError::None) {
+                return result;
+            }
+            isJog = true;
+        }
 
         bool G10 = false;
         int G10LNumber = -1;
@@ -191,8 +242,63 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
                         referencePositionAction =
                             ReferencePositionAction::SetPrimaryReferencePosition;
                     }
-                    else if (value == 54.f) { // G54 (Use coordinate system)
-                                              // Not implemented
+                    else if (value == 53.f) { // G53 (Move in machine coordinates)
+                        if (machineCoordinates) {
+                            return GrblError::GCodeMultipleModalCommandsInOneBlock;
+                        }
+                        machineCoordinates = true;
+                    }
+                    else if (value >= 54.f && value <= 59.3f) { // G54-G59.3 (Select WCS)
+                        int system = -1;
+                        if (value == floorf(value)) { // G54-G59
+                            system = static_cast<int>(value) - 54;
+                        }
+                        else if (value == 59.1f) {
+                            system = 6;
+                        }
+                        else if (value == 59.2f) {
+                            system = 7;
+                        }
+                        else if (value == 59.3f) {
+                            system = 8;
+                        }
+                        if (system < 0) {
+                            return GrblError::GCodeUnsupportedGCommand;
+                        }
+                        if (workCoordinateSystem != -1) {
+                            return GrblError::GCodeMultipleModalCommandsInOneBlock;
+                        }
+                        workCoordinateSystem = system;
+                    }
+                    else if (value == 43.1f) { // G43.1 (Dynamic tool length offset)
+                        if (toolLengthOffsetAction != ToolLengthOffsetAction::None) {
+                            return GrblError::GCodeMultipleModalCommandsInOneBlock;
+                        }
+                        toolLengthOffsetAction = ToolLengthOffsetAction::SetDynamic;
+                    }
+                    else if (value == 49.f) { // G49 (Cancel tool length offset)
+                        if (toolLengthOffsetAction != ToolLengthOffsetAction::None) {
+                            return GrblError::GCodeMultipleModalCommandsInOneBlock;
+                        }
+                        toolLengthOffsetAction = ToolLengthOffsetAction::Cancel;
+                    }
+                    else if (value == 61.f) { // G61 (Exact path mode)
+                        if (pathControlMode != PathControlMode::None) {
+                            return GrblError::GCodeMultipleModalCommandsInOneBlock;
+                        }
+                        pathControlMode = PathControlMode::ExactPath;
+                    }
+                    else if (value == 61.1f) { // G61.1 (Exact stop mode)
+                        if (pathControlMode != PathControlMode::None) {
+                            return GrblError::GCodeMultipleModalCommandsInOneBlock;
+                        }
+                        pathControlMode = PathControlMode::ExactStop;
+                    }
+                    else if (value == 64.f) { // G64 (Path blending)
+                        if (pathControlMode != PathControlMode::None) {
+                            return GrblError::GCodeMultipleModalCommandsInOneBlock;
+                        }
+                        pathControlMode = PathControlMode::Blending;
                     }
                     else if (value == 90.f) { // G90 (Absolute distance)
                         if (distanceMode != DistanceMode::None) {
@@ -343,25 +449,24 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
                     break;
 
                 case 'X':
-                    if (!isnan(posX)) {
-                        return GrblError::GCodeMultiplyDefinedParameters;
-                    }
-                    posX = value;
-                    break;
-
                 case 'Y':
-                    if (!isnan(posY)) {
-                        return GrblError::GCodeMultiplyDefinedParameters;
-                    }
-                    posY = value;
-                    break;
-
                 case 'Z':
-                    if (!isnan(posZ)) {
+                case 'A':
+                case 'B':
+                case 'C':
+                case 'U':
+                case 'V':
+                case 'W': {
+                    int axis = axisIndex(letter);
+                    if (axis < 0) {
+                        return GrblError::GCodeUnsupportedCommand;
+                    }
+                    if (!isnan(pos[axis])) {
                         return GrblError::GCodeMultiplyDefinedParameters;
                     }
-                    posZ = value;
+                    pos[axis] = value;
                     break;
+                }
 
                 case 'I':
                     if (!isnan(arcI)) {
@@ -419,11 +524,17 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
                     }
                     else {
                         if (dwell) {
-                            if (dwellTime) {
+                            if (!isnan(dwellTime)) {
                                 return GrblError::GCodeMultiplyDefinedParameters;
                             }
                             dwellTime = value;
                         }
+                        else if (pathControlMode == PathControlMode::Blending) {
+                            if (!isnan(pathTolerance)) {
+                                return GrblError::GCodeMultiplyDefinedParameters;
+                            }
+                            pathTolerance = value;
+                        }
                         else {
                             return GrblError::GCodeLonelyParameter;
                         }
@@ -473,7 +584,26 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
             }
         }
 
-        if (motionType != MotionType::None && isnan(posX) && isnan(posY) && isnan(posZ)) {
+        // Jogging is a linear move at the given feedrate
+        if (isJog) {
+            motionType = MotionType::Feed;
+            if (isnan(setFeedrate)) {
+                return GrblError::FeedRateHasNotYetBeenSetOrIsNone;
+            }
+        }
+        return GrblError::None;
+    }
+
+    // The checks across words, once all of them are interpreted
+    GrblError validate() const
+    {
+        if (machineCoordinates && motionType != MotionType::Rapid &&
+            motionType != MotionType::Feed) {
+            return GrblError::G53OnlyValidWithG0AndG1MotionModes;
+        }
+
+        bool hasAxisWords = this->hasAxisWords();
+        if (motionType != MotionType::None && !hasAxisWords) {
             return GrblError::NoAxisWordsFoundInCommandBlock;
         }
         if ((motionType == MotionType::ArcCW || motionType == MotionType::ArcCCW)) {
@@ -482,10 +612,29 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
             }
         }
 
-        if (motionType == MotionType::None &&
-            (!isnan(posX) || !isnan(posY) || !isnan(posZ))) {
+        // Axis words are used by motions, and by the commands that take a position
+        bool setsPosition = axisOffsetAction == AxisOffsetAction::SetAxisOffset ||
+                            toolLengthOffsetAction == ToolLengthOffsetAction::SetDynamic;
+        bool usesAxisWords =
+            motionType != MotionType::None || setsPosition ||
+            offsetAction != SetOffsetAction::None ||
+            referencePositionAction ==
+                ReferencePositionAction::GoToPrimaryReferencePosition ||
+            referencePositionAction ==
+                ReferencePositionAction::GoToSecondaryReferencePosition;
+        if (!usesAxisWords && hasAxisWords) {
             return GrblError::UnneededAxisWordsFoundInBlock;
         }
+        if (setsPosition && !hasAxisWords) {
+            return GrblError::NoAxisWordsFoundInCommandBlock;
+        }
+        if (toolLengthOffsetAction == ToolLengthOffsetAction::SetDynamic) {
+            for (int i = 0; i < axes; i++) {
+                if (i != 2 && !isnan(pos[i])) { // Only Z
+                    return GrblError::G431OffsetNotAssignedToToolLengthAxis;
+                }
+            }
+        }
         if (motionType != MotionType::ArcCW && motionType != MotionType::ArcCCW &&
             (!isnan(arcI) || !isnan(arcJ) || !isnan(arcK))) {
             return GrblError::UnneededAxisWordsFoundInBlock;
@@ -498,6 +647,9 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
         if (dwell && dwellTime < 0) {
             return GrblError::GCodeDwellTimeInvalid;
         }
+        if (pathTolerance < 0) {
+            return GrblError::GCodeNegativeValueNotAllowed;
+        }
 
         return GrblError::None;
     }
@@ -591,6 +743,40 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
                 break;
         }
 
+        switch (toolLengthOffsetAction) {
+            case ToolLengthOffsetAction::SetDynamic:
+                serial.println(" - Set Tool length offset");
+                break;
+            case ToolLengthOffsetAction::Cancel:
+                serial.println(" - Cancel Tool length offset");
+                break;
+            default:
+                break;
+        }
+
+        if (workCoordinateSystem >= 0) {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), " - Select Work coordinate system %d",
+                     workCoordinateSystem + 1);
+            serial.println(buffer);
+        }
+
+        switch (pathControlMode) {
+            case PathControlMode::ExactPath:
+                serial.println(" - Set Path Control Mode to Exact Path");
+                break;
+            case PathControlMode::ExactStop:
+                serial.println(" - Set Path Control Mode to Exact Stop");
+                break;
+            case PathControlMode::Blending:
+                serial.println(" - Set Path Control Mode to Blending");
+                PRINT_FLOAT(pathTolerance, " - Set Path Tolerance to %f",
+                            pathTolerance);
+                break;
+            default:
+                break;
+        }
+
         switch (referencePositionAction) {
             case ReferencePositionAction::SetPrimaryReferencePosition:
                 serial.println(" - Set Refpos Action to Primary Reference Position");
@@ -659,6 +845,9 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
                 break;
         }
 
+        PRINT_BOOL(isJog, " - Jog");
+        PRINT_BOOL(machineCoordinates, " - Use machine coordinates");
+
         switch (stopAction) {
             case StopAction::Pause:
                 serial.println(" - Pause the program");
@@ -673,9 +862,9 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
                 break;
         }
 
-        PRINT_FLOAT(posX, "-> Parameter X=%f", posX);
-        PRINT_FLOAT(posY, "-> Parameter Y=%f", posY);
-        PRINT_FLOAT(posZ, "-> Parameter Z=%f", posZ);
+        for (int i = 0; i < axes; i++) {
+            PRINT_FLOAT(pos[i], "-> Parameter %c=%f", GCGP_AXIS_LETTERS[i], pos[i]);
+        }
         PRINT_FLOAT(arcI, "-> Parameter I=%f", arcI);
         PRINT_FLOAT(arcJ, "-> Parameter J=%f", arcJ);
         PRINT_FLOAT(arcK, "-> Parameter K=%f", arcK);
@@ -688,6 +877,49 @@ template <size_t capacity> class Command { // https://linuxcnc.org/docs/html/
             PRINT_BOOL(true, " - Value letter: %c", systemCommand.valueLetter);
         }
     }
+
+  private:
+    // Index of an axis letter, or -1 if this command has no such axis
+    static int axisIndex(char letter)
+    {
+        const char *letters = GCGP_AXIS_LETTERS;
+        for (int i = 0; i < axes; i++) {
+            if (letters[i] == letter) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // '$J=' only allows G20, G21, G53, G90, G91, axis words and F, and needs at least
+    // one of them after the '='
+    static GrblError validateJogTokens(const CommandTokens<capacity> &tokens)
+    {
+        if (tokens.numberOfValidTokens == 0) {
+            return GrblError::JogCmdMissingOrHasProhibitedGCode;
+        }
+        for (size_t i = 0; i < tokens.numberOfValidTokens; i++) {
+            float value = tokens.tokens[i].value;
+            switch (tokens.tokens[i].type) {
+                case 'G':
+                    if (value != 20.f && value != 21.f && value != 53.f && value != 90.f &&
+                        value != 91.f) {
+                        return GrblError::JogCmdMissingOrHasProhibitedGCode;
+                    }
+                    break;
+
+                case 'F':
+                    break;
+
+                default:
+                    if (axisIndex(tokens.tokens[i].type) < 0) {
+                        return GrblError::JogCmdMissingOrHasProhibitedGCode;
+                    }
+                    break;
+            }
+        }
+        return GrblError::None;
+    }
 };
 
 #endif // GCGP_COMMAND_H
@@ -8,6 +8,7 @@
 #include <string.h>
 #include <cstring>
 #include <cmath>
+#include <math.h>
 #include <cstdio>
 #include <cinttypes>
 #endif
@@ -16,6 +17,102 @@
 #define GCGP_MAX_COMMAND_LENGTH 80
 #endif
 
+// Bytes received but not yet parsed into a line. Hosts using GRBL's character
+// counting protocol never have more than 128 bytes unacknowledged, so with at least
+// that size every real-time command is seen as soon as it arrives.
+#ifndef GCGP_RX_BUFFER_SIZE
+#define GCGP_RX_BUFFER_SIZE 128
+#endif
+
+// Bytes read from the serial interface at once, on the stack
+#ifndef GCGP_RX_CHUNK_SIZE
+#define GCGP_RX_CHUNK_SIZE 16
+#endif
+
+// Number of axes of Command and the motion modules. They are X, Y and Z, then A, B, C,
+// U, V and W, in this order. Words of the axes beyond this are unsupported.
+#ifndef GCGP_NUM_AXES
+#define GCGP_NUM_AXES 3
+#endif
+#define GCGP_AXIS_LETTERS "XYZABCUVW"
+
+static_assert(GCGP_NUM_AXES >= 3 && GCGP_NUM_AXES <= 9, "GCGP_NUM_AXES must be 3 to 9");
+
+// A bit per axis, e.g. step or direction bits. One byte is enough up to 8 axes.
+#if GCGP_NUM_AXES <= 8
+typedef uint8_t AxisBits;
+#else
+typedef uint16_t AxisBits;
+#endif
+
+// Work coordinate systems G54 to G59, up to 9 with G59.1 to G59.3
+#ifndef GCGP_NUM_WORK_COORDINATE_SYSTEMS
+#define GCGP_NUM_WORK_COORDINATE_SYSTEMS 6
+#endif
+
+// Number of linear moves the planner can look ahead. Each block takes 64 bytes.
+#ifndef GCGP_PLANNER_BUFFER_SIZE
+#define GCGP_PLANNER_BUFFER_SIZE 16
+#endif
+
+// Number of moves queued for the setpoint generator, must be a power of two
+#ifndef GCGP_SETPOINT_BUFFER_SIZE
+#define GCGP_SETPOINT_BUFFER_SIZE 4
+#endif
+
+// Number of step segments queued for the step interrupt, must be a power of two
+#ifndef GCGP_STEP_SEGMENT_BUFFER_SIZE
+#define GCGP_STEP_SEGMENT_BUFFER_SIZE 8
+#endif
+
+// Arc segments between exact sin/cos corrections of the incremental rotation, like
+// GRBL's N_ARC_CORRECTION
+#ifndef GCGP_ARC_ANGULAR_CORRECTION
+#define GCGP_ARC_ANGULAR_CORRECTION 12
+#endif
+
+// Smallest chord tolerance of ArcLinearizer in mm, smaller ones, 0 included, are raised
+// to it so that the number of segments stays finite
+#ifndef GCGP_ARC_MIN_TOLERANCE
+#define GCGP_ARC_MIN_TOLERANCE 0.0001f
+#endif
+
+// Tracepoints of the stages every line goes through, see Trace.h. Without them, the
+// tracepoints are not compiled in at all.
+#ifndef GCGP_ENABLE_TRACE
+#define GCGP_ENABLE_TRACE 0
+#endif
+
+// Records the trace keeps, the latest ones. Each takes 8 bytes on a controller with
+// 32-bit timestamps.
+#ifndef GCGP_TRACE_BUFFER_SIZE
+#define GCGP_TRACE_BUFFER_SIZE 256
+#endif
+
+// Counters and latency histograms of GrblInterface, see Metrics.h. They take about
+// 450 bytes and a clock reading per line, so they are off unless enabled. Like
+// GCGP_ENABLE_TRACE, it changes the layout of GrblInterface: set it for the library
+// and all its users alike, e.g. with the CMake option GCGP_ENABLE_METRICS.
+#ifndef GCGP_ENABLE_METRICS
+#define GCGP_ENABLE_METRICS 0
+#endif
+
+// Buckets of each latency histogram, doubling in width. The last one holds all from
+// 2^(buckets - 2) us, about 4 s with 24.
+#ifndef GCGP_METRICS_HISTOGRAM_BUCKETS
+#define GCGP_METRICS_HISTOGRAM_BUCKETS 24
+#endif
+
+// Error codes that are counted each on their own
+#ifndef GCGP_METRICS_ERROR_CODES
+#define GCGP_METRICS_ERROR_CODES 8
+#endif
+
+// Tasks a Scheduler can run, see Scheduler.h
+#ifndef GCGP_SCHEDULER_MAX_TASKS
+#define GCGP_SCHEDULER_MAX_TASKS 8
+#endif
+
 #ifndef GCGP_MAX_NUM_OF_CMD_TOKENS
 #define GCGP_MAX_NUM_OF_CMD_TOKENS 10
 #endif
@@ -28,6 +125,36 @@
 #define GCGP_MAX_SETTINGS_DESCRIPTION_LENGTH 32
 #endif
 
+#ifndef GCGP_DEFAULT_FEED_OVERRIDE
+#define GCGP_DEFAULT_FEED_OVERRIDE 100 // Percent, like all override values
+#endif
+
+#ifndef GCGP_MIN_FEED_OVERRIDE
+#define GCGP_MIN_FEED_OVERRIDE 10
+#endif
+
+#ifndef GCGP_MAX_FEED_OVERRIDE
+#define GCGP_MAX_FEED_OVERRIDE 200
+#endif
+
+#ifndef GCGP_DEFAULT_SPINDLE_OVERRIDE
+#define GCGP_DEFAULT_SPINDLE_OVERRIDE 100
+#endif
+
+#ifndef GCGP_MIN_SPINDLE_OVERRIDE
+#define GCGP_MIN_SPINDLE_OVERRIDE 10
+#endif
+
+#ifndef GCGP_MAX_SPINDLE_OVERRIDE
+#define GCGP_MAX_SPINDLE_OVERRIDE 200
+#endif
+
+#define GCGP_OVERRIDE_COARSE_INCREMENT 10
+#define GCGP_OVERRIDE_FINE_INCREMENT 1
+#define GCGP_DEFAULT_RAPID_OVERRIDE 100
+#define GCGP_RAPID_OVERRIDE_MEDIUM 50
+#define GCGP_RAPID_OVERRIDE_LOW 25
+
 #define GCGP_WELCOME_MESSAGE "GCGP v0.1 - pretending to be Grbl 1.1h [$ help]"
 #define GCGP_OK_MESSAGE "ok"
 #define GCGP_ERROR_MESSAGE "error:"
@@ -36,6 +163,24 @@
 #define GCGP_CMD_FEED_HOLD '!'
 #define GCGP_CMD_SOFT_RESET '\x18'
 #define GCGP_CMD_STATUS_REPORT '?'
+#define GCGP_CMD_SAFETY_DOOR '\x84'
+#define GCGP_CMD_JOG_CANCEL '\x85'
+#define GCGP_CMD_FEED_OVR_RESET '\x90'
+#define GCGP_CMD_FEED_OVR_COARSE_PLUS '\x91'
+#define GCGP_CMD_FEED_OVR_COARSE_MINUS '\x92'
+#define GCGP_CMD_FEED_OVR_FINE_PLUS '\x93'
+#define GCGP_CMD_FEED_OVR_FINE_MINUS '\x94'
+#define GCGP_CMD_RAPID_OVR_RESET '\x95'
+#define GCGP_CMD_RAPID_OVR_MEDIUM '\x96'
+#define GCGP_CMD_RAPID_OVR_LOW '\x97'
+#define GCGP_CMD_SPINDLE_OVR_RESET '\x99'
+#define GCGP_CMD_SPINDLE_OVR_COARSE_PLUS '\x9A'
+#define GCGP_CMD_SPINDLE_OVR_COARSE_MINUS '\x9B'
+#define GCGP_CMD_SPINDLE_OVR_FINE_PLUS '\x9C'
+#define GCGP_CMD_SPINDLE_OVR_FINE_MINUS '\x9D'
+#define GCGP_CMD_SPINDLE_OVR_STOP '\x9E'
+#define GCGP_CMD_COOLANT_FLOOD_OVR_TOGGLE '\xA0'
+#define GCGP_CMD_COOLANT_MIST_OVR_TOGGLE '\xA1'
 #define GCGP_SYSTEM_CMD '$'
 
 #endif // GCGP_CONFIG_H
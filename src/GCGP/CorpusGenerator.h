@@ -0,0 +1,133 @@
+#ifdef __cplusplus
+#ifndef GCGP_CORPUSGENERATOR_H
+#define GCGP_CORPUSGENERATOR_H
+
+// Test input for desktop hosts, it is never needed on the controller itself
+#if !defined(ARDUINO)
+
+#include "GCGP/Config.h"
+
+enum class CorpusStyle {
+    Surfacing,   // 3D finishing of a dome: dense tiny G1 moves in X, Y and Z
+    Pocketing,   // 2.5D pockets with rounded corners: G1 and G3 at several depths
+    Drilling,    // Peck drilling, expanded into G0 and G1 like for GRBL
+    LaserRaster, // Rows of G1 moves with a new S power for every run of pixels
+    Mixed,       // All of the above in random order, with tool changes
+};
+
+struct CorpusSettings {
+    CorpusStyle style = CorpusStyle::Mixed;
+    uint64_t seed = 1;
+    float malformedRate = 0.f; // Fraction of lines that are malformed, 0 to 1
+    float stockSize = 100.f;   // mm, the square in X and Y that is machined
+};
+
+/// @brief Deterministic generator of realistic G-code, e.g. for benchmarks and scale
+///        tests without customer programs.
+/// @details Lines are generated one at a time by a small state machine per style, so
+///          a corpus of any size, also many gigabytes, is streamed with constant
+///          memory. The same settings always give the same lines on every platform:
+///          coordinates are integer micrometers, and the random numbers come from a
+///          seeded SplitMix64 instead of the standard library.
+///
+///          With a malformedRate, that fraction of lines is replaced by typical
+///          errors: cut off values, two decimal points, unknown letters, canned
+///          cycles that are not supported, repeated words, conflicting motion modes
+///          and stray characters. They are inserted between the valid lines and
+///          drawn from a random sequence of their own, so the valid lines are the
+///          same as without them. Every malformed line is rejected by
+///          Command::parse(), every valid line is accepted by it and by the Planner.
+///
+///          Usage:
+///              CorpusGenerator generator(settings);
+///              generator.write(1ull << 30, [](void *file, const char *data,
+///                                             size_t length) {
+///                  fwrite(data, 1, length, static_cast<FILE *>(file));
+///              }, file);
+///          Or line by line, e.g. for MachineSimulator::cbNextLine:
+///              const char *line = generator.nextLine();
+class CorpusGenerator {
+  public:
+    CorpusGenerator(const CorpusSettings &settings = CorpusSettings());
+
+    // The next line without its newline. It stays valid until the next call, and
+    // there is always a next line.
+    const char *nextLine();
+
+    // Writes whole lines with their newlines to cbWrite until at least the given
+    // number of bytes is written. Returns the number of bytes written.
+    uint64_t write(uint64_t bytes, void (*cbWrite)(void *, const char *, size_t),
+                   void *instance);
+
+    uint64_t lines() const
+    {
+        return m_lines;
+    }
+
+    uint64_t malformedLines() const
+    {
+        return m_malformedLines;
+    }
+
+    CorpusSettings settings;
+
+  private:
+    static uint64_t random(uint64_t &state);
+    static int32_t random(uint64_t &state, int32_t minimum, int32_t maximum);
+
+    void startLine();
+    void addText(const char *text);
+    void addWord(char letter, int32_t micrometers); // Printed in mm
+    void addInteger(char letter, int32_t value);
+
+    void startOperation();
+    void toolChangeLine();
+    void surfacingLine();
+    void pocketingLine();
+    void drillingLine();
+    void rasterLine();
+    void malformedLine();
+
+    int32_t surfaceHeight(int32_t x, int32_t y) const;
+    void pocketRingStart(int32_t ring, int32_t &x, int32_t &y) const;
+    void pocketRingSize(int32_t ring, int32_t &a, int32_t &b, int32_t &r) const;
+
+    uint64_t m_random;
+    uint64_t m_malformedRandom;
+    uint64_t m_lines = 0;
+    uint64_t m_malformedLines = 0;
+    char m_line[GCGP_MAX_COMMAND_LENGTH + 2]; // With room for the newline of write()
+    size_t m_length = 0;
+
+    // The current operation. All lengths are in micrometers.
+    CorpusStyle m_operation = CorpusStyle::Mixed; // Mixed before the first one
+    bool m_operationDone = true;
+    bool m_preambleDone = false;
+    int32_t m_phase = 0; // Negative for the tool change before it
+    int32_t m_tool = 0;
+    int32_t m_stock = 0;
+
+    struct {
+        int32_t row, rows, column, columns, step, stepover, direction;
+        bool feed;
+    } m_surface;
+
+    struct {
+        int32_t centerX, centerY, halfWidth, halfHeight, radius;
+        int32_t level, levels, ring, rings, stepover, segment;
+        bool feed; // Whether the next contour line sets the feed
+    } m_pocket;
+
+    struct {
+        int32_t hole, holes, depth, peck, drilled;
+    } m_drill;
+
+    struct {
+        int32_t originX, originY, row, rows, column, columns, pixel, direction;
+        bool feed;
+    } m_raster;
+};
+
+#endif // !defined(ARDUINO)
+#endif // GCGP_CORPUSGENERATOR_H
+#endif // __cplusplus
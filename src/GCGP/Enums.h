@@ -35,6 +35,13 @@ enum class ArcPlaneMode {
     YZ, // G19
 };
 
+enum class PathControlMode {
+    None,
+    ExactPath, // G61 -> Follow the path exactly, but do not stop at corners
+    ExactStop, // G61.1 -> Stop at every corner
+    Blending   // G64 P<> -> Round corners within the tolerance P
+};
+
 enum class FeedrateMode {
     None,
     InverseTime,       // G93 -> every command MUST have F, each move is completed in 1/F
@@ -101,6 +108,12 @@ enum class AxisOffsetAction {
     ClearAxisOffset, // G92.1, G92.2, G92.3  -> TODO: THIS IS NOT REALLY COMPLIANT!!!
 };
 
+enum class ToolLengthOffsetAction {
+    None,
+    SetDynamic, // G43.1 -> Set the tool length offset to the Z word
+    Cancel      // G49
+};
+
 enum class StopAction {
     None,
     Pause,        // M0 -> Pause program
@@ -200,6 +213,7 @@ enum class GrblError { // https://www.sainsmart.com/blogs/news/grbl-v1-1-quick-r
     GCodeMultiplyDefinedParameters,
     GCodeTooManyParameters,
     GCodeG10MissingParameter,
+    PlannerBufferFull,
 
     FeatureNotYetImplemented = 200,
     TurningFeaturesNotYetImplemented,
@@ -308,6 +322,8 @@ static const char *ErrorEnumToString(GrblError error)
         return "Command contains more parameters than supported.";
     case GrblError::GCodeG10MissingParameter:
         return "Command contains G10 but not enough parameters for it.";
+    case GrblError::PlannerBufferFull:
+        return "Planner buffer is full.";
     case GrblError::FeatureNotYetImplemented:
         return "Feature not yet implemented.";
     case GrblError::TurningFeaturesNotYetImplemented:
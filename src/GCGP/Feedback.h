@@ -0,0 +1,96 @@
+#ifdef __cplusplus
+#ifndef GCGP_FEEDBACK_H
+#define GCGP_FEEDBACK_H
+
+#include "GCGP/Atomic.h"
+#include "GCGP/Config.h"
+
+// Limits of the following error, like LinuxCNC's FERROR
+struct FollowingErrorSettings {
+    float maxError[GCGP_NUM_AXES]; // mm, the alarm is raised beyond it
+    float servoRate = 1000.f;      // Hz, of the calls to publish()
+    float rmsTimeConstant = 0.1f;  // s, of the running RMS
+
+    FollowingErrorSettings()
+    {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            maxError[i] = 1.f;
+        }
+    }
+};
+
+// The positions of one servo tick and the following error statistics up to it
+struct FeedbackSnapshot {
+    float setPosition[GCGP_NUM_AXES];     // mm, machine coordinates
+    float actualPosition[GCGP_NUM_AXES];  // mm, from the encoders
+    float error[GCGP_NUM_AXES];           // mm, actual - set
+    float meanSquareError[GCGP_NUM_AXES]; // mm^2, averaged over rmsTimeConstant
+    float peakError[GCGP_NUM_AXES];       // mm, largest |error| since resetPeaks()
+    AxisBits alarmAxes;                   // Exceeded maxError since clearAlarm()
+    uint32_t samples;                     // Calls to publish()
+
+    float rmsError(int axis) const
+    {
+        return sqrtf(meanSquareError[axis]);
+    }
+};
+
+/// @brief Lock-free channel for the actual positions of a closed-loop machine, with
+///        a following error monitor.
+/// @details The servo loop calls publish() on every tick with the set and the actual
+///          position. This updates the following error statistics and publishes
+///          them with the positions as one FeedbackSnapshot. snapshot() returns a
+///          consistent copy of the last one, e.g. for the status report, from the
+///          main loop or another thread. It never blocks publish(): the snapshot is
+///          guarded by a sequence counter, and a reader that overlaps with a write
+///          simply copies it again.
+///
+///          When the error of an axis first exceeds its maxError, cbAlarm is called
+///          from publish() with the bits of the new axes. It runs in the servo loop,
+///          so it must be short, e.g. disable the drives and set a flag. The alarm
+///          is latched until clearAlarm().
+///
+///          Usage:
+///              void servoTick() {  // E.g. in a timer interrupt
+///                  readEncoders(actual);
+///                  monitor.publish(setpoint.position, actual);
+///              }
+///              grbl.cbGetFeedback = [](void *machine, FeedbackSnapshot *snapshot) {
+///                  return static_cast<Machine *>(machine)->monitor.snapshot(*snapshot);
+///              };
+class FollowingErrorMonitor {
+  public:
+    FollowingErrorMonitor(
+        const FollowingErrorSettings &settings = FollowingErrorSettings());
+
+    void (*cbAlarm)(void *, AxisBits axes) = nullptr;
+    void *instance = nullptr;
+
+    // Servo loop only, one writer
+    void publish(const float setPosition[GCGP_NUM_AXES],
+                 const float actualPosition[GCGP_NUM_AXES]);
+
+    // Any number of readers. Returns false if nothing was published yet.
+    bool snapshot(FeedbackSnapshot &snapshot) const;
+
+    // Requests from one reader, e.g. the main loop, applied by the next publish()
+    void resetPeaks();
+    void clearAlarm();
+
+    FollowingErrorSettings settings;
+
+  private:
+    // Written by publish() only
+    FeedbackSnapshot m_state;
+    FeedbackSnapshot m_published;
+    SequenceLock m_lock; // Of m_published
+    uint8_t m_peakResetsDone = 0;
+    uint8_t m_alarmClearsDone = 0;
+
+    // Written by the reader only
+    uint8_t m_peakResetRequests = 0;
+    uint8_t m_alarmClearRequests = 0;
+};
+
+#endif // GCGP_FEEDBACK_H
+#endif // __cplusplus
@@ -2,11 +2,24 @@
 #ifndef GCGP_GRBLINTERFACE_H
 #define GCGP_GRBLINTERFACE_H
 
+#include "GCGP/Clock.h"
 #include "GCGP/Command.h"
 #include "GCGP/Config.h"
+#include "GCGP/Feedback.h"
+#include "GCGP/Metrics.h"
+#include "GCGP/Overrides.h"
 #include "GCGP/Serial.h"
 #include "GCGP/String.h"
 
+// Limits of the received bytes one update() works through, 0 for no limit. The time is
+// checked before every line, so it is exceeded by at most one line and its callback.
+// Real-time commands are never held back by a budget.
+struct UpdateBudget {
+    uint32_t bytes = 0;
+    uint32_t lines = 0; // Including empty ones
+    uint32_t microseconds = 0;
+};
+
 /// @brief Class for implementing GRBL-compatible communication with the host.
 /// @details This class is responsible for reading the serial stream byte by byte,
 ///          parsing and interpreting them, and responding how GRBL would.
@@ -21,30 +34,85 @@ class GrblInterface {
     bool (*cbIsInAlarmState)(void *) = nullptr;
     bool (*cbIsInJogState)(void *) = nullptr;
     float (*cbGetFeedrate)(void *) = nullptr;
+    void (*cbJog)(void *, Command<10> *) = nullptr; // '$J=...', Command::isJog is set
+    void (*cbJogCancel)(void *) = nullptr;          // 0x85, real-time
+    void (*cbSafetyDoor)(void *) = nullptr;         // 0x84, real-time
+    void (*cbToggleFloodCoolant)(void *) = nullptr; // 0xA0, real-time
+    void (*cbToggleMistCoolant)(void *) = nullptr;  // 0xA1, real-time
+    void (*cbOverridesChanged)(void *, const OverrideState *) = nullptr; // 0x90-0x9E
+    bool (*cbGetFeedback)(void *, FeedbackSnapshot *) = nullptr; // For '?' reports
 
     GrblInterface(const SerialInterface &serialInterface, void *instance);
 
-    void update();
+    // Returns whether the budget ran out before all received lines were worked through
+    bool update(const UpdateBudget &budget = UpdateBudget());
+
+    // update() as a Scheduler task, with the time the scheduler leaves it as budget
+    static void scheduledUpdate(void *grbl, uint32_t microseconds);
+
+    const OverrideState &overrides() const
+    {
+        return m_overrides;
+    }
+
+#if GCGP_ENABLE_METRICS
+    // Counters and histograms since start, also reported by "$M"
+    const Metrics &metrics() const
+    {
+        return m_metrics;
+    }
+
+    Metrics &metrics()
+    {
+        return m_metrics;
+    }
+#endif
+
+    // The answer to a command: "ok", or the error message
+    static void printResponse(const SerialInterface &serial, GrblError error);
 
   private:
-    void parseSingleByte();
-    void flushSerialCommand(); // Flush the current command, until a newline is found.
+    void receiveBytes();
+    void parseSingleByte(char c);
+    void executeRealtimeCommand(char c);
+    void discardCommand(); // Drop the current command and everything until a newline.
 
     void printStatusReport();
+    void printAxes(const char *label, const float values[GCGP_NUM_AXES]);
+    static void formatFloat(char *str, size_t size, float value);
     void printOk();
     void printError(const char *error);
     void printError(GrblError error);
+    void countAnswer(bool ok, GrblError error);
+#if GCGP_ENABLE_METRICS
+    void printMetrics();
+    void printHistogram(const char *name, const MetricsHistogram &histogram);
+    void printNumber(uint32_t value);
+#endif
 
     void appendCharacter(char c);
     void finishCommand();
     void processCommand(const char *command);
+    void processJogCommand();
     void processSystemCommand(const char *command);
     void processGCodeCommand(const char *command);
 
     SerialInterface m_serial;
+    char m_rxBuffer[GCGP_RX_BUFFER_SIZE];
+    size_t m_rxBufferStart = 0;
+    size_t m_rxBufferCount = 0;
     size_t m_commandBufferIndex = 0;
     char m_commandBuffer[GCGP_MAX_COMMAND_LENGTH];
+    bool m_discardingCommand = false;
+    bool m_bufferFull = false; // Lines wait for cbBufferIsFull
+    OverrideState m_overrides;
     Command<10> m_command;
+#if GCGP_ENABLE_METRICS
+    Metrics m_metrics;
+    bool m_lineStarted = false; // m_lineStart is the first byte of the current line
+    uint32_t m_lineStart = 0;
+    uint32_t m_bufferFullSince = 0;
+#endif
 
     void *m_instance = nullptr;
 };
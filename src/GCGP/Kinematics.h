@@ -0,0 +1,130 @@
+#ifdef __cplusplus
+#ifndef GCGP_KINEMATICS_H
+#define GCGP_KINEMATICS_H
+
+#include "GCGP/Config.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Maps Cartesian positions in mm to the positions of the joints, i.e. the
+///        motors, and back.
+/// @details Like SerialInterface, this is a set of callbacks with a user instance, so
+///          that any machine can be plugged in. Without callbacks, the joints are
+///          the Cartesian axes. inverse() is meant for the servo tick, e.g. on each
+///          setpoint of the SetpointGenerator, and for the StepGenerator, which
+///          converts the target of every planner block. inverseBatch() converts many
+///          points at once, to verify a job on the host. Its points are stored as
+///          one array per axis, like in SoftLimits::transformAndCheck().
+///
+///          The built-in CartesianKinematics, CoreXYKinematics and
+///          LinearDeltaKinematics return their callbacks from kinematics():
+///              LinearDeltaKinematics delta(250.f, 120.f);
+///              stepperSettings.kinematics = delta.kinematics();
+///
+///          The StepGenerator only converts the ends of the blocks. Machines with
+///          non-linear kinematics like a delta must thus be fed short moves, or be
+///          driven by the SetpointGenerator.
+struct Kinematics {
+    void *instance = nullptr;
+
+    // Returns false if the position cannot be reached
+    bool (*cbInverse)(void *, const float cartesian[GCGP_NUM_AXES],
+                      float joints[GCGP_NUM_AXES]) = nullptr;
+    bool (*cbForward)(void *, const float joints[GCGP_NUM_AXES],
+                      float cartesian[GCGP_NUM_AXES]) = nullptr;
+
+    // Optional, inverse() is called per point otherwise. Sets a bit per joint that
+    // cannot reach its point in unreachable, and returns the number of such points.
+    size_t (*cbInverseBatch)(void *, const float *const cartesian[GCGP_NUM_AXES],
+                             float *const joints[GCGP_NUM_AXES], AxisBits *unreachable,
+                             size_t count) = nullptr;
+
+    bool inverse(const float cartesian[GCGP_NUM_AXES],
+                 float joints[GCGP_NUM_AXES]) const
+    {
+        if (cbInverse != nullptr) {
+            return cbInverse(instance, cartesian, joints);
+        }
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            joints[i] = cartesian[i];
+        }
+        return true;
+    }
+
+    bool forward(const float joints[GCGP_NUM_AXES],
+                 float cartesian[GCGP_NUM_AXES]) const
+    {
+        if (cbForward != nullptr) {
+            return cbForward(instance, joints, cartesian);
+        }
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            cartesian[i] = joints[i];
+        }
+        return true;
+    }
+
+    // cartesian and joints may be the same arrays
+    size_t inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                        float *const joints[GCGP_NUM_AXES], AxisBits *unreachable,
+                        size_t count) const;
+};
+
+// X, Y and Z each have their own motor
+class CartesianKinematics {
+  public:
+    static bool inverse(const float cartesian[GCGP_NUM_AXES],
+                        float joints[GCGP_NUM_AXES]);
+    static bool forward(const float joints[GCGP_NUM_AXES],
+                        float cartesian[GCGP_NUM_AXES]);
+    static size_t inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                               float *const joints[GCGP_NUM_AXES], AxisBits *unreachable,
+                               size_t count);
+
+    Kinematics kinematics();
+};
+
+// Two motors move X and Y together over crossed belts: A = X + Y and B = X - Y
+class CoreXYKinematics {
+  public:
+    static bool inverse(const float cartesian[GCGP_NUM_AXES],
+                        float joints[GCGP_NUM_AXES]);
+    static bool forward(const float joints[GCGP_NUM_AXES],
+                        float cartesian[GCGP_NUM_AXES]);
+    static size_t inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                               float *const joints[GCGP_NUM_AXES], AxisBits *unreachable,
+                               size_t count);
+
+    Kinematics kinematics();
+};
+
+/// @brief Three carriages on vertical towers hold the effector with rods of equal
+///        length, like a Rostock printer.
+/// @details The towers stand on a circle of the given radius around the origin, at
+///          210, 330 and 90 degrees from X (the effector offset is included in the
+///          radius). The joint positions are the heights of the carriages, with the
+///          same origin as Z. With the effector in the centre at Z0, all three are
+///          sqrt(diagonalRod^2 - radius^2). A point is unreachable if a tower is
+///          further from it than the rod length.
+class LinearDeltaKinematics {
+  public:
+    LinearDeltaKinematics(float diagonalRod, float radius);
+
+    bool inverse(const float cartesian[GCGP_NUM_AXES],
+                 float joints[GCGP_NUM_AXES]) const;
+    bool forward(const float joints[GCGP_NUM_AXES],
+                 float cartesian[GCGP_NUM_AXES]) const;
+    size_t inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                        float *const joints[GCGP_NUM_AXES], AxisBits *unreachable,
+                        size_t count) const;
+
+    Kinematics kinematics();
+
+  private:
+    float m_diagonalRodSqr;
+    float m_towerX[3];
+    float m_towerY[3];
+};
+
+#endif // GCGP_KINEMATICS_H
+#endif // __cplusplus
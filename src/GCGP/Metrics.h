@@ -0,0 +1,96 @@
+#ifdef __cplusplus
+#ifndef GCGP_METRICS_H
+#define GCGP_METRICS_H
+
+#include "GCGP/Atomic.h"
+#include "GCGP/Clock.h"
+#include "GCGP/Config.h"
+#include "GCGP/Enums.h"
+
+// Microseconds for the latencies
+#ifndef GCGP_METRICS_CLOCK_US
+#define GCGP_METRICS_CLOCK_US() GCGP_CLOCK_US()
+#endif
+
+// Bucket 0 counts durations below 1 us, bucket i those from 2^(i-1) to 2^i us, and the
+// last one also all longer ones
+struct MetricsHistogram {
+    uint32_t buckets[GCGP_METRICS_HISTOGRAM_BUCKETS] = {};
+    uint32_t count = 0;
+    uint32_t max = 0; // us
+    uint64_t sum = 0; // us
+
+    void add(uint32_t microseconds);
+
+    double mean() const
+    {
+        return count ? static_cast<double>(sum) / count : 0.;
+    }
+
+    // The first duration that is not in the bucket any more, UINT32_MAX for the last
+    static uint32_t bucketEnd(size_t bucket);
+};
+
+struct MetricsErrorCount {
+    uint16_t code = 0; // GrblError, 0 for an unused slot
+    uint32_t count = 0;
+};
+
+struct MetricsSnapshot {
+    uint32_t bytesReceived = 0;    // Including real-time commands
+    uint32_t realtimeCommands = 0;
+    uint32_t linesParsed = 0;      // Lines through Command::parse()
+    uint32_t ok = 0;
+    uint32_t errors = 0;
+    // The first error codes that occurred, and all others together. Errors without a
+    // code, e.g. unknown characters, are also among the others.
+    MetricsErrorCount errorCodes[GCGP_METRICS_ERROR_CODES];
+    uint32_t otherErrors = 0;
+
+    MetricsHistogram lineLatency;    // From the first byte of a line to its answer
+    MetricsHistogram parseTime;      // Of Command::parse()
+    MetricsHistogram bufferFullTime; // Of every wait for cbBufferIsFull
+
+    uint32_t errorCount(GrblError error) const;
+};
+
+/// @brief Counters and latency histograms of a GrblInterface, e.g. for dashboards
+///        that look for slow lines and buffer starvation.
+/// @details Only compiled into GrblInterface with GCGP_ENABLE_METRICS. It records
+///          into them from the main loop, the only writer. Every record is guarded
+///          by a SequenceLock, so snapshot() gets a consistent copy from any thread
+///          without blocking the main loop. Do not call it from an interrupt of the
+///          main loop: it would wait for a record that cannot finish. The host reads
+///          the same values with the "$M" command.
+///
+///          Usage:
+///              MetricsSnapshot metrics;
+///              grbl.metrics().snapshot(metrics);
+///              if (metrics.bufferFullTime.max > 100000) { ... }
+class Metrics {
+  public:
+    // Any number of readers
+    void snapshot(MetricsSnapshot &snapshot) const;
+
+    // Main loop only, one writer. The latency of an answer is only counted if it is
+    // known, an error of GrblError::None is one without a code.
+    void addReceivedBytes(uint32_t count, uint32_t realtimeCommands);
+    void addParse(uint32_t microseconds);
+    void addOk(bool hasLatency, uint32_t latency);
+    void addError(GrblError error, bool hasLatency, uint32_t latency);
+    void addBufferFull(uint32_t microseconds);
+    void clear();
+
+    // The counters as they are, for the writer itself
+    const MetricsSnapshot &current() const
+    {
+        return m_data;
+    }
+
+  private:
+    MetricsSnapshot m_data;
+    SequenceLock m_lock; // Of m_data
+};
+
+#endif // GCGP_METRICS_H
+#endif // __cplusplus
@@ -0,0 +1,128 @@
+#ifdef __cplusplus
+#ifndef GCGP_MOVE_H
+#define GCGP_MOVE_H
+
+#include "GCGP/Command.h"
+#include "GCGP/Config.h"
+#include "GCGP/Enums.h"
+
+/// @brief A resolved motion: absolute start and target in mm and the feedrate.
+/// @details Arcs lie in the plane of axis0 and axis1 and can be helical along the
+///          linear axis. A positive angularTravel is counter-clockwise when looking
+///          from the positive linear axis onto the plane, like G3.
+struct Move {
+    MotionType type = MotionType::None; // Rapid, Feed, ArcCW or ArcCCW
+    float start[GCGP_NUM_AXES];
+    float target[GCGP_NUM_AXES];
+    float feedrate = NAN; // mm/min, NAN for rapids
+
+    int axis0 = 0;
+    int axis1 = 1;
+    int linearAxis = 2;
+    float center[2];
+    float radius = 0.f;
+    float startAngle = 0.f;    // rad, of the start point around the center
+    float angularTravel = 0.f; // rad
+
+    bool isArc() const
+    {
+        return type == MotionType::ArcCW || type == MotionType::ArcCCW;
+    }
+
+    // Path length in mm
+    float length() const;
+
+    // Position and unit tangent at the given distance along the path
+    void evaluate(float distance, float position[GCGP_NUM_AXES],
+                  float direction[GCGP_NUM_AXES]) const;
+};
+
+// Program to machine coordinates for one modal state: machine = program * scale + offset
+struct CoordinateTransform {
+    float scale[GCGP_NUM_AXES]; // mm per program unit, 1 for the rotary axes
+    float offset[GCGP_NUM_AXES];
+};
+
+/// @brief The modal state of the G-code interpreter, to turn commands into moves.
+/// @details Keeps G0/G1/G2/G3, G17/G18/G19, G20/G21, G43.1/G49, G54-G59.3,
+///          G61/G61.1/G64, G90/G91, G93/G94 and F across commands, like a real
+///          controller does, and resolves the words of a command into absolute
+///          machine coordinates in millimetres.
+///
+///          Program coordinates become machine coordinates by adding the offset of
+///          the selected work coordinate system, the G92 offset and the tool length
+///          offset on Z. Their sum is cached, and only recomputed when one of them
+///          changes. G10 L2/L20, G92 and G43.1 change the offsets, G53 bypasses them
+///          for one move. The work offsets are not persistent, the integrator can
+///          store and restore them with workOffset() and setWorkOffset().
+class ModalState {
+  public:
+    ModalState();
+
+    // Applies the modal words of the command. If it moves, move.type is set and the
+    // move starts at the given machine position, else move.type is MotionType::None.
+    // A command with an error changes nothing.
+    GrblError resolve(const Command<10> &command, const float position[GCGP_NUM_AXES],
+                      Move &move);
+
+    // Converts a machine position into program coordinates in mm, for reporting WPos
+    void toProgramCoordinates(const float machine[GCGP_NUM_AXES],
+                              float program[GCGP_NUM_AXES]) const;
+
+    // Offset from program to machine coordinates, in mm
+    const float *offset() const
+    {
+        return m_offset;
+    }
+
+    // The cached transform of absolute program coordinates, for batch processing
+    CoordinateTransform transform() const;
+
+    int workCoordinateSystem() const
+    {
+        return m_workCoordinateSystem;
+    }
+
+    const float *workOffset(int system) const
+    {
+        return m_workOffsets[system];
+    }
+
+    void setWorkOffset(int system, const float offset[GCGP_NUM_AXES]);
+
+    const float *axisOffset() const
+    {
+        return m_axisOffset;
+    }
+
+    float toolLengthOffset() const
+    {
+        return m_toolLengthOffset;
+    }
+
+    MotionType motionType = MotionType::Rapid;
+    ArcPlaneMode arcPlaneMode = ArcPlaneMode::XY;
+    DistanceMode distanceMode = DistanceMode::Absolute;
+    LengthUnits lengthUnits = LengthUnits::Metric;
+    FeedrateMode feedrateMode = FeedrateMode::UnitsPerMinute;
+    float feedrate = NAN; // mm/min, or 1/min in inverse time mode
+    PathControlMode pathControlMode = PathControlMode::ExactPath;
+    float pathTolerance = 0.f; // mm, of G64 P, 0 for no tolerance
+
+  private:
+    GrblError apply(const Command<10> &command, const float position[GCGP_NUM_AXES],
+                    Move &move);
+    GrblError resolveOffsets(const Command<10> &command, const float words[GCGP_NUM_AXES],
+                             float scale, const float position[GCGP_NUM_AXES]);
+    GrblError resolveArc(const Command<10> &command, float scale, Move &move) const;
+    void updateOffset();
+
+    int m_workCoordinateSystem = 0; // G54
+    float m_workOffsets[GCGP_NUM_WORK_COORDINATE_SYSTEMS][GCGP_NUM_AXES];
+    float m_axisOffset[GCGP_NUM_AXES]; // G92
+    float m_toolLengthOffset = 0.f;    // mm, on Z
+    float m_offset[GCGP_NUM_AXES];     // Sum of all offsets
+};
+
+#endif // GCGP_MOVE_H
+#endif // __cplusplus
@@ -0,0 +1,98 @@
+#ifdef __cplusplus
+#ifndef GCGP_OVERRIDES_H
+#define GCGP_OVERRIDES_H
+
+#include "GCGP/Config.h"
+
+/// @brief Feed, rapid and spindle overrides in percent, as set by the GRBL 1.1
+///        real-time commands 0x90-0x9E.
+struct OverrideState {
+    uint8_t feed = GCGP_DEFAULT_FEED_OVERRIDE;
+    uint8_t rapid = GCGP_DEFAULT_RAPID_OVERRIDE;
+    uint8_t spindle = GCGP_DEFAULT_SPINDLE_OVERRIDE;
+    bool spindleStop = false; // Toggled by 0x9E
+
+    // Applies an override command. Returns false if it is none, or if it did not
+    // change anything because a limit was already reached.
+    bool apply(char command)
+    {
+        OverrideState previous = *this;
+        switch (command) {
+            case GCGP_CMD_FEED_OVR_RESET:
+                feed = GCGP_DEFAULT_FEED_OVERRIDE;
+                break;
+            case GCGP_CMD_FEED_OVR_COARSE_PLUS:
+                feed = step(feed, GCGP_OVERRIDE_COARSE_INCREMENT, GCGP_MIN_FEED_OVERRIDE,
+                            GCGP_MAX_FEED_OVERRIDE);
+                break;
+            case GCGP_CMD_FEED_OVR_COARSE_MINUS:
+                feed = step(feed, -GCGP_OVERRIDE_COARSE_INCREMENT, GCGP_MIN_FEED_OVERRIDE,
+                            GCGP_MAX_FEED_OVERRIDE);
+                break;
+            case GCGP_CMD_FEED_OVR_FINE_PLUS:
+                feed = step(feed, GCGP_OVERRIDE_FINE_INCREMENT, GCGP_MIN_FEED_OVERRIDE,
+                            GCGP_MAX_FEED_OVERRIDE);
+                break;
+            case GCGP_CMD_FEED_OVR_FINE_MINUS:
+                feed = step(feed, -GCGP_OVERRIDE_FINE_INCREMENT, GCGP_MIN_FEED_OVERRIDE,
+                            GCGP_MAX_FEED_OVERRIDE);
+                break;
+            case GCGP_CMD_RAPID_OVR_RESET:
+                rapid = GCGP_DEFAULT_RAPID_OVERRIDE;
+                break;
+            case GCGP_CMD_RAPID_OVR_MEDIUM:
+                rapid = GCGP_RAPID_OVERRIDE_MEDIUM;
+                break;
+            case GCGP_CMD_RAPID_OVR_LOW:
+                rapid = GCGP_RAPID_OVERRIDE_LOW;
+                break;
+            case GCGP_CMD_SPINDLE_OVR_RESET:
+                spindle = GCGP_DEFAULT_SPINDLE_OVERRIDE;
+                break;
+            case GCGP_CMD_SPINDLE_OVR_COARSE_PLUS:
+                spindle = step(spindle, GCGP_OVERRIDE_COARSE_INCREMENT,
+                               GCGP_MIN_SPINDLE_OVERRIDE, GCGP_MAX_SPINDLE_OVERRIDE);
+                break;
+            case GCGP_CMD_SPINDLE_OVR_COARSE_MINUS:
+                spindle = step(spindle, -GCGP_OVERRIDE_COARSE_INCREMENT,
+                               GCGP_MIN_SPINDLE_OVERRIDE, GCGP_MAX_SPINDLE_OVERRIDE);
+                break;
+            case GCGP_CMD_SPINDLE_OVR_FINE_PLUS:
+                spindle = step(spindle, GCGP_OVERRIDE_FINE_INCREMENT,
+                               GCGP_MIN_SPINDLE_OVERRIDE, GCGP_MAX_SPINDLE_OVERRIDE);
+                break;
+            case GCGP_CMD_SPINDLE_OVR_FINE_MINUS:
+                spindle = step(spindle, -GCGP_OVERRIDE_FINE_INCREMENT,
+                               GCGP_MIN_SPINDLE_OVERRIDE, GCGP_MAX_SPINDLE_OVERRIDE);
+                break;
+            case GCGP_CMD_SPINDLE_OVR_STOP:
+                spindleStop = !spindleStop;
+                break;
+            default:
+                return false;
+        }
+        return !(*this == previous);
+    }
+
+    bool operator==(const OverrideState &other) const
+    {
+        return feed == other.feed && rapid == other.rapid && spindle == other.spindle &&
+               spindleStop == other.spindleStop;
+    }
+
+  private:
+    static uint8_t step(uint8_t value, int increment, int min, int max)
+    {
+        int result = value + increment;
+        if (result < min) {
+            return static_cast<uint8_t>(min);
+        }
+        if (result > max) {
+            return static_cast<uint8_t>(max);
+        }
+        return static_cast<uint8_t>(result);
+    }
+};
+
+#endif // GCGP_OVERRIDES_H
+#endif // __cplusplus
@@ -0,0 +1,174 @@
+#ifdef __cplusplus
+#ifndef GCGP_PLANNER_H
+#define GCGP_PLANNER_H
+
+#include "GCGP/ArcLinearizer.h"
+#include "GCGP/Command.h"
+#include "GCGP/Config.h"
+#include "GCGP/Enums.h"
+#include "GCGP/Move.h"
+#include "GCGP/SoftLimits.h"
+
+// Chords that round a corner in G64 P mode
+#define GCGP_PLANNER_BLEND_SEGMENTS 2
+
+// Machine limits used for planning, like GRBL's $110-$112, $120-$122 and $11
+struct PlannerSettings {
+    float maxRate[GCGP_NUM_AXES];      // mm/min
+    float acceleration[GCGP_NUM_AXES]; // mm/s^2
+    float junctionDeviation = 0.01f;   // mm
+    float minimumJunctionSpeed = 0.f;  // mm/min
+    float arcTolerance = 0.002f;       // mm, like GRBL's $12
+    SoftLimits softLimits;             // Jogs beyond them are rejected
+
+    PlannerSettings()
+    {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            maxRate[i] = 500.f;
+            acceleration[i] = 10.f;
+        }
+    }
+};
+
+// A straight move, ready to be executed. All speeds are squared, in (mm/s)^2.
+// The profile accelerates from entrySpeedSqr to peakSpeedSqr until accelerateUntil,
+// cruises and decelerates to exitSpeedSqr from decelerateAfter on (both in mm from
+// the start of the block).
+struct PlannerBlock {
+    float target[GCGP_NUM_AXES]; // mm, absolute
+    float unitVector[GCGP_NUM_AXES];
+    float millimeters;
+    float acceleration; // mm/s^2, along the path
+    bool rapid;
+
+    float nominalSpeedSqr;
+    float maxEntrySpeedSqr; // Limited by the junction with the previous block
+    float entrySpeedSqr;
+    float exitSpeedSqr;
+    float peakSpeedSqr;
+    float accelerateUntil;
+    float decelerateAfter;
+};
+
+/// @brief Look-ahead planner for linear moves.
+/// @details Moves are queued in a fixed-size ring of GCGP_PLANNER_BUFFER_SIZE blocks.
+///          Every new block gets a maximum entry speed from the junction deviation
+///          of the corner with the previous block. A backward pass then makes sure
+///          every block can still decelerate to a stop at the end of the queue, and
+///          a forward pass limits the entry speeds by the acceleration from the
+///          previous block. Both passes only cover the blocks after the last one
+///          whose speed can no longer improve, so adding a block is cheap even with
+///          a full buffer. Like this, short segments of CAM programs are run at full
+///          feed instead of stopping at every corner.
+///
+///          With G64 P<tolerance>, the corner between two feed moves is cut by
+///          GCGP_PLANNER_BLEND_SEGMENTS chords that stay within the tolerance of the
+///          programmed corner. Each junction then only turns by a part of the corner
+///          angle, which allows a higher junction speed. For this, the last move is
+///          held back until the next one arrives, or until the buffer runs empty.
+///          G61.1 stops at every corner instead.
+///
+///          The planner is not interrupt safe, it must be used from the main loop.
+///          Its fill level is meant to drive GrblInterface::cbBufferIsFull:
+///              grbl.cbBufferIsFull = [](void *machine) {
+///                  return static_cast<Machine *>(machine)->planner.isFull();
+///              };
+///              grbl.cbProcessCommand = [](void *machine, Command<10> *command) {
+///                  static_cast<Machine *>(machine)->planner.addCommand(*command);
+///              };
+class Planner {
+  public:
+    Planner(const PlannerSettings &settings = PlannerSettings());
+
+    // Resolves the command with modalState and queues its move, if any. Arcs are
+    // split into segments within settings.arcTolerance. The segments that do not fit
+    // are queued by discardCurrentBlock() as space frees up. With soft limits, jogs
+    // to a target outside of the travel return JogTargetExceedsMachineTravelIgnored.
+    // modalState changes only with a block that is accepted, and never with a jog.
+    GrblError addCommand(const Command<10> &command);
+
+    // Queues a move to the absolute target in mm. Returns false if the buffer is full.
+    // Moves shorter than a micrometer are skipped. The path control mode of
+    // modalState applies.
+    bool addLinearMove(const float target[GCGP_NUM_AXES], float feedrate, bool rapid);
+
+    // The block that is being executed, or nullptr. Once it was returned, the speeds
+    // of it and of its junction to the next block are fixed.
+    const PlannerBlock *currentBlock();
+    void discardCurrentBlock();
+
+    // Whether no more moves can be added, also while segments of an arc wait. A held
+    // back move needs space for the blend of its corner.
+    bool isFull() const
+    {
+        size_t needed = m_hasHeldMove ? GCGP_PLANNER_BLEND_SEGMENTS + 1 : 1;
+        return m_count + needed > GCGP_PLANNER_BUFFER_SIZE || !m_arc.isDone();
+    }
+
+    bool isEmpty() const
+    {
+        return m_count == 0 && !m_hasHeldMove;
+    }
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+    // The block at index 0 is the oldest one
+    const PlannerBlock &block(size_t index) const
+    {
+        return m_blocks[(m_tail + index) % GCGP_PLANNER_BUFFER_SIZE];
+    }
+
+    // The end position of the last move, in mm, also if it is held back for blending
+    // or is an arc whose segments are not all queued yet
+    const float *position() const
+    {
+        return m_position;
+    }
+
+    // Sets the position, for example after homing. The buffer must be empty.
+    void setPosition(const float position[GCGP_NUM_AXES]);
+
+    void clear();
+
+    PlannerSettings settings;
+    ModalState modalState;
+
+  private:
+    static size_t nextIndex(size_t index);
+    static size_t previousIndex(size_t index);
+    float limitByAxisMaximum(const float maximum[GCGP_NUM_AXES],
+                             const float unitVector[GCGP_NUM_AXES]) const;
+    float junctionSpeedSqr(const PlannerBlock &block) const;
+    bool queueBlock(const float target[GCGP_NUM_AXES], float feedrate, bool rapid);
+    void blendCorner(const float target[GCGP_NUM_AXES], float feedrate);
+    void releaseHeldMove();
+    void queueArcSegments();
+    void recalculate();
+    void calculateTrapezoid(PlannerBlock &block, float exitSpeedSqr);
+
+    PlannerBlock m_blocks[GCGP_PLANNER_BUFFER_SIZE];
+    size_t m_tail = 0;    // Oldest block
+    size_t m_head = 0;    // Next free block
+    size_t m_planned = 0; // First block whose entry speed can still change
+    size_t m_count = 0;
+    bool m_currentBlockFixed = false;
+
+    float m_position[GCGP_NUM_AXES];
+    float m_blockPosition[GCGP_NUM_AXES]; // End of the last queued block
+    float m_previousUnitVector[GCGP_NUM_AXES];
+    float m_previousNominalSpeedSqr = 0.f;
+
+    ArcLinearizer m_arc;
+    float m_arcFeedrate = 0.f;
+
+    bool m_hasHeldMove = false;
+    float m_heldTarget[GCGP_NUM_AXES];
+    float m_heldLength = 0.f; // As programmed, before the blend of its start
+    float m_heldFeedrate = 0.f;
+};
+
+#endif // GCGP_PLANNER_H
+#endif // __cplusplus
@@ -0,0 +1,27 @@
+#ifdef __cplusplus
+#ifndef GCGP_REALTIME_H
+#define GCGP_REALTIME_H
+
+#include "GCGP/Config.h"
+
+// Real-time commands are single bytes that are executed as soon as they are read,
+// independent of any line they might be embedded in. All extended ASCII bytes are
+// reserved for them, the ones that are not defined are ignored like in GRBL.
+static inline bool isRealtimeCommand(char c)
+{
+    if (static_cast<uint8_t>(c) >= 0x80) {
+        return true;
+    }
+    switch (c) {
+        case GCGP_CMD_CYCLE_START:
+        case GCGP_CMD_FEED_HOLD:
+        case GCGP_CMD_SOFT_RESET:
+        case GCGP_CMD_STATUS_REPORT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+#endif // GCGP_REALTIME_H
+#endif // __cplusplus
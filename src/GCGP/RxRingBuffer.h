@@ -0,0 +1,268 @@
+#ifdef __cplusplus
+#ifndef GCGP_RXRINGBUFFER_H
+#define GCGP_RXRINGBUFFER_H
+
+#include "GCGP/Atomic.h"
+#include "GCGP/Config.h"
+#include "GCGP/Realtime.h"
+#include "GCGP/Serial.h"
+
+#ifndef GCGP_RX_REALTIME_QUEUE_SIZE
+#define GCGP_RX_REALTIME_QUEUE_SIZE 16
+#endif
+
+// Indices run freely and wrap around, so they must be able to count to twice the
+// capacity. uint8_t is used where possible, as it is the only type AVR can load and
+// store atomically.
+template <bool fitsInByte> struct RxRingBufferIndex {
+    typedef uint32_t type;
+};
+template <> struct RxRingBufferIndex<true> {
+    typedef uint8_t type;
+};
+
+/// @brief Lock-free single-producer single-consumer buffer between a UART receive
+///        interrupt and the main loop.
+/// @details The interrupt calls push() for every received byte. Real-time commands
+///          are sorted out right there into their own small queue, which the main
+///          loop always reads first, so they overtake any queued line data. Line
+///          data can be drained in batches, either as raw bytes or only complete
+///          lines. serialInterface() plugs the buffer into a GrblInterface.
+///
+///          push() must only be called from one context (the ISR) and all reading
+///          functions only from another one (the main loop). Each side only writes
+///          its own index, with release semantics after the data, and reads the
+///          other one with acquire semantics, so no locks or disabled interrupts
+///          are needed.
+///
+///          Usage:
+///              RxRingBuffer<128> rx;
+///              ISR(USART_RX_vect) { rx.push(UDR0); }
+///              GrblInterface grbl(rx.serialInterface(uartWrite), &machine);
+template <size_t capacity> class RxRingBuffer {
+    static_assert(capacity > 0 && (capacity & (capacity - 1)) == 0,
+                  "capacity must be a power of two");
+    static_assert((GCGP_RX_REALTIME_QUEUE_SIZE & (GCGP_RX_REALTIME_QUEUE_SIZE - 1)) == 0,
+                  "GCGP_RX_REALTIME_QUEUE_SIZE must be a power of two");
+#ifdef __AVR__
+    static_assert(capacity <= 128, "AVR can only access 8-bit indices atomically");
+#endif
+
+  public:
+    typedef typename RxRingBufferIndex<(capacity <= 128)>::type Index;
+
+    // ===================================================== Producer (interrupt) side
+
+    // Stores a received byte. Returns false if the buffer was full and it was dropped.
+    bool push(char c)
+    {
+        if (isRealtimeCommand(c)) {
+            Index head = m_realtimeHead;
+            if (static_cast<Index>(head - atomicLoadAcquire(&m_realtimeTail)) >=
+                GCGP_RX_REALTIME_QUEUE_SIZE) {
+                countDroppedByte();
+                return false;
+            }
+            m_realtime[head & (GCGP_RX_REALTIME_QUEUE_SIZE - 1)] = c;
+            atomicStoreRelease(&m_realtimeHead, static_cast<Index>(head + 1));
+            return true;
+        }
+
+        Index head = m_head;
+        if (static_cast<Index>(head - atomicLoadAcquire(&m_tail)) >= capacity) {
+            countDroppedByte();
+            return false;
+        }
+        m_data[head & (capacity - 1)] = c;
+        atomicStoreRelease(&m_head, static_cast<Index>(head + 1));
+        if (c == '\n') { // Published after the data, so a counted line is complete
+            atomicStoreRelease(&m_linesPushed, static_cast<Index>(m_linesPushed + 1));
+        }
+        return true;
+    }
+
+    // ===================================================== Consumer (main loop) side
+
+    // A real-time command is waiting, flagged when it was received
+    bool realtimePending() const
+    {
+        return atomicLoadAcquire(&m_realtimeHead) != m_realtimeTail;
+    }
+
+    // Number of complete lines that can be read
+    size_t numberOfLines() const
+    {
+        return completeLines();
+    }
+
+    // Number of bytes dropped because the buffer was full (wraps around)
+    Index droppedBytes() const
+    {
+        return atomicLoadAcquire(&m_droppedBytes);
+    }
+
+    int available() const
+    {
+        return static_cast<int>(realtimeCount() + dataCount());
+    }
+
+    // Returns the next byte like Arduino's Serial.peek(), real-time commands first
+    int peek() const
+    {
+        if (realtimeCount() > 0) {
+            return static_cast<uint8_t>(
+                m_realtime[m_realtimeTail & (GCGP_RX_REALTIME_QUEUE_SIZE - 1)]);
+        }
+        if (dataCount() > 0) {
+            return static_cast<uint8_t>(m_data[m_tail & (capacity - 1)]);
+        }
+        return -1;
+    }
+
+    // Returns the next byte like Arduino's Serial.read(), real-time commands first
+    int read()
+    {
+        char c;
+        if (readBytes(&c, 1) == 0) {
+            return -1;
+        }
+        return static_cast<uint8_t>(c);
+    }
+
+    // Copies up to length real-time commands, and returns how many. The line data
+    // stays, so a consumer whose line buffer is full can still take them.
+    size_t readRealtime(char *buffer, size_t length)
+    {
+        size_t count = 0;
+        Index realtimeTail = m_realtimeTail;
+        Index realtimeHead = atomicLoadAcquire(&m_realtimeHead);
+        while (count < length && realtimeTail != realtimeHead) {
+            buffer[count++] =
+                m_realtime[realtimeTail & (GCGP_RX_REALTIME_QUEUE_SIZE - 1)];
+            realtimeTail++;
+        }
+        atomicStoreRelease(&m_realtimeTail, realtimeTail);
+        return count;
+    }
+
+    // Copies up to length bytes, real-time commands first, and returns how many
+    size_t readBytes(char *buffer, size_t length)
+    {
+        size_t count = readRealtime(buffer, length);
+
+        Index tail = m_tail;
+        Index head = atomicLoadAcquire(&m_head);
+        Index lines = 0;
+        while (count < length && tail != head) {
+            char c = m_data[tail & (capacity - 1)];
+            buffer[count++] = c;
+            tail++;
+            if (c == '\n') {
+                lines++;
+            }
+        }
+        m_linesPopped = static_cast<Index>(m_linesPopped + lines);
+        atomicStoreRelease(&m_tail, tail);
+        return count;
+    }
+
+    // Copies as many complete lines as fit into length bytes, including their '\n',
+    // and returns the number of bytes. If the next line alone is longer than the
+    // buffer, its first length bytes are returned so that it cannot block forever.
+    // Real-time commands are not returned here, see readBytes().
+    size_t readLines(char *buffer, size_t length)
+    {
+        Index lines = completeLines();
+        if (lines == 0) {
+            return 0;
+        }
+
+        Index tail = m_tail;
+        size_t count = 0;
+        size_t copiedCount = 0;
+        Index copiedLines = 0;
+        while (count < length && copiedLines < lines) {
+            char c = m_data[(tail + count) & (capacity - 1)];
+            buffer[count++] = c;
+            if (c == '\n') {
+                copiedCount = count;
+                copiedLines++;
+            }
+        }
+        if (copiedLines == 0) { // The first line does not fit at all
+            copiedCount = count;
+        }
+
+        m_linesPopped = static_cast<Index>(m_linesPopped + copiedLines);
+        atomicStoreRelease(&m_tail, static_cast<Index>(tail + copiedCount));
+        return copiedCount;
+    }
+
+    // A SerialInterface reading from this buffer and writing through cbWrite
+    SerialInterface serialInterface(void (*cbWrite)(const char *))
+    {
+        SerialInterface serial;
+        serial.instance = this;
+        serial.cbInstanceAvailable = [](void *instance) {
+            return static_cast<RxRingBuffer *>(instance)->available();
+        };
+        serial.cbInstancePeek = [](void *instance) {
+            return static_cast<RxRingBuffer *>(instance)->peek();
+        };
+        serial.cbInstanceRead = [](void *instance) {
+            return static_cast<RxRingBuffer *>(instance)->read();
+        };
+        serial.cbInstanceReadBytes = [](void *instance, char *buffer, int length) {
+            return static_cast<int>(static_cast<RxRingBuffer *>(instance)->readBytes(
+                buffer, static_cast<size_t>(length)));
+        };
+        serial.cbInstanceReadRealtime = [](void *instance, char *buffer, int length) {
+            return static_cast<int>(static_cast<RxRingBuffer *>(instance)->readRealtime(
+                buffer, static_cast<size_t>(length)));
+        };
+        serial.cbWrite = cbWrite;
+        return serial;
+    }
+
+  private:
+    // readBytes() can take a '\n' before push() has counted it. The difference is
+    // then negative for a moment, which is treated as no complete line.
+    Index completeLines() const
+    {
+        Index lines =
+            static_cast<Index>(atomicLoadAcquire(&m_linesPushed) - m_linesPopped);
+        return lines > capacity ? 0 : lines;
+    }
+
+    void countDroppedByte()
+    {
+        atomicStoreRelease(&m_droppedBytes, static_cast<Index>(m_droppedBytes + 1));
+    }
+
+    size_t realtimeCount() const
+    {
+        return static_cast<Index>(atomicLoadAcquire(&m_realtimeHead) - m_realtimeTail);
+    }
+
+    size_t dataCount() const
+    {
+        return static_cast<Index>(atomicLoadAcquire(&m_head) - m_tail);
+    }
+
+    char m_data[capacity];
+    char m_realtime[GCGP_RX_REALTIME_QUEUE_SIZE];
+
+    // Written by the producer only
+    Index m_head = 0;
+    Index m_realtimeHead = 0;
+    Index m_linesPushed = 0;
+    Index m_droppedBytes = 0;
+
+    // Written by the consumer only
+    Index m_tail = 0;
+    Index m_realtimeTail = 0;
+    Index m_linesPopped = 0;
+};
+
+#endif // GCGP_RXRINGBUFFER_H
+#endif // __cplusplus
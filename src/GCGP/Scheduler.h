@@ -0,0 +1,91 @@
+#ifdef __cplusplus
+#ifndef GCGP_SCHEDULER_H
+#define GCGP_SCHEDULER_H
+
+#include "GCGP/Clock.h"
+#include "GCGP/Config.h"
+
+// All times in microseconds
+struct SchedulerTask {
+    // Gets the time left of the tick, 0 if the tick has no budget
+    void (*cbRun)(void *, uint32_t) = nullptr;
+    void *instance = nullptr;
+    uint8_t priority = 0;  // Higher ones run first
+    uint32_t period = 0;   // 0 to be due in every tick
+    uint32_t deadline = 0; // After it is due, 0 for its period
+    uint32_t due = 0;
+
+    uint32_t runs = 0;
+    uint32_t missed = 0; // Runs after their deadline
+    uint32_t maxLateness = 0;
+    uint32_t maxDuration = 0;
+
+    // Absolute, or as far as the clock can tell apart without a deadline
+    uint32_t absoluteDeadline() const
+    {
+        uint32_t relative = deadline ? deadline : period;
+        return due + (relative ? relative : INT32_MAX);
+    }
+};
+
+/// @brief Cooperative scheduler for the main loop, so that the time between two calls
+///        of e.g. the step generator stays bounded while the host streams.
+/// @details Every tick() runs the tasks that are due, each at most once: the highest
+///          priority first, and of equal priorities the earliest deadline. The first
+///          due task always runs; further ones only while the budget of the tick
+///          lasts. A task that misses its deadline is counted, and a task that falls
+///          more than a period behind skips the periods it missed instead of running
+///          them back to back. Tasks cannot be interrupted, so each should bound its own
+///          work with the time it gets, like GrblInterface::scheduledUpdate().
+///
+///          Usage:
+///              Scheduler scheduler;
+///              scheduler.add(GrblInterface::scheduledUpdate, &grbl, 1, 0, 2000);
+///              scheduler.add(printStatus, &machine, 0, 200000);
+///              while (true) {
+///                  stepGenerator.update(); // Outside, every loop
+///                  scheduler.tick(500);
+///              }
+class Scheduler {
+  public:
+    uint32_t (*cbMicroseconds)(void *) = nullptr; // The clock, GCGP_CLOCK_US() if not set
+
+    Scheduler(void *instance = nullptr);
+
+    // Due right away. Returns the index of the task, -1 without cbRun or if there are
+    // already GCGP_SCHEDULER_MAX_TASKS.
+    int add(void (*cbRun)(void *, uint32_t), void *instance, uint8_t priority,
+            uint32_t period = 0, uint32_t deadline = 0);
+
+    // Runs the due tasks within the budget, 0 for no limit. Returns how many ran.
+    size_t tick(uint32_t microseconds = 0);
+
+    size_t size() const
+    {
+        return m_count;
+    }
+
+    const SchedulerTask &operator[](size_t index) const
+    {
+        return m_tasks[index];
+    }
+
+    // Of all ticks so far
+    uint32_t maxTickDuration() const
+    {
+        return m_maxTickDuration;
+    }
+
+  private:
+    uint32_t now() const;
+    void run(SchedulerTask &task, uint32_t time, uint32_t budget);
+    static bool before(const SchedulerTask &a, const SchedulerTask &b);
+
+    SchedulerTask m_tasks[GCGP_SCHEDULER_MAX_TASKS];
+    size_t m_count = 0;
+    uint32_t m_maxTickDuration = 0;
+    void *m_instance = nullptr;
+};
+
+#endif // GCGP_SCHEDULER_H
+#endif // __cplusplus
@@ -7,9 +7,25 @@ struct SerialInterface {
     int (*cbPeek)() = nullptr;
     int (*cbRead)() = nullptr;
     void (*cbWrite)(const char *) = nullptr;
+    int (*cbReadBytes)(char *, int) = nullptr; // Optional, read() is used otherwise
+
+    // Alternative callbacks taking a user instance, for serial ports that are objects
+    // rather than globals (e.g. many simulated sessions in one process). If set, they
+    // take precedence over the plain callbacks above.
+    void *instance = nullptr;
+    int (*cbInstanceAvailable)(void *) = nullptr;
+    int (*cbInstancePeek)(void *) = nullptr;
+    int (*cbInstanceRead)(void *) = nullptr;
+    void (*cbInstanceWrite)(void *, const char *) = nullptr;
+    int (*cbInstanceReadBytes)(void *, char *, int) = nullptr;
+    // Optional, for buffers that queue real-time commands apart from the line data
+    int (*cbInstanceReadRealtime)(void *, char *, int) = nullptr;
 
     int available() const
     {
+        if (cbInstanceAvailable != nullptr) {
+            return cbInstanceAvailable(instance);
+        }
         if (cbAvailable == nullptr) {
             return 0;
         }
@@ -18,6 +34,9 @@ struct SerialInterface {
 
     int peek() const
     {
+        if (cbInstancePeek != nullptr) {
+            return cbInstancePeek(instance);
+        }
         if (cbPeek == nullptr) {
             return 0;
         }
@@ -26,14 +45,52 @@ struct SerialInterface {
 
     int read() const
     {
+        if (cbInstanceRead != nullptr) {
+            return cbInstanceRead(instance);
+        }
         if (cbRead == nullptr) {
             return 0;
         }
         return cbRead();
     }
 
+    // Reads up to length bytes at once and returns how many were read. Without a
+    // batch callback, this falls back to reading byte by byte.
+    int readBytes(char *buffer, int length) const
+    {
+        if (cbInstanceReadBytes != nullptr) {
+            return cbInstanceReadBytes(instance, buffer, length);
+        }
+        if (cbReadBytes != nullptr) {
+            return cbReadBytes(buffer, length);
+        }
+        int count = 0;
+        while (count < length && available() > 0) {
+            int c = read();
+            if (c < 0) {
+                break;
+            }
+            buffer[count++] = static_cast<char>(c);
+        }
+        return count;
+    }
+
+    // Reads up to length real-time commands that were queued on their own, without
+    // touching the line data. Returns how many, 0 without such a queue.
+    int readRealtime(char *buffer, int length) const
+    {
+        if (cbInstanceReadRealtime != nullptr) {
+            return cbInstanceReadRealtime(instance, buffer, length);
+        }
+        return 0;
+    }
+
     void write(const char *str) const
     {
+        if (cbInstanceWrite != nullptr) {
+            cbInstanceWrite(instance, str);
+            return;
+        }
         if (cbWrite == nullptr) {
             return;
         }
@@ -57,6 +114,12 @@ struct SerialInterface {
         : cbAvailable(cbAvailable), cbPeek(cbPeek), cbRead(cbRead), cbWrite(cbWrite)
     {
     }
+    SerialInterface(void *instance, int (*cbAvailable)(void *), int (*cbPeek)(void *),
+                    int (*cbRead)(void *), void (*cbWrite)(void *, const char *))
+        : instance(instance), cbInstanceAvailable(cbAvailable), cbInstancePeek(cbPeek),
+          cbInstanceRead(cbRead), cbInstanceWrite(cbWrite)
+    {
+    }
 };
 
 #endif // GCGP_SERIAL_H
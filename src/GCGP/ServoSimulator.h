@@ -0,0 +1,163 @@
+#ifdef __cplusplus
+#ifndef GCGP_SERVOSIMULATOR_H
+#define GCGP_SERVOSIMULATOR_H
+
+// Like the machine simulator, only for desktop hosts
+#if !defined(ARDUINO)
+
+#include "GCGP/Config.h"
+#include "GCGP/Feedback.h"
+#include "GCGP/SetpointGenerator.h"
+#include "GCGP/VirtualUart.h"
+
+struct ServoAxisSettings {
+    // Plant: a mass on a viscous damper, driven by a force
+    float mass = 5.f;       // kg, moved by the axis
+    float damping = 50.f;   // N/(m/s)
+    float maxForce = 500.f; // N, of the drive
+
+    float resolution = 0.001f; // mm per encoder count, 0 for an exact position
+
+    // Controller: PID on the position error, with feed-forward of the setpoint
+    float kp = 200.f;                    // N/mm
+    float ki = 0.f;                      // N/(mm*s)
+    float kd = 1.5f;                     // N/(mm/s), on the velocity error
+    float velocityFeedForward = 0.f;     // N/(mm/s), ideally damping / 1000
+    float accelerationFeedForward = 0.f; // N/(mm/s^2), ideally mass / 1000
+};
+
+/// @brief One simulated servo axis: controller, drive, plant and encoder.
+/// @details Every tick, the controller computes the force from the encoder position
+///          and the setpoint, the drive limits it to maxForce, and the plant moves
+///          under it for one period. The plant is integrated exactly for a force
+///          that is constant during the period, so the simulation is stable at any
+///          rate. The integral stops while the force is limited in the direction of
+///          the error, to avoid windup.
+///
+///          Usage:
+///              ServoAxis axis(settings, 1.f / servoRate);
+///              float force = axis.tick(setPosition, setVelocity, setAcceleration);
+///              float measured = axis.encoderPosition();
+class ServoAxis {
+  public:
+    ServoAxis(const ServoAxisSettings &settings = ServoAxisSettings(),
+              float period = 0.001f);
+
+    // Changes the settings or the period, e.g. when tuning
+    void configure(const ServoAxisSettings &settings, float period);
+
+    // Runs the controller and the plant for one period. Returns the force, in N.
+    float tick(float setPosition, float setVelocity, float setAcceleration);
+
+    // Applies a force for one period without the controller, e.g. to identify the
+    // plant
+    void applyForce(float force);
+
+    // Moves the axis to rest at the position, in mm, and resets the controller
+    void setPosition(float position);
+
+    float encoderPosition() const
+    {
+        return m_encoderPosition;
+    }
+
+    float position() const // mm, of the plant
+    {
+        return m_position;
+    }
+
+    float velocity() const // mm/s, of the plant
+    {
+        return m_velocity;
+    }
+
+  private:
+    float readEncoder() const;
+
+    ServoAxisSettings m_settings;
+    float m_period;
+    float m_decay;          // Of the velocity over one period
+    float m_decayIntegral;  // Integral of the decay over one period, in s
+    float m_position = 0.f; // mm
+    float m_velocity = 0.f; // mm/s
+    float m_encoderPosition = 0.f;
+    float m_integral = 0.f; // mm*s
+};
+
+struct ServoSimulatorSettings {
+    SetpointSettings setpoints; // Its servoRate is the rate of the simulated loop
+    ServoAxisSettings axes[GCGP_NUM_AXES];
+    FollowingErrorSettings feedback; // Its servoRate is set from setpoints
+};
+
+// One tick of all axes, for following error traces
+struct ServoSample {
+    double time;                         // s, virtual
+    float setPosition[GCGP_NUM_AXES];    // mm
+    float actualPosition[GCGP_NUM_AXES]; // mm, from the encoders
+    float error[GCGP_NUM_AXES];          // mm, actual - set
+    float force[GCGP_NUM_AXES];          // N
+};
+
+/// @brief A closed-loop machine on a virtual clock: a SetpointGenerator feeds one
+///        ServoAxis per axis.
+/// @details Moves are queued like on the controller, and every tick runs the setpoint
+///          generator and all axes for one servo period and publishes the result to
+///          a FollowingErrorMonitor. The clock only moves with the ticks, so a job
+///          runs as fast as the host can compute, thousands of times faster than
+///          real time, and every run gives the same result. cbSample receives every
+///          tick, e.g. to write following error traces for tuning. The acceleration
+///          feed-forward uses the change of the setpoint velocity, which includes
+///          the centripetal acceleration on arcs.
+///
+///          Usage:
+///              ServoSimulator simulator(settings);
+///              simulator.cbSample = writeTrace;
+///              simulator.addCommand(command); // Ticks while the generator is full
+///              simulator.run(0.1f);           // Until idle, then settles for 0.1 s
+///              float rms = snapshot.rmsError(0);
+class ServoSimulator {
+  public:
+    ServoSimulator(const ServoSimulatorSettings &settings = ServoSimulatorSettings());
+    ServoSimulator(const ServoSimulator &) = delete;
+    ServoSimulator &operator=(const ServoSimulator &) = delete;
+
+    void (*cbSample)(void *, const ServoSample &sample) = nullptr;
+    void *instance = nullptr;
+
+    // Queues the move of the command. While the generator is full, the simulation
+    // runs until there is space.
+    GrblError addCommand(const Command<10> &command);
+
+    // One servo period
+    void tick();
+
+    // Ticks until the generator is idle, then for settleTime more seconds. Returns
+    // the number of ticks.
+    uint64_t run(float settleTime = 0.f);
+
+    const VirtualClock &clock() const
+    {
+        return m_clock;
+    }
+
+    uint64_t ticks() const
+    {
+        return m_ticks;
+    }
+
+    SetpointGenerator generator;
+    FollowingErrorMonitor monitor;
+    ServoAxis axes[GCGP_NUM_AXES];
+
+  private:
+    VirtualClock m_clock;
+    uint64_t m_period; // ns
+    uint64_t m_ticks = 0;
+    float m_lastVelocity[GCGP_NUM_AXES];
+    ServoSample m_sample;
+};
+
+#endif // !defined(ARDUINO)
+#endif // GCGP_SERVOSIMULATOR_H
+#endif // __cplusplus
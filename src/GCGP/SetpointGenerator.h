@@ -0,0 +1,129 @@
+#ifdef __cplusplus
+#ifndef GCGP_SETPOINTGENERATOR_H
+#define GCGP_SETPOINTGENERATOR_H
+
+#include "GCGP/Atomic.h"
+#include "GCGP/Command.h"
+#include "GCGP/Config.h"
+#include "GCGP/Move.h"
+
+struct SetpointSettings {
+    float servoRate = 1000.f;     // Hz
+    float maxRate[GCGP_NUM_AXES]; // mm/min, rapids run at this rate
+    float acceleration = 100.f;   // mm/s^2, along the path and centripetal on arcs
+    float jerk = 2000.f;          // mm/s^3, along the path
+
+    SetpointSettings()
+    {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            maxRate[i] = 500.f;
+        }
+    }
+};
+
+/// @brief Jerk-limited (S-curve) motion profile from standstill to standstill.
+/// @details The profile consists of seven phases of constant jerk: jerk up, constant
+///          acceleration, jerk down, cruise, and the same mirrored for braking.
+///          Phases that are not needed have a duration of 0, for example if the
+///          distance is too short to reach the maximum velocity.
+struct SCurveProfile {
+    float distance = 0.f;
+    float duration = 0.f;
+    float peakVelocity = 0.f;
+    float phaseEnd[7];      // s, since the start of the profile
+    float phaseJerk[7];     // Jerk during the phase
+    float phaseState[7][3]; // Position, velocity and acceleration at its start
+
+    void plan(float distance, float maxVelocity, float maxAcceleration, float jerk);
+
+    // Position, velocity and acceleration at the given time within the given phase
+    void evaluate(int phase, float time, float &position, float &velocity,
+                  float &acceleration) const;
+};
+
+struct Setpoint {
+    float position[GCGP_NUM_AXES]; // mm
+    float velocity[GCGP_NUM_AXES]; // mm/s
+    float pathVelocity = 0.f;      // mm/s
+    float pathAcceleration = 0.f;  // mm/s^2
+};
+
+/// @brief Generates position and velocity setpoints for servo loops at a fixed rate.
+/// @details Linear and arc moves are queued in a ring of GCGP_SETPOINT_BUFFER_SIZE
+///          moves, and each one is run along a jerk-limited S-curve profile from
+///          standstill to standstill, which is computed when the move is added.
+///          tick() advances by one servo period and only evaluates the current
+///          phase polynomial and the path, so its cost is constant and it does not
+///          allocate. It is meant to be called from the servo interrupt, while
+///          moves are added from the main loop. The buffer is a single-producer
+///          single-consumer ring like RxRingBuffer, so no locks are needed.
+///
+///          Usage:
+///              SetpointGenerator generator(settings);
+///              generator.addCommand(command);               // Main loop
+///              const Setpoint &setpoint = generator.tick(); // Servo interrupt
+class SetpointGenerator {
+  public:
+    SetpointGenerator(const SetpointSettings &settings = SetpointSettings());
+
+    // Resolves the command with modalState and queues its move, if any. Jogs do not
+    // change modalState.
+    GrblError addCommand(const Command<10> &command);
+
+    // Returns false if the buffer is full
+    bool addMove(const Move &move);
+
+    // Advances by one servo period
+    const Setpoint &tick();
+
+    const Setpoint &setpoint() const
+    {
+        return m_setpoint;
+    }
+
+    bool isFull() const
+    {
+        return numberOfMoves() >= GCGP_SETPOINT_BUFFER_SIZE;
+    }
+
+    bool isIdle() const
+    {
+        return numberOfMoves() == 0;
+    }
+
+    // The end position of the last queued move, in mm
+    const float *position() const
+    {
+        return m_position;
+    }
+
+    // Sets the position, for example after homing. The generator must be idle.
+    void setPosition(const float position[GCGP_NUM_AXES]);
+
+    SetpointSettings settings;
+    ModalState modalState;
+
+  private:
+    uint8_t numberOfMoves() const
+    {
+        return static_cast<uint8_t>(atomicLoadAcquire(&m_head) -
+                                    atomicLoadAcquire(&m_tail));
+    }
+
+    float maxVelocity(const Move &move) const;
+    void finishMove();
+
+    Move m_moves[GCGP_SETPOINT_BUFFER_SIZE];
+    SCurveProfile m_profiles[GCGP_SETPOINT_BUFFER_SIZE];
+    uint8_t m_head = 0; // Written by addMove() only
+    uint8_t m_tail = 0; // Written by tick() only
+    int m_phase = 0;
+    uint32_t m_ticks = 0;     // Since the start of the current move
+    float m_startTime = 0.f; // s, the rest of a period carried over from the last move
+
+    float m_position[GCGP_NUM_AXES];
+    Setpoint m_setpoint;
+};
+
+#endif // GCGP_SETPOINTGENERATOR_H
+#endif // __cplusplus
@@ -0,0 +1,63 @@
+#ifdef __cplusplus
+#ifndef GCGP_SIMD_H
+#define GCGP_SIMD_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+// Vectors of four floats for the batch functions, which is SSE2 on x86-64 and NEON on
+// ARM. They use the vector extensions of GCC and Clang, so that one code path serves
+// both. Elsewhere, e.g. on AVR or a Cortex-M0 where GCC would emulate the vectors lane
+// by lane, GCGP_SIMD_LANES is not defined, and the batch functions only use their
+// scalar loop.
+#if defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON)) // Also Clang
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#define GCGP_SIMD_LANES 4
+typedef float FloatVector __attribute__((vector_size(16)));
+typedef int32_t MaskVector __attribute__((vector_size(16))); // All bits set if true
+
+static inline FloatVector splatVector(float value)
+{
+    return FloatVector{ value, value, value, value };
+}
+
+// The arrays need no alignment, memcpy() becomes an unaligned load or store
+static inline FloatVector loadVector(const float *values)
+{
+    FloatVector vector;
+    memcpy(&vector, values, sizeof(vector));
+    return vector;
+}
+
+static inline void storeVector(float *values, FloatVector vector)
+{
+    memcpy(values, &vector, sizeof(vector));
+}
+
+// Zero where the mask is not set
+static inline FloatVector selectVector(MaskVector mask, FloatVector value)
+{
+    return reinterpret_cast<FloatVector>(mask & reinterpret_cast<MaskVector>(value));
+}
+
+static inline FloatVector sqrtVector(FloatVector value)
+{
+#if defined(__SSE__)
+    return _mm_sqrt_ps(value);
+#else
+    for (int lane = 0; lane < GCGP_SIMD_LANES; lane++) {
+        value[lane] = sqrtf(value[lane]);
+    }
+    return value;
+#endif
+}
+
+#endif // defined(__GNUC__) && (defined(__SSE2__) || defined(__ARM_NEON))
+
+#endif // GCGP_SIMD_H
+#endif // __cplusplus
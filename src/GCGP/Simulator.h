@@ -0,0 +1,172 @@
+#ifdef __cplusplus
+#ifndef GCGP_SIMULATOR_H
+#define GCGP_SIMULATOR_H
+
+// Headless simulation of a whole machine for desktop hosts, e.g. regression tests of
+// G-code jobs. It is never needed on the controller itself.
+#if !defined(ARDUINO)
+
+#include "GCGP/Config.h"
+#include "GCGP/Feedback.h"
+#include "GCGP/GrblInterface.h"
+#include "GCGP/Planner.h"
+#include "GCGP/VirtualUart.h"
+
+struct SimulatorSettings {
+    PlannerSettings planner;
+    FollowingErrorSettings feedback;
+    UartSettings uart;
+    float spindleDelay = 0.f; // s, waited after M3 and M4, like a spin-up time
+    float pollPeriod = 0.f;   // s between calls to update(), 0 for every byte
+
+    SimulatorSettings()
+    {
+        uart.baudRate = 0; // An ideal link, unless one is configured
+    }
+};
+
+// What happened so far in a simulation
+struct SimulationReport {
+    double time = 0.;              // s, virtual
+    uint32_t lines = 0;            // Answered by GrblInterface
+    uint32_t errors = 0;           // Answered with an error
+    uint32_t rejected = 0;         // Accepted by GrblInterface, but not by the planner
+    uint32_t blocks = 0;           // Executed planner blocks
+    double distance = 0.;          // mm, along the path
+    double motionTime = 0.;        // s, while a block was executed
+    double spindleTime = 0.;       // s, with the spindle on
+    double dwellTime = 0.;         // s, of G4
+    float position[GCGP_NUM_AXES]; // mm, machine coordinates
+};
+
+enum class StreamingMode {
+    SendResponse,      // The next line is sent after the answer to the last one
+    CharacterCounting, // As many lines as fit into the RX buffer of GrblInterface
+};
+
+/// @brief A GrblInterface with a simulated host and machine, on a virtual clock.
+/// @details The host streams lines over a VirtualUart. The machine has a planner,
+///          executes its blocks along their trapezoidal profiles, switches the
+///          spindle with M3, M4 and M5, dwells on G4 and publishes its position to a
+///          FollowingErrorMonitor for the status report. Nothing sleeps. Instead, the
+///          clock jumps to the next event: a byte that arrives, the end of a block,
+///          or the host getting ready after its latency. A job of hours is thereby
+///          simulated in about the time the parser and the planner need for it, with
+///          the same code that runs on the controller. With a realistic link, the
+///          report shows whether the serial line or the machine limits the job.
+///
+///          sendLine() sends one line and waits for its answer, stream() sends all
+///          lines of cbNextLine like a sender. Both skip empty lines, which are not
+///          answered. M0, M1, M2, M30, G4 and spindle changes wait for the planned
+///          motion to finish, like in GRBL. M0 and M1 do not pause, as there is
+///          nobody to resume.
+///
+///          Usage:
+///              MachineSimulator simulator;
+///              while (readLine(file, line)) {
+///                  if (!simulator.sendLine(line)) {
+///                      printf("Line %u: %s\n", lineNumber, simulator.response());
+///                  }
+///              }
+///              simulator.finish(); // Runs the remaining motion
+///              printf("%.1f s\n", simulator.report().time);
+class MachineSimulator {
+  public:
+    MachineSimulator(const SimulatorSettings &settings = SimulatorSettings());
+    MachineSimulator(const MachineSimulator &) = delete;
+    MachineSimulator &operator=(const MachineSimulator &) = delete;
+
+    // Called for every line that the host receives, including status reports
+    void (*cbOutput)(void *, const char *line) = nullptr;
+    // Called for every error answer, with the number of the line, from 1 on
+    void (*cbError)(void *, uint32_t lineNumber, const char *error) = nullptr;
+    // The next line for stream(), without its newline, or nullptr at the end. It must
+    // stay valid until the next call.
+    const char *(*cbNextLine)(void *) = nullptr;
+    void *instance = nullptr;
+
+    // Sends one line without its newline and waits for the answer. Returns false if
+    // it is an error, see response().
+    bool sendLine(const char *line);
+
+    // Sends the lines of cbNextLine and waits for the last answer
+    void stream(StreamingMode mode);
+
+    // Sends a real-time command, e.g. '?', and waits until it was answered
+    void sendRealtime(char command);
+
+    // Runs until the machine is idle and nothing is on the wire
+    void finish();
+
+    // The last "ok" or "error:..." line
+    const char *response() const
+    {
+        return m_response;
+    }
+
+    const SimulationReport &report() const
+    {
+        return m_report;
+    }
+
+    const VirtualClock &clock() const
+    {
+        return m_clock;
+    }
+
+    bool spindleOn() const
+    {
+        return m_spindle != SpindleAction::Stop;
+    }
+
+  private:
+    VirtualClock m_clock; // Before uart, which refers to it
+
+  public:
+    VirtualUart uart;
+    Planner planner;
+    FollowingErrorMonitor monitor;
+    GrblInterface grbl;
+    SimulatorSettings settings;
+
+  private:
+    static bool isEmptyLine(const char *line);
+    void runController();
+    bool advance(); // To the next event. Returns false if nothing will happen anymore.
+    void advanceTo(uint64_t time);
+    bool startBlock();
+    void finishBlock();
+    void runUntilIdle();
+    void processCommand(const Command<10> &command);
+
+    void queueLine(const char *line);
+    void sendPendingBytes();
+    void receiveAnswers();
+
+    SimulationReport m_report;
+    SpindleAction m_spindle = SpindleAction::Stop;
+    float m_feedrate = 0.f; // mm/min, of the executing block
+    bool m_moving = false;
+    uint64_t m_blockEnd = 0;
+    uint64_t m_nextPoll = 0;
+
+    // The host
+    const char *m_sending = nullptr; // The line that is being put on the wire
+    size_t m_sendingLength = 0;      // With its newline
+    size_t m_sendingOffset = 0;
+    uint64_t m_hostReadyAt = 0;
+    uint32_t m_lineNumber = 0;
+    uint32_t m_inFlightLines[GCGP_RX_BUFFER_SIZE]; // Sent and not answered yet
+    size_t m_inFlightBytes[GCGP_RX_BUFFER_SIZE];
+    size_t m_inFlightStart = 0;
+    size_t m_inFlightCount = 0;
+    size_t m_inFlightTotal = 0; // Bytes
+    char m_hostLine[GCGP_MAX_COMMAND_LENGTH + 32];
+    size_t m_hostLineLength = 0;
+    char m_response[GCGP_MAX_COMMAND_LENGTH + 32];
+    bool m_lastAnswerIsError = false;
+};
+
+#endif // !defined(ARDUINO)
+#endif // GCGP_SIMULATOR_H
+#endif // __cplusplus
@@ -0,0 +1,52 @@
+#ifdef __cplusplus
+#ifndef GCGP_SOFTLIMITS_H
+#define GCGP_SOFTLIMITS_H
+
+#include "GCGP/Config.h"
+#include "GCGP/Move.h"
+
+/// @brief The travel of the machine, in machine coordinates, like GRBL's $20 and
+///        $130-$132.
+/// @details check() tests one target, e.g. of a jog. transformAndCheck() converts and
+///          tests a whole parsed program at once, to verify a job on the host before
+///          it is sent. Its targets are stored as one array per axis, so that four
+///          moves are processed per instruction with SSE2 or NEON. On compilers
+///          without vector extensions, a scalar loop is used instead.
+///
+///          Usage:
+///              float x[n], y[n], z[n];  // Absolute program coordinates
+///              const float *program[] = { x, y, z };
+///              float *machine[] = { x, y, z };  // In place
+///              std::vector<AxisBits> violations(n);
+///              size_t count = limits.transformAndCheck(planner.modalState.transform(),
+///                                                      program, machine,
+///                                                      violations.data(), n);
+struct SoftLimits {
+    bool enabled = false;
+    float min[GCGP_NUM_AXES]; // mm
+    float max[GCGP_NUM_AXES]; // mm
+
+    // GRBL homes to the positive end, the travel then extends into negative
+    SoftLimits()
+    {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            min[i] = -200.f;
+            max[i] = 0.f;
+        }
+    }
+
+    // A bit per axis whose target is outside of the travel. NAN is never outside.
+    // Like transformAndCheck(), this does not look at enabled.
+    AxisBits check(const float target[GCGP_NUM_AXES]) const;
+
+    // Converts count targets with the transform and sets a bit per axis outside of the
+    // travel in violations. program and machine may be the same arrays. Returns the
+    // number of moves with a violation.
+    size_t transformAndCheck(const CoordinateTransform &transform,
+                             const float *const program[GCGP_NUM_AXES],
+                             float *const machine[GCGP_NUM_AXES], AxisBits *violations,
+                             size_t count) const;
+};
+
+#endif // GCGP_SOFTLIMITS_H
+#endif // __cplusplus
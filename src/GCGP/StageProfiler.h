@@ -0,0 +1,173 @@
+#ifdef __cplusplus
+#ifndef GCGP_STAGEPROFILER_H
+#define GCGP_STAGEPROFILER_H
+
+// Profiling on desktop hosts, to budget the controller before flashing it
+#if !defined(ARDUINO)
+
+#include "GCGP/Command.h"
+#include "GCGP/Config.h"
+#include "GCGP/Serial.h"
+
+// What a block goes through, in this order. A block with an error skips the stages
+// after it to the response.
+enum class PipelineStage {
+    Tokenize, // tokenizeCommand()
+    Parse,    // Command::interpret(), the words into the fields of the command
+    Validate, // Command::validate(), the checks across words
+    Dispatch, // cbProcessCommand, e.g. into the planner
+    Respond,  // "ok" or the error message, formatted and written
+};
+#define GCGP_NUM_PIPELINE_STAGES 5
+
+enum class PerfCounter {
+    Instructions,
+    Branches,
+    BranchMisses,
+    CacheMisses,
+};
+#define GCGP_NUM_PERF_COUNTERS 4
+
+/// @brief The hardware performance counters of the calling thread, in user space.
+/// @details Opened with perf_event_open() on Linux as one group, so all of them are
+///          read at once. Counters the CPU or the kernel does not provide, e.g. in a
+///          virtual machine or with a high perf_event_paranoid, are not available
+///          and read as 0. On other systems none are.
+class PerfCounters {
+  public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool available(PerfCounter counter) const
+    {
+        return m_index[static_cast<int>(counter)] >= 0;
+    }
+
+    bool anyAvailable() const
+    {
+        return m_leader >= 0;
+    }
+
+    // The counts since the counters were opened
+    void read(uint64_t values[GCGP_NUM_PERF_COUNTERS]) const;
+
+  private:
+    int m_fds[GCGP_NUM_PERF_COUNTERS];
+    int m_index[GCGP_NUM_PERF_COUNTERS]; // In the group read, -1 if not available
+    int m_leader = -1;
+    int m_count = 0;
+};
+
+// One stage, summed over all blocks that reached it
+struct StageCost {
+    uint64_t blocks = 0;
+    uint64_t nanoseconds = 0; // Wall time
+    uint64_t counts[GCGP_NUM_PERF_COUNTERS] = {};
+    uint64_t maxNanoseconds = 0;  // Of a single block
+    uint64_t maxInstructions = 0; // Of a single block
+
+    double perBlock(PerfCounter counter) const
+    {
+        return blocks ? static_cast<double>(counts[static_cast<int>(counter)]) / blocks
+                      : 0.;
+    }
+
+    double nanosecondsPerBlock() const
+    {
+        return blocks ? static_cast<double>(nanoseconds) / blocks : 0.;
+    }
+};
+
+/// @brief Cost model of the command pipeline: instructions, branches, branch misses
+///        and cache misses of every stage per block, across a corpus of lines.
+/// @details Every line runs through the same code as in GrblInterface, one stage at a
+///          time, and the counters are read between the stages. The cost of reading
+///          them is measured when the profiler is created and subtracted. Instruction
+///          counts hardly depend on the host, unlike the wall time, so their ratios
+///          between stages and lines carry over to the controller: multiply them by
+///          the instructions per cycle of the target, e.g. measured for one stage on
+///          it, to budget its cycles before flashing. Without hardware counters, only
+///          the wall time is measured.
+///
+///          Usage:
+///              StageProfiler profiler(planner);
+///              profiler.cbProcessCommand = [](void *planner, Command<10> *command) {
+///                  ...
+///              };
+///              while (fgets(line, sizeof(line), file)) {
+///                  profiler.addLine(line, strcspn(line, "\r\n"));
+///              }
+///              profiler.print(serial);
+class StageProfiler {
+  public:
+    void (*cbProcessCommand)(void *, Command<10> *) = nullptr; // Measured as Dispatch
+
+    StageProfiler(void *instance = nullptr);
+
+    // Runs one line without its newline through all stages it reaches
+    void addLine(const char *line, size_t length);
+
+    const StageCost &cost(PipelineStage stage) const
+    {
+        return m_costs[static_cast<int>(stage)];
+    }
+
+    // All stages of a block together, with the most expensive block as maximum
+    const StageCost &total() const
+    {
+        return m_total;
+    }
+
+    uint64_t blocks() const
+    {
+        return m_total.blocks;
+    }
+
+    uint64_t errors() const
+    {
+        return m_errors;
+    }
+
+    bool countersAvailable() const
+    {
+        return m_counters.anyAvailable();
+    }
+
+    // A table of the cost per block of every stage and of all together
+    void print(const SerialInterface &serial) const;
+
+    static const char *stageName(PipelineStage stage);
+
+  private:
+    void begin();
+    void elapsed(uint64_t counts[GCGP_NUM_PERF_COUNTERS], uint64_t &nanoseconds) const;
+    void end(PipelineStage stage);
+    static void add(StageCost &cost, const uint64_t counts[GCGP_NUM_PERF_COUNTERS],
+                    uint64_t nanoseconds);
+    static void printRow(const SerialInterface &serial, const char *name,
+                         const StageCost &cost, const PerfCounters &counters);
+    static void discardResponse(void *instance, const char *str);
+
+    PerfCounters m_counters;
+    uint64_t m_overhead[GCGP_NUM_PERF_COUNTERS]; // Of one begin() and end()
+    uint64_t m_overheadNanoseconds;
+    uint64_t m_start[GCGP_NUM_PERF_COUNTERS] = {};
+    uint64_t m_startNanoseconds = 0;
+
+    StageCost m_costs[GCGP_NUM_PIPELINE_STAGES];
+    StageCost m_total;
+    uint64_t m_line[GCGP_NUM_PERF_COUNTERS] = {}; // Of the current block so far
+    uint64_t m_lineNanoseconds = 0;
+    uint64_t m_errors = 0;
+    uint64_t m_responseBytes = 0;
+    CommandTokens<10> m_tokens;
+    Command<10> m_command;
+    SerialInterface m_response;
+    void *m_instance = nullptr;
+};
+
+#endif // !defined(ARDUINO)
+#endif // GCGP_STAGEPROFILER_H
+#endif // __cplusplus
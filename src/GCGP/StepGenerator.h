@@ -0,0 +1,151 @@
+#ifdef __cplusplus
+#ifndef GCGP_STEPGENERATOR_H
+#define GCGP_STEPGENERATOR_H
+
+#include "GCGP/Atomic.h"
+#include "GCGP/Config.h"
+#include "GCGP/Kinematics.h"
+#include "GCGP/Planner.h"
+
+// Adaptive multi-axis step smoothing: below these step rates, the interrupt runs 2,
+// 4 or 8 times as often as steps are made, so that the Bresenham algorithm can place
+// the steps of the slower axes more evenly.
+#define GCGP_STEP_MAX_AMASS_LEVEL 3
+#define GCGP_STEP_AMASS_LEVEL1_RATE 8000 // Hz
+#define GCGP_STEP_AMASS_LEVEL2_RATE 4000 // Hz
+#define GCGP_STEP_AMASS_LEVEL3_RATE 2000 // Hz
+
+struct StepperSettings {
+    float stepsPerMm[GCGP_NUM_AXES];
+    uint32_t timerFrequency = 16000000; // Hz, of the timer driving the interrupt
+    float segmentFrequency = 400.f;     // Hz, the speed is constant within a segment
+    AxisBits directionInvertMask = 0;
+
+    // Maps the block targets to joints, stepsPerMm are then per joint. The steps count
+    // from joint position 0, so the planner must start at its forward() position.
+    Kinematics kinematics;
+
+    StepperSettings()
+    {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            stepsPerMm[i] = 80.f;
+        }
+    }
+};
+
+// The steps of one planner block, scaled by the maximum AMASS level
+struct StepBlock {
+    uint32_t steps[GCGP_NUM_AXES];
+    uint32_t stepEventCount;
+    AxisBits directionBits;
+};
+
+// A piece of a block with a constant step rate
+struct StepSegment {
+    uint32_t stepCount; // Interrupts, including the extra ones of AMASS
+    uint32_t period;    // Timer ticks between the interrupts
+    uint8_t block;      // Index of its StepBlock
+    uint8_t amassLevel;
+};
+
+/// @brief Bresenham step/dir generator for open-loop machines, fed by the planner.
+/// @details prepare() runs in the main loop. It takes the current planner block,
+///          cuts its trapezoid into segments of 1 / segmentFrequency seconds with a
+///          constant step rate, and queues them in a ring of
+///          GCGP_STEP_SEGMENT_BUFFER_SIZE segments. The block is discarded from the
+///          planner once it is fully segmented.
+///
+///          tick() runs in the step timer interrupt. It makes one Bresenham step
+///          over all axes and returns the step bits to pulse. Its work is constant,
+///          and the timer must then be set to period(). The segment ring is a
+///          single-producer single-consumer ring like RxRingBuffer, so no locks are
+///          needed.
+///
+///          Usage:
+///              ISR(TIMER1_COMPA_vect) {
+///                  AxisBits steps = stepper.tick();
+///                  DIR_PORT = stepper.directionBits();
+///                  STEP_PORT = steps;  // And reset after the pulse width
+///                  OCR1A = stepper.period();
+///              }
+///              void loop() { grbl.update(); stepper.prepare(planner); }
+class StepGenerator {
+  public:
+    StepGenerator(const StepperSettings &settings = StepperSettings());
+
+    // Fills the segment buffer from the planner. Returns the number of new segments.
+    size_t prepare(Planner &planner);
+
+    // One step interrupt. Returns a bit per axis that must make a step.
+    AxisBits tick();
+
+    // A bit per axis that moves in negative direction, after the invert mask
+    AxisBits directionBits() const
+    {
+        return m_directionBits;
+    }
+
+    // Timer ticks until the next call of tick()
+    uint32_t period() const
+    {
+        return m_period;
+    }
+
+    // Whether tick() has segments to execute
+    bool isRunning() const
+    {
+        return numberOfSegments() > 0;
+    }
+
+    bool isFull() const
+    {
+        return numberOfSegments() >= GCGP_STEP_SEGMENT_BUFFER_SIZE;
+    }
+
+    // Machine position in steps, updated by tick()
+    const int32_t *position() const
+    {
+        return m_position;
+    }
+
+    // Drops all segments and the block being prepared, keeping the position
+    void reset();
+
+    StepperSettings settings;
+
+  private:
+    uint8_t numberOfSegments() const
+    {
+        return static_cast<uint8_t>(atomicLoadAcquire(&m_segmentHead) -
+                                    atomicLoadAcquire(&m_segmentTail));
+    }
+
+    bool startBlock(Planner &planner);
+    float speedAt(float distance) const;
+    float advance(float distance, float &time) const;
+
+    // Written by prepare() only
+    StepBlock m_blocks[GCGP_STEP_SEGMENT_BUFFER_SIZE + 1];
+    StepSegment m_segments[GCGP_STEP_SEGMENT_BUFFER_SIZE];
+    uint8_t m_segmentHead = 0;
+    uint8_t m_blockHead = 0;
+    const PlannerBlock *m_prepBlock = nullptr;
+    float m_prepDistance = 0.f; // mm, into the block
+    float m_prepStepsPerMm = 0.f;
+    uint32_t m_prepSteps = 0; // Steps of the block that are already in segments
+    int32_t m_prepPosition[GCGP_NUM_AXES]; // Steps, at the end of the queued blocks
+
+    // Written by tick() only
+    uint8_t m_segmentTail = 0;
+    uint8_t m_executingBlock = 0xFF;
+    uint32_t m_stepsLeft = 0;
+    uint32_t m_axisSteps[GCGP_NUM_AXES];
+    uint32_t m_eventCount = 0;
+    uint32_t m_counter[GCGP_NUM_AXES];
+    AxisBits m_directionBits = 0;
+    uint32_t m_period = 0;
+    int32_t m_position[GCGP_NUM_AXES];
+};
+
+#endif // GCGP_STEPGENERATOR_H
+#endif // __cplusplus
@@ -0,0 +1,172 @@
+#ifdef __cplusplus
+#ifndef GCGP_TRACE_H
+#define GCGP_TRACE_H
+
+#include "GCGP/Config.h"
+
+// Clock of the timestamps, and its ticks per microsecond. On the controller, micros()
+// by default, or e.g. the cycle counter of a Cortex-M for a finer resolution:
+//   #define GCGP_TRACE_CLOCK() (DWT->CYCCNT)
+//   #define GCGP_TRACE_TICKS_PER_US 168
+// The timestamps may wrap around, as long as no two records are further apart.
+#ifndef GCGP_TRACE_CLOCK
+#ifdef ARDUINO
+#define GCGP_TRACE_CLOCK() micros()
+#define GCGP_TRACE_TICKS_PER_US 1
+#else
+uint64_t traceClockNanoseconds();
+#define GCGP_TRACE_CLOCK() traceClockNanoseconds()
+#define GCGP_TRACE_TICKS_PER_US 1000
+#endif
+#endif
+
+#ifndef GCGP_TRACE_TIMESTAMP_TYPE
+#ifdef ARDUINO
+#define GCGP_TRACE_TIMESTAMP_TYPE uint32_t
+#else
+#define GCGP_TRACE_TIMESTAMP_TYPE uint64_t
+#endif
+#endif
+typedef GCGP_TRACE_TIMESTAMP_TYPE TraceTimestamp;
+
+// The stages a line goes through. Parse encloses its own three steps.
+enum class TraceEvent : uint8_t {
+    Receive,    // GrblInterface::receiveBytes(), the arg is the number of bytes
+    Realtime,   // A real-time command, the arg is its byte
+    BufferFull, // Lines wait because cbBufferIsFull, until it is not any more
+    Parse,      // Command::parse(), the arg is the GrblError
+    Tokenize,   // The arg is the GrblError
+    Interpret,  // The arg is the GrblError
+    Validate,   // The arg is the GrblError
+    Callback,   // cbProcessCommand or cbJog
+    Transmit,   // An answer or a status report, the arg is the GrblError if any
+};
+#define GCGP_NUM_TRACE_EVENTS 9
+
+enum class TracePhase : uint8_t {
+    Begin,
+    End,
+};
+
+struct TraceRecord {
+    TraceTimestamp timestamp;
+    TraceEvent event;
+    TracePhase phase;
+    uint16_t arg;
+};
+
+/// @brief Fixed ring buffer of the latest trace records, where the time of a line
+///        went.
+/// @details Records are written by the tracepoints, which are only compiled in with
+///          GCGP_ENABLE_TRACE. Without it, they are empty and cost nothing. When the
+///          buffer is full, the oldest records are overwritten. Only trace from the
+///          main loop, the buffer is not safe to write from an interrupt.
+///
+///          Usage:
+///              GCGP_TRACE_BEGIN(Parse);
+///              GrblError error = command.parse(line, length);
+///              GCGP_TRACE_END(Parse, error);
+///          And on the desktop, after a stall:
+///              writeChromeTrace(traceBuffer, cbWrite, file);
+class TraceBuffer {
+  public:
+    void record(TraceEvent event, TracePhase phase, uint16_t arg)
+    {
+        TraceRecord &record = m_records[m_next];
+        record.timestamp = static_cast<TraceTimestamp>(GCGP_TRACE_CLOCK());
+        record.event = event;
+        record.phase = phase;
+        record.arg = arg;
+        m_next = (m_next + 1) % GCGP_TRACE_BUFFER_SIZE;
+        if (m_size < GCGP_TRACE_BUFFER_SIZE) {
+            m_size++;
+        }
+        else if (m_dropped < UINT32_MAX) {
+            m_dropped++;
+        }
+    }
+
+    // Records in the buffer, at most GCGP_TRACE_BUFFER_SIZE
+    size_t size() const
+    {
+        return m_size;
+    }
+
+    // Records that were overwritten
+    uint32_t dropped() const
+    {
+        return m_dropped;
+    }
+
+    // The oldest record is at index 0
+    const TraceRecord &operator[](size_t index) const
+    {
+        return m_records[(m_next + GCGP_TRACE_BUFFER_SIZE - m_size + index) %
+                         GCGP_TRACE_BUFFER_SIZE];
+    }
+
+    void clear()
+    {
+        m_next = 0;
+        m_size = 0;
+        m_dropped = 0;
+    }
+
+  private:
+    TraceRecord m_records[GCGP_TRACE_BUFFER_SIZE];
+    size_t m_next = 0;
+    size_t m_size = 0;
+    uint32_t m_dropped = 0;
+};
+
+#if GCGP_ENABLE_TRACE
+
+// All tracepoints write into this one
+extern TraceBuffer traceBuffer;
+
+// Begin and end of a span, for a function with many returns
+struct TraceScope {
+    TraceEvent event;
+    uint16_t arg;
+
+    TraceScope(TraceEvent event, uint16_t arg) : event(event), arg(arg)
+    {
+        traceBuffer.record(event, TracePhase::Begin, arg);
+    }
+
+    ~TraceScope()
+    {
+        traceBuffer.record(event, TracePhase::End, arg);
+    }
+};
+
+#define GCGP_TRACE_BEGIN(event)                                                          \
+    traceBuffer.record(TraceEvent::event, TracePhase::Begin, 0)
+#define GCGP_TRACE_END(event, arg)                                                       \
+    traceBuffer.record(TraceEvent::event, TracePhase::End, static_cast<uint16_t>(arg))
+#define GCGP_TRACE_SCOPE(event, arg)                                                     \
+    TraceScope traceScope(TraceEvent::event, static_cast<uint16_t>(arg))
+
+#else
+
+// The args are not evaluated, only referenced, so they are not unused
+#define GCGP_TRACE_BEGIN(event) ((void)0)
+#define GCGP_TRACE_END(event, arg) ((void)sizeof(arg))
+#define GCGP_TRACE_SCOPE(event, arg) ((void)sizeof(arg))
+
+#endif // GCGP_ENABLE_TRACE
+
+#if !defined(ARDUINO)
+
+const char *traceEventName(TraceEvent event);
+
+// Writes the records as Chrome trace JSON, which chrome://tracing and Perfetto open.
+// Spans are written as complete events with their duration. Spans whose begin was
+// overwritten, or that have not ended yet, are left out.
+void writeChromeTrace(const TraceBuffer &buffer,
+                      void (*cbWrite)(void *, const char *, size_t), void *instance);
+
+#endif // !defined(ARDUINO)
+
+#endif // GCGP_TRACE_H
+#endif // __cplusplus
@@ -0,0 +1,119 @@
+#ifdef __cplusplus
+#ifndef GCGP_VIRTUALUART_H
+#define GCGP_VIRTUALUART_H
+
+// Like the simulator, only for desktop hosts
+#if !defined(ARDUINO)
+
+#include "GCGP/Config.h"
+#include "GCGP/Serial.h"
+
+// Bytes on the wire in each direction, and the largest receive FIFO
+#define GCGP_VIRTUAL_UART_BUFFER_SIZE 1024
+
+// Simulated time, it only moves when the simulation says so
+struct VirtualClock {
+    uint64_t now = 0; // ns
+
+    double seconds() const
+    {
+        return static_cast<double>(now) * 1e-9;
+    }
+
+    static uint64_t fromSeconds(double seconds)
+    {
+        return static_cast<uint64_t>(seconds * 1e9 + 0.5);
+    }
+};
+
+struct UartSettings {
+    uint32_t baudRate = 115200; // 0 is infinitely fast, with flow control
+    uint8_t frameBits = 10;     // Per byte: start bit, 8 data bits and stop bit
+    uint16_t rxFifoDepth = 64;  // Bytes the controller holds until they are read
+    bool flowControl = false;   // RTS/CTS: the host waits instead of overrunning
+    float hostLatency = 0.f;    // s, from an answer to the next send, e.g. USB polling
+};
+
+/// @brief A serial link between a simulated host and a controller, on a virtual clock.
+/// @details Every byte takes frameBits / baudRate on the wire, and bytes are sent one
+///          after another. On the controller side, arrived bytes wait in a receive
+///          FIFO of rxFifoDepth bytes until they are read through serial(). Bytes that
+///          arrive while it is full are lost, like on a real UART without flow
+///          control, and counted by lostBytes(). Bytes only move when the clock does,
+///          so throughput limits and overruns of a serial link show up in a
+///          simulation that runs much faster than real time.
+///
+///          Usage:
+///              VirtualUart uart(clock, settings);
+///              GrblInterface grbl(uart.serial(), machine);
+///              uart.hostWrite("G1 X10 F100\n", 12);
+///              clock.now = uart.nextArrival();
+///              grbl.update();
+class VirtualUart {
+  public:
+    VirtualUart(const VirtualClock &clock, const UartSettings &settings = UartSettings());
+    VirtualUart(const VirtualUart &) = delete;
+    VirtualUart &operator=(const VirtualUart &) = delete;
+
+    // Host side. Returns how many bytes fit on the wire.
+    size_t hostWrite(const char *data, size_t length);
+    int hostRead(); // -1 if nothing arrived yet
+
+    // Controller side
+    SerialInterface serial();
+
+    // The next time a byte arrives at either side, or UINT64_MAX if none will. Bytes
+    // that wait for space in a full FIFO with flow control are not counted.
+    uint64_t nextArrival();
+
+    // Whether bytes are on the wire or in the FIFO towards the controller
+    bool pendingToController();
+
+    // Bytes in the FIFO, which the controller can read right now
+    size_t readable();
+
+    // Whether no byte is on the wire or unread, in both directions
+    bool isIdle();
+
+    uint32_t lostBytes() const
+    {
+        return m_lostBytes;
+    }
+
+    // The time to transmit one byte, in ns
+    uint64_t byteTime() const;
+
+    UartSettings settings;
+
+  private:
+    // Bytes in transmission, with the time they arrive
+    struct Channel {
+        char data[GCGP_VIRTUAL_UART_BUFFER_SIZE];
+        uint64_t arrival[GCGP_VIRTUAL_UART_BUFFER_SIZE];
+        size_t start = 0;
+        size_t count = 0;
+        uint64_t lastArrival = 0;
+
+        size_t push(const char *bytes, size_t length, uint64_t now, uint64_t byteTime);
+        void pop();
+    };
+
+    static int available(void *instance);
+    static int peek(void *instance);
+    static int read(void *instance);
+    static void write(void *instance, const char *str);
+
+    void receive(); // Moves the arrived bytes into the FIFO
+
+    const VirtualClock &m_clock;
+    Channel m_toController;
+    Channel m_toHost;
+    char m_fifo[GCGP_VIRTUAL_UART_BUFFER_SIZE];
+    size_t m_fifoStart = 0;
+    size_t m_fifoCount = 0;
+    uint32_t m_lostBytes = 0;
+};
+
+#endif // !defined(ARDUINO)
+#endif // GCGP_VIRTUALUART_H
+#endif // __cplusplus
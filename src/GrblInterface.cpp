@@ -1,5 +1,7 @@
 
 #include "GCGP/GrblInterface.h"
+#include "GCGP/Realtime.h"
+#include "GCGP/Trace.h"
 
 GrblInterface::GrblInterface(const SerialInterface &serialInterface, void *instance)
     : m_serial(serialInterface), m_instance(instance)
@@ -7,27 +9,125 @@ GrblInterface::GrblInterface(const SerialInterface &serialInterface, void *insta
     m_serial.println(GCGP_WELCOME_MESSAGE);
 }
 
-// This function reads the serial interface as long as there is data, and
-// stops when an entire command has been parsed. Then, the command is parsed,
-// a callback is called, the command is removed and the function returns.
-void GrblInterface::update()
+// This function reads everything that arrived on the serial interface. Real-time
+// commands are executed right away, wherever they are in the stream. All other bytes
+// are parsed into commands as long as the buffer is not full, and for every complete
+// command a callback is called. The buffer is checked before every line, as every
+// command can fill it further. A budget stops the lines early; the rest waits in the
+// RX buffer for the next call, and the serial interface holds back the host meanwhile.
+bool GrblInterface::update(const UpdateBudget &budget)
 {
-    // If we see there is an immediate command pending, handle it (even if buffer is full)
-    if (m_serial.peek() == GCGP_CMD_CYCLE_START ||
-        m_serial.peek() == GCGP_CMD_FEED_HOLD || m_serial.peek() == GCGP_CMD_SOFT_RESET ||
-        m_serial.peek() == GCGP_CMD_STATUS_REPORT) {
-        parseSingleByte();
-    }
+    receiveBytes();
 
-    bool bufferFull = false;
-    if (cbBufferIsFull) {
-        bufferFull = cbBufferIsFull(m_instance);
+    uint32_t start = budget.microseconds ? GCGP_CLOCK_US() : 0;
+    uint32_t bytes = 0;
+    uint32_t lines = 0;
+    while (m_rxBufferCount > 0) {
+        bool lineStart = m_commandBufferIndex == 0 && !m_discardingCommand;
+        if ((budget.bytes && bytes >= budget.bytes) ||
+            (budget.lines && lines >= budget.lines) ||
+            (lineStart && budget.microseconds &&
+             GCGP_CLOCK_US() - start >= budget.microseconds)) {
+            return true;
+        }
+#if GCGP_ENABLE_METRICS
+        if (lineStart && !m_lineStarted) {
+            m_lineStarted = true;
+            m_lineStart = GCGP_METRICS_CLOCK_US();
+        }
+#endif
+        if (lineStart && cbBufferIsFull) {
+            bool full = cbBufferIsFull(m_instance);
+            if (full && !m_bufferFull) {
+                GCGP_TRACE_BEGIN(BufferFull);
+#if GCGP_ENABLE_METRICS
+                m_bufferFullSince = GCGP_METRICS_CLOCK_US();
+#endif
+            }
+            else if (!full && m_bufferFull) {
+                GCGP_TRACE_END(BufferFull, 0);
+#if GCGP_ENABLE_METRICS
+                m_metrics.addBufferFull(GCGP_METRICS_CLOCK_US() - m_bufferFullSince);
+#endif
+            }
+            m_bufferFull = full;
+            if (full) {
+                break;
+            }
+        }
+        char c = m_rxBuffer[m_rxBufferStart];
+        m_rxBufferStart = (m_rxBufferStart + 1) % GCGP_RX_BUFFER_SIZE;
+        m_rxBufferCount--;
+        parseSingleByte(c);
+        bytes++;
+        if (c == '\n') {
+            lines++;
+        }
     }
+    return false;
+}
+
+void GrblInterface::scheduledUpdate(void *grbl, uint32_t microseconds)
+{
+    UpdateBudget budget;
+    budget.microseconds = microseconds;
+    static_cast<GrblInterface *>(grbl)->update(budget);
+}
 
-    if (!bufferFull) {
-        while (m_serial.available() > 0) {
-            parseSingleByte();
+// Moves all available bytes from the serial interface into the RX buffer, taking out
+// the real-time commands on the way. Once the RX buffer is full, only real-time
+// commands are read: the ones the serial interface queues on their own, like
+// RxRingBuffer, and the ones next in the stream. A host counting characters never has
+// more line bytes outstanding than GCGP_RX_BUFFER_SIZE, so its real-time commands are
+// executed within one update() of their arrival, even while cbBufferIsFull holds the
+// lines back. The cost per call is bounded by GCGP_RX_BUFFER_SIZE bytes plus the
+// real-time commands.
+void GrblInterface::receiveBytes()
+{
+    char chunk[GCGP_RX_CHUNK_SIZE];
+    size_t received = 0;
+    uint32_t realtimeCommands = 0;
+    while (true) {
+        int count = m_serial.readRealtime(chunk, static_cast<int>(sizeof(chunk)));
+        if (count <= 0 && m_rxBufferCount < GCGP_RX_BUFFER_SIZE) {
+            size_t space = GCGP_RX_BUFFER_SIZE - m_rxBufferCount;
+            size_t length = space < sizeof(chunk) ? space : sizeof(chunk);
+            count = m_serial.readBytes(chunk, static_cast<int>(length));
+        }
+        else if (count <= 0 && m_serial.available() > 0) {
+            int next = m_serial.peek();
+            if (next >= 0 && isRealtimeCommand(static_cast<char>(next))) {
+                chunk[0] = static_cast<char>(m_serial.read());
+                count = 1;
+            }
         }
+        if (count <= 0) { // No new data, or only line data without room for it
+            break;
+        }
+        if (received == 0) { // Traced only with data, not for every poll
+            GCGP_TRACE_BEGIN(Receive);
+        }
+        received += static_cast<size_t>(count);
+
+        for (int i = 0; i < count; i++) {
+            if (isRealtimeCommand(chunk[i])) {
+                executeRealtimeCommand(chunk[i]);
+                realtimeCommands++;
+            }
+            else {
+                m_rxBuffer[(m_rxBufferStart + m_rxBufferCount) % GCGP_RX_BUFFER_SIZE] =
+                    chunk[i];
+                m_rxBufferCount++;
+            }
+        }
+    }
+    if (received > 0) {
+        GCGP_TRACE_END(Receive, received);
+#if GCGP_ENABLE_METRICS
+        m_metrics.addReceivedBytes(static_cast<uint32_t>(received), realtimeCommands);
+#else
+        (void)realtimeCommands;
+#endif
     }
 }
 
@@ -36,13 +136,43 @@ static bool isPrintableCharacter(char c)
     return c >= 32 && c <= 126;
 }
 
-void GrblInterface::parseSingleByte()
+void GrblInterface::parseSingleByte(char c)
 {
-    char c = m_serial.read();
     switch (c) {
-        case -1: // No new data: do nothing
+        case '\r': // Carriage return is ignored, Line feed is crucial
+            break;
+
+        case '\n':
+            if (m_discardingCommand) {
+                m_discardingCommand = false;
+            }
+            else {
+                finishCommand();
+            }
             break;
 
+        default:
+            if (m_discardingCommand) {
+                break;
+            }
+            if (isPrintableCharacter(c)) {
+                appendCharacter(c);
+            }
+            else {
+                char str[64];
+                snprintf(str, sizeof(str), "Unknown character: 0x%x",
+                         static_cast<uint8_t>(c));
+                printError(str);
+                discardCommand(); // Get rid of rest of command
+            }
+            break;
+    }
+}
+
+void GrblInterface::executeRealtimeCommand(char c)
+{
+    GCGP_TRACE_SCOPE(Realtime, static_cast<uint8_t>(c));
+    switch (c) {
         case GCGP_CMD_STATUS_REPORT:
             printStatusReport();
             break;
@@ -60,86 +190,244 @@ void GrblInterface::parseSingleByte()
             break;
 
         case GCGP_CMD_SOFT_RESET:
-            if (cbCycleStart) {
-                cbCycleStart(m_instance);
+            if (cbSoftReset) {
+                cbSoftReset(m_instance);
             }
             break;
 
-        case '\r': // Carriage return is ignored, Line feed is crucial
+        case GCGP_CMD_JOG_CANCEL:
+            if (cbJogCancel) {
+                cbJogCancel(m_instance);
+            }
             break;
 
-        case '\n':
-            finishCommand();
+        case GCGP_CMD_SAFETY_DOOR:
+            if (cbSafetyDoor) {
+                cbSafetyDoor(m_instance);
+            }
             break;
 
-        default:
-            if (isPrintableCharacter(c)) {
-                appendCharacter(c);
+        case GCGP_CMD_COOLANT_FLOOD_OVR_TOGGLE:
+            if (cbToggleFloodCoolant) {
+                cbToggleFloodCoolant(m_instance);
             }
-            else {
-                char str[64];
-                snprintf(str, sizeof(str), "Unknown character: 0x%x", (int)c);
-                printError(str);
-                flushSerialCommand(); // Get rid of rest of command
+            break;
+
+        case GCGP_CMD_COOLANT_MIST_OVR_TOGGLE:
+            if (cbToggleMistCoolant) {
+                cbToggleMistCoolant(m_instance);
+            }
+            break;
+
+        default: // Feed, rapid and spindle overrides, or an undefined byte
+            if (m_overrides.apply(c) && cbOverridesChanged) {
+                cbOverridesChanged(m_instance, &m_overrides);
             }
             break;
     }
 }
 
-void GrblInterface::flushSerialCommand()
+// The rest of the line is dropped as it arrives rather than read in a loop here, so
+// that real-time commands within it are still executed.
+void GrblInterface::discardCommand()
 {
-    char c = '\0';
-    do {
-        c = m_serial.read();
-    } while (c != '\n' && c != -1);
+    m_commandBufferIndex = 0;
+    m_discardingCommand = true;
 }
 
+// E.g. "<Run|MPos:1.000,2.000,0.000|APos:1.002,1.998,0.000|FS:500.000,0>". MPos is
+// the set position and APos the actual one of the feedback channel; both are left
+// out without cbGetFeedback. A following error alarm reports the state Alarm.
 void GrblInterface::printStatusReport()
 {
+    GCGP_TRACE_SCOPE(Transmit, 0);
+    FeedbackSnapshot feedback;
+    bool hasFeedback = cbGetFeedback && cbGetFeedback(m_instance, &feedback);
+
+    const char *state = "Run";
+    if ((cbIsInAlarmState && cbIsInAlarmState(m_instance)) ||
+        (hasFeedback && feedback.alarmAxes)) {
+        state = "Alarm";
+    }
+    else if (cbIsInJogState && cbIsInJogState(m_instance)) {
+        state = "Jog";
+    }
+    else if (cbIsIdle && cbIsIdle(m_instance)) {
+        state = "Idle";
+    }
+    m_serial.write("<");
+    m_serial.write(state);
+
+    if (hasFeedback) {
+        printAxes("|MPos:", feedback.setPosition);
+        printAxes("|APos:", feedback.actualPosition);
+    }
 
-    // glm::vec3 desired = GetDesiredPosition();
-    // glm::vec3 actual = GetActualPosition();
+    m_serial.write("|FS:");
+    float feedrate = cbGetFeedrate ? cbGetFeedrate(m_instance) : 0.f;
+    char str[24];
+    formatFloat(str, sizeof(str), feedrate);
+    m_serial.write(str);
+    m_serial.println(",0>");
+}
 
-    // char str[100];
-    // snprintf(str, 100,
-    // "<%s,MPos:%d.%03d,%d.%03d,%d.%03d,WPos:%d.%03d,%d.%03d,%d.%03d,F:%d>",
-    // GetStateString(), 	(int)desired.x, (int)(fabsf(desired.x) * 1000) % 1000,
-    // 	(int)desired.y, (int)(fabsf(desired.y) * 1000) % 1000,
-    // 	(int)desired.z, (int)(fabsf(desired.z) * 1000) % 1000,
-    // 	(int)actual.x, (int)(fabsf(actual.x) * 1000) % 1000,
-    // 	(int)actual.y, (int)(fabsf(actual.y) * 1000) % 1000,
-    // 	(int)actual.z, (int)(fabsf(actual.z) * 1000) % 1000,
-    // 	(int)GetFeedrate()
-    // );
-    // Serial.println(str);
+// Without %f, which is missing from the printf of many embedded C libraries. The value
+// is clamped so that its thousandths fit in a 32-bit long, NaN is printed as such.
+void GrblInterface::formatFloat(char *str, size_t size, float value)
+{
+    if (isnan(value)) {
+        snprintf(str, size, "nan");
+        return;
+    }
+    long thousandths = lroundf(fminf(fabsf(value), 1e6f) * 1000.f);
+    snprintf(str, size, "%s%ld.%03ld", value < 0.f && thousandths ? "-" : "",
+             thousandths / 1000, thousandths % 1000);
+}
+
+void GrblInterface::printAxes(const char *label, const float values[GCGP_NUM_AXES])
+{
+    m_serial.write(label);
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        char str[24];
+        formatFloat(str, sizeof(str), values[i]);
+        if (i > 0) {
+            m_serial.write(",");
+        }
+        m_serial.write(str);
+    }
+}
+
+void GrblInterface::printResponse(const SerialInterface &serial, GrblError error)
+{
+    GCGP_TRACE_SCOPE(Transmit, error);
+    if (error == GrblError::None) {
+        serial.println(GCGP_OK_MESSAGE);
+        return;
+    }
+    serial.write(GCGP_ERROR_MESSAGE);
+    serial.println(ErrorEnumToString(error));
 }
 
 void GrblInterface::printOk()
 {
-    m_serial.println(GCGP_OK_MESSAGE);
+    countAnswer(true, GrblError::None);
+    printResponse(m_serial, GrblError::None);
 }
 
+// An error without a code, counted among the other errors
 void GrblInterface::printError(const char *error)
 {
+    GCGP_TRACE_SCOPE(Transmit, 0);
+    countAnswer(false, GrblError::None);
     m_serial.write(GCGP_ERROR_MESSAGE);
     m_serial.println(error);
 }
 
 void GrblInterface::printError(GrblError error)
 {
-    printError(ErrorEnumToString(error));
+    countAnswer(false, error);
+    printResponse(m_serial, error);
+}
+
+// The latency of a line ends with its first answer
+void GrblInterface::countAnswer(bool ok, GrblError error)
+{
+#if GCGP_ENABLE_METRICS
+    uint32_t latency = GCGP_METRICS_CLOCK_US() - m_lineStart;
+    if (ok) {
+        m_metrics.addOk(m_lineStarted, latency);
+    }
+    else {
+        m_metrics.addError(error, m_lineStarted, latency);
+    }
+    m_lineStarted = false;
+#else
+    (void)ok;
+    (void)error;
+#endif
+}
+
+#if GCGP_ENABLE_METRICS
+// E.g. "[MET:RX:1520,RT:3,LN:40,OK:39,ERR:1]" and "[MET:ERR:20=1,OTHER=0]", then a
+// histogram of the line latency, the parse time and the time the buffer was full:
+// "[MET:LAT:40,182,950|0,0,0,0,0,0,2,25,12,1]" is the count, the mean and the max in
+// us, then the buckets up to the last one that is not empty.
+void GrblInterface::printMetrics()
+{
+    GCGP_TRACE_SCOPE(Transmit, 0);
+    const MetricsSnapshot &metrics = m_metrics.current();
+    m_serial.write("[MET:RX:");
+    printNumber(metrics.bytesReceived);
+    m_serial.write(",RT:");
+    printNumber(metrics.realtimeCommands);
+    m_serial.write(",LN:");
+    printNumber(metrics.linesParsed);
+    m_serial.write(",OK:");
+    printNumber(metrics.ok);
+    m_serial.write(",ERR:");
+    printNumber(metrics.errors);
+    m_serial.println("]");
+
+    m_serial.write("[MET:ERR:");
+    for (const MetricsErrorCount &entry : metrics.errorCodes) {
+        if (entry.code != 0) {
+            printNumber(entry.code);
+            m_serial.write("=");
+            printNumber(entry.count);
+            m_serial.write(",");
+        }
+    }
+    m_serial.write("OTHER=");
+    printNumber(metrics.otherErrors);
+    m_serial.println("]");
+
+    printHistogram("LAT", metrics.lineLatency);
+    printHistogram("PARSE", metrics.parseTime);
+    printHistogram("FULL", metrics.bufferFullTime);
+}
+
+void GrblInterface::printHistogram(const char *name, const MetricsHistogram &histogram)
+{
+    m_serial.write("[MET:");
+    m_serial.write(name);
+    m_serial.write(":");
+    printNumber(histogram.count);
+    m_serial.write(",");
+    printNumber(histogram.count ? static_cast<uint32_t>(histogram.sum / histogram.count)
+                                : 0);
+    m_serial.write(",");
+    printNumber(histogram.max);
+    m_serial.write("|");
+    size_t used = GCGP_METRICS_HISTOGRAM_BUCKETS;
+    while (used > 1 && histogram.buckets[used - 1] == 0) {
+        used--;
+    }
+    for (size_t i = 0; i < used; i++) {
+        if (i > 0) {
+            m_serial.write(",");
+        }
+        printNumber(histogram.buckets[i]);
+    }
+    m_serial.println("]");
+}
+
+void GrblInterface::printNumber(uint32_t value)
+{
+    char str[12];
+    snprintf(str, sizeof(str), "%lu", static_cast<unsigned long>(value));
+    m_serial.write(str);
 }
+#endif // GCGP_ENABLE_METRICS
 
 void GrblInterface::appendCharacter(char c)
 {
     m_commandBuffer[m_commandBufferIndex++] = c;
     if (m_commandBufferIndex >= GCGP_MAX_COMMAND_LENGTH) {
-        m_commandBufferIndex = 0;
         memset(m_commandBuffer, 0, GCGP_MAX_COMMAND_LENGTH);
         char str[64];
         snprintf(str, sizeof(str), "Command too long (>%d)", GCGP_MAX_COMMAND_LENGTH);
         printError(str);
-        flushSerialCommand();
+        discardCommand();
     }
 }
 
@@ -150,26 +438,51 @@ void GrblInterface::finishCommand()
     if (m_commandBuffer[0] != '\0') {
         processCommand(m_commandBuffer);
     }
+#if GCGP_ENABLE_METRICS
+    m_lineStarted = false; // An empty line has no answer
+#endif
 }
 
 void GrblInterface::processCommand(const char *command)
 {
+#if GCGP_ENABLE_METRICS
+    uint32_t parseStart = GCGP_METRICS_CLOCK_US();
+#endif
+    GCGP_TRACE_BEGIN(Parse);
     auto error = m_command.parse(command, strlen(command));
+    GCGP_TRACE_END(Parse, error);
+#if GCGP_ENABLE_METRICS
+    m_metrics.addParse(GCGP_METRICS_CLOCK_US() - parseStart);
+#endif
     if (error != GrblError::None) {
         printError(error);
         return;
     }
 
+#if GCGP_ENABLE_METRICS
+    // "$M", unused by GRBL, reports the metrics in any state
+    if (m_command.isSystemCommand && m_command.systemCommand.letter == 'M' &&
+        m_command.systemCommand.index == -1) {
+        printMetrics();
+        printOk();
+        return;
+    }
+#endif
+
+    if (m_command.isJog) {
+        processJogCommand();
+        return;
+    }
+
     if (m_command.isSystemCommand) {
         if (cbIsIdle) {
             if (!cbIsIdle(m_instance)) {
-                printError(ErrorEnumToString(GrblError::GrblSystemCmdOnlyValidWhenIdle));
+                printError(GrblError::GrblSystemCmdOnlyValidWhenIdle);
                 return;
             }
         }
     }
-
-    if (m_command.isGCode && m_command.isMCode) {
+    else {
         bool disallowed = false;
         if (cbIsInAlarmState) {
             if (cbIsInAlarmState(m_instance)) {
@@ -182,22 +495,49 @@ void GrblInterface::processCommand(const char *command)
             }
         }
         if (disallowed) {
-            printError(
-                ErrorEnumToString(GrblError::GCodeCommandsInvalidInAlarmOrJogState));
+            printError(GrblError::GCodeCommandsInvalidInAlarmOrJogState);
+            return;
         }
     }
 
     if (m_command.motionType != MotionType::None && isnan(m_command.setFeedrate)) {
         if (cbGetFeedrate) {
             if (isnan(cbGetFeedrate(m_instance))) {
-                printError(
-                    ErrorEnumToString(GrblError::FeedRateHasNotYetBeenSetOrIsNone));
+                printError(GrblError::FeedRateHasNotYetBeenSetOrIsNone);
+                return;
             }
         }
     }
 
     if (cbProcessCommand) {
+        GCGP_TRACE_BEGIN(Callback);
         cbProcessCommand(m_instance, &m_command);
+        GCGP_TRACE_END(Callback, 0);
+    }
+    printOk();
+}
+
+void GrblInterface::processJogCommand()
+{
+    // Jogging is allowed when idle, or to queue up more jog motions while jogging
+    bool allowed = true;
+    if (cbIsIdle) {
+        allowed = cbIsIdle(m_instance);
+    }
+    if (!allowed && cbIsInJogState) {
+        allowed = cbIsInJogState(m_instance);
+    }
+    if (!allowed) {
+        printError(GrblError::GrblSystemCmdOnlyValidWhenIdle);
+        return;
+    }
+
+    if (!cbJog) {
+        printError(GrblError::GrblSystemCmdNotRecognizedOrSupported);
+        return;
     }
+    GCGP_TRACE_BEGIN(Callback);
+    cbJog(m_instance, &m_command);
+    GCGP_TRACE_END(Callback, 0);
     printOk();
 }
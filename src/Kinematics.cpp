@@ -0,0 +1,321 @@
+
+#include "GCGP/Kinematics.h"
+#include "GCGP/Simd.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+size_t Kinematics::inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                                float *const joints[GCGP_NUM_AXES], AxisBits *unreachable,
+                                size_t count) const
+{
+    if (cbInverseBatch != nullptr) {
+        return cbInverseBatch(instance, cartesian, joints, unreachable, count);
+    }
+
+    size_t failed = 0;
+    for (size_t index = 0; index < count; index++) {
+        float point[GCGP_NUM_AXES];
+        float result[GCGP_NUM_AXES];
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            point[i] = cartesian[i][index];
+        }
+        // Without per joint results, all joints are marked
+        bool reachable = inverse(point, result);
+        const AxisBits allJoints = static_cast<AxisBits>((1 << GCGP_NUM_AXES) - 1);
+        unreachable[index] = reachable ? 0 : allJoints;
+        failed += !reachable;
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            joints[i][index] = result[i];
+        }
+    }
+    return failed;
+}
+
+// Cartesian
+
+bool CartesianKinematics::inverse(const float cartesian[GCGP_NUM_AXES],
+                                  float joints[GCGP_NUM_AXES])
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        joints[i] = cartesian[i];
+    }
+    return true;
+}
+
+bool CartesianKinematics::forward(const float joints[GCGP_NUM_AXES],
+                                  float cartesian[GCGP_NUM_AXES])
+{
+    return inverse(joints, cartesian);
+}
+
+size_t CartesianKinematics::inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                                         float *const joints[GCGP_NUM_AXES],
+                                         AxisBits *unreachable, size_t count)
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        if (joints[i] != cartesian[i]) {
+            memcpy(joints[i], cartesian[i], count * sizeof(float));
+        }
+    }
+    memset(unreachable, 0, count * sizeof(AxisBits));
+    return 0;
+}
+
+Kinematics CartesianKinematics::kinematics()
+{
+    Kinematics kinematics;
+    kinematics.instance = this;
+    kinematics.cbInverse = [](void *, const float *cartesian, float *joints) {
+        return inverse(cartesian, joints);
+    };
+    kinematics.cbForward = [](void *, const float *joints, float *cartesian) {
+        return forward(joints, cartesian);
+    };
+    kinematics.cbInverseBatch = [](void *, const float *const *cartesian,
+                                   float *const *joints, AxisBits *unreachable,
+                                   size_t count) {
+        return inverseBatch(cartesian, joints, unreachable, count);
+    };
+    return kinematics;
+}
+
+// CoreXY
+
+bool CoreXYKinematics::inverse(const float cartesian[GCGP_NUM_AXES],
+                               float joints[GCGP_NUM_AXES])
+{
+    float x = cartesian[0];
+    float y = cartesian[1];
+    joints[0] = x + y;
+    joints[1] = x - y;
+    for (int i = 2; i < GCGP_NUM_AXES; i++) {
+        joints[i] = cartesian[i];
+    }
+    return true;
+}
+
+bool CoreXYKinematics::forward(const float joints[GCGP_NUM_AXES],
+                               float cartesian[GCGP_NUM_AXES])
+{
+    float a = joints[0];
+    float b = joints[1];
+    cartesian[0] = 0.5f * (a + b);
+    cartesian[1] = 0.5f * (a - b);
+    for (int i = 2; i < GCGP_NUM_AXES; i++) {
+        cartesian[i] = joints[i];
+    }
+    return true;
+}
+
+size_t CoreXYKinematics::inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                                      float *const joints[GCGP_NUM_AXES],
+                                      AxisBits *unreachable, size_t count)
+{
+    size_t index = 0;
+#ifdef GCGP_SIMD_LANES
+    for (; index + GCGP_SIMD_LANES <= count; index += GCGP_SIMD_LANES) {
+        FloatVector x = loadVector(cartesian[0] + index);
+        FloatVector y = loadVector(cartesian[1] + index);
+        storeVector(joints[0] + index, x + y);
+        storeVector(joints[1] + index, x - y);
+    }
+#endif
+    for (; index < count; index++) {
+        float x = cartesian[0][index];
+        float y = cartesian[1][index];
+        joints[0][index] = x + y;
+        joints[1][index] = x - y;
+    }
+
+    for (int i = 2; i < GCGP_NUM_AXES; i++) {
+        if (joints[i] != cartesian[i]) {
+            memcpy(joints[i], cartesian[i], count * sizeof(float));
+        }
+    }
+    memset(unreachable, 0, count * sizeof(AxisBits));
+    return 0;
+}
+
+Kinematics CoreXYKinematics::kinematics()
+{
+    Kinematics kinematics;
+    kinematics.instance = this;
+    kinematics.cbInverse = [](void *, const float *cartesian, float *joints) {
+        return inverse(cartesian, joints);
+    };
+    kinematics.cbForward = [](void *, const float *joints, float *cartesian) {
+        return forward(joints, cartesian);
+    };
+    kinematics.cbInverseBatch = [](void *, const float *const *cartesian,
+                                   float *const *joints, AxisBits *unreachable,
+                                   size_t count) {
+        return inverseBatch(cartesian, joints, unreachable, count);
+    };
+    return kinematics;
+}
+
+// Linear delta
+
+LinearDeltaKinematics::LinearDeltaKinematics(float diagonalRod, float radius)
+    : m_diagonalRodSqr(diagonalRod * diagonalRod)
+{
+    const float angles[3] = { 210.f, 330.f, 90.f };
+    for (int tower = 0; tower < 3; tower++) {
+        float angle = angles[tower] * static_cast<float>(M_PI) / 180.f;
+        m_towerX[tower] = radius * cosf(angle);
+        m_towerY[tower] = radius * sinf(angle);
+    }
+}
+
+bool LinearDeltaKinematics::inverse(const float cartesian[GCGP_NUM_AXES],
+                                    float joints[GCGP_NUM_AXES]) const
+{
+    float x = cartesian[0];
+    float y = cartesian[1];
+    float z = cartesian[2];
+    bool reachable = true;
+    for (int tower = 0; tower < 3; tower++) {
+        float dx = x - m_towerX[tower];
+        float dy = y - m_towerY[tower];
+        float heightSqr = m_diagonalRodSqr - dx * dx - dy * dy;
+        if (heightSqr < 0.f) {
+            reachable = false;
+            heightSqr = 0.f;
+        }
+        joints[tower] = z + sqrtf(heightSqr);
+    }
+    for (int i = 3; i < GCGP_NUM_AXES; i++) {
+        joints[i] = cartesian[i];
+    }
+    return reachable;
+}
+
+// The effector is at the lower intersection of three spheres with the radius of the
+// rods around the carriages. This is trilateration in a frame with the first carriage
+// at the origin, the second on its x axis and the third in its xy plane.
+bool LinearDeltaKinematics::forward(const float joints[GCGP_NUM_AXES],
+                                    float cartesian[GCGP_NUM_AXES]) const
+{
+    const float p1[3] = { m_towerX[0], m_towerY[0], joints[0] };
+    float ex[3] = { m_towerX[1] - p1[0], m_towerY[1] - p1[1], joints[1] - p1[2] };
+    float v[3] = { m_towerX[2] - p1[0], m_towerY[2] - p1[1], joints[2] - p1[2] };
+
+    float d = sqrtf(ex[0] * ex[0] + ex[1] * ex[1] + ex[2] * ex[2]);
+    for (int k = 0; k < 3; k++) {
+        ex[k] /= d;
+    }
+    float i = ex[0] * v[0] + ex[1] * v[1] + ex[2] * v[2];
+    float ey[3];
+    for (int k = 0; k < 3; k++) {
+        ey[k] = v[k] - i * ex[k];
+    }
+    float j = sqrtf(ey[0] * ey[0] + ey[1] * ey[1] + ey[2] * ey[2]);
+    for (int k = 0; k < 3; k++) {
+        ey[k] /= j;
+    }
+    const float ez[3] = { ex[1] * ey[2] - ex[2] * ey[1], ex[2] * ey[0] - ex[0] * ey[2],
+                          ex[0] * ey[1] - ex[1] * ey[0] };
+
+    // All rods have the same length, which simplifies x and y
+    float x = 0.5f * d;
+    float y = (i * i + j * j - 2.f * i * x) / (2.f * j);
+    float zSqr = m_diagonalRodSqr - x * x - y * y;
+    if (zSqr < 0.f) {
+        return false;
+    }
+    float z = ez[2] > 0.f ? -sqrtf(zSqr) : sqrtf(zSqr);
+
+    for (int k = 0; k < 3; k++) {
+        cartesian[k] = p1[k] + x * ex[k] + y * ey[k] + z * ez[k];
+    }
+    for (int k = 3; k < GCGP_NUM_AXES; k++) {
+        cartesian[k] = joints[k];
+    }
+    return true;
+}
+
+size_t LinearDeltaKinematics::inverseBatch(const float *const cartesian[GCGP_NUM_AXES],
+                                           float *const joints[GCGP_NUM_AXES],
+                                           AxisBits *unreachable, size_t count) const
+{
+    size_t failed = 0;
+    size_t index = 0;
+
+#ifdef GCGP_SIMD_LANES
+    const FloatVector rodSqr = splatVector(m_diagonalRodSqr);
+    const FloatVector zero = splatVector(0.f);
+    FloatVector towerX[3], towerY[3];
+    for (int tower = 0; tower < 3; tower++) {
+        towerX[tower] = splatVector(m_towerX[tower]);
+        towerY[tower] = splatVector(m_towerY[tower]);
+    }
+
+    for (; index + GCGP_SIMD_LANES <= count; index += GCGP_SIMD_LANES) {
+        // All coordinates are loaded first, as the joints may be the same arrays
+        FloatVector x = loadVector(cartesian[0] + index);
+        FloatVector y = loadVector(cartesian[1] + index);
+        FloatVector z = loadVector(cartesian[2] + index);
+        MaskVector flags = {};
+        for (int tower = 0; tower < 3; tower++) {
+            FloatVector dx = x - towerX[tower];
+            FloatVector dy = y - towerY[tower];
+            FloatVector heightSqr = rodSqr - dx * dx - dy * dy;
+            MaskVector outside = heightSqr < zero;
+            flags |= outside & (1 << tower);
+            storeVector(joints[tower] + index,
+                        z + sqrtVector(selectVector(~outside, heightSqr)));
+        }
+        for (int lane = 0; lane < GCGP_SIMD_LANES; lane++) {
+            unreachable[index + lane] = static_cast<AxisBits>(flags[lane]);
+            failed += flags[lane] != 0;
+        }
+    }
+#endif
+
+    for (; index < count; index++) {
+        float x = cartesian[0][index];
+        float y = cartesian[1][index];
+        float z = cartesian[2][index];
+        AxisBits flags = 0;
+        for (int tower = 0; tower < 3; tower++) {
+            float dx = x - m_towerX[tower];
+            float dy = y - m_towerY[tower];
+            float heightSqr = m_diagonalRodSqr - dx * dx - dy * dy;
+            if (heightSqr < 0.f) {
+                flags |= 1 << tower;
+                heightSqr = 0.f;
+            }
+            joints[tower][index] = z + sqrtf(heightSqr);
+        }
+        unreachable[index] = flags;
+        failed += flags != 0;
+    }
+
+    for (int i = 3; i < GCGP_NUM_AXES; i++) {
+        if (joints[i] != cartesian[i]) {
+            memcpy(joints[i], cartesian[i], count * sizeof(float));
+        }
+    }
+    return failed;
+}
+
+Kinematics LinearDeltaKinematics::kinematics()
+{
+    Kinematics kinematics;
+    kinematics.instance = this;
+    kinematics.cbInverse = [](void *instance, const float *cartesian, float *joints) {
+        return static_cast<LinearDeltaKinematics *>(instance)->inverse(cartesian, joints);
+    };
+    kinematics.cbForward = [](void *instance, const float *joints, float *cartesian) {
+        return static_cast<LinearDeltaKinematics *>(instance)->forward(joints, cartesian);
+    };
+    kinematics.cbInverseBatch = [](void *instance, const float *const *cartesian,
+                                   float *const *joints, AxisBits *unreachable,
+                                   size_t count) {
+        return static_cast<LinearDeltaKinematics *>(instance)->inverseBatch(
+            cartesian, joints, unreachable, count);
+    };
+    return kinematics;
+}
@@ -0,0 +1,107 @@
+#include "GCGP/Metrics.h"
+
+void MetricsHistogram::add(uint32_t microseconds)
+{
+    size_t bucket = 0;
+    while (bucket < GCGP_METRICS_HISTOGRAM_BUCKETS - 1 &&
+           microseconds >= bucketEnd(bucket)) {
+        bucket++;
+    }
+    buckets[bucket]++;
+    count++;
+    sum += microseconds;
+    if (microseconds > max) {
+        max = microseconds;
+    }
+}
+
+uint32_t MetricsHistogram::bucketEnd(size_t bucket)
+{
+    if (bucket >= GCGP_METRICS_HISTOGRAM_BUCKETS - 1 || bucket >= 32) {
+        return UINT32_MAX;
+    }
+    return static_cast<uint32_t>(1ull << bucket);
+}
+
+uint32_t MetricsSnapshot::errorCount(GrblError error) const
+{
+    for (const MetricsErrorCount &entry : errorCodes) {
+        if (entry.code != 0 && entry.code == static_cast<uint16_t>(error)) {
+            return entry.count;
+        }
+    }
+    return 0;
+}
+
+void Metrics::snapshot(MetricsSnapshot &snapshot) const
+{
+    m_lock.read(m_data, snapshot);
+}
+
+void Metrics::addReceivedBytes(uint32_t count, uint32_t realtimeCommands)
+{
+    m_lock.beginWrite();
+    m_data.bytesReceived += count;
+    m_data.realtimeCommands += realtimeCommands;
+    m_lock.endWrite();
+}
+
+void Metrics::addParse(uint32_t microseconds)
+{
+    m_lock.beginWrite();
+    m_data.linesParsed++;
+    m_data.parseTime.add(microseconds);
+    m_lock.endWrite();
+}
+
+void Metrics::addOk(bool hasLatency, uint32_t latency)
+{
+    m_lock.beginWrite();
+    m_data.ok++;
+    if (hasLatency) {
+        m_data.lineLatency.add(latency);
+    }
+    m_lock.endWrite();
+}
+
+void Metrics::addError(GrblError error, bool hasLatency, uint32_t latency)
+{
+    m_lock.beginWrite();
+    m_data.errors++;
+    if (hasLatency) {
+        m_data.lineLatency.add(latency);
+    }
+    // Into the slot of the code, or the first free one
+    MetricsErrorCount *slot = nullptr;
+    for (MetricsErrorCount &entry : m_data.errorCodes) {
+        if (error == GrblError::None) {
+            break;
+        }
+        if (entry.code == static_cast<uint16_t>(error) || entry.code == 0) {
+            slot = &entry;
+            break;
+        }
+    }
+    if (slot) {
+        slot->code = static_cast<uint16_t>(error);
+        slot->count++;
+    }
+    else {
+        m_data.otherErrors++;
+    }
+    m_lock.endWrite();
+}
+
+void Metrics::addBufferFull(uint32_t microseconds)
+{
+    m_lock.beginWrite();
+    m_data.bufferFullTime.add(microseconds);
+    m_lock.endWrite();
+}
+
+void Metrics::clear()
+{
+    m_lock.beginWrite();
+    m_data = {};
+    m_lock.endWrite();
+}
@@ -0,0 +1,362 @@
+
+#include "GCGP/Move.h"
+
+#define MOVE_INCHES_TO_MM 25.4f
+#define MOVE_ARC_ANGULAR_TRAVEL_EPSILON 5e-7f // rad, below this an arc is a full circle
+#define MOVE_ARC_RADIUS_TOLERANCE 0.005f      // mm, like GRBL
+#define MOVE_TOOL_LENGTH_AXIS 2               // Z
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// A, B and C are rotary axes in degrees, which G20 does not scale
+static inline float axisScale(int axis, float scale)
+{
+    return axis >= 3 && axis <= 5 ? 1.f : scale;
+}
+
+float Move::length() const
+{
+    float lengthSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        if (isArc() && (i == axis0 || i == axis1)) {
+            continue;
+        }
+        float delta = target[i] - start[i];
+        lengthSqr += delta * delta;
+    }
+    if (isArc()) {
+        float arcLength = radius * angularTravel;
+        lengthSqr += arcLength * arcLength;
+    }
+    return sqrtf(lengthSqr);
+}
+
+void Move::evaluate(float distance, float position[GCGP_NUM_AXES],
+                    float direction[GCGP_NUM_AXES]) const
+{
+    float totalLength = length();
+    float fraction = totalLength > 0.f ? distance / totalLength : 1.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        float delta = target[i] - start[i];
+        position[i] = start[i] + delta * fraction;
+        direction[i] = totalLength > 0.f ? delta / totalLength : 0.f;
+    }
+
+    if (isArc()) {
+        float angle = startAngle + angularTravel * fraction;
+        float angularSpeed = totalLength > 0.f ? angularTravel / totalLength : 0.f;
+        float cosAngle = cosf(angle);
+        float sinAngle = sinf(angle);
+        position[axis0] = center[0] + radius * cosAngle;
+        position[axis1] = center[1] + radius * sinAngle;
+        direction[axis0] = -radius * sinAngle * angularSpeed;
+        direction[axis1] = radius * cosAngle * angularSpeed;
+    }
+}
+
+ModalState::ModalState()
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        for (int system = 0; system < GCGP_NUM_WORK_COORDINATE_SYSTEMS; system++) {
+            m_workOffsets[system][i] = 0.f;
+        }
+        m_axisOffset[i] = 0.f;
+    }
+    updateOffset();
+}
+
+void ModalState::toProgramCoordinates(const float machine[GCGP_NUM_AXES],
+                                      float program[GCGP_NUM_AXES]) const
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        program[i] = machine[i] - m_offset[i];
+    }
+}
+
+CoordinateTransform ModalState::transform() const
+{
+    CoordinateTransform transform;
+    float scale = lengthUnits == LengthUnits::Imperial ? MOVE_INCHES_TO_MM : 1.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        transform.scale[i] = axisScale(i, scale);
+        transform.offset[i] = m_offset[i];
+    }
+    return transform;
+}
+
+void ModalState::setWorkOffset(int system, const float offset[GCGP_NUM_AXES])
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_workOffsets[system][i] = offset[i];
+    }
+    updateOffset();
+}
+
+// GRBL applies nothing of a block with an error, so the block is applied to a copy
+// that only replaces the state once the whole block is valid
+GrblError ModalState::resolve(const Command<10> &command,
+                              const float position[GCGP_NUM_AXES], Move &move)
+{
+    ModalState state = *this;
+    GrblError error = state.apply(command, position, move);
+    if (error != GrblError::None) {
+        move.type = MotionType::None;
+        return error;
+    }
+    *this = state;
+    return GrblError::None;
+}
+
+GrblError ModalState::apply(const Command<10> &command,
+                            const float position[GCGP_NUM_AXES], Move &move)
+{
+    move.type = MotionType::None;
+
+    if (command.feedrateMode != FeedrateMode::None) {
+        feedrateMode = command.feedrateMode;
+    }
+    if (command.lengthUnits != LengthUnits::None) {
+        lengthUnits = command.lengthUnits;
+    }
+    if (command.distanceMode != DistanceMode::None) {
+        distanceMode = command.distanceMode;
+    }
+    if (command.arcPlaneMode != ArcPlaneMode::None) {
+        arcPlaneMode = command.arcPlaneMode;
+    }
+    if (command.motionType != MotionType::None) {
+        motionType = command.motionType;
+    }
+
+    float scale = lengthUnits == LengthUnits::Imperial ? MOVE_INCHES_TO_MM : 1.f;
+    if (!isnan(command.setFeedrate)) {
+        if (feedrateMode == FeedrateMode::InverseTime) {
+            feedrate = command.setFeedrate;
+        }
+        else {
+            feedrate = command.setFeedrate * scale;
+        }
+    }
+
+    if (command.pathControlMode != PathControlMode::None) {
+        pathControlMode = command.pathControlMode;
+        pathTolerance = 0.f;
+        if (pathControlMode == PathControlMode::Blending &&
+            !isnan(command.pathTolerance)) {
+            pathTolerance = command.pathTolerance * scale;
+        }
+    }
+
+    if (command.workCoordinateSystem >= 0) {
+        if (command.workCoordinateSystem >= GCGP_NUM_WORK_COORDINATE_SYSTEMS) {
+            return GrblError::G59xWCSAreNotSupported;
+        }
+        m_workCoordinateSystem = command.workCoordinateSystem;
+        updateOffset();
+    }
+
+    const float *words = command.pos;
+    GrblError error = resolveOffsets(command, words, scale, position);
+    if (error != GrblError::None) {
+        return error;
+    }
+
+    // The axis words of these commands are not a target
+    if (command.referencePositionAction != ReferencePositionAction::None ||
+        command.offsetAction != SetOffsetAction::None ||
+        command.axisOffsetAction != AxisOffsetAction::None ||
+        command.toolLengthOffsetAction != ToolLengthOffsetAction::None) {
+        return GrblError::None;
+    }
+
+    bool hasTarget = false;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        move.start[i] = position[i];
+        move.target[i] = position[i];
+        if (!isnan(words[i])) {
+            hasTarget = true;
+            if (command.machineCoordinates) { // G53 is always absolute
+                move.target[i] = words[i] * axisScale(i, scale);
+            }
+            else if (distanceMode == DistanceMode::Relative) {
+                move.target[i] += words[i] * axisScale(i, scale);
+            }
+            else {
+                move.target[i] = words[i] * axisScale(i, scale) + m_offset[i];
+            }
+        }
+    }
+    if (!hasTarget) {
+        return GrblError::None;
+    }
+
+    move.type = motionType;
+    if (move.isArc()) {
+        error = resolveArc(command, scale, move);
+        if (error != GrblError::None) {
+            move.type = MotionType::None;
+            return error;
+        }
+    }
+
+    move.feedrate = NAN;
+    if (move.type != MotionType::Rapid) {
+        if (feedrateMode == FeedrateMode::InverseTime) {
+            if (isnan(command.setFeedrate)) { // Must be given with every move
+                move.type = MotionType::None;
+                return GrblError::FeedRateHasNotYetBeenSetOrIsNone;
+            }
+            move.feedrate = feedrate * move.length();
+        }
+        else {
+            move.feedrate = feedrate;
+        }
+        if (isnan(move.feedrate) || move.feedrate <= 0.f) {
+            move.type = MotionType::None;
+            return GrblError::FeedRateHasNotYetBeenSetOrIsNone;
+        }
+    }
+    return GrblError::None;
+}
+
+// G10 L2/L20, G92 and G43.1 set an offset for the given axes, G92.1 and G49 clear it.
+// With L20 and G92, the offset is chosen such that the current position gets the
+// given program coordinates.
+GrblError ModalState::resolveOffsets(const Command<10> &command,
+                                     const float words[GCGP_NUM_AXES],
+                                     float scale, const float position[GCGP_NUM_AXES])
+{
+    bool changed = false;
+
+    const SetOffsetAction action = command.offsetAction;
+    if (action == SetOffsetAction::SetCoordinateSystemOffset ||
+        action == SetOffsetAction::SetCoordinateSystemOffsetToCurrentPosition) {
+        // P0 is the selected system, P1 is G54
+        int system = command.coordinateSystem == 0 ? m_workCoordinateSystem
+                                                   : command.coordinateSystem - 1;
+        if (system < 0 || system >= GCGP_NUM_WORK_COORDINATE_SYSTEMS) {
+            return GrblError::G59xWCSAreNotSupported;
+        }
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            if (isnan(words[i])) {
+                continue;
+            }
+            float word = words[i] * axisScale(i, scale);
+            if (action == SetOffsetAction::SetCoordinateSystemOffset) {
+                m_workOffsets[system][i] = word;
+            }
+            else {
+                float toolLength = i == MOVE_TOOL_LENGTH_AXIS ? m_toolLengthOffset : 0.f;
+                m_workOffsets[system][i] =
+                    position[i] - m_axisOffset[i] - toolLength - word;
+            }
+        }
+        changed = true;
+    }
+    else if (action != SetOffsetAction::None) {
+        return GrblError::FeatureNotYetImplemented; // The tool table of G10 L1/L10/L11
+    }
+
+    if (command.axisOffsetAction == AxisOffsetAction::SetAxisOffset) {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            if (!isnan(words[i])) {
+                float toolLength = i == MOVE_TOOL_LENGTH_AXIS ? m_toolLengthOffset : 0.f;
+                m_axisOffset[i] = position[i] - m_workOffsets[m_workCoordinateSystem][i] -
+                                  toolLength - words[i] * axisScale(i, scale);
+            }
+        }
+        changed = true;
+    }
+    else if (command.axisOffsetAction == AxisOffsetAction::ClearAxisOffset) {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            m_axisOffset[i] = 0.f;
+        }
+        changed = true;
+    }
+
+    if (command.toolLengthOffsetAction == ToolLengthOffsetAction::SetDynamic) {
+        m_toolLengthOffset = words[MOVE_TOOL_LENGTH_AXIS] * scale;
+        changed = true;
+    }
+    else if (command.toolLengthOffsetAction == ToolLengthOffsetAction::Cancel) {
+        m_toolLengthOffset = 0.f;
+        changed = true;
+    }
+
+    if (changed) {
+        updateOffset();
+    }
+    return GrblError::None;
+}
+
+void ModalState::updateOffset()
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_offset[i] = m_workOffsets[m_workCoordinateSystem][i] + m_axisOffset[i];
+    }
+    if (MOVE_TOOL_LENGTH_AXIS < GCGP_NUM_AXES) {
+        m_offset[MOVE_TOOL_LENGTH_AXIS] += m_toolLengthOffset;
+    }
+}
+
+// Center format arcs as in GRBL: the center is given by the offsets I, J and K from
+// the start point, and the end point must be on the same circle.
+GrblError ModalState::resolveArc(const Command<10> &command, float scale,
+                                 Move &move) const
+{
+    switch (arcPlaneMode) {
+        case ArcPlaneMode::XZ: // G18
+            move.axis0 = 2;
+            move.axis1 = 0;
+            move.linearAxis = 1;
+            break;
+        case ArcPlaneMode::YZ: // G19
+            move.axis0 = 1;
+            move.axis1 = 2;
+            move.linearAxis = 0;
+            break;
+        default: // G17
+            move.axis0 = 0;
+            move.axis1 = 1;
+            move.linearAxis = 2;
+            break;
+    }
+
+    const float offsets[3] = { command.arcI, command.arcJ, command.arcK };
+    float offset0 = isnan(offsets[move.axis0]) ? 0.f : offsets[move.axis0] * scale;
+    float offset1 = isnan(offsets[move.axis1]) ? 0.f : offsets[move.axis1] * scale;
+    if (offset0 == 0.f && offset1 == 0.f) {
+        return GrblError::G2G3ArcsNeedAtLeastOneInPlaneOffsetWord;
+    }
+
+    move.center[0] = move.start[move.axis0] + offset0;
+    move.center[1] = move.start[move.axis1] + offset1;
+    move.radius = sqrtf(offset0 * offset0 + offset1 * offset1);
+    move.startAngle = atan2f(-offset1, -offset0);
+
+    float end0 = move.target[move.axis0] - move.center[0];
+    float end1 = move.target[move.axis1] - move.center[1];
+    float radiusError = fabsf(sqrtf(end0 * end0 + end1 * end1) - move.radius);
+    if (radiusError > MOVE_ARC_RADIUS_TOLERANCE &&
+        (radiusError > 0.5f || radiusError > 0.001f * move.radius)) {
+        return GrblError::MotionCommandTargetIsInvalid;
+    }
+
+    // Angle from the start to the end vector, then wrapped into the arc direction.
+    // The same start and end point is a full circle.
+    float start0 = -offset0;
+    float start1 = -offset1;
+    move.angularTravel =
+        atan2f(start0 * end1 - start1 * end0, start0 * end0 + start1 * end1);
+    if (move.type == MotionType::ArcCW) {
+        if (move.angularTravel >= -MOVE_ARC_ANGULAR_TRAVEL_EPSILON) {
+            move.angularTravel -= 2.f * static_cast<float>(M_PI);
+        }
+    }
+    else if (move.angularTravel <= MOVE_ARC_ANGULAR_TRAVEL_EPSILON) {
+        move.angularTravel += 2.f * static_cast<float>(M_PI);
+    }
+    return GrblError::None;
+}
@@ -0,0 +1,491 @@
+
+#include "GCGP/Planner.h"
+
+#define PLANNER_MINIMUM_BLOCK_LENGTH 0.001f // mm
+#define PLANNER_MAXIMUM_BLEND_FRACTION 0.4f // Of a move, that a corner blend may use
+
+Planner::Planner(const PlannerSettings &settings) : settings(settings)
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_position[i] = 0.f;
+        m_blockPosition[i] = 0.f;
+        m_previousUnitVector[i] = 0.f;
+    }
+}
+
+GrblError Planner::addCommand(const Command<10> &command)
+{
+    // Modal changes must wait, too, until all segments of an arc are queued
+    if (!m_arc.isDone()) {
+        return GrblError::PlannerBufferFull;
+    }
+
+    // Resolved on a copy, which is kept only once the block is accepted. Jogs never
+    // change the modal state of the program.
+    ModalState state = modalState;
+    Move move;
+    GrblError error = state.resolve(command, m_position, move);
+    if (error != GrblError::None) {
+        return error;
+    }
+    if (move.type != MotionType::None) {
+        const SoftLimits &limits = settings.softLimits;
+        if (command.isJog && limits.enabled && limits.check(move.target)) {
+            return GrblError::JogTargetExceedsMachineTravelIgnored;
+        }
+        if (isFull()) {
+            return GrblError::PlannerBufferFull;
+        }
+    }
+    if (!command.isJog) {
+        modalState = state;
+    }
+    if (move.type == MotionType::None) {
+        return GrblError::None;
+    }
+    if (move.isArc()) {
+        releaseHeldMove();
+        m_arc.begin(move, settings.arcTolerance);
+        m_arcFeedrate = move.feedrate;
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            m_position[i] = move.target[i];
+        }
+        queueArcSegments();
+        return GrblError::None;
+    }
+
+    if (!addLinearMove(move.target, move.feedrate, move.type == MotionType::Rapid)) {
+        return GrblError::PlannerBufferFull;
+    }
+    return GrblError::None;
+}
+
+bool Planner::addLinearMove(const float target[GCGP_NUM_AXES], float feedrate, bool rapid)
+{
+    if (isFull()) {
+        return false;
+    }
+
+    bool blending = !rapid && modalState.pathControlMode == PathControlMode::Blending &&
+                    modalState.pathTolerance > 0.f;
+    if (!blending) {
+        releaseHeldMove();
+        queueBlock(target, feedrate, rapid);
+    }
+    else {
+        float lengthSqr = 0.f;
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            float delta = target[i] - m_position[i];
+            lengthSqr += delta * delta;
+        }
+        if (lengthSqr < PLANNER_MINIMUM_BLOCK_LENGTH * PLANNER_MINIMUM_BLOCK_LENGTH) {
+            return true;
+        }
+        if (m_hasHeldMove) {
+            blendCorner(target, feedrate);
+        }
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            m_heldTarget[i] = target[i];
+        }
+        m_heldLength = sqrtf(lengthSqr);
+        m_heldFeedrate = feedrate;
+        m_hasHeldMove = true;
+    }
+
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_position[i] = target[i];
+    }
+    return true;
+}
+
+// Queues a block from the end of the previous one. Returns false if the buffer is
+// full.
+bool Planner::queueBlock(const float target[GCGP_NUM_AXES], float feedrate, bool rapid)
+{
+    if (m_count >= GCGP_PLANNER_BUFFER_SIZE) {
+        return false;
+    }
+
+    PlannerBlock &block = m_blocks[m_head];
+    float lengthSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        float delta = target[i] - m_blockPosition[i];
+        block.unitVector[i] = delta;
+        lengthSqr += delta * delta;
+    }
+    block.millimeters = sqrtf(lengthSqr);
+    if (block.millimeters < PLANNER_MINIMUM_BLOCK_LENGTH) {
+        return true;
+    }
+
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        block.target[i] = target[i];
+        block.unitVector[i] /= block.millimeters;
+    }
+    block.rapid = rapid;
+    block.acceleration = limitByAxisMaximum(settings.acceleration, block.unitVector);
+
+    float rate = limitByAxisMaximum(settings.maxRate, block.unitVector);
+    if (!rapid && feedrate < rate) {
+        rate = feedrate;
+    }
+    float speed = rate / 60.f;
+    block.nominalSpeedSqr = speed * speed;
+
+    // The speed at the corner is limited by the junction deviation and by both
+    // nominal speeds. Without a previous block, the machine starts from standstill.
+    if (m_count == 0 || modalState.pathControlMode == PathControlMode::ExactStop) {
+        block.maxEntrySpeedSqr = 0.f;
+    }
+    else {
+        block.maxEntrySpeedSqr = junctionSpeedSqr(block);
+        if (block.maxEntrySpeedSqr > block.nominalSpeedSqr) {
+            block.maxEntrySpeedSqr = block.nominalSpeedSqr;
+        }
+        if (block.maxEntrySpeedSqr > m_previousNominalSpeedSqr) {
+            block.maxEntrySpeedSqr = m_previousNominalSpeedSqr;
+        }
+    }
+    block.entrySpeedSqr = 0.f; // Set by recalculate(), unless the entry is fixed
+
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_blockPosition[i] = target[i];
+        m_previousUnitVector[i] = block.unitVector[i];
+    }
+    m_previousNominalSpeedSqr = block.nominalSpeedSqr;
+
+    m_head = nextIndex(m_head);
+    m_count++;
+    recalculate();
+    return true;
+}
+
+const PlannerBlock *Planner::currentBlock()
+{
+    // Once the executor runs out of blocks, waiting for the next move to blend with
+    // only stops the machine
+    if (m_count == 0) {
+        releaseHeldMove();
+    }
+    if (m_count == 0) {
+        return nullptr;
+    }
+
+    // The executor relies on the exit speed, so the next entry speed is fixed too
+    if (!m_currentBlockFixed) {
+        m_currentBlockFixed = true;
+        if (m_planned == m_tail) {
+            m_planned = nextIndex(m_tail);
+        }
+    }
+    return &m_blocks[m_tail];
+}
+
+void Planner::discardCurrentBlock()
+{
+    if (m_count == 0) {
+        return;
+    }
+    if (m_planned == m_tail) {
+        m_planned = nextIndex(m_tail);
+    }
+    m_tail = nextIndex(m_tail);
+    m_count--;
+    m_currentBlockFixed = false;
+    queueArcSegments();
+}
+
+void Planner::setPosition(const float position[GCGP_NUM_AXES])
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_position[i] = position[i];
+        m_blockPosition[i] = position[i];
+    }
+    m_hasHeldMove = false;
+}
+
+void Planner::clear()
+{
+    m_tail = 0;
+    m_head = 0;
+    m_planned = 0;
+    m_count = 0;
+    m_currentBlockFixed = false;
+    m_previousNominalSpeedSqr = 0.f;
+    m_arc.cancel();
+    m_hasHeldMove = false;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_blockPosition[i] = m_position[i];
+    }
+}
+
+// Rounds the corner at the end of the held move towards the new target. The held
+// move is queued up to the distance d before the corner, followed by chords to the
+// point d after it, which all turn by the same angle, like a polygon around a circle.
+// The chords are farthest from the corner in the middle of the polygon, and this
+// distance grows linearly with d, so d follows from the tolerance.
+void Planner::blendCorner(const float target[GCGP_NUM_AXES], float feedrate)
+{
+    const float *corner = m_heldTarget;
+    float in[GCGP_NUM_AXES];
+    float out[GCGP_NUM_AXES];
+    float inLengthSqr = 0.f;
+    float outLengthSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        in[i] = corner[i] - m_blockPosition[i];
+        out[i] = target[i] - corner[i];
+        inLengthSqr += in[i] * in[i];
+        outLengthSqr += out[i] * out[i];
+    }
+    float inLength = sqrtf(inLengthSqr);
+    float outLength = sqrtf(outLengthSqr);
+    if (inLength < PLANNER_MINIMUM_BLOCK_LENGTH) {
+        releaseHeldMove();
+        return;
+    }
+
+    float cosTheta = 0.f; // Of the angle between both directions
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        in[i] /= inLength;
+        out[i] /= outLength;
+        cosTheta += in[i] * out[i];
+    }
+    if (cosTheta > 0.9999f || cosTheta < -0.999f) { // Straight, or a reversal
+        releaseHeldMove();
+        return;
+    }
+
+    // Chord directions, interpolated between both directions, and the polygon for
+    // d = 1 around the corner
+    float theta = acosf(cosTheta);
+    float sinTheta = sinf(theta);
+    float chords[GCGP_PLANNER_BLEND_SEGMENTS][GCGP_NUM_AXES];
+    float sum[GCGP_NUM_AXES] = {};
+    for (int k = 0; k < GCGP_PLANNER_BLEND_SEGMENTS; k++) {
+        float s = static_cast<float>(k + 1) / (GCGP_PLANNER_BLEND_SEGMENTS + 1);
+        float a = sinf((1.f - s) * theta) / sinTheta;
+        float b = sinf(s * theta) / sinTheta;
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            chords[k][i] = a * in[i] + b * out[i];
+            sum[i] += chords[k][i];
+        }
+    }
+    float sumLengthSqr = 0.f;
+    float bisectorLengthSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        sumLengthSqr += sum[i] * sum[i];
+        bisectorLengthSqr += (in[i] + out[i]) * (in[i] + out[i]);
+    }
+    float chordLength = sqrtf(bisectorLengthSqr / sumLengthSqr);
+
+    float middleSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        float middle = -in[i];
+        for (int k = 0; k < GCGP_PLANNER_BLEND_SEGMENTS / 2; k++) {
+            middle += chordLength * chords[k][i];
+        }
+        if (GCGP_PLANNER_BLEND_SEGMENTS % 2 == 1) {
+            middle += 0.5f * chordLength * chords[GCGP_PLANNER_BLEND_SEGMENTS / 2][i];
+        }
+        middleSqr += middle * middle;
+    }
+
+    // A straight piece stays between the blends of both ends of a move, otherwise
+    // their chords would meet at a sharper angle
+    float distance = modalState.pathTolerance / sqrtf(middleSqr);
+    float maximum = PLANNER_MAXIMUM_BLEND_FRACTION *
+                    (m_heldLength < outLength ? m_heldLength : outLength);
+    distance = distance < maximum ? distance : maximum;
+
+    float point[GCGP_NUM_AXES];
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        point[i] = corner[i] - distance * in[i];
+    }
+    queueBlock(point, m_heldFeedrate, false);
+    m_hasHeldMove = false;
+
+    float blendFeedrate = feedrate < m_heldFeedrate ? feedrate : m_heldFeedrate;
+    for (int k = 0; k < GCGP_PLANNER_BLEND_SEGMENTS; k++) {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            point[i] += distance * chordLength * chords[k][i];
+        }
+        if (k == GCGP_PLANNER_BLEND_SEGMENTS - 1) {
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                point[i] = corner[i] + distance * out[i];
+            }
+        }
+        queueBlock(point, blendFeedrate, false);
+    }
+}
+
+void Planner::releaseHeldMove()
+{
+    if (m_hasHeldMove) {
+        m_hasHeldMove = false;
+        queueBlock(m_heldTarget, m_heldFeedrate, false);
+    }
+}
+
+// Adds the pending segments of an arc, as long as there is space
+void Planner::queueArcSegments()
+{
+    float point[GCGP_NUM_AXES];
+    while (m_count < GCGP_PLANNER_BUFFER_SIZE && m_arc.next(point)) {
+        queueBlock(point, m_arcFeedrate, false);
+    }
+}
+
+size_t Planner::nextIndex(size_t index)
+{
+    return index + 1 < GCGP_PLANNER_BUFFER_SIZE ? index + 1 : 0;
+}
+
+size_t Planner::previousIndex(size_t index)
+{
+    return index > 0 ? index - 1 : GCGP_PLANNER_BUFFER_SIZE - 1;
+}
+
+// The largest value along the unit vector that respects the maximum of every axis
+float Planner::limitByAxisMaximum(const float maximum[GCGP_NUM_AXES],
+                                  const float unitVector[GCGP_NUM_AXES]) const
+{
+    float limit = INFINITY;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        if (unitVector[i] != 0.f) {
+            float axisLimit = fabsf(maximum[i] / unitVector[i]);
+            if (axisLimit < limit) {
+                limit = axisLimit;
+            }
+        }
+    }
+    return limit;
+}
+
+// Junction deviation as in GRBL: the corner is approximated by a circle which
+// deviates by settings.junctionDeviation from the corner point, and the speed is
+// chosen such that the centripetal acceleration on it is within the limits.
+float Planner::junctionSpeedSqr(const PlannerBlock &block) const
+{
+    float minimumSpeed = settings.minimumJunctionSpeed / 60.f;
+    float minimumSpeedSqr = minimumSpeed * minimumSpeed;
+
+    float cosTheta = 0.f; // Of the angle between the previous and the new direction
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        cosTheta -= m_previousUnitVector[i] * block.unitVector[i];
+    }
+    if (cosTheta > 0.999999f) { // Reversal
+        return minimumSpeedSqr;
+    }
+    if (cosTheta < -0.999999f) { // Straight, no limit
+        return INFINITY;
+    }
+
+    float junctionVector[GCGP_NUM_AXES];
+    float lengthSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        junctionVector[i] = block.unitVector[i] - m_previousUnitVector[i];
+        lengthSqr += junctionVector[i] * junctionVector[i];
+    }
+    float length = sqrtf(lengthSqr);
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        junctionVector[i] /= length;
+    }
+
+    float acceleration = limitByAxisMaximum(settings.acceleration, junctionVector);
+    float sinThetaHalf = sqrtf(0.5f * (1.f - cosTheta));
+    float speedSqr =
+        acceleration * settings.junctionDeviation * sinThetaHalf / (1.f - sinThetaHalf);
+    return speedSqr > minimumSpeedSqr ? speedSqr : minimumSpeedSqr;
+}
+
+// Only the blocks from m_planned on are recalculated. Blocks before it either run at
+// their maximum entry speed or accelerate as hard as possible into the next one, so
+// no later block can ever improve them.
+void Planner::recalculate()
+{
+    size_t firstChanged = m_planned;
+    size_t index = previousIndex(m_head);
+
+    // Backward pass: the newest block must be able to stop at its end
+    if (index != m_planned) {
+        PlannerBlock *current = &m_blocks[index];
+        float entrySpeedSqr = 2.f * current->acceleration * current->millimeters;
+        current->entrySpeedSqr = entrySpeedSqr < current->maxEntrySpeedSqr
+                                     ? entrySpeedSqr
+                                     : current->maxEntrySpeedSqr;
+
+        index = previousIndex(index);
+        while (index != m_planned) {
+            PlannerBlock *next = current;
+            current = &m_blocks[index];
+            if (current->entrySpeedSqr != current->maxEntrySpeedSqr) {
+                entrySpeedSqr = next->entrySpeedSqr +
+                                2.f * current->acceleration * current->millimeters;
+                current->entrySpeedSqr = entrySpeedSqr < current->maxEntrySpeedSqr
+                                             ? entrySpeedSqr
+                                             : current->maxEntrySpeedSqr;
+            }
+            index = previousIndex(index);
+        }
+    }
+
+    // Forward pass: entry speeds must be reachable from the previous block
+    PlannerBlock *next = &m_blocks[m_planned];
+    index = nextIndex(m_planned);
+    while (index != m_head) {
+        PlannerBlock *current = next;
+        next = &m_blocks[index];
+        if (current->entrySpeedSqr < next->entrySpeedSqr) {
+            float entrySpeedSqr = current->entrySpeedSqr +
+                                  2.f * current->acceleration * current->millimeters;
+            if (entrySpeedSqr < next->entrySpeedSqr) {
+                next->entrySpeedSqr = entrySpeedSqr; // Full acceleration, optimal
+                m_planned = index;
+            }
+        }
+        if (next->entrySpeedSqr == next->maxEntrySpeedSqr) {
+            m_planned = index;
+        }
+        index = nextIndex(index);
+    }
+
+    // The exit speed of a block is the entry speed of the next one
+    for (index = firstChanged; index != m_head; index = nextIndex(index)) {
+        size_t following = nextIndex(index);
+        float exitSpeedSqr = 0.f; // The last block must stop
+        if (following != m_head) {
+            exitSpeedSqr = m_blocks[following].entrySpeedSqr;
+        }
+        calculateTrapezoid(m_blocks[index], exitSpeedSqr);
+    }
+}
+
+void Planner::calculateTrapezoid(PlannerBlock &block, float exitSpeedSqr)
+{
+    float twoAcceleration = 2.f * block.acceleration;
+    float accelerateDistance =
+        (block.nominalSpeedSqr - block.entrySpeedSqr) / twoAcceleration;
+    float decelerateDistance = (block.nominalSpeedSqr - exitSpeedSqr) / twoAcceleration;
+
+    block.exitSpeedSqr = exitSpeedSqr;
+    if (accelerateDistance + decelerateDistance <= block.millimeters) {
+        block.peakSpeedSqr = block.nominalSpeedSqr;
+        block.accelerateUntil = accelerateDistance;
+        block.decelerateAfter = block.millimeters - decelerateDistance;
+        return;
+    }
+
+    // Too short to reach the nominal speed, the profile is a triangle
+    float distance = (twoAcceleration * block.millimeters + exitSpeedSqr -
+                      block.entrySpeedSqr) /
+                     (2.f * twoAcceleration);
+    if (distance < 0.f) {
+        distance = 0.f;
+    }
+    if (distance > block.millimeters) {
+        distance = block.millimeters;
+    }
+    block.peakSpeedSqr = block.entrySpeedSqr + twoAcceleration * distance;
+    block.accelerateUntil = distance;
+    block.decelerateAfter = distance;
+}
@@ -0,0 +1,96 @@
+#include "GCGP/Scheduler.h"
+
+Scheduler::Scheduler(void *instance) : m_instance(instance)
+{
+}
+
+int Scheduler::add(void (*cbRun)(void *, uint32_t), void *instance, uint8_t priority,
+                   uint32_t period, uint32_t deadline)
+{
+    if (!cbRun || m_count >= GCGP_SCHEDULER_MAX_TASKS) {
+        return -1;
+    }
+    SchedulerTask &task = m_tasks[m_count];
+    task = SchedulerTask();
+    task.cbRun = cbRun;
+    task.instance = instance;
+    task.priority = priority;
+    task.period = period;
+    task.deadline = deadline;
+    task.due = now();
+    return static_cast<int>(m_count++);
+}
+
+size_t Scheduler::tick(uint32_t microseconds)
+{
+    uint32_t start = now();
+    bool ran[GCGP_SCHEDULER_MAX_TASKS] = {};
+    size_t count = 0;
+    while (true) {
+        uint32_t time = count ? now() : start;
+        uint32_t elapsed = time - start;
+        if (count > 0 && microseconds && elapsed >= microseconds) {
+            break;
+        }
+        SchedulerTask *next = nullptr;
+        size_t nextIndex = 0;
+        for (size_t i = 0; i < m_count; i++) {
+            if (!ran[i] && clockReached(time, m_tasks[i].due) &&
+                (!next || before(m_tasks[i], *next))) {
+                next = &m_tasks[i];
+                nextIndex = i;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        run(*next, time, microseconds ? microseconds - elapsed : 0);
+        ran[nextIndex] = true;
+        count++;
+    }
+
+    uint32_t duration = now() - start;
+    if (duration > m_maxTickDuration) {
+        m_maxTickDuration = duration;
+    }
+    return count;
+}
+
+uint32_t Scheduler::now() const
+{
+    return cbMicroseconds ? cbMicroseconds(m_instance) : GCGP_CLOCK_US();
+}
+
+void Scheduler::run(SchedulerTask &task, uint32_t time, uint32_t budget)
+{
+    uint32_t lateness = time - task.due;
+    if (!clockReached(task.absoluteDeadline(), time)) {
+        task.missed++;
+    }
+    if (lateness > task.maxLateness) {
+        task.maxLateness = lateness;
+    }
+
+    task.cbRun(task.instance, budget);
+    uint32_t end = now();
+    task.runs++;
+    if (end - time > task.maxDuration) {
+        task.maxDuration = end - time;
+    }
+
+    // Every period from the last due time. Only a task that is more than a period
+    // behind at the end of its run continues a period from then, so a late run does
+    // not cost the next period.
+    task.due += task.period;
+    if (!task.period || clockReached(end, task.due + task.period)) {
+        task.due = end + task.period;
+    }
+}
+
+bool Scheduler::before(const SchedulerTask &a, const SchedulerTask &b)
+{
+    if (a.priority != b.priority) {
+        return a.priority > b.priority;
+    }
+    return !clockReached(a.absoluteDeadline(), b.absoluteDeadline());
+}
@@ -0,0 +1,144 @@
+
+#include "GCGP/ServoSimulator.h"
+
+#if !defined(ARDUINO)
+
+ServoAxis::ServoAxis(const ServoAxisSettings &settings, float period)
+{
+    configure(settings, period);
+}
+
+// With the damping, the velocity approaches force / damping exponentially. The
+// factors of that for one period only depend on the settings.
+void ServoAxis::configure(const ServoAxisSettings &settings, float period)
+{
+    m_settings = settings;
+    m_period = period;
+    float rate = settings.damping / settings.mass; // 1/s
+    if (rate > 0.f) {
+        m_decay = expf(-rate * period);
+        m_decayIntegral = (1.f - m_decay) / rate;
+    }
+    else {
+        m_decay = 1.f;
+        m_decayIntegral = period;
+    }
+}
+
+float ServoAxis::tick(float setPosition, float setVelocity, float setAcceleration)
+{
+    float encoderPosition = readEncoder();
+    float measuredVelocity = (encoderPosition - m_encoderPosition) / m_period;
+    m_encoderPosition = encoderPosition;
+
+    float error = setPosition - encoderPosition;
+    float force = m_settings.kp * error + m_settings.ki * m_integral +
+                  m_settings.kd * (setVelocity - measuredVelocity) +
+                  m_settings.velocityFeedForward * setVelocity +
+                  m_settings.accelerationFeedForward * setAcceleration;
+
+    if (force > m_settings.maxForce) {
+        force = m_settings.maxForce;
+    }
+    else if (force < -m_settings.maxForce) {
+        force = -m_settings.maxForce;
+    }
+    else {
+        m_integral += error * m_period;
+    }
+
+    applyForce(force);
+    return force;
+}
+
+// The velocity in mm/s tends to 1000 * force / damping, or grows linearly without
+// damping
+void ServoAxis::applyForce(float force)
+{
+    if (m_settings.damping > 0.f) {
+        float finalVelocity = 1000.f * force / m_settings.damping;
+        float difference = m_velocity - finalVelocity;
+        m_position += finalVelocity * m_period + difference * m_decayIntegral;
+        m_velocity = finalVelocity + difference * m_decay;
+    }
+    else {
+        float acceleration = 1000.f * force / m_settings.mass;
+        m_position += (m_velocity + 0.5f * acceleration * m_period) * m_period;
+        m_velocity += acceleration * m_period;
+    }
+}
+
+void ServoAxis::setPosition(float position)
+{
+    m_position = position;
+    m_velocity = 0.f;
+    m_integral = 0.f;
+    m_encoderPosition = readEncoder();
+}
+
+float ServoAxis::readEncoder() const
+{
+    if (m_settings.resolution <= 0.f) {
+        return m_position;
+    }
+    return floorf(m_position / m_settings.resolution) * m_settings.resolution;
+}
+
+ServoSimulator::ServoSimulator(const ServoSimulatorSettings &settings)
+    : generator(settings.setpoints), monitor(settings.feedback)
+{
+    float period = 1.f / settings.setpoints.servoRate;
+    m_period = VirtualClock::fromSeconds(period);
+    monitor.settings.servoRate = settings.setpoints.servoRate;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        axes[i].configure(settings.axes[i], period);
+        axes[i].setPosition(generator.position()[i]);
+        m_lastVelocity[i] = 0.f;
+    }
+}
+
+GrblError ServoSimulator::addCommand(const Command<10> &command)
+{
+    while (generator.isFull()) {
+        tick();
+    }
+    return generator.addCommand(command);
+}
+
+void ServoSimulator::tick()
+{
+    const Setpoint &setpoint = generator.tick();
+    float rate = generator.settings.servoRate;
+    m_clock.now += m_period;
+    m_ticks++;
+
+    m_sample.time = m_clock.seconds();
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        float acceleration = (setpoint.velocity[i] - m_lastVelocity[i]) * rate;
+        m_lastVelocity[i] = setpoint.velocity[i];
+        m_sample.force[i] =
+            axes[i].tick(setpoint.position[i], setpoint.velocity[i], acceleration);
+        m_sample.setPosition[i] = setpoint.position[i];
+        m_sample.actualPosition[i] = axes[i].encoderPosition();
+        m_sample.error[i] = m_sample.actualPosition[i] - setpoint.position[i];
+    }
+    monitor.publish(m_sample.setPosition, m_sample.actualPosition);
+    if (cbSample) {
+        cbSample(instance, m_sample);
+    }
+}
+
+uint64_t ServoSimulator::run(float settleTime)
+{
+    uint64_t start = m_ticks;
+    while (!generator.isIdle()) {
+        tick();
+    }
+    uint64_t end = m_clock.now + VirtualClock::fromSeconds(settleTime);
+    while (m_clock.now < end) {
+        tick();
+    }
+    return m_ticks - start;
+}
+
+#endif // !defined(ARDUINO)
@@ -0,0 +1,238 @@
+
+#include "GCGP/SetpointGenerator.h"
+
+static_assert((GCGP_SETPOINT_BUFFER_SIZE & (GCGP_SETPOINT_BUFFER_SIZE - 1)) == 0 &&
+                  GCGP_SETPOINT_BUFFER_SIZE <= 128,
+              "GCGP_SETPOINT_BUFFER_SIZE must be a power of two up to 128");
+
+void SCurveProfile::plan(float distance, float maxVelocity, float maxAcceleration,
+                         float jerk)
+{
+    this->distance = distance;
+    float jerkTime = 0.f;       // Duration of each jerk phase
+    float accelerateTime = 0.f; // Duration of the acceleration, with both jerk phases
+    float cruiseTime = 0.f;
+    float velocity = maxVelocity;
+
+    if (distance > 0.f && maxVelocity > 0.f) {
+        // Acceleration does not reach its maximum if the velocity is reached before
+        if (velocity * jerk >= maxAcceleration * maxAcceleration) {
+            jerkTime = maxAcceleration / jerk;
+            accelerateTime = jerkTime + velocity / maxAcceleration;
+        }
+        else {
+            jerkTime = sqrtf(velocity / jerk);
+            accelerateTime = 2.f * jerkTime;
+        }
+
+        // Accelerating and braking take velocity * accelerateTime, the rest is cruise.
+        // If that is too far, the peak velocity is lowered until it fits exactly.
+        if (velocity * accelerateTime <= distance) {
+            cruiseTime = (distance - velocity * accelerateTime) / velocity;
+        }
+        else {
+            float ratio = maxAcceleration / jerk;
+            velocity = 0.5f * maxAcceleration *
+                       (-ratio + sqrtf(ratio * ratio + 4.f * distance / maxAcceleration));
+            if (velocity * jerk >= maxAcceleration * maxAcceleration) {
+                jerkTime = ratio;
+                accelerateTime = jerkTime + velocity / maxAcceleration;
+            }
+            else {
+                velocity = cbrtf(0.25f * distance * distance * jerk);
+                jerkTime = sqrtf(velocity / jerk);
+                accelerateTime = 2.f * jerkTime;
+            }
+        }
+    }
+    peakVelocity = velocity;
+
+    float constantTime = accelerateTime - 2.f * jerkTime;
+    if (constantTime < 0.f) {
+        constantTime = 0.f;
+    }
+    const float durations[7] = { jerkTime, constantTime, jerkTime, cruiseTime,
+                                 jerkTime, constantTime, jerkTime };
+    const float jerks[7] = { jerk, 0.f, -jerk, 0.f, -jerk, 0.f, jerk };
+
+    float time = 0.f;
+    float position = 0.f;
+    float currentVelocity = 0.f;
+    float acceleration = 0.f;
+    for (int i = 0; i < 7; i++) {
+        phaseJerk[i] = jerks[i];
+        phaseState[i][0] = position;
+        phaseState[i][1] = currentVelocity;
+        phaseState[i][2] = acceleration;
+        time += durations[i];
+        phaseEnd[i] = time;
+        evaluate(i, durations[i], position, currentVelocity, acceleration);
+    }
+    duration = time;
+}
+
+void SCurveProfile::evaluate(int phase, float time, float &position, float &velocity,
+                             float &acceleration) const
+{
+    const float *state = phaseState[phase];
+    float jerk = phaseJerk[phase];
+    position = state[0] +
+               time * (state[1] + time * (0.5f * state[2] + time * (jerk / 6.f)));
+    velocity = state[1] + time * (state[2] + time * (0.5f * jerk));
+    acceleration = state[2] + time * jerk;
+}
+
+SetpointGenerator::SetpointGenerator(const SetpointSettings &settings)
+    : settings(settings)
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_position[i] = 0.f;
+        m_setpoint.position[i] = 0.f;
+        m_setpoint.velocity[i] = 0.f;
+    }
+}
+
+GrblError SetpointGenerator::addCommand(const Command<10> &command)
+{
+    if (isFull()) {
+        return GrblError::PlannerBufferFull;
+    }
+
+    Move move;
+    GrblError error;
+    if (command.isJog) {
+        ModalState state = modalState; // Jogs never change the modal state of the program
+        error = state.resolve(command, m_position, move);
+    }
+    else {
+        error = modalState.resolve(command, m_position, move);
+    }
+    if (error != GrblError::None || move.type == MotionType::None) {
+        return error;
+    }
+    addMove(move);
+    return GrblError::None;
+}
+
+bool SetpointGenerator::addMove(const Move &move)
+{
+    if (isFull()) {
+        return false;
+    }
+
+    uint8_t head = m_head;
+    size_t index = head & (GCGP_SETPOINT_BUFFER_SIZE - 1);
+    m_moves[index] = move;
+    m_profiles[index].plan(move.length(), maxVelocity(move), settings.acceleration,
+                           settings.jerk);
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_position[i] = move.target[i];
+    }
+    atomicStoreRelease(&m_head, static_cast<uint8_t>(head + 1));
+    return true;
+}
+
+const Setpoint &SetpointGenerator::tick()
+{
+    if (isIdle()) {
+        return m_setpoint;
+    }
+
+    size_t index = m_tail & (GCGP_SETPOINT_BUFFER_SIZE - 1);
+    const SCurveProfile *profile = &m_profiles[index];
+    // Counted in ticks, as a sum of periods in a float stops growing on long moves
+    m_ticks++;
+    float time = m_startTime + static_cast<float>(m_ticks) / settings.servoRate;
+
+    // The rest of the period is carried over into the next move, at most one per tick
+    if (time >= profile->duration) {
+        float remainingTime = time - profile->duration;
+        finishMove();
+        if (isIdle()) {
+            return m_setpoint;
+        }
+        index = m_tail & (GCGP_SETPOINT_BUFFER_SIZE - 1);
+        profile = &m_profiles[index];
+        m_startTime =
+            remainingTime < profile->duration ? remainingTime : profile->duration;
+        time = m_startTime;
+    }
+
+    while (m_phase < 6 && time > profile->phaseEnd[m_phase]) {
+        m_phase++;
+    }
+    float phaseStart = m_phase > 0 ? profile->phaseEnd[m_phase - 1] : 0.f;
+
+    float distance, velocity, acceleration;
+    profile->evaluate(m_phase, time - phaseStart, distance, velocity, acceleration);
+    if (distance > profile->distance) {
+        distance = profile->distance;
+    }
+
+    float direction[GCGP_NUM_AXES];
+    m_moves[index].evaluate(distance, m_setpoint.position, direction);
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_setpoint.velocity[i] = direction[i] * velocity;
+    }
+    m_setpoint.pathVelocity = velocity;
+    m_setpoint.pathAcceleration = acceleration;
+    return m_setpoint;
+}
+
+void SetpointGenerator::setPosition(const float position[GCGP_NUM_AXES])
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_position[i] = position[i];
+        m_setpoint.position[i] = position[i];
+        m_setpoint.velocity[i] = 0.f;
+    }
+}
+
+// The feedrate, limited by the maximum rate of every moving axis. On arcs, the
+// centripetal acceleration v^2 / r is limited too.
+float SetpointGenerator::maxVelocity(const Move &move) const
+{
+    float length = move.length();
+    float rate = INFINITY;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        float axisRate = settings.maxRate[i]; // Arcs move in both directions of the plane
+        if (!move.isArc() || (i != move.axis0 && i != move.axis1)) {
+            float delta = fabsf(move.target[i] - move.start[i]);
+            if (delta == 0.f) {
+                continue;
+            }
+            axisRate *= length / delta;
+        }
+        if (axisRate < rate) {
+            rate = axisRate;
+        }
+    }
+    if (move.type != MotionType::Rapid && move.feedrate < rate) {
+        rate = move.feedrate;
+    }
+
+    float velocity = rate / 60.f;
+    if (move.isArc()) {
+        float centripetalLimit = sqrtf(settings.acceleration * move.radius);
+        if (centripetalLimit < velocity) {
+            velocity = centripetalLimit;
+        }
+    }
+    return velocity;
+}
+
+// Ends exactly on the target, at rest
+void SetpointGenerator::finishMove()
+{
+    size_t index = m_tail & (GCGP_SETPOINT_BUFFER_SIZE - 1);
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_setpoint.position[i] = m_moves[index].target[i];
+        m_setpoint.velocity[i] = 0.f;
+    }
+    m_setpoint.pathVelocity = 0.f;
+    m_setpoint.pathAcceleration = 0.f;
+    m_phase = 0;
+    m_ticks = 0;
+    m_startTime = 0.f;
+    atomicStoreRelease(&m_tail, static_cast<uint8_t>(m_tail + 1));
+}
@@ -0,0 +1,334 @@
+
+#include "GCGP/Simulator.h"
+
+#if !defined(ARDUINO)
+
+MachineSimulator::MachineSimulator(const SimulatorSettings &settings)
+    : uart(m_clock, settings.uart), planner(settings.planner), monitor(settings.feedback),
+      grbl(uart.serial(), this), settings(settings), m_response("")
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_report.position[i] = planner.position()[i];
+    }
+
+    grbl.cbBufferIsFull = [](void *simulator) {
+        return static_cast<MachineSimulator *>(simulator)->planner.isFull();
+    };
+    grbl.cbProcessCommand = [](void *simulator, Command<10> *command) {
+        static_cast<MachineSimulator *>(simulator)->processCommand(*command);
+    };
+    grbl.cbIsIdle = [](void *simulator) {
+        return static_cast<MachineSimulator *>(simulator)->planner.isEmpty();
+    };
+    grbl.cbGetFeedrate = [](void *simulator) {
+        return static_cast<MachineSimulator *>(simulator)->m_feedrate;
+    };
+    grbl.cbGetFeedback = [](void *simulator, FeedbackSnapshot *snapshot) {
+        return static_cast<MachineSimulator *>(simulator)->monitor.snapshot(*snapshot);
+    };
+    monitor.publish(m_report.position, m_report.position);
+}
+
+bool MachineSimulator::sendLine(const char *line)
+{
+    m_lineNumber++;
+    if (isEmptyLine(line)) {
+        return true;
+    }
+    queueLine(line);
+    m_lastAnswerIsError = false;
+    do {
+        sendPendingBytes();
+        runController();
+        if (!m_sending && m_inFlightCount == 0) {
+            break;
+        }
+    } while (advance());
+    return !m_lastAnswerIsError;
+}
+
+// With character counting, a line is sent as soon as all unanswered lines and it fit
+// into the RX buffer of GrblInterface. A longer line waits until all are answered.
+void MachineSimulator::stream(StreamingMode mode)
+{
+    const char *next = nullptr;
+    bool end = false;
+    for (;;) {
+        while (!m_sending && !end) {
+            if (!next) {
+                next = cbNextLine ? cbNextLine(instance) : nullptr;
+                if (!next) {
+                    end = true;
+                    break;
+                }
+                m_lineNumber++;
+                if (isEmptyLine(next)) {
+                    next = nullptr;
+                    continue;
+                }
+            }
+            size_t length = strlen(next) + 1;
+            bool fits = m_inFlightCount == 0;
+            if (mode == StreamingMode::CharacterCounting) {
+                fits = fits || m_inFlightTotal + length <= GCGP_RX_BUFFER_SIZE;
+            }
+            if (!fits) {
+                break;
+            }
+            queueLine(next);
+            next = nullptr;
+        }
+        sendPendingBytes();
+        uint32_t answered = m_report.lines;
+        runController();
+        if (end && !m_sending && m_inFlightCount == 0) {
+            break;
+        }
+        // Time only passes once the host cannot send more right now
+        bool hostMaySend = !m_sending && !end && m_inFlightCount == 0;
+        if (m_report.lines == answered && !hostMaySend && !advance()) {
+            break;
+        }
+    }
+}
+
+void MachineSimulator::sendRealtime(char command)
+{
+    uart.hostWrite(&command, 1);
+    do {
+        runController();
+    } while (!uart.isIdle() && advance());
+}
+
+void MachineSimulator::finish()
+{
+    do {
+        runController();
+    } while (advance());
+}
+
+bool MachineSimulator::isEmptyLine(const char *line)
+{
+    for (; *line != '\0'; line++) {
+        if (*line != '\r') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Everything that happens at the current time: the controller reads and executes,
+// and the host reads the answers
+void MachineSimulator::runController()
+{
+    if (m_clock.now >= m_nextPoll) {
+        grbl.update();
+        m_nextPoll = m_clock.now + VirtualClock::fromSeconds(settings.pollPeriod);
+    }
+    startBlock();
+    receiveAnswers();
+}
+
+// update() reads at most GCGP_RX_BUFFER_SIZE bytes per call, so it may need another
+// call at the same time
+bool MachineSimulator::advance()
+{
+    if (settings.pollPeriod == 0.f && uart.readable() > 0 && !planner.isFull()) {
+        return true;
+    }
+    uint64_t next = uart.nextArrival();
+    if (m_moving && m_blockEnd < next) {
+        next = m_blockEnd;
+    }
+    if (m_sending && m_hostReadyAt > m_clock.now && m_hostReadyAt < next) {
+        next = m_hostReadyAt;
+    }
+    bool controllerHasWork = uart.pendingToController() || m_inFlightCount > 0;
+    if (controllerHasWork && m_nextPoll > m_clock.now && m_nextPoll < next) {
+        next = m_nextPoll;
+    }
+    if (next == UINT64_MAX) {
+        return false;
+    }
+
+    advanceTo(next);
+    if (m_moving && m_clock.now >= m_blockEnd) {
+        finishBlock();
+    }
+    return true;
+}
+
+void MachineSimulator::advanceTo(uint64_t time)
+{
+    if (time <= m_clock.now) {
+        return;
+    }
+    double seconds = static_cast<double>(time - m_clock.now) * 1e-9;
+    if (m_spindle != SpindleAction::Stop) {
+        m_report.spindleTime += seconds;
+    }
+    if (m_moving) {
+        m_report.motionTime += seconds;
+    }
+    m_clock.now = time;
+    m_report.time = m_clock.seconds();
+}
+
+// The time of a block follows from its trapezoid: the distance of each phase divided
+// by its average speed
+bool MachineSimulator::startBlock()
+{
+    if (m_moving) {
+        return true;
+    }
+    const PlannerBlock *block = planner.currentBlock();
+    if (!block) {
+        m_feedrate = 0.f;
+        return false;
+    }
+    float entry = sqrtf(block->entrySpeedSqr);
+    float peak = sqrtf(block->peakSpeedSqr);
+    float exit = sqrtf(block->exitSpeedSqr);
+    double duration = 0.;
+    if (block->accelerateUntil > 0.f && entry + peak > 0.f) {
+        duration += 2. * block->accelerateUntil / (entry + peak);
+    }
+    if (block->decelerateAfter > block->accelerateUntil && peak > 0.f) {
+        duration += (block->decelerateAfter - block->accelerateUntil) / peak;
+    }
+    if (block->millimeters > block->decelerateAfter && peak + exit > 0.f) {
+        duration += 2. * (block->millimeters - block->decelerateAfter) / (peak + exit);
+    }
+
+    m_moving = true;
+    m_blockEnd = m_clock.now + VirtualClock::fromSeconds(duration);
+    m_feedrate = peak * 60.f;
+    return true;
+}
+
+// The simulated axes follow their setpoints exactly
+void MachineSimulator::finishBlock()
+{
+    const PlannerBlock *block = planner.currentBlock();
+    m_report.blocks++;
+    m_report.distance += block->millimeters;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_report.position[i] = block->target[i];
+    }
+    planner.discardCurrentBlock();
+    m_moving = false;
+    monitor.publish(m_report.position, m_report.position);
+}
+
+// Like GRBL, the controller does not read further until the motion is done
+void MachineSimulator::runUntilIdle()
+{
+    while (startBlock()) {
+        advanceTo(m_blockEnd);
+        finishBlock();
+    }
+}
+
+void MachineSimulator::processCommand(const Command<10> &command)
+{
+    bool synchronize = command.dwell || command.stopAction != StopAction::None ||
+                       command.spindleAction != SpindleAction::None;
+    if (synchronize) {
+        runUntilIdle();
+    }
+    if (command.spindleAction != SpindleAction::None) {
+        bool starts = command.spindleAction != SpindleAction::Stop &&
+                      command.spindleAction != m_spindle;
+        m_spindle = command.spindleAction;
+        if (starts) {
+            advanceTo(m_clock.now + VirtualClock::fromSeconds(settings.spindleDelay));
+        }
+    }
+    if (command.dwell) {
+        advanceTo(m_clock.now + VirtualClock::fromSeconds(command.dwellTime));
+        m_report.dwellTime += command.dwellTime;
+    }
+    if (command.stopAction == StopAction::EndProgram) {
+        m_spindle = SpindleAction::Stop;
+    }
+
+    if (planner.addCommand(command) != GrblError::None) {
+        m_report.rejected++;
+    }
+}
+
+void MachineSimulator::queueLine(const char *line)
+{
+    m_sending = line;
+    m_sendingLength = strlen(line) + 1;
+    m_sendingOffset = 0;
+    size_t index = (m_inFlightStart + m_inFlightCount) % GCGP_RX_BUFFER_SIZE;
+    m_inFlightLines[index] = m_lineNumber;
+    m_inFlightBytes[index] = m_sendingLength;
+    m_inFlightCount++;
+    m_inFlightTotal += m_sendingLength;
+}
+
+// As much of the line as fits on the wire, the newline last. The host only starts a
+// line once it has processed the last answer.
+void MachineSimulator::sendPendingBytes()
+{
+    if (!m_sending || (m_sendingOffset == 0 && m_clock.now < m_hostReadyAt)) {
+        return;
+    }
+    size_t textLength = m_sendingLength - 1;
+    if (m_sendingOffset < textLength) {
+        m_sendingOffset += uart.hostWrite(m_sending + m_sendingOffset,
+                                          textLength - m_sendingOffset);
+    }
+    if (m_sendingOffset == textLength && uart.hostWrite("\n", 1) == 1) {
+        m_sendingOffset++;
+    }
+    if (m_sendingOffset == m_sendingLength) {
+        m_sending = nullptr;
+    }
+}
+
+// Every "ok" or "error:" answers the oldest line in flight
+void MachineSimulator::receiveAnswers()
+{
+    for (int c = uart.hostRead(); c != -1; c = uart.hostRead()) {
+        if (c != '\n') {
+            if (m_hostLineLength < sizeof(m_hostLine) - 1) {
+                m_hostLine[m_hostLineLength++] = static_cast<char>(c);
+            }
+            continue;
+        }
+        m_hostLine[m_hostLineLength] = '\0';
+        m_hostLineLength = 0;
+        if (cbOutput) {
+            cbOutput(instance, m_hostLine);
+        }
+
+        bool error =
+            strncmp(m_hostLine, GCGP_ERROR_MESSAGE, strlen(GCGP_ERROR_MESSAGE)) == 0;
+        if (!error && strcmp(m_hostLine, GCGP_OK_MESSAGE) != 0) {
+            continue;
+        }
+        memcpy(m_response, m_hostLine, sizeof(m_response));
+        m_lastAnswerIsError = error;
+        m_report.lines++;
+        uint32_t lineNumber = m_lineNumber;
+        if (m_inFlightCount > 0) {
+            lineNumber = m_inFlightLines[m_inFlightStart];
+            m_inFlightTotal -= m_inFlightBytes[m_inFlightStart];
+            m_inFlightStart = (m_inFlightStart + 1) % GCGP_RX_BUFFER_SIZE;
+            m_inFlightCount--;
+        }
+        if (error) {
+            m_report.errors++;
+            if (cbError) {
+                cbError(instance, lineNumber, m_hostLine);
+            }
+        }
+        uint64_t latency = VirtualClock::fromSeconds(settings.uart.hostLatency);
+        m_hostReadyAt = m_clock.now + latency;
+    }
+}
+
+#endif // !defined(ARDUINO)
@@ -0,0 +1,59 @@
+
+#include "GCGP/SoftLimits.h"
+#include "GCGP/Simd.h"
+
+AxisBits SoftLimits::check(const float target[GCGP_NUM_AXES]) const
+{
+    AxisBits bits = 0;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        if (target[i] < min[i] || target[i] > max[i]) {
+            bits |= 1 << i;
+        }
+    }
+    return bits;
+}
+
+size_t SoftLimits::transformAndCheck(const CoordinateTransform &transform,
+                                     const float *const program[GCGP_NUM_AXES],
+                                     float *const machine[GCGP_NUM_AXES],
+                                     AxisBits *violations, size_t count) const
+{
+    size_t violating = 0;
+    size_t index = 0;
+
+#ifdef GCGP_SIMD_LANES
+    FloatVector scale[GCGP_NUM_AXES], offset[GCGP_NUM_AXES];
+    FloatVector lower[GCGP_NUM_AXES], upper[GCGP_NUM_AXES];
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        scale[i] = splatVector(transform.scale[i]);
+        offset[i] = splatVector(transform.offset[i]);
+        lower[i] = splatVector(min[i]);
+        upper[i] = splatVector(max[i]);
+    }
+
+    for (; index + GCGP_SIMD_LANES <= count; index += GCGP_SIMD_LANES) {
+        MaskVector flags = {};
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            FloatVector value = loadVector(program[i] + index) * scale[i] + offset[i];
+            storeVector(machine[i] + index, value);
+            MaskVector outside = (value < lower[i]) | (value > upper[i]);
+            flags |= outside & (1 << i);
+        }
+        for (int lane = 0; lane < GCGP_SIMD_LANES; lane++) {
+            violations[index + lane] = static_cast<AxisBits>(flags[lane]);
+            violating += flags[lane] != 0;
+        }
+    }
+#endif
+
+    for (; index < count; index++) {
+        float target[GCGP_NUM_AXES];
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            target[i] = program[i][index] * transform.scale[i] + transform.offset[i];
+            machine[i][index] = target[i];
+        }
+        violations[index] = check(target);
+        violating += violations[index] != 0;
+    }
+    return violating;
+}
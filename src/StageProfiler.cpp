@@ -0,0 +1,290 @@
+#include "GCGP/StageProfiler.h"
+
+#if !defined(ARDUINO)
+
+#include "GCGP/GrblInterface.h"
+#include <chrono>
+#include <cstdio>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define CALIBRATION_RUNS 1000
+
+PerfCounters::PerfCounters()
+{
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        m_fds[i] = -1;
+        m_index[i] = -1;
+    }
+#if defined(__linux__)
+    static const uint64_t events[GCGP_NUM_PERF_COUNTERS] = {
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES,
+    };
+    // The first counter that opens leads the group, the others join it
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        perf_event_attr attr = {};
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        long fd = syscall(SYS_perf_event_open, &attr, 0, -1, m_leader, 0);
+        if (fd < 0) {
+            continue;
+        }
+        m_fds[i] = static_cast<int>(fd);
+        m_index[i] = m_count++;
+        if (m_leader < 0) {
+            m_leader = m_fds[i];
+        }
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#if defined(__linux__)
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        if (m_fds[i] >= 0) {
+            close(m_fds[i]);
+        }
+    }
+#endif
+}
+
+void PerfCounters::read(uint64_t values[GCGP_NUM_PERF_COUNTERS]) const
+{
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        values[i] = 0;
+    }
+#if defined(__linux__)
+    if (m_leader < 0) {
+        return;
+    }
+    // The number of counters, then their values in the order they joined
+    uint64_t data[1 + GCGP_NUM_PERF_COUNTERS];
+    if (::read(m_leader, data, sizeof(data)) < static_cast<ssize_t>(sizeof(data[0]))) {
+        return;
+    }
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        if (m_index[i] >= 0 && static_cast<uint64_t>(m_index[i]) < data[0]) {
+            values[i] = data[1 + m_index[i]];
+        }
+    }
+#endif
+}
+
+static uint64_t nanosecondsNow()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+// The overhead is the cheapest of many measurements of nothing, as interrupts and
+// cache misses only ever add to it
+StageProfiler::StageProfiler(void *instance)
+    : m_response(this, nullptr, nullptr, nullptr, discardResponse), m_instance(instance)
+{
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        m_overhead[i] = UINT64_MAX;
+    }
+    m_overheadNanoseconds = UINT64_MAX;
+    for (int run = 0; run < CALIBRATION_RUNS; run++) {
+        uint64_t counts[GCGP_NUM_PERF_COUNTERS];
+        uint64_t nanoseconds;
+        begin();
+        elapsed(counts, nanoseconds);
+        for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+            m_overhead[i] = counts[i] < m_overhead[i] ? counts[i] : m_overhead[i];
+        }
+        if (nanoseconds < m_overheadNanoseconds) {
+            m_overheadNanoseconds = nanoseconds;
+        }
+    }
+}
+
+void StageProfiler::addLine(const char *line, size_t length)
+{
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        m_line[i] = 0;
+    }
+    m_lineNanoseconds = 0;
+
+    // Like Command::parse() and GrblInterface::processCommand()
+    begin();
+    m_tokens = {};
+    GrblError error = tokenizeCommand(m_tokens, line, length);
+    end(PipelineStage::Tokenize);
+    if (error == GrblError::None) {
+        begin();
+        m_command = {};
+        error = m_command.interpret(m_tokens);
+        end(PipelineStage::Parse);
+    }
+    if (error == GrblError::None) {
+        begin();
+        error = m_command.validate();
+        end(PipelineStage::Validate);
+    }
+    if (error == GrblError::None) {
+        begin();
+        if (cbProcessCommand) {
+            cbProcessCommand(m_instance, &m_command);
+        }
+        end(PipelineStage::Dispatch);
+    }
+    else {
+        m_errors++;
+    }
+    begin();
+    GrblInterface::printResponse(m_response, error);
+    end(PipelineStage::Respond);
+
+    add(m_total, m_line, m_lineNanoseconds);
+}
+
+// The clock outside of the counters, so they count as little of it as possible
+void StageProfiler::begin()
+{
+    m_startNanoseconds = nanosecondsNow();
+    m_counters.read(m_start);
+}
+
+void StageProfiler::elapsed(uint64_t counts[GCGP_NUM_PERF_COUNTERS],
+                            uint64_t &nanoseconds) const
+{
+    m_counters.read(counts);
+    nanoseconds = nanosecondsNow() - m_startNanoseconds;
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        counts[i] -= m_start[i];
+    }
+}
+
+void StageProfiler::end(PipelineStage stage)
+{
+    uint64_t counts[GCGP_NUM_PERF_COUNTERS];
+    uint64_t nanoseconds;
+    elapsed(counts, nanoseconds);
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        counts[i] = counts[i] > m_overhead[i] ? counts[i] - m_overhead[i] : 0;
+        m_line[i] += counts[i];
+    }
+    nanoseconds =
+        nanoseconds > m_overheadNanoseconds ? nanoseconds - m_overheadNanoseconds : 0;
+    m_lineNanoseconds += nanoseconds;
+    add(m_costs[static_cast<int>(stage)], counts, nanoseconds);
+}
+
+void StageProfiler::add(StageCost &cost, const uint64_t counts[GCGP_NUM_PERF_COUNTERS],
+                        uint64_t nanoseconds)
+{
+    cost.blocks++;
+    cost.nanoseconds += nanoseconds;
+    for (int i = 0; i < GCGP_NUM_PERF_COUNTERS; i++) {
+        cost.counts[i] += counts[i];
+    }
+    if (nanoseconds > cost.maxNanoseconds) {
+        cost.maxNanoseconds = nanoseconds;
+    }
+    uint64_t instructions = counts[static_cast<int>(PerfCounter::Instructions)];
+    if (instructions > cost.maxInstructions) {
+        cost.maxInstructions = instructions;
+    }
+}
+
+void StageProfiler::discardResponse(void *instance, const char *str)
+{
+    StageProfiler *self = static_cast<StageProfiler *>(instance);
+    while (*str++) {
+        self->m_responseBytes++;
+    }
+}
+
+const char *StageProfiler::stageName(PipelineStage stage)
+{
+    switch (stage) {
+        case PipelineStage::Tokenize:
+            return "Tokenize";
+        case PipelineStage::Parse:
+            return "Parse";
+        case PipelineStage::Validate:
+            return "Validate";
+        case PipelineStage::Dispatch:
+            return "Dispatch";
+        case PipelineStage::Respond:
+            return "Respond";
+        default:
+            return "Unknown";
+    }
+}
+
+// A value per block, or - for a counter that is not available
+static void formatPerBlock(char *str, size_t size, double value, bool available)
+{
+    if (available) {
+        snprintf(str, size, "%.1f", value);
+    }
+    else {
+        snprintf(str, size, "-");
+    }
+}
+
+void StageProfiler::printRow(const SerialInterface &serial, const char *name,
+                             const StageCost &cost, const PerfCounters &counters)
+{
+    char instructions[24], maxInstructions[24], branches[24], misses[24], cache[24];
+    bool hasInstructions = counters.available(PerfCounter::Instructions);
+    formatPerBlock(instructions, sizeof(instructions),
+                   cost.perBlock(PerfCounter::Instructions), hasInstructions);
+    formatPerBlock(maxInstructions, sizeof(maxInstructions),
+                   static_cast<double>(cost.maxInstructions), hasInstructions);
+    formatPerBlock(branches, sizeof(branches), cost.perBlock(PerfCounter::Branches),
+                   counters.available(PerfCounter::Branches));
+    double branchCount = cost.perBlock(PerfCounter::Branches);
+    formatPerBlock(misses, sizeof(misses),
+                   branchCount > 0. ? 100. * cost.perBlock(PerfCounter::BranchMisses) /
+                                          branchCount
+                                    : 0.,
+                   counters.available(PerfCounter::BranchMisses) &&
+                       counters.available(PerfCounter::Branches));
+    formatPerBlock(cache, sizeof(cache), cost.perBlock(PerfCounter::CacheMisses),
+                   counters.available(PerfCounter::CacheMisses));
+
+    char str[160];
+    snprintf(str, sizeof(str), "%-9s %10llu %10s %10s %10s %7s %8s %8.1f %8llu", name,
+             static_cast<unsigned long long>(cost.blocks), instructions, maxInstructions,
+             branches, misses, cache, cost.nanosecondsPerBlock(),
+             static_cast<unsigned long long>(cost.maxNanoseconds));
+    serial.println(str);
+}
+
+void StageProfiler::print(const SerialInterface &serial) const
+{
+    char str[160];
+    snprintf(str, sizeof(str), "%llu blocks, %llu with errors, %s",
+             static_cast<unsigned long long>(blocks()),
+             static_cast<unsigned long long>(m_errors),
+             countersAvailable() ? "per block in user space"
+                                 : "no hardware counters, only the wall time");
+    serial.println(str);
+    snprintf(str, sizeof(str), "%-9s %10s %10s %10s %10s %7s %8s %8s %8s", "Stage",
+             "Blocks", "Instr", "Max instr", "Branches", "Miss %", "Cache", "ns",
+             "Max ns");
+    serial.println(str);
+    for (int i = 0; i < GCGP_NUM_PIPELINE_STAGES; i++) {
+        PipelineStage stage = static_cast<PipelineStage>(i);
+        printRow(serial, stageName(stage), m_costs[i], m_counters);
+    }
+    printRow(serial, "Total", m_total, m_counters);
+}
+
+#endif // !defined(ARDUINO)
@@ -0,0 +1,255 @@
+
+#include "GCGP/StepGenerator.h"
+
+#define STEP_BLOCK_BUFFER_SIZE (GCGP_STEP_SEGMENT_BUFFER_SIZE + 1)
+
+static_assert((GCGP_STEP_SEGMENT_BUFFER_SIZE & (GCGP_STEP_SEGMENT_BUFFER_SIZE - 1)) == 0 &&
+                  GCGP_STEP_SEGMENT_BUFFER_SIZE <= 128,
+              "GCGP_STEP_SEGMENT_BUFFER_SIZE must be a power of two up to 128");
+
+StepGenerator::StepGenerator(const StepperSettings &settings) : settings(settings)
+{
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_prepPosition[i] = 0;
+        m_axisSteps[i] = 0;
+        m_counter[i] = 0;
+        m_position[i] = 0;
+    }
+}
+
+size_t StepGenerator::prepare(Planner &planner)
+{
+    const float segmentTime = 1.f / settings.segmentFrequency;
+    size_t added = 0;
+
+    while (!isFull()) {
+        if (!m_prepBlock) {
+            if (!startBlock(planner)) {
+                break;
+            }
+            if (!m_prepBlock) { // Shorter than a step
+                continue;
+            }
+        }
+
+        // Slow segments are extended until they contain at least one step
+        const StepBlock &stepBlock = m_blocks[m_blockHead];
+        uint32_t totalSteps = stepBlock.stepEventCount >> GCGP_STEP_MAX_AMASS_LEVEL;
+        float distance = m_prepDistance;
+        float time = 0.f;
+        uint32_t steps = m_prepSteps;
+        while (steps == m_prepSteps && distance < m_prepBlock->millimeters) {
+            float dt = segmentTime;
+            distance = advance(distance, dt);
+            time += dt;
+            if (distance >= m_prepBlock->millimeters) {
+                steps = totalSteps;
+            }
+            else {
+                steps = static_cast<uint32_t>(distance * m_prepStepsPerMm);
+                steps = steps < totalSteps ? steps : totalSteps;
+            }
+        }
+
+        // The segment ends at its last step, the time to the next step is carried
+        // over, so that the step rate is exact even with few steps per segment
+        if (distance < m_prepBlock->millimeters) {
+            float stepDistance = steps / m_prepStepsPerMm;
+            float speed = speedAt(distance);
+            if (speed > 0.f && stepDistance < distance) {
+                float excess = (distance - stepDistance) / speed;
+                time = excess < time ? time - excess : time;
+                distance = stepDistance;
+            }
+        }
+
+        uint32_t count = steps - m_prepSteps;
+        if (count > 0 && time > 0.f) {
+            float period = settings.timerFrequency * time / count;
+            uint8_t amassLevel = 0;
+            if (period >= settings.timerFrequency / GCGP_STEP_AMASS_LEVEL3_RATE) {
+                amassLevel = 3;
+            }
+            else if (period >= settings.timerFrequency / GCGP_STEP_AMASS_LEVEL2_RATE) {
+                amassLevel = 2;
+            }
+            else if (period >= settings.timerFrequency / GCGP_STEP_AMASS_LEVEL1_RATE) {
+                amassLevel = 1;
+            }
+
+            uint8_t head = m_segmentHead;
+            StepSegment &segment = m_segments[head & (GCGP_STEP_SEGMENT_BUFFER_SIZE - 1)];
+            segment.stepCount = count << amassLevel;
+            segment.period = static_cast<uint32_t>(period / (1 << amassLevel) + 0.5f);
+            segment.block = m_blockHead;
+            segment.amassLevel = amassLevel;
+            atomicStoreRelease(&m_segmentHead, static_cast<uint8_t>(head + 1));
+            added++;
+        }
+
+        m_prepDistance = distance;
+        m_prepSteps = steps;
+        if (distance >= m_prepBlock->millimeters) {
+            planner.discardCurrentBlock();
+            m_prepBlock = nullptr;
+            m_blockHead = (m_blockHead + 1) % STEP_BLOCK_BUFFER_SIZE;
+        }
+    }
+    return added;
+}
+
+AxisBits StepGenerator::tick()
+{
+    if (m_stepsLeft == 0) {
+        if (atomicLoadAcquire(&m_segmentHead) == m_segmentTail) {
+            return 0;
+        }
+        const StepSegment &segment =
+            m_segments[m_segmentTail & (GCGP_STEP_SEGMENT_BUFFER_SIZE - 1)];
+        const StepBlock &block = m_blocks[segment.block];
+        if (segment.block != m_executingBlock) {
+            m_executingBlock = segment.block;
+            m_eventCount = block.stepEventCount;
+            m_directionBits = block.directionBits ^ settings.directionInvertMask;
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                m_counter[i] = m_eventCount >> 1;
+            }
+        }
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            m_axisSteps[i] = block.steps[i] >> segment.amassLevel;
+        }
+        m_stepsLeft = segment.stepCount;
+        m_period = segment.period;
+    }
+
+    AxisBits stepBits = 0;
+    AxisBits negative = m_directionBits ^ settings.directionInvertMask;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_counter[i] += m_axisSteps[i];
+        if (m_counter[i] > m_eventCount) {
+            m_counter[i] -= m_eventCount;
+            stepBits |= 1 << i;
+            m_position[i] += (negative & (1 << i)) ? -1 : 1;
+        }
+    }
+
+    if (--m_stepsLeft == 0) {
+        atomicStoreRelease(&m_segmentTail, static_cast<uint8_t>(m_segmentTail + 1));
+    }
+    return stepBits;
+}
+
+void StepGenerator::reset()
+{
+    m_segmentTail = m_segmentHead;
+    m_stepsLeft = 0;
+    m_executingBlock = 0xFF;
+    m_prepBlock = nullptr;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        m_prepPosition[i] = m_position[i];
+    }
+}
+
+// Converts the current planner block into a StepBlock. Returns false if there is
+// none. Blocks without steps are discarded right away, then m_prepBlock stays null.
+bool StepGenerator::startBlock(Planner &planner)
+{
+    const PlannerBlock *block = planner.currentBlock();
+    if (!block) {
+        return false;
+    }
+
+    // Unreachable targets are clamped by the kinematics, jobs can be checked for them
+    // on the host with Kinematics::inverseBatch()
+    float joints[GCGP_NUM_AXES];
+    settings.kinematics.inverse(block->target, joints);
+
+    StepBlock &stepBlock = m_blocks[m_blockHead];
+    stepBlock.directionBits = 0;
+    uint32_t maxSteps = 0;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        int32_t target =
+            static_cast<int32_t>(lroundf(joints[i] * settings.stepsPerMm[i]));
+        int32_t delta = target - m_prepPosition[i];
+        m_prepPosition[i] = target;
+        if (delta < 0) {
+            stepBlock.directionBits |= 1 << i;
+            delta = -delta;
+        }
+        uint32_t steps = static_cast<uint32_t>(delta);
+        stepBlock.steps[i] = steps << GCGP_STEP_MAX_AMASS_LEVEL;
+        maxSteps = steps > maxSteps ? steps : maxSteps;
+    }
+    stepBlock.stepEventCount = maxSteps << GCGP_STEP_MAX_AMASS_LEVEL;
+
+    if (maxSteps == 0) {
+        planner.discardCurrentBlock();
+        return true;
+    }
+    m_prepBlock = block;
+    m_prepDistance = 0.f;
+    m_prepSteps = 0;
+    m_prepStepsPerMm = maxSteps / block->millimeters;
+    return true;
+}
+
+// Speed of the trapezoid at the distance into the block
+float StepGenerator::speedAt(float distance) const
+{
+    const PlannerBlock &block = *m_prepBlock;
+    float speedSqr;
+    if (distance < block.accelerateUntil) {
+        speedSqr = block.entrySpeedSqr + 2.f * block.acceleration * distance;
+    }
+    else if (distance < block.decelerateAfter) {
+        speedSqr = block.peakSpeedSqr;
+    }
+    else {
+        speedSqr = block.peakSpeedSqr -
+                   2.f * block.acceleration * (distance - block.decelerateAfter);
+    }
+    return speedSqr > 0.f ? sqrtf(speedSqr) : 0.f;
+}
+
+// Moves along the trapezoid of the block for the given time. Returns the new
+// distance, and if the end of the block is reached first, sets the time to the part
+// that was used.
+float StepGenerator::advance(float distance, float &time) const
+{
+    const PlannerBlock &block = *m_prepBlock;
+    float acceleration = block.acceleration;
+    float peakSpeed = sqrtf(block.peakSpeedSqr);
+    float remaining = time;
+
+    if (distance < block.accelerateUntil) {
+        float speed = sqrtf(block.entrySpeedSqr + 2.f * acceleration * distance);
+        float phaseTime = (peakSpeed - speed) / acceleration;
+        if (remaining < phaseTime) {
+            return distance + remaining * (speed + 0.5f * acceleration * remaining);
+        }
+        remaining -= phaseTime;
+        distance = block.accelerateUntil;
+    }
+
+    if (distance < block.decelerateAfter && peakSpeed > 0.f) {
+        float phaseTime = (block.decelerateAfter - distance) / peakSpeed;
+        if (remaining < phaseTime) {
+            return distance + remaining * peakSpeed;
+        }
+        remaining -= phaseTime;
+        distance = block.decelerateAfter;
+    }
+
+    float speedSqr =
+        block.peakSpeedSqr - 2.f * acceleration * (distance - block.decelerateAfter);
+    float speed = speedSqr > 0.f ? sqrtf(speedSqr) : 0.f;
+    float phaseTime = (speed - sqrtf(block.exitSpeedSqr)) / acceleration;
+    if (phaseTime > 0.f && remaining < phaseTime) {
+        return distance + remaining * (speed - 0.5f * acceleration * remaining);
+    }
+    if (phaseTime > 0.f) {
+        remaining -= phaseTime;
+    }
+    time -= remaining;
+    return block.millimeters;
+}
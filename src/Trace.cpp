@@ -0,0 +1,129 @@
+#include "GCGP/Trace.h"
+
+#if GCGP_ENABLE_TRACE
+TraceBuffer traceBuffer;
+#endif
+
+#if !defined(ARDUINO)
+
+#include <chrono>
+
+// Spans nested deeper than this are left out of the Chrome trace
+#define MAX_TRACE_DEPTH 16
+
+uint64_t traceClockNanoseconds()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                     std::chrono::steady_clock::now().time_since_epoch())
+                                     .count());
+}
+
+const char *traceEventName(TraceEvent event)
+{
+    switch (event) {
+        case TraceEvent::Receive:
+            return "Receive";
+        case TraceEvent::Realtime:
+            return "Realtime";
+        case TraceEvent::BufferFull:
+            return "BufferFull";
+        case TraceEvent::Parse:
+            return "Parse";
+        case TraceEvent::Tokenize:
+            return "Tokenize";
+        case TraceEvent::Interpret:
+            return "Interpret";
+        case TraceEvent::Validate:
+            return "Validate";
+        case TraceEvent::Callback:
+            return "Callback";
+        case TraceEvent::Transmit:
+            return "Transmit";
+        default:
+            return "Unknown";
+    }
+}
+
+// What the arg of an event means, for the details of it in the viewer
+static const char *traceArgName(TraceEvent event)
+{
+    switch (event) {
+        case TraceEvent::Receive:
+            return "bytes";
+        case TraceEvent::Realtime:
+            return "byte";
+        case TraceEvent::Parse:
+        case TraceEvent::Tokenize:
+        case TraceEvent::Interpret:
+        case TraceEvent::Validate:
+            return "error";
+        default:
+            return "arg";
+    }
+}
+
+static void writeString(void (*cbWrite)(void *, const char *, size_t), void *instance,
+                        const char *str)
+{
+    cbWrite(instance, str, strlen(str));
+}
+
+void writeChromeTrace(const TraceBuffer &buffer,
+                      void (*cbWrite)(void *, const char *, size_t), void *instance)
+{
+    struct Span {
+        TraceEvent event;
+        uint64_t start;
+    };
+    Span open[MAX_TRACE_DEPTH];
+    size_t depth = 0;
+    size_t skipped = 0; // Begins deeper than MAX_TRACE_DEPTH, their ends are skipped
+
+    // Ticks since the oldest record. The differences of the timestamps are taken in
+    // their own type, so a clock that wraps around still counts up.
+    uint64_t ticks = 0;
+    const char *separator = "\n";
+    char str[192];
+    writeString(cbWrite, instance, "{\"traceEvents\":[");
+    for (size_t i = 0; i < buffer.size(); i++) {
+        const TraceRecord &record = buffer[i];
+        if (i > 0) {
+            TraceTimestamp previous = buffer[i - 1].timestamp;
+            ticks += static_cast<TraceTimestamp>(record.timestamp - previous);
+        }
+        double timestamp = static_cast<double>(ticks) / GCGP_TRACE_TICKS_PER_US;
+        const char *name = traceEventName(record.event);
+        const char *argName = traceArgName(record.event);
+
+        if (record.phase == TracePhase::Begin) {
+            if (depth < MAX_TRACE_DEPTH) {
+                open[depth++] = {record.event, ticks};
+            }
+            else {
+                skipped++;
+            }
+            continue;
+        }
+        if (skipped > 0) {
+            skipped--;
+            continue;
+        }
+        // An end without its begin, which was overwritten
+        if (depth == 0 || open[depth - 1].event != record.event) {
+            continue;
+        }
+        depth--;
+        double start = static_cast<double>(open[depth].start) / GCGP_TRACE_TICKS_PER_US;
+        snprintf(str, sizeof(str),
+                 "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,"
+                 "\"tid\":1,\"args\":{\"%s\":%u}}",
+                 separator, name, start, timestamp - start, argName, record.arg);
+        writeString(cbWrite, instance, str);
+        separator = ",\n";
+    }
+    snprintf(str, sizeof(str), "\n],\"displayTimeUnit\":\"ns\",\"otherData\":{"
+             "\"dropped\":%u}}\n", buffer.dropped());
+    writeString(cbWrite, instance, str);
+}
+
+#endif // !defined(ARDUINO)
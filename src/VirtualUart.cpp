@@ -0,0 +1,156 @@
+
+#include "GCGP/VirtualUart.h"
+
+#if !defined(ARDUINO)
+
+VirtualUart::VirtualUart(const VirtualClock &clock, const UartSettings &settings)
+    : settings(settings), m_clock(clock)
+{
+}
+
+uint64_t VirtualUart::byteTime() const
+{
+    if (settings.baudRate == 0) {
+        return 0;
+    }
+    return VirtualClock::fromSeconds(static_cast<double>(settings.frameBits) /
+                                     settings.baudRate);
+}
+
+// A byte starts once the previous one is through, or right away if the line is free
+size_t VirtualUart::Channel::push(const char *bytes, size_t length, uint64_t now,
+                                  uint64_t byteTime)
+{
+    size_t pushed = 0;
+    for (; pushed < length && count < GCGP_VIRTUAL_UART_BUFFER_SIZE; pushed++) {
+        lastArrival = (lastArrival > now ? lastArrival : now) + byteTime;
+        size_t index = (start + count) % GCGP_VIRTUAL_UART_BUFFER_SIZE;
+        data[index] = bytes[pushed];
+        arrival[index] = lastArrival;
+        count++;
+    }
+    return pushed;
+}
+
+void VirtualUart::Channel::pop()
+{
+    start = (start + 1) % GCGP_VIRTUAL_UART_BUFFER_SIZE;
+    count--;
+}
+
+size_t VirtualUart::hostWrite(const char *data, size_t length)
+{
+    return m_toController.push(data, length, m_clock.now, byteTime());
+}
+
+int VirtualUart::hostRead()
+{
+    if (m_toHost.count == 0 || m_toHost.arrival[m_toHost.start] > m_clock.now) {
+        return -1;
+    }
+    int c = static_cast<unsigned char>(m_toHost.data[m_toHost.start]);
+    m_toHost.pop();
+    return c;
+}
+
+SerialInterface VirtualUart::serial()
+{
+    return SerialInterface(this, available, peek, read, write);
+}
+
+// As nothing was read since the last call, everything that arrived in the meantime
+// competes for the space that was left then
+void VirtualUart::receive()
+{
+    size_t depth = settings.rxFifoDepth;
+    depth = depth < GCGP_VIRTUAL_UART_BUFFER_SIZE ? depth : GCGP_VIRTUAL_UART_BUFFER_SIZE;
+    bool flowControl = settings.flowControl || settings.baudRate == 0;
+    while (m_toController.count > 0 &&
+           m_toController.arrival[m_toController.start] <= m_clock.now) {
+        if (m_fifoCount < depth) {
+            m_fifo[(m_fifoStart + m_fifoCount) % GCGP_VIRTUAL_UART_BUFFER_SIZE] =
+                m_toController.data[m_toController.start];
+            m_fifoCount++;
+        }
+        else if (flowControl) {
+            break; // Held back by the host until there is space
+        }
+        else {
+            m_lostBytes++;
+        }
+        m_toController.pop();
+    }
+}
+
+uint64_t VirtualUart::nextArrival()
+{
+    receive();
+    uint64_t next = UINT64_MAX;
+    if (m_toController.count > 0) {
+        uint64_t arrival = m_toController.arrival[m_toController.start];
+        if (arrival > m_clock.now) {
+            next = arrival;
+        }
+    }
+    if (m_toHost.count > 0) {
+        uint64_t arrival = m_toHost.arrival[m_toHost.start];
+        next = arrival < next ? arrival : next;
+    }
+    return next;
+}
+
+bool VirtualUart::pendingToController()
+{
+    return m_toController.count > 0 || m_fifoCount > 0;
+}
+
+size_t VirtualUart::readable()
+{
+    receive();
+    return m_fifoCount;
+}
+
+bool VirtualUart::isIdle()
+{
+    return !pendingToController() && m_toHost.count == 0;
+}
+
+int VirtualUart::available(void *instance)
+{
+    VirtualUart *self = static_cast<VirtualUart *>(instance);
+    self->receive();
+    return static_cast<int>(self->m_fifoCount);
+}
+
+int VirtualUart::peek(void *instance)
+{
+    VirtualUart *self = static_cast<VirtualUart *>(instance);
+    self->receive();
+    if (self->m_fifoCount == 0) {
+        return -1;
+    }
+    return static_cast<unsigned char>(self->m_fifo[self->m_fifoStart]);
+}
+
+int VirtualUart::read(void *instance)
+{
+    VirtualUart *self = static_cast<VirtualUart *>(instance);
+    int c = peek(instance);
+    if (c != -1) {
+        self->m_fifoStart = (self->m_fifoStart + 1) % GCGP_VIRTUAL_UART_BUFFER_SIZE;
+        self->m_fifoCount--;
+    }
+    return c;
+}
+
+// Answers that do not fit on the wire anymore are lost, there is no flow control
+// towards the host
+void VirtualUart::write(void *instance, const char *str)
+{
+    VirtualUart *self = static_cast<VirtualUart *>(instance);
+    size_t length = strlen(str);
+    size_t pushed = self->m_toHost.push(str, length, self->m_clock.now, self->byteTime());
+    self->m_lostBytes += static_cast<uint32_t>(length - pushed);
+}
+
+#endif // !defined(ARDUINO)
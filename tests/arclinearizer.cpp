@@ -0,0 +1,133 @@
+#include <GCGP/ArcLinearizer.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+static Move resolve(const char *str, const float start[GCGP_NUM_AXES])
+{
+    Command<10> command;
+    REQUIRE(command.parse(str, strlen(str)) == GrblError::None);
+    ModalState modalState;
+    Move move;
+    REQUIRE(modalState.resolve(command, start, move) == GrblError::None);
+    REQUIRE(move.isArc());
+    return move;
+}
+
+struct Point {
+    float p[GCGP_NUM_AXES];
+};
+
+static std::vector<Point> linearize(const Move &move, float tolerance)
+{
+    ArcLinearizer arc;
+    arc.begin(move, tolerance);
+    std::vector<Point> points;
+    Point point;
+    while (arc.next(point.p)) {
+        points.push_back(point);
+    }
+    REQUIRE(points.size() == arc.segmentCount());
+    REQUIRE(arc.isDone());
+    return points;
+}
+
+// Distance of the point from the arc, measured in the plane
+static float radiusError(const Move &move, const float point[GCGP_NUM_AXES])
+{
+    float d0 = point[move.axis0] - move.center[0];
+    float d1 = point[move.axis1] - move.center[1];
+    return fabsf(sqrtf(d0 * d0 + d1 * d1) - move.radius);
+}
+
+TEST_CASE("chords stay within the tolerance in all planes", "arclinearizer")
+{
+    const char *commands[] = {
+        "G17 G2 X10 Y0 I5 F100", "G17 G3 X10 Y0 I5 F100", "G18 G2 X10 Z0 I5 F100",
+        "G18 G3 X0 Z0 K-3 F100", "G19 G2 Y10 Z0 J5 F100", "G19 G3 Y2 Z2 K2 F100",
+    };
+    const float start[GCGP_NUM_AXES] = {};
+    const float tolerance = 0.002f;
+
+    for (const char *command : commands) {
+        Move move = resolve(command, start);
+        std::vector<Point> points = linearize(move, tolerance);
+        REQUIRE(points.size() > 1);
+
+        const float *previous = move.start;
+        for (const Point &point : points) {
+            REQUIRE(radiusError(move, point.p) < 1e-4f);
+
+            // The middle of the chord is the farthest from the arc
+            float middle[GCGP_NUM_AXES];
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                middle[i] = 0.5f * (previous[i] + point.p[i]);
+            }
+            REQUIRE(radiusError(move, middle) <= tolerance * 1.01f);
+            previous = point.p;
+        }
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            REQUIRE(points.back().p[i] == move.target[i]);
+        }
+    }
+}
+
+TEST_CASE("rotation direction", "arclinearizer")
+{
+    const float start[GCGP_NUM_AXES] = {};
+    // From the left of the center, clockwise goes over the top in XY
+    Move cw = resolve("G17 G2 X10 Y0 I5 F100", start);
+    REQUIRE(linearize(cw, 0.01f)[1].p[1] > 0.f);
+    Move ccw = resolve("G17 G3 X10 Y0 I5 F100", start);
+    REQUIRE(linearize(ccw, 0.01f)[1].p[1] < 0.f);
+}
+
+TEST_CASE("helical arcs move the linear axis evenly", "arclinearizer")
+{
+    const float start[GCGP_NUM_AXES] = { 1.f, 2.f, 3.f };
+    Move move = resolve("G17 G3 X1 Y2 Z-7 I4 J0 F100", start); // Full circle
+    std::vector<Point> points = linearize(move, 0.001f);
+
+    float step = -10.f / points.size();
+    for (size_t i = 0; i < points.size(); i++) {
+        REQUIRE(fabsf(points[i].p[2] - (3.f + step * (i + 1))) < 1e-4f);
+    }
+    REQUIRE(points.back().p[2] == -7.f);
+}
+
+TEST_CASE("incremental rotation does not drift", "arclinearizer")
+{
+    // Many segments on a large radius, where rounding errors would add up the most
+    const float start[GCGP_NUM_AXES] = {};
+    Move move = resolve("G17 G2 X0 Y0 I500 F100", start);
+    std::vector<Point> points = linearize(move, 0.0005f);
+    REQUIRE(points.size() > 2000);
+
+    float maxError = 0.f;
+    for (const Point &point : points) {
+        maxError = fmaxf(maxError, radiusError(move, point.p));
+    }
+    REQUIRE(maxError < 1e-3f);
+}
+
+TEST_CASE("tolerance of 0 or less", "arclinearizer")
+{
+    const float start[GCGP_NUM_AXES] = {};
+    Move move = resolve("G17 G2 X0 Y0 I10 F100", start);
+    size_t minimum = linearize(move, GCGP_ARC_MIN_TOLERANCE).size();
+    for (float tolerance : {0.f, -1.f}) {
+        std::vector<Point> points = linearize(move, tolerance);
+        REQUIRE(points.size() == minimum);
+        REQUIRE(points.back().p[0] == move.target[0]);
+        REQUIRE(points.back().p[1] == move.target[1]);
+    }
+}
+
+TEST_CASE("tolerance larger than the radius", "arclinearizer")
+{
+    const float start[GCGP_NUM_AXES] = {};
+    Move move = resolve("G17 G2 X0.2 Y0 I0.1 F100", start);
+    std::vector<Point> points = linearize(move, 1.f);
+    REQUIRE(points.size() == 1);
+    REQUIRE(points[0].p[0] == move.target[0]);
+}
@@ -0,0 +1,86 @@
+#include <GCGP/Async.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+TEST_CASE("async", "async")
+{
+    AsyncEventLoop loop;
+    AsyncGrblInterface grbl(loop, 2);
+
+    std::vector<MotionType> received;
+    std::vector<std::string> responses;
+    const std::vector<std::string> lines = {"G0 X1", "G1 Y2 F100", "G4 X", "G2 X1 I1"};
+
+    auto controller = [&]() -> AsyncTask {
+        while (true) {
+            Command<10> command = co_await grbl.nextCommand();
+            received.push_back(command.motionType);
+        }
+    };
+
+    auto sender = [&]() -> AsyncTask {
+        responses.push_back(co_await grbl.tx().readLine()); // Welcome message
+        for (const std::string &line : lines) {
+            grbl.rx().write(line.c_str());
+            grbl.rx().write('\n');
+            responses.push_back(co_await grbl.tx().readLine());
+        }
+    };
+
+    // Without a consumer, the interface stops parsing once its buffer is full
+    loop.spawn(sender());
+    loop.run();
+    REQUIRE(grbl.numberOfQueuedCommands() == 2);
+    REQUIRE(responses.size() == 3);
+
+    loop.spawn(controller());
+    loop.run();
+    REQUIRE(received ==
+            std::vector<MotionType>{MotionType::Rapid, MotionType::Feed, MotionType::ArcCW});
+    REQUIRE(responses.size() == 5);
+    REQUIRE(responses[0] == GCGP_WELCOME_MESSAGE);
+    REQUIRE(responses[1] == GCGP_OK_MESSAGE);
+    REQUIRE(responses[2] == GCGP_OK_MESSAGE);
+    REQUIRE(responses[3].rfind(GCGP_ERROR_MESSAGE, 0) == 0);
+    REQUIRE(responses[4] == GCGP_OK_MESSAGE);
+    REQUIRE(grbl.numberOfQueuedCommands() == 0);
+}
+
+TEST_CASE("async with more bytes than the RX buffer", "async")
+{
+    AsyncEventLoop loop;
+    AsyncGrblInterface grbl(loop, 4);
+
+    std::string stream;
+    for (int i = 0; i < 40; i++) {
+        stream += "G999\n";
+    }
+    stream += "G1 X1 F100\n";
+    REQUIRE(stream.size() > GCGP_RX_BUFFER_SIZE);
+
+    size_t commands = 0;
+    size_t answers = 0;
+    auto controller = [&]() -> AsyncTask {
+        while (true) {
+            co_await grbl.nextCommand();
+            commands++;
+        }
+    };
+
+    auto sender = [&]() -> AsyncTask {
+        co_await grbl.tx().readLine(); // Welcome message
+        grbl.rx().write(stream.c_str()); // All at once
+        for (int i = 0; i < 41; i++) {
+            co_await grbl.tx().readLine();
+            answers++;
+        }
+    };
+
+    loop.spawn(controller());
+    loop.spawn(sender());
+    loop.run();
+    REQUIRE(answers == 41);
+    REQUIRE(commands == 1);
+    REQUIRE(grbl.rx().available() == 0);
+}
@@ -0,0 +1,83 @@
+// Built with GCGP_NUM_AXES 9, see CMakeLists.txt
+#include <GCGP/Planner.h>
+#include <GCGP/SoftLimits.h>
+#include <GCGP/StepGenerator.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "testutils.h"
+
+static_assert(GCGP_NUM_AXES == 9, "This test needs all axes");
+static_assert(sizeof(AxisBits) == 2, "Nine axes need two bytes of bits");
+
+TEST_CASE("axis words of all axes", "axes")
+{
+    Command<10> command = parse("G1 X1 Y2 Z3 A4 B5 C6 U7 V8 W9");
+    for (int i = 0; i < 9; i++) {
+        REQUIRE(command.pos[i] == static_cast<float>(i + 1));
+    }
+    const char *str = "G1 A1 A2";
+    REQUIRE(command.parse(str, strlen(str)) == GrblError::GCodeMultiplyDefinedParameters);
+    str = "$J=G91 W-1 F100";
+    REQUIRE(command.parse(str, strlen(str)) == GrblError::None);
+    REQUIRE(command.pos[8] == -1.f);
+
+    // A command with fewer axes rejects the others
+    Command<10, 4> fourAxes;
+    str = "G1 X1 A90";
+    REQUIRE(fourAxes.parse(str, strlen(str)) == GrblError::None);
+    REQUIRE(fourAxes.pos[3] == 90.f);
+    str = "G1 X1 B90";
+    REQUIRE(fourAxes.parse(str, strlen(str)) == GrblError::GCodeUnsupportedCommand);
+    Command<10, 3> threeAxes;
+    str = "G1 A90";
+    REQUIRE(threeAxes.parse(str, strlen(str)) == GrblError::GCodeUnsupportedCommand);
+}
+
+TEST_CASE("rotary axes are not scaled by G20", "axes")
+{
+    ModalState state;
+    float position[GCGP_NUM_AXES] = {};
+    Move move;
+    REQUIRE(state.resolve(parse("G20 G1 X1 A90 U1 F10"), position, move) ==
+            GrblError::None);
+    REQUIRE(near(move.target[0], 25.4f));
+    REQUIRE(near(move.target[3], 90.f));
+    REQUIRE(near(move.target[6], 25.4f));
+
+    CoordinateTransform transform = state.transform();
+    REQUIRE(transform.scale[3] == 1.f);
+    REQUIRE(transform.scale[8] == 25.4f);
+
+    REQUIRE(state.resolve(parse("G92 C10"), position, move) == GrblError::None);
+    REQUIRE(near(state.offset()[5], -10.f));
+}
+
+TEST_CASE("moves and steps on all axes", "axes")
+{
+    PlannerSettings plannerSettings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        plannerSettings.maxRate[i] = 6000.f;
+        plannerSettings.acceleration[i] = 500.f;
+    }
+    Planner planner(plannerSettings);
+    StepperSettings stepperSettings;
+    stepperSettings.directionInvertMask = 1 << 8;
+    StepGenerator stepper(stepperSettings);
+
+    REQUIRE(planner.addCommand(parse("G1 X1 A2 W-3 F600")) == GrblError::None);
+    REQUIRE(planner.addCommand(parse("G2 X3 Y0 I1 J0 A4")) == GrblError::None);
+    AxisBits directionBits = 0;
+    while (!planner.isEmpty() || stepper.isRunning()) {
+        stepper.prepare(planner);
+        if (stepper.tick() & (1 << 8)) {
+            directionBits = stepper.directionBits();
+        }
+    }
+    REQUIRE(stepper.position()[0] == 240);
+    REQUIRE(stepper.position()[3] == 320);
+    REQUIRE(stepper.position()[8] == -240);
+    REQUIRE(directionBits == 0); // Negative, but inverted
+
+    SoftLimits limits;
+    REQUIRE(limits.check(planner.position()) == (1 << 0 | 1 << 3));
+}
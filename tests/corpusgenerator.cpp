@@ -0,0 +1,141 @@
+#include <GCGP/CorpusGenerator.h>
+#include <GCGP/Planner.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+static CorpusSettings corpusSettings(CorpusStyle style, uint64_t seed = 1)
+{
+    CorpusSettings settings;
+    settings.style = style;
+    settings.seed = seed;
+    return settings;
+}
+
+static PlannerSettings plannerSettings()
+{
+    PlannerSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.maxRate[i] = 6000.f;
+        settings.acceleration[i] = 1000.f;
+    }
+    return settings;
+}
+
+// Every line must parse and be accepted by the planner, which also checks the arcs
+static void checkValid(CorpusGenerator &generator, size_t lines)
+{
+    Planner planner(plannerSettings());
+    bool inside = true;
+    for (size_t i = 0; i < lines; i++) {
+        const char *line = generator.nextLine();
+        Command<10> command;
+        INFO(line);
+        REQUIRE(command.parse(line, strlen(line)) == GrblError::None);
+        REQUIRE(planner.addCommand(command) == GrblError::None);
+        while (planner.isFull()) {
+            planner.currentBlock();
+            planner.discardCurrentBlock();
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            float position = planner.position()[axis];
+            inside = inside && position >= -20.f && position <= 120.f;
+        }
+    }
+    REQUIRE(inside); // Within the stock of 100 mm and 20 mm of depth
+}
+
+TEST_CASE("all styles are valid G-code", "corpusgenerator")
+{
+    CorpusStyle styles[] = {CorpusStyle::Surfacing, CorpusStyle::Pocketing,
+                            CorpusStyle::Drilling, CorpusStyle::LaserRaster,
+                            CorpusStyle::Mixed};
+    for (CorpusStyle style : styles) {
+        CorpusGenerator generator(corpusSettings(style));
+        checkValid(generator, style == CorpusStyle::Mixed ? 300000 : 30000);
+        REQUIRE(generator.lines() == (style == CorpusStyle::Mixed ? 300000 : 30000));
+        REQUIRE(generator.malformedLines() == 0);
+    }
+}
+
+TEST_CASE("styles have their typical lines", "corpusgenerator")
+{
+    auto count = [](CorpusStyle style, const char *word) {
+        CorpusGenerator generator(corpusSettings(style));
+        size_t found = 0;
+        for (int i = 0; i < 10000; i++) {
+            found += strstr(generator.nextLine(), word) != nullptr;
+        }
+        return found;
+    };
+    REQUIRE(count(CorpusStyle::Surfacing, "Z") > 9000);
+    REQUIRE(count(CorpusStyle::Pocketing, "G3") > 2000);
+    REQUIRE(count(CorpusStyle::Drilling, "G0 Z") > 4000);
+    REQUIRE(count(CorpusStyle::LaserRaster, " S") > 9000);
+    REQUIRE(count(CorpusStyle::Mixed, "M6") > 0);
+}
+
+TEST_CASE("the same seed gives the same corpus", "corpusgenerator")
+{
+    CorpusGenerator a(corpusSettings(CorpusStyle::Mixed, 7));
+    CorpusGenerator b(corpusSettings(CorpusStyle::Mixed, 7));
+    CorpusGenerator c(corpusSettings(CorpusStyle::Mixed, 8));
+    size_t different = 0;
+    for (int i = 0; i < 50000; i++) {
+        std::string line = a.nextLine();
+        REQUIRE(line == b.nextLine());
+        different += line != c.nextLine();
+    }
+    REQUIRE(different > 0);
+
+    // Fixed output, so a change of it is noticed
+    CorpusGenerator pocket(corpusSettings(CorpusStyle::Pocketing, 1));
+    REQUIRE(std::string(pocket.nextLine()) == "G21 G90 G17 G94");
+    REQUIRE(std::string(pocket.nextLine()).rfind("T1 M6", 0) == 0);
+}
+
+TEST_CASE("malformed lines", "corpusgenerator")
+{
+    CorpusSettings settings = corpusSettings(CorpusStyle::Mixed, 3);
+    settings.malformedRate = 0.05f;
+    CorpusGenerator generator(settings);
+    CorpusGenerator valid(corpusSettings(CorpusStyle::Mixed, 3));
+
+    size_t rejected = 0;
+    for (int i = 0; i < 100000; i++) {
+        const char *line = generator.nextLine();
+        Command<10> command;
+        if (command.parse(line, strlen(line)) != GrblError::None) {
+            rejected++;
+            continue;
+        }
+        // Apart from the inserted lines, the program is the same as without them
+        REQUIRE(std::string(line) == valid.nextLine());
+    }
+    REQUIRE(rejected == generator.malformedLines());
+    REQUIRE(rejected > 4500);
+    REQUIRE(rejected < 5500);
+}
+
+TEST_CASE("write streams whole lines", "corpusgenerator")
+{
+    struct Sink {
+        uint64_t bytes = 0;
+        uint64_t newlines = 0;
+        bool wholeLines = true;
+    } sink;
+    CorpusGenerator generator;
+    uint64_t written = generator.write(
+        1 << 20,
+        [](void *instance, const char *data, size_t length) {
+            Sink *sink = static_cast<Sink *>(instance);
+            sink->bytes += length;
+            sink->newlines += data[length - 1] == '\n';
+            sink->wholeLines = sink->wholeLines && memchr(data, '\n', length - 1) == 0;
+        },
+        &sink);
+    REQUIRE(written == sink.bytes);
+    REQUIRE(written >= 1 << 20);
+    REQUIRE(written < (1 << 20) + GCGP_MAX_COMMAND_LENGTH + 1);
+    REQUIRE(sink.newlines == generator.lines());
+    REQUIRE(sink.wholeLines);
+}
@@ -0,0 +1,124 @@
+#include <GCGP/Feedback.h>
+#include <catch2/catch_test_macros.hpp>
+#include <thread>
+
+#include "testutils.h"
+
+static void publishError(FollowingErrorMonitor &monitor, float error)
+{
+    float set[GCGP_NUM_AXES] = {};
+    float actual[GCGP_NUM_AXES] = {};
+    actual[0] = error;
+    monitor.publish(set, actual);
+}
+
+TEST_CASE("following error statistics", "feedback")
+{
+    FollowingErrorSettings settings;
+    settings.servoRate = 100.f;
+    settings.rmsTimeConstant = 0.1f; // Weight 1/10
+    FollowingErrorMonitor monitor(settings);
+    FeedbackSnapshot snapshot;
+    REQUIRE(!monitor.snapshot(snapshot));
+
+    publishError(monitor, 0.2f);
+    REQUIRE(monitor.snapshot(snapshot));
+    REQUIRE(snapshot.samples == 1);
+    REQUIRE(near(snapshot.error[0], 0.2f));
+    REQUIRE(near(snapshot.actualPosition[0], 0.2f));
+    REQUIRE(near(snapshot.rmsError(0), 0.2f)); // The first sample starts the average
+    REQUIRE(snapshot.error[1] == 0.f);
+
+    publishError(monitor, -0.4f);
+    REQUIRE(monitor.snapshot(snapshot));
+    REQUIRE(near(snapshot.meanSquareError[0], 0.04f + 0.1f * (0.16f - 0.04f)));
+    REQUIRE(near(snapshot.peakError[0], 0.4f));
+
+    // Constant errors converge
+    for (int i = 0; i < 200; i++) {
+        publishError(monitor, 0.1f);
+    }
+    REQUIRE(monitor.snapshot(snapshot));
+    REQUIRE(near(snapshot.rmsError(0), 0.1f));
+    REQUIRE(near(snapshot.peakError[0], 0.4f));
+
+    // Reset by the next publish()
+    monitor.resetPeaks();
+    publishError(monitor, 0.05f);
+    REQUIRE(monitor.snapshot(snapshot));
+    REQUIRE(near(snapshot.peakError[0], 0.05f));
+    REQUIRE(snapshot.samples == 203);
+    REQUIRE(snapshot.alarmAxes == 0);
+}
+
+TEST_CASE("following error alarm", "feedback")
+{
+    FollowingErrorMonitor monitor;
+    monitor.settings.maxError[0] = 0.5f;
+    int alarms = 0;
+    AxisBits alarmAxes = 0;
+    struct Alarm {
+        int *count;
+        AxisBits *axes;
+    } alarm = {&alarms, &alarmAxes};
+    monitor.instance = &alarm;
+    monitor.cbAlarm = [](void *instance, AxisBits axes) {
+        Alarm *alarm = static_cast<Alarm *>(instance);
+        (*alarm->count)++;
+        *alarm->axes = axes;
+    };
+
+    publishError(monitor, 0.4f);
+    REQUIRE(alarms == 0);
+    publishError(monitor, -0.6f);
+    REQUIRE(alarms == 1);
+    REQUIRE(alarmAxes == 1);
+
+    // Latched, and reported once
+    publishError(monitor, 0.7f);
+    publishError(monitor, 0.f);
+    REQUIRE(alarms == 1);
+    FeedbackSnapshot snapshot;
+    REQUIRE(monitor.snapshot(snapshot));
+    REQUIRE(snapshot.alarmAxes == 1);
+
+    monitor.clearAlarm();
+    publishError(monitor, 0.f);
+    REQUIRE(monitor.snapshot(snapshot));
+    REQUIRE(snapshot.alarmAxes == 0);
+    publishError(monitor, 0.6f);
+    REQUIRE(alarms == 2);
+}
+
+// A servo thread publishes positions where all axes are equal. A torn copy would mix
+// two ticks, so every snapshot of the main thread must still have equal axes.
+TEST_CASE("consistent snapshots while publishing", "feedback")
+{
+    FollowingErrorMonitor monitor;
+    const uint32_t ticks = 200000;
+    std::thread servo([&monitor, ticks]() {
+        for (uint32_t tick = 1; tick <= ticks; tick++) {
+            float set[GCGP_NUM_AXES];
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                set[i] = static_cast<float>(tick);
+            }
+            monitor.publish(set, set);
+        }
+    });
+
+    uint32_t lastSamples = 0;
+    while (lastSamples < ticks) {
+        FeedbackSnapshot snapshot;
+        if (!monitor.snapshot(snapshot)) {
+            continue;
+        }
+        REQUIRE(snapshot.samples >= lastSamples);
+        REQUIRE(snapshot.setPosition[0] == static_cast<float>(snapshot.samples));
+        for (int i = 1; i < GCGP_NUM_AXES; i++) {
+            REQUIRE(snapshot.setPosition[i] == snapshot.setPosition[0]);
+            REQUIRE(snapshot.actualPosition[i] == snapshot.setPosition[0]);
+        }
+        lastSamples = snapshot.samples;
+    }
+    servo.join();
+}
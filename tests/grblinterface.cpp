@@ -0,0 +1,271 @@
+#include <GCGP/GrblInterface.h>
+#include <algorithm>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+#include "stringserial.h"
+
+static std::string errorLine(GrblError error)
+{
+    return std::string(GCGP_ERROR_MESSAGE) + ErrorEnumToString(error) + "\n";
+}
+
+TEST_CASE("jog commands", "grblinterface")
+{
+    TestMachine machine;
+
+    machine.send("$J=G91 G21 X10 Y-2.5 F500\n");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog"});
+    REQUIRE(machine.tx == "ok\n");
+
+    machine.tx.clear();
+    machine.send("$J=G1 X10 F500\n");
+    machine.grbl.update();
+    REQUIRE(machine.tx == errorLine(GrblError::JogCmdMissingOrHasProhibitedGCode));
+
+    machine.tx.clear();
+    machine.send("$J=X10 M3 F500\n");
+    machine.grbl.update();
+    REQUIRE(machine.tx == errorLine(GrblError::JogCmdMissingOrHasProhibitedGCode));
+
+    machine.tx.clear();
+    machine.send("$J\n");
+    machine.grbl.update();
+    REQUIRE(machine.tx == errorLine(GrblError::JogCmdMissingOrHasProhibitedGCode));
+
+    machine.tx.clear();
+    machine.send("$J=X10\n");
+    machine.grbl.update();
+    REQUIRE(machine.tx == errorLine(GrblError::FeedRateHasNotYetBeenSetOrIsNone));
+
+    machine.tx.clear();
+    machine.send("$J=G90 F500\n");
+    machine.grbl.update();
+    REQUIRE(machine.tx == errorLine(GrblError::NoAxisWordsFoundInCommandBlock));
+    REQUIRE(machine.events.size() == 1);
+}
+
+TEST_CASE("jog state", "grblinterface")
+{
+    TestMachine machine;
+    machine.idle = false;
+    machine.jogging = true;
+
+    // More jog motions may be queued while jogging, but no regular G-Code
+    machine.send("$J=X1 F100\nG1 X1 F100\n");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog"});
+    REQUIRE(machine.tx ==
+            "ok\n" + errorLine(GrblError::GCodeCommandsInvalidInAlarmOrJogState));
+
+    machine.tx.clear();
+    machine.jogging = false;
+    machine.send("$J=X1 F100\n");
+    machine.grbl.update();
+    REQUIRE(machine.tx == errorLine(GrblError::GrblSystemCmdOnlyValidWhenIdle));
+}
+
+TEST_CASE("jog cancel", "grblinterface")
+{
+    TestMachine machine;
+
+    // Within a partially received line, which is completed afterwards
+    machine.send("$J=G91 X1");
+    machine.grbl.update();
+    machine.send("\x85");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog cancel"});
+    machine.send(" F100\n");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog cancel", "jog"});
+
+    // Within a line that is being discarded
+    machine.events.clear();
+    machine.send(std::string(GCGP_MAX_COMMAND_LENGTH + 5, 'X') + "\x85" + "X\n");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog cancel"});
+
+    // As the next byte while the buffer is full
+    machine.events.clear();
+    machine.bufferFull = true;
+    machine.send("\x85$J=X1 F100\n");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog cancel"});
+    machine.bufferFull = false;
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog cancel", "jog"});
+}
+
+TEST_CASE("override commands", "grblinterface")
+{
+    TestMachine machine;
+
+    // Inside a line, which is not affected by them
+    machine.send("G1 X1\x91\x93\x96\x9B\x98 F100\n");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{
+                                  "overrides 110 100 100", "overrides 111 100 100",
+                                  "overrides 111 50 100", "overrides 111 50 90", "command"});
+    REQUIRE(machine.tx == "ok\n");
+
+    // Limits, no callback if nothing changed
+    machine.events.clear();
+    machine.send(std::string(20, '\x91') + "\x90\x90");
+    machine.grbl.update();
+    REQUIRE(machine.grbl.overrides().feed == GCGP_DEFAULT_FEED_OVERRIDE);
+    REQUIRE(machine.events.size() == 10);
+    REQUIRE(machine.events[8] == "overrides 200 50 90");
+
+    machine.events.clear();
+    machine.send(std::string(20, '\x9B') + "\x9E");
+    machine.grbl.update();
+    REQUIRE(machine.grbl.overrides().spindle == GCGP_MIN_SPINDLE_OVERRIDE);
+    REQUIRE(machine.grbl.overrides().spindleStop);
+
+    // Ahead of the queued lines while the buffer is full
+    machine.events.clear();
+    machine.bufferFull = true;
+    machine.send("\x97\xA0\xA1\x84G1 X1 F100\n");
+    for (int i = 0; i < 4; i++) {
+        machine.grbl.update();
+    }
+    REQUIRE(machine.events == std::vector<std::string>{"overrides 100 25 10", "flood",
+                                                       "mist", "safety door"});
+    machine.bufferFull = false;
+    machine.grbl.update();
+    REQUIRE(machine.events.back() == "command");
+}
+
+TEST_CASE("real-time commands anywhere in the stream", "grblinterface")
+{
+    TestMachine machine;
+    machine.bufferFull = true;
+
+    // Behind queued lines and inside a partial line, while the buffer is full
+    machine.send("G1 X1 F100\nG1 X2\nG1 X3!\nG1");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"feed hold"});
+    REQUIRE(machine.tx.empty());
+
+    machine.send("\x85 X4\n");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"feed hold", "jog cancel"});
+
+    // The lines are complete and in order once there is room again
+    machine.bufferFull = false;
+    machine.grbl.update();
+    REQUIRE(machine.events ==
+            std::vector<std::string>{"feed hold", "jog cancel", "command", "command",
+                                     "command", "command"});
+    REQUIRE(machine.tx == "ok\nok\nok\nok\n");
+
+    // Once the RX buffer is full, further bytes stay in the serial port until there
+    // is room again
+    machine.tx.clear();
+    machine.events.clear();
+    machine.bufferFull = true;
+    std::string line = "G1 X1\n";
+    for (size_t i = 0; i < GCGP_RX_BUFFER_SIZE / line.size() + 1; i++) {
+        machine.send(line);
+    }
+    machine.send("!");
+    machine.grbl.update();
+    REQUIRE(machine.events.empty());
+    machine.bufferFull = false;
+    machine.grbl.update();
+    machine.grbl.update();
+    REQUIRE(std::count(machine.events.begin(), machine.events.end(), "feed hold") == 1);
+}
+
+TEST_CASE("real-time commands behind a full RX buffer", "grblinterface")
+{
+    TestMachine machine;
+    machine.bufferFull = true;
+
+    // As much as a host counting characters may send before its first answer
+    std::string lines;
+    while (lines.size() < GCGP_RX_BUFFER_SIZE) {
+        lines += "G1 X1 F100\n";
+    }
+    lines.resize(GCGP_RX_BUFFER_SIZE);
+    machine.send(lines);
+    machine.grbl.update();
+    REQUIRE(machine.rxIndex == GCGP_RX_BUFFER_SIZE);
+
+    machine.send("\x85!");
+    machine.grbl.update();
+    REQUIRE(machine.events == std::vector<std::string>{"jog cancel", "feed hold"});
+    REQUIRE(machine.rxIndex == machine.rx.size());
+    REQUIRE(machine.tx.empty());
+}
+
+TEST_CASE("feed rate not set", "grblinterface")
+{
+    TestMachine machine;
+    machine.grbl.cbGetFeedrate = [](void *) { return NAN; };
+    machine.send("G1 X1\n");
+    machine.grbl.update();
+    REQUIRE(machine.tx == errorLine(GrblError::FeedRateHasNotYetBeenSetOrIsNone));
+    REQUIRE(machine.events.empty());
+}
+
+TEST_CASE("status report", "grblinterface")
+{
+    TestMachine machine;
+    machine.send("?");
+    machine.grbl.update();
+    REQUIRE(machine.tx == "<Idle|FS:0.000,0>\n");
+
+    FollowingErrorMonitor monitor;
+    float set[GCGP_NUM_AXES] = {1.f, -2.5f};
+    float actual[GCGP_NUM_AXES] = {1.0004f, -2.4996f};
+    monitor.publish(set, actual);
+    machine.grbl.cbGetFeedback = [](void *, FeedbackSnapshot *) {
+        return false; // Nothing published yet
+    };
+    machine.tx.clear();
+    machine.idle = false;
+    machine.send("?");
+    machine.grbl.update();
+    REQUIRE(machine.tx == "<Run|FS:0.000,0>\n");
+
+    static FollowingErrorMonitor *published = &monitor;
+    machine.grbl.cbGetFeedback = [](void *, FeedbackSnapshot *snapshot) {
+        return published->snapshot(*snapshot);
+    };
+    machine.grbl.cbGetFeedrate = [](void *) { return 500.f; };
+    machine.tx.clear();
+    machine.send("?");
+    machine.grbl.update();
+    REQUIRE(machine.tx == "<Run|MPos:1.000,-2.500,0.000|APos:1.000,-2.500,0.000"
+                         "|FS:500.000,0>\n");
+
+    // A following error alarm is reported even before the machine reacts to it
+    actual[1] = 0.f;
+    monitor.publish(set, actual);
+    machine.tx.clear();
+    machine.send("?");
+    machine.grbl.update();
+    REQUIRE(machine.tx == "<Alarm|MPos:1.000,-2.500,0.000|APos:1.000,0.000,0.000"
+                         "|FS:500.000,0>\n");
+}
+
+TEST_CASE("status report with values out of range", "grblinterface")
+{
+    TestMachine machine;
+    FollowingErrorMonitor monitor;
+    float values[GCGP_NUM_AXES] = {3e9f, NAN, -1e7f};
+    monitor.publish(values, values);
+    static FollowingErrorMonitor *published = &monitor;
+    machine.grbl.cbGetFeedback = [](void *, FeedbackSnapshot *snapshot) {
+        return published->snapshot(*snapshot);
+    };
+    machine.grbl.cbGetFeedrate = [](void *) { return 1e12f; };
+    machine.idle = false;
+    machine.send("?");
+    machine.grbl.update();
+    REQUIRE(machine.tx == "<Run|MPos:1000000.000,nan,-1000000.000"
+                         "|APos:1000000.000,nan,-1000000.000|FS:1000000.000,0>\n");
+}
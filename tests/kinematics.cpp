@@ -0,0 +1,130 @@
+#include <GCGP/Kinematics.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <math.h>
+#include <vector>
+
+#include "testutils.h"
+
+// Points on a grid of the build volume, some of them outside of the reach of a delta
+static std::vector<float> testPoints(int axis, size_t count)
+{
+    std::vector<float> points;
+    for (size_t j = 0; j < count; j++) {
+        float grid = static_cast<float>((j * (3 + axis * 4) + axis) % 17) - 8.f;
+        points.push_back(axis == 2 ? grid * 2.f + 20.f : grid * 17.f);
+    }
+    return points;
+}
+
+// Compares the batch with the scalar path, with the joints in place
+static void checkBatch(const Kinematics &kinematics, size_t count)
+{
+    std::vector<float> axes[GCGP_NUM_AXES];
+    std::vector<float> copies[GCGP_NUM_AXES];
+    float *joints[GCGP_NUM_AXES];
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        axes[i] = testPoints(i, count);
+        copies[i] = axes[i];
+        joints[i] = axes[i].data();
+    }
+    std::vector<AxisBits> unreachable(count, 0xFF);
+    size_t failed = kinematics.inverseBatch(joints, joints, unreachable.data(), count);
+
+    size_t expected = 0;
+    for (size_t j = 0; j < count; j++) {
+        float point[GCGP_NUM_AXES];
+        float result[GCGP_NUM_AXES];
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            point[i] = copies[i][j];
+        }
+        bool reachable = kinematics.inverse(point, result);
+        REQUIRE(reachable == (unreachable[j] == 0));
+        expected += !reachable;
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            float tolerance = 1e-4f * fmaxf(1.f, fabsf(result[i]));
+            REQUIRE(near(joints[i][j], result[i], tolerance));
+        }
+    }
+    REQUIRE(failed == expected);
+}
+
+TEST_CASE("without callbacks the joints are the axes", "kinematics")
+{
+    Kinematics kinematics;
+    const float point[GCGP_NUM_AXES] = { 1.f, -2.f, 3.f };
+    float joints[GCGP_NUM_AXES];
+    REQUIRE(kinematics.inverse(point, joints));
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(joints[i] == point[i]);
+    }
+    checkBatch(kinematics, 10);
+
+    CartesianKinematics cartesian;
+    checkBatch(cartesian.kinematics(), 10);
+}
+
+TEST_CASE("corexy", "kinematics")
+{
+    CoreXYKinematics coreXY;
+    Kinematics kinematics = coreXY.kinematics();
+    const float point[GCGP_NUM_AXES] = { 10.f, 4.f, -1.f };
+    float joints[GCGP_NUM_AXES];
+    float back[GCGP_NUM_AXES];
+    REQUIRE(kinematics.inverse(point, joints));
+    REQUIRE(joints[0] == 14.f);
+    REQUIRE(joints[1] == 6.f);
+    REQUIRE(joints[2] == -1.f);
+    REQUIRE(kinematics.forward(joints, back));
+    for (int i = 0; i < 3; i++) {
+        REQUIRE(back[i] == point[i]);
+    }
+
+    for (size_t count : { 3, 4, 101 }) {
+        checkBatch(kinematics, count);
+    }
+}
+
+TEST_CASE("linear delta", "kinematics")
+{
+    LinearDeltaKinematics delta(250.f, 120.f);
+    Kinematics kinematics = delta.kinematics();
+
+    // In the centre, all carriages are at the same height
+    const float center[GCGP_NUM_AXES] = { 0.f, 0.f, 0.f };
+    float joints[GCGP_NUM_AXES];
+    REQUIRE(kinematics.inverse(center, joints));
+    float height = sqrtf(250.f * 250.f - 120.f * 120.f);
+    for (int tower = 0; tower < 3; tower++) {
+        REQUIRE(near(joints[tower], height, 1e-3));
+    }
+
+    // Towards the third tower at 90 degrees, its carriage rises the most
+    const float front[GCGP_NUM_AXES] = { 0.f, 50.f, 10.f };
+    REQUIRE(kinematics.inverse(front, joints));
+    REQUIRE(near(joints[0], joints[1], 1e-3));
+    REQUIRE(joints[2] > joints[0]);
+
+    // The forward kinematics return to the point
+    for (size_t j = 0; j < 200; j++) {
+        float point[GCGP_NUM_AXES];
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            point[i] = testPoints(i, j + 1).back();
+        }
+        float back[GCGP_NUM_AXES];
+        if (kinematics.inverse(point, joints)) {
+            REQUIRE(kinematics.forward(joints, back));
+            for (int i = 0; i < 3; i++) {
+                REQUIRE(near(back[i], point[i], 1e-2f));
+            }
+        }
+    }
+
+    // Further than a rod from a tower
+    const float outside[GCGP_NUM_AXES] = { 0.f, -200.f, 0.f };
+    REQUIRE_FALSE(kinematics.inverse(outside, joints));
+
+    for (size_t count : { 0, 5, 1000 }) {
+        checkBatch(kinematics, count);
+    }
+}
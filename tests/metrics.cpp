@@ -0,0 +1,165 @@
+#include <GCGP/GrblInterface.h>
+#include <GCGP/Metrics.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "stringserial.h"
+
+// Built with GCGP_ENABLE_METRICS, see CMakeLists.txt
+static_assert(GCGP_ENABLE_METRICS, "The metrics test needs the metrics");
+
+// The error of a line that passes the tokenizer, whichever code it is
+static GrblError unsupportedError()
+{
+    Command<10> command;
+    return command.parse("G81", 3);
+}
+
+static MetricsSnapshot snapshot(const TestMachine &machine)
+{
+    MetricsSnapshot metrics;
+    machine.grbl.metrics().snapshot(metrics);
+    return metrics;
+}
+
+TEST_CASE("histogram buckets double", "metrics")
+{
+    MetricsHistogram histogram;
+    histogram.add(0);
+    histogram.add(1);
+    histogram.add(3);
+    histogram.add(4);
+    histogram.add(UINT32_MAX);
+
+    REQUIRE(histogram.buckets[0] == 1);
+    REQUIRE(histogram.buckets[1] == 1);
+    REQUIRE(histogram.buckets[2] == 1);
+    REQUIRE(histogram.buckets[3] == 1);
+    REQUIRE(histogram.buckets[GCGP_METRICS_HISTOGRAM_BUCKETS - 1] == 1);
+    REQUIRE(histogram.count == 5);
+    REQUIRE(histogram.max == UINT32_MAX);
+    REQUIRE(histogram.sum == 8ull + UINT32_MAX);
+
+    REQUIRE(MetricsHistogram::bucketEnd(0) == 1);
+    REQUIRE(MetricsHistogram::bucketEnd(3) == 8);
+    REQUIRE(MetricsHistogram::bucketEnd(GCGP_METRICS_HISTOGRAM_BUCKETS - 1) ==
+            UINT32_MAX);
+}
+
+TEST_CASE("error codes beyond the table are counted together", "metrics")
+{
+    Metrics metrics;
+    for (int code = 1; code <= GCGP_METRICS_ERROR_CODES + 2; code++) {
+        metrics.addError(static_cast<GrblError>(code), false, 0);
+    }
+    metrics.addError(GrblError::GCodeCommandLetterNotFound, true, 10);
+    metrics.addError(GrblError::None, false, 0);
+
+    MetricsSnapshot snapshot;
+    metrics.snapshot(snapshot);
+    REQUIRE(snapshot.errors == GCGP_METRICS_ERROR_CODES + 4);
+    REQUIRE(snapshot.errorCount(GrblError::GCodeCommandLetterNotFound) == 2);
+    REQUIRE(snapshot.otherErrors == 3);
+    REQUIRE(snapshot.lineLatency.count == 1);
+
+    metrics.clear();
+    metrics.snapshot(snapshot);
+    REQUIRE(snapshot.errors == 0);
+    REQUIRE(snapshot.errorCount(GrblError::GCodeCommandLetterNotFound) == 0);
+}
+
+TEST_CASE("lines, answers and bytes are counted", "metrics")
+{
+    TestMachine machine;
+    machine.send("G0 X1\n\nG81\n?G1 X2 F100\r\n");
+    machine.grbl.update();
+
+    MetricsSnapshot metrics = snapshot(machine);
+    REQUIRE(metrics.bytesReceived == 24);
+    REQUIRE(metrics.realtimeCommands == 1);
+    REQUIRE(metrics.linesParsed == 3);
+    REQUIRE(metrics.ok == 2);
+    REQUIRE(metrics.errors == 1);
+    REQUIRE(metrics.errorCount(unsupportedError()) == 1);
+    REQUIRE(metrics.lineLatency.count == 3); // Not the empty line
+    REQUIRE(metrics.parseTime.count == 3);
+    REQUIRE(metrics.bufferFullTime.count == 0);
+}
+
+TEST_CASE("extended real-time commands are counted", "metrics")
+{
+    TestMachine machine;
+    machine.send("\x85G0 \x91X1\n");
+    machine.grbl.update();
+
+    MetricsSnapshot metrics = snapshot(machine);
+    REQUIRE(metrics.bytesReceived == 8);
+    REQUIRE(metrics.realtimeCommands == 2);
+    REQUIRE(metrics.ok == 1);
+}
+
+TEST_CASE("unknown characters are errors without a code", "metrics")
+{
+    TestMachine machine;
+    machine.send("G0 \x01X1\nG0 X2\n");
+    machine.grbl.update();
+
+    MetricsSnapshot metrics = snapshot(machine);
+    REQUIRE(metrics.errors == 1);
+    REQUIRE(metrics.otherErrors == 1);
+    REQUIRE(metrics.ok == 1);
+    REQUIRE(metrics.lineLatency.count == 2);
+}
+
+TEST_CASE("a line gets one answer, so ok and errors add up to the lines", "metrics")
+{
+    TestMachine machine;
+    machine.grbl.cbGetFeedrate = [](void *) { return NAN; };
+    machine.send("G1 X1\nG1 X2 F100\n");
+    machine.grbl.update();
+
+    MetricsSnapshot metrics = snapshot(machine);
+    REQUIRE(metrics.linesParsed == 2);
+    REQUIRE(metrics.errorCount(GrblError::FeedRateHasNotYetBeenSetOrIsNone) == 1);
+    REQUIRE(metrics.ok == 1);
+    REQUIRE(metrics.ok + metrics.errors == metrics.linesParsed);
+}
+
+TEST_CASE("a full buffer is timed until it has space again", "metrics")
+{
+    TestMachine machine;
+    machine.bufferFull = true;
+    machine.send("G0 X1\n");
+    machine.grbl.update();
+    machine.grbl.update();
+    REQUIRE(snapshot(machine).bufferFullTime.count == 0);
+    REQUIRE(snapshot(machine).linesParsed == 0);
+
+    machine.bufferFull = false;
+    machine.grbl.update();
+    MetricsSnapshot metrics = snapshot(machine);
+    REQUIRE(metrics.bufferFullTime.count == 1);
+    REQUIRE(metrics.linesParsed == 1);
+    REQUIRE(metrics.lineLatency.max >= metrics.bufferFullTime.max);
+}
+
+TEST_CASE("$M reports the metrics", "metrics")
+{
+    TestMachine machine;
+    machine.send("G0 X1\nG81\n");
+    machine.grbl.update();
+    machine.tx.clear();
+    machine.send("$M\n");
+    machine.grbl.update();
+
+    // The report is sent before its own answer is counted
+    std::string code = std::to_string(static_cast<int>(unsupportedError()));
+    std::string head = "[MET:RX:13,RT:0,LN:3,OK:1,ERR:1]\n"
+                       "[MET:ERR:" + code + "=1,OTHER=0]\n"
+                       "[MET:LAT:2,";
+    REQUIRE(machine.tx.compare(0, head.size(), head) == 0);
+    REQUIRE(machine.tx.find("\n[MET:PARSE:3,") != std::string::npos);
+    REQUIRE(machine.tx.find("\n[MET:FULL:0,0,0|0]\n") != std::string::npos);
+    REQUIRE(machine.tx.substr(machine.tx.size() - 3) == "ok\n");
+    REQUIRE(snapshot(machine).ok == 2);
+}
@@ -0,0 +1,145 @@
+#include <GCGP/Move.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "testutils.h"
+
+// Resolves the command from the machine position and moves there if it moves
+static GrblError run(ModalState &state, float position[GCGP_NUM_AXES], const char *str)
+{
+    Move move;
+    GrblError error = state.resolve(parse(str), position, move);
+    if (error == GrblError::None && move.type != MotionType::None) {
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            position[i] = move.target[i];
+        }
+    }
+    return error;
+}
+
+TEST_CASE("work coordinate systems", "modalstate")
+{
+    ModalState state;
+    float position[GCGP_NUM_AXES] = {};
+
+    REQUIRE(run(state, position, "G10 L2 P1 X10 Y20") == GrblError::None);
+    REQUIRE(run(state, position, "G10 L2 P2 X-5 Z1") == GrblError::None);
+    REQUIRE(state.workCoordinateSystem() == 0);
+    REQUIRE(run(state, position, "G0 X1 Y2 Z3") == GrblError::None);
+    REQUIRE(near(position[0], 11.f));
+    REQUIRE(near(position[1], 22.f));
+    REQUIRE(near(position[2], 3.f));
+
+    REQUIRE(run(state, position, "G55 G0 X1 Y2 Z3") == GrblError::None);
+    REQUIRE(state.workCoordinateSystem() == 1);
+    REQUIRE(near(position[0], -4.f));
+    REQUIRE(near(position[1], 2.f));
+    REQUIRE(near(position[2], 4.f));
+
+    // P0 is the selected system
+    REQUIRE(run(state, position, "G10 L2 P0 Y100") == GrblError::None);
+    REQUIRE(near(state.workOffset(1)[1], 100.f));
+    REQUIRE(near(state.offset()[1], 100.f));
+
+    // G53 ignores all offsets, and is always absolute
+    REQUIRE(run(state, position, "G91 G53 G0 X1 Y1") == GrblError::None);
+    REQUIRE(near(position[0], 1.f));
+    REQUIRE(near(position[1], 1.f));
+    REQUIRE(run(state, position, "G0 X1") == GrblError::None);
+    REQUIRE(near(position[0], 2.f));
+
+    // Only GCGP_NUM_WORK_COORDINATE_SYSTEMS systems exist
+    REQUIRE(run(state, position, "G59") == GrblError::None);
+    REQUIRE(run(state, position, "G59.1") == GrblError::G59xWCSAreNotSupported);
+    REQUIRE(run(state, position, "G10 L2 P7 X0") == GrblError::G59xWCSAreNotSupported);
+    REQUIRE(run(state, position, "G10 L1 P1 Z0") == GrblError::FeatureNotYetImplemented);
+}
+
+TEST_CASE("offsets from the current position", "modalstate")
+{
+    ModalState state;
+    float position[GCGP_NUM_AXES] = { 10.f, 20.f, 30.f };
+
+    // The current position becomes X0 Y1
+    REQUIRE(run(state, position, "G10 L20 P1 X0 Y1") == GrblError::None);
+    REQUIRE(near(state.workOffset(0)[0], 10.f));
+    REQUIRE(near(state.workOffset(0)[1], 19.f));
+    REQUIRE(near(state.workOffset(0)[2], 0.f));
+
+    // The current position becomes Z5, on top of the work offset
+    REQUIRE(run(state, position, "G92 Z5") == GrblError::None);
+    REQUIRE(near(state.axisOffset()[2], 25.f));
+    REQUIRE(run(state, position, "G92 X2") == GrblError::None);
+    REQUIRE(near(state.axisOffset()[0], -2.f));
+    float program[GCGP_NUM_AXES];
+    state.toProgramCoordinates(position, program);
+    REQUIRE(near(program[0], 2.f));
+    REQUIRE(near(program[1], 1.f));
+    REQUIRE(near(program[2], 5.f));
+
+    REQUIRE(run(state, position, "G0 X0 Z0") == GrblError::None);
+    REQUIRE(near(position[0], 8.f));
+    REQUIRE(near(position[2], 25.f));
+
+    REQUIRE(run(state, position, "G92.1") == GrblError::None);
+    REQUIRE(near(state.offset()[0], 10.f));
+    REQUIRE(near(state.offset()[2], 0.f));
+}
+
+TEST_CASE("tool length offset", "modalstate")
+{
+    ModalState state;
+    float position[GCGP_NUM_AXES] = {};
+
+    REQUIRE(run(state, position, "G43.1 Z-2.5") == GrblError::None);
+    REQUIRE(near(state.toolLengthOffset(), -2.5f));
+    REQUIRE(run(state, position, "G1 Z1 F100") == GrblError::None);
+    REQUIRE(near(position[2], -1.5f));
+
+    // Inches, also for the offsets
+    REQUIRE(run(state, position, "G20 G43.1 Z1") == GrblError::None);
+    REQUIRE(near(state.toolLengthOffset(), 25.4f));
+    REQUIRE(run(state, position, "G10 L2 P1 X1") == GrblError::None);
+    REQUIRE(near(state.offset()[0], 25.4f));
+    REQUIRE(run(state, position, "G1 X1 Z0") == GrblError::None);
+    REQUIRE(near(position[0], 50.8f));
+    REQUIRE(near(position[2], 25.4f));
+
+    REQUIRE(run(state, position, "G49") == GrblError::None);
+    REQUIRE(near(state.offset()[2], 0.f));
+
+    Command<10> command;
+    const char *str = "G43.1 X1";
+    REQUIRE(command.parse(str, strlen(str)) ==
+            GrblError::G431OffsetNotAssignedToToolLengthAxis);
+}
+
+TEST_CASE("a block with an error changes nothing", "modalstate")
+{
+    ModalState state;
+    float position[GCGP_NUM_AXES] = {};
+
+    // The arc has no radius, after its units, plane, feed and motion mode were read
+    REQUIRE(run(state, position, "G20 G18 G91 G2 X10 Y0 I0 J0 F10") != GrblError::None);
+    REQUIRE(state.lengthUnits == LengthUnits::Metric);
+    REQUIRE(state.arcPlaneMode == ArcPlaneMode::XY);
+    REQUIRE(state.distanceMode == DistanceMode::Absolute);
+    REQUIRE(state.motionType == MotionType::Rapid);
+    REQUIRE(isnan(state.feedrate));
+
+    REQUIRE(run(state, position, "G55 G10 L2 P7 X5") == GrblError::G59xWCSAreNotSupported);
+    REQUIRE(state.workCoordinateSystem() == 0);
+
+    REQUIRE(run(state, position, "G0 X1") == GrblError::None);
+    REQUIRE(near(position[0], 1.f));
+}
+
+TEST_CASE("axis words need a command that uses them", "modalstate")
+{
+    Command<10> command;
+    for (const char *str : { "G92", "G43.1" }) {
+        REQUIRE(command.parse(str, strlen(str)) ==
+                GrblError::NoAxisWordsFoundInCommandBlock);
+    }
+    const char *str = "G21 X1";
+    REQUIRE(command.parse(str, strlen(str)) == GrblError::UnneededAxisWordsFoundInBlock);
+}
@@ -0,0 +1,362 @@
+#include <GCGP/GrblInterface.h>
+#include <GCGP/Planner.h>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "testutils.h"
+
+static PlannerSettings testSettings()
+{
+    PlannerSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.maxRate[i] = 6000.f;
+        settings.acceleration[i] = 100.f;
+    }
+    settings.junctionDeviation = 0.01f;
+    return settings;
+}
+
+TEST_CASE("single move trapezoid", "planner")
+{
+    Planner planner(testSettings());
+    float target[GCGP_NUM_AXES] = { 100.f };
+    REQUIRE(planner.addLinearMove(target, 600.f, false));
+    REQUIRE(planner.size() == 1);
+
+    const PlannerBlock &block = planner.block(0);
+    REQUIRE(nearRelative(block.millimeters, 100.f));
+    REQUIRE(nearRelative(block.nominalSpeedSqr, 100.f)); // 10 mm/s
+    REQUIRE(block.entrySpeedSqr == 0.f);
+    REQUIRE(block.exitSpeedSqr == 0.f);
+    REQUIRE(nearRelative(block.peakSpeedSqr, 100.f));
+    REQUIRE(nearRelative(block.accelerateUntil, 0.5f)); // v^2 / 2a
+    REQUIRE(nearRelative(block.decelerateAfter, 99.5f));
+
+    // Too short to reach the feedrate
+    target[0] = 100.2f;
+    planner.discardCurrentBlock();
+    REQUIRE(planner.addLinearMove(target, 600.f, false));
+    REQUIRE(nearRelative(planner.block(0).peakSpeedSqr, 20.f));
+    REQUIRE(nearRelative(planner.block(0).accelerateUntil, 0.1f));
+}
+
+TEST_CASE("junction speeds", "planner")
+{
+    Planner planner(testSettings());
+    float target[GCGP_NUM_AXES] = {};
+
+    // Straight segments run through at the nominal speed
+    for (int i = 1; i <= 5; i++) {
+        target[0] = i * 10.f;
+        REQUIRE(planner.addLinearMove(target, 600.f, false));
+    }
+    for (size_t i = 1; i < planner.size(); i++) {
+        REQUIRE(nearRelative(planner.block(i).entrySpeedSqr, 100.f));
+    }
+    REQUIRE(planner.block(planner.size() - 1).exitSpeedSqr == 0.f);
+
+    // 90 degree corner: a * d * sin(45deg) / (1 - sin(45deg))
+    target[1] = 10.f;
+    REQUIRE(planner.addLinearMove(target, 6000.f, false));
+    float acceleration = 100.f * sqrtf(2.f); // Along the diagonal junction vector
+    float sinThetaHalf = sqrtf(0.5f);
+    float expected = acceleration * 0.01f * sinThetaHalf / (1.f - sinThetaHalf);
+    REQUIRE(nearRelative(planner.block(5).maxEntrySpeedSqr, expected));
+
+    // Reversal stops
+    target[1] = 0.f;
+    REQUIRE(planner.addLinearMove(target, 6000.f, false));
+    REQUIRE(planner.block(6).maxEntrySpeedSqr == 0.f);
+    REQUIRE(planner.block(5).exitSpeedSqr == 0.f);
+}
+
+// Plans all blocks from scratch with full backward and forward passes
+static std::vector<float> referenceEntrySpeeds(const Planner &planner)
+{
+    size_t count = planner.size();
+    std::vector<float> entry(count);
+    for (size_t i = count; i-- > 0;) {
+        const PlannerBlock &block = planner.block(i);
+        float exit = i + 1 < count ? entry[i + 1] : 0.f;
+        entry[i] = fminf(block.maxEntrySpeedSqr,
+                         exit + 2.f * block.acceleration * block.millimeters);
+    }
+    for (size_t i = 0; i + 1 < count; i++) {
+        const PlannerBlock &block = planner.block(i);
+        entry[i + 1] =
+            fminf(entry[i + 1], entry[i] + 2.f * block.acceleration * block.millimeters);
+    }
+    return entry;
+}
+
+TEST_CASE("incremental planning matches full replanning", "planner")
+{
+    Planner planner(testSettings());
+    srand(42);
+    float target[GCGP_NUM_AXES] = {};
+    for (int move = 0; move < 1000; move++) {
+        if (planner.isFull()) {
+            // Only compared before anything is executed, which fixes speeds
+            std::vector<float> expected = referenceEntrySpeeds(planner);
+            for (size_t i = 0; i < planner.size(); i++) {
+                REQUIRE(nearRelative(planner.block(i).entrySpeedSqr, expected[i]));
+                float exit = i + 1 < planner.size() ? expected[i + 1] : 0.f;
+                REQUIRE(nearRelative(planner.block(i).exitSpeedSqr, exit));
+            }
+            planner.clear();
+        }
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            target[i] += (rand() % 2001 - 1000) / 1000.f * (i == 0 ? 5.f : 1.f);
+        }
+        REQUIRE(planner.addLinearMove(target, 100.f + rand() % 3000, false));
+    }
+}
+
+TEST_CASE("executed block keeps its exit speed", "planner")
+{
+    Planner planner(testSettings());
+    float target[GCGP_NUM_AXES] = {};
+    target[0] = 10.f;
+    REQUIRE(planner.addLinearMove(target, 600.f, false));
+    const PlannerBlock *block = planner.currentBlock();
+    REQUIRE(block != nullptr);
+    REQUIRE(block->exitSpeedSqr == 0.f);
+
+    target[0] = 20.f;
+    REQUIRE(planner.addLinearMove(target, 600.f, false));
+    REQUIRE(block->exitSpeedSqr == 0.f);
+    REQUIRE(planner.block(1).entrySpeedSqr == 0.f);
+
+    planner.discardCurrentBlock();
+    block = planner.currentBlock();
+    target[0] = 30.f;
+    REQUIRE(planner.addLinearMove(target, 600.f, false));
+    REQUIRE(block->exitSpeedSqr == 0.f);
+
+    planner.discardCurrentBlock();
+    REQUIRE(planner.size() == 1);
+    target[0] = 40.f;
+    REQUIRE(planner.addLinearMove(target, 600.f, false));
+    REQUIRE(nearRelative(planner.block(0).exitSpeedSqr, 100.f));
+}
+
+TEST_CASE("modal state of commands", "planner")
+{
+    Planner planner(testSettings());
+    REQUIRE(planner.addCommand(parse("G1 X10")) ==
+            GrblError::FeedRateHasNotYetBeenSetOrIsNone);
+    REQUIRE(planner.addCommand(parse("G0 X10")) == GrblError::None);
+    REQUIRE(nearRelative(planner.block(0).nominalSpeedSqr, 10000.f)); // Max rate
+    REQUIRE(planner.block(0).rapid);
+
+    REQUIRE(planner.addCommand(parse("F600")) == GrblError::None);
+    REQUIRE(planner.size() == 1);
+    REQUIRE(planner.addCommand(parse("G1 Y10")) == GrblError::None);
+    REQUIRE(!planner.block(1).rapid);
+    REQUIRE(nearRelative(planner.block(1).nominalSpeedSqr, 100.f));
+
+    REQUIRE(planner.addCommand(parse("G20 G91 G1 X1 F10")) == GrblError::None);
+    REQUIRE(nearRelative(planner.position()[0], 35.4f));
+    REQUIRE(nearRelative(planner.position()[1], 10.f));
+    REQUIRE(nearRelative(planner.block(2).nominalSpeedSqr, (254.f / 60.f) * (254.f / 60.f)));
+
+    REQUIRE(planner.addCommand(parse("G21 G90 G93 G1 X45.4 F6")) == GrblError::None);
+    REQUIRE(nearRelative(planner.block(3).nominalSpeedSqr, 1.f)); // 10 mm in 1/6 min
+    REQUIRE(planner.addCommand(parse("G1 X0")) ==
+            GrblError::FeedRateHasNotYetBeenSetOrIsNone);
+
+    Command<10> home = parse("G28"); // Its axis words are an intermediate point
+    home.pos[0] = 0.f;
+    REQUIRE(planner.addCommand(home) == GrblError::None);
+    REQUIRE(planner.size() == 4);
+}
+
+TEST_CASE("arcs are queued as segments", "planner")
+{
+    Planner planner(testSettings());
+    REQUIRE(planner.addCommand(parse("G2 X20 Y0 I10 F600")) == GrblError::None);
+
+    // A half circle with a radius of 10 mm needs 79 chords of 0.04 rad for 0.002 mm
+    REQUIRE(planner.isFull());
+    REQUIRE(planner.addCommand(parse("G1 X0")) == GrblError::PlannerBufferFull);
+    size_t segments = 0;
+    float maxY = 0.f;
+    while (!planner.isEmpty()) {
+        const PlannerBlock *block = planner.currentBlock();
+        maxY = fmaxf(maxY, block->target[1]);
+        REQUIRE(block->nominalSpeedSqr <= 100.f * 1.0001f);
+        planner.discardCurrentBlock();
+        segments++;
+    }
+    REQUIRE(segments == 79);
+    REQUIRE(nearRelative(maxY, 10.f));
+    REQUIRE(planner.position()[0] == 20.f);
+    REQUIRE(planner.position()[1] == 0.f);
+    REQUIRE(!planner.isFull());
+}
+
+// Distance of the point from the segment from a to b
+static float segmentDistance(const float point[GCGP_NUM_AXES],
+                             const float a[GCGP_NUM_AXES], const float b[GCGP_NUM_AXES])
+{
+    float dot = 0.f;
+    float lengthSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        dot += (point[i] - a[i]) * (b[i] - a[i]);
+        lengthSqr += (b[i] - a[i]) * (b[i] - a[i]);
+    }
+    float t = lengthSqr > 0.f ? fminf(fmaxf(dot / lengthSqr, 0.f), 1.f) : 0.f;
+    float distanceSqr = 0.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        float delta = point[i] - (a[i] + t * (b[i] - a[i]));
+        distanceSqr += delta * delta;
+    }
+    return sqrtf(distanceSqr);
+}
+
+TEST_CASE("path control modes", "planner")
+{
+    Command<10> command;
+    const char *blend = "G64 P0.02";
+    REQUIRE(command.parse(blend, strlen(blend)) == GrblError::None);
+    REQUIRE(command.pathControlMode == PathControlMode::Blending);
+    REQUIRE(nearRelative(command.pathTolerance, 0.02f));
+    REQUIRE(command.parse("P0.02", 5) == GrblError::GCodeLonelyParameter);
+    REQUIRE(command.parse("G61.1", 5) == GrblError::None);
+    REQUIRE(command.pathControlMode == PathControlMode::ExactStop);
+
+    Planner planner(testSettings());
+    REQUIRE(planner.addCommand(parse("G61.1")) == GrblError::None);
+    REQUIRE(planner.addCommand(parse("G1 X10 F600")) == GrblError::None);
+    REQUIRE(planner.addCommand(parse("G1 X20")) == GrblError::None);
+    REQUIRE(planner.block(1).maxEntrySpeedSqr == 0.f);
+
+    REQUIRE(planner.addCommand(parse("G20 G64 P0.001")) == GrblError::None);
+    REQUIRE(nearRelative(planner.modalState.pathTolerance, 0.0254f));
+    REQUIRE(planner.addCommand(parse("G21 G64")) == GrblError::None);
+    REQUIRE(planner.modalState.pathTolerance == 0.f);
+}
+
+TEST_CASE("corners are blended within the tolerance", "planner")
+{
+    // Short moves over a curved surface, like CAM programs for 3D finishing
+    const float tolerance = 0.01f;
+    std::vector<std::vector<float>> path = { { 0.f, 0.f, 0.f } };
+    for (int i = 1; i <= 40; i++) {
+        path.push_back({ i * 0.5f, 0.f, 2.f * sinf(i * 0.5f) });
+    }
+
+    auto run = [&](bool blending, float &cycleTime) {
+        Planner planner(testSettings());
+        if (blending) {
+            REQUIRE(planner.addCommand(parse("G64 P0.01")) == GrblError::None);
+        }
+        cycleTime = 0.f;
+        float previous[GCGP_NUM_AXES] = {};
+        size_t next = 1;
+        size_t blocks = 0;
+        while (next < path.size() || !planner.isEmpty()) {
+            if (next < path.size() && !planner.isFull()) {
+                REQUIRE(planner.addLinearMove(path[next++].data(), 1200.f, false));
+                continue;
+            }
+            const PlannerBlock *block = planner.currentBlock();
+            REQUIRE(block != nullptr);
+
+            // The ends and middles of all blocks stay close to the programmed path
+            float middle[GCGP_NUM_AXES];
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                middle[i] = 0.5f * (previous[i] + block->target[i]);
+            }
+            const float *points[] = { block->target, middle };
+            for (const float *point : points) {
+                float distance = INFINITY;
+                for (size_t i = 1; i < path.size(); i++) {
+                    distance = fminf(distance, segmentDistance(point, path[i - 1].data(),
+                                                               path[i].data()));
+                }
+                REQUIRE(distance <= tolerance * 1.001f);
+            }
+
+            float entry = sqrtf(block->entrySpeedSqr);
+            float peak = sqrtf(block->peakSpeedSqr);
+            float exit = sqrtf(block->exitSpeedSqr);
+            cycleTime += (peak - entry) / block->acceleration +
+                         (block->decelerateAfter - block->accelerateUntil) / peak +
+                         (peak - exit) / block->acceleration;
+            std::copy(block->target, block->target + GCGP_NUM_AXES, previous);
+            planner.discardCurrentBlock();
+            blocks++;
+        }
+        REQUIRE(nearRelative(previous[0], 20.f));
+        REQUIRE(nearRelative(previous[2], 2.f * sinf(20.f)));
+        return blocks;
+    };
+
+    float exactTime, blendedTime;
+    REQUIRE(run(false, exactTime) == 40);
+    REQUIRE(run(true, blendedTime) > 40);
+    REQUIRE(blendedTime < 0.85f * exactTime);
+}
+
+TEST_CASE("fill level drives cbBufferIsFull", "planner")
+{
+    struct Machine {
+        Planner planner = Planner(testSettings());
+        std::string rx;
+        size_t rxIndex = 0;
+        std::vector<GrblError> errors;
+    } machine;
+
+    SerialInterface serial(
+        &machine,
+        [](void *instance) {
+            Machine *machine = static_cast<Machine *>(instance);
+            return static_cast<int>(machine->rx.size() - machine->rxIndex);
+        },
+        [](void *instance) {
+            Machine *machine = static_cast<Machine *>(instance);
+            if (machine->rxIndex >= machine->rx.size()) {
+                return -1;
+            }
+            return static_cast<int>(static_cast<uint8_t>(machine->rx[machine->rxIndex]));
+        },
+        [](void *instance) {
+            Machine *machine = static_cast<Machine *>(instance);
+            if (machine->rxIndex >= machine->rx.size()) {
+                return -1;
+            }
+            return static_cast<int>(
+                static_cast<uint8_t>(machine->rx[machine->rxIndex++]));
+        },
+        [](void *, const char *) {});
+
+    GrblInterface grbl(serial, &machine);
+    grbl.cbBufferIsFull = [](void *instance) {
+        return static_cast<Machine *>(instance)->planner.isFull();
+    };
+    grbl.cbProcessCommand = [](void *instance, Command<10> *command) {
+        Machine *machine = static_cast<Machine *>(instance);
+        machine->errors.push_back(machine->planner.addCommand(*command));
+    };
+
+    for (int i = 1; i <= GCGP_PLANNER_BUFFER_SIZE + 4; i++) {
+        machine.rx += "G1X" + std::to_string(i) + "F9\n";
+    }
+    grbl.update();
+    REQUIRE(machine.planner.isFull());
+    REQUIRE(machine.errors.size() == GCGP_PLANNER_BUFFER_SIZE);
+
+    for (int i = 0; i < 4; i++) {
+        machine.planner.discardCurrentBlock();
+    }
+    grbl.update();
+    grbl.update();
+    REQUIRE(machine.errors.size() == GCGP_PLANNER_BUFFER_SIZE + 4);
+    REQUIRE(std::count(machine.errors.begin(), machine.errors.end(), GrblError::None) ==
+            static_cast<long>(machine.errors.size()));
+    REQUIRE(machine.planner.position()[0] == GCGP_PLANNER_BUFFER_SIZE + 4);
+}
@@ -0,0 +1,171 @@
+#include <GCGP/GrblInterface.h>
+#include <GCGP/RxRingBuffer.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <thread>
+
+template <size_t capacity>
+static void push(RxRingBuffer<capacity> &buffer, const std::string &data)
+{
+    for (char c : data) {
+        REQUIRE(buffer.push(c));
+    }
+}
+
+template <size_t capacity>
+static std::string readBytes(RxRingBuffer<capacity> &buffer, size_t length)
+{
+    std::string result(length, '\0');
+    result.resize(buffer.readBytes(&result[0], length));
+    return result;
+}
+
+template <size_t capacity>
+static std::string readLines(RxRingBuffer<capacity> &buffer, size_t length)
+{
+    std::string result(length, '\0');
+    result.resize(buffer.readLines(&result[0], length));
+    return result;
+}
+
+TEST_CASE("real-time commands overtake line data", "rxringbuffer")
+{
+    RxRingBuffer<64> buffer;
+    push(buffer, "G1 X1\n!G1\x85");
+    REQUIRE(buffer.realtimePending());
+    REQUIRE(buffer.available() == 10);
+    REQUIRE(buffer.peek() == '!');
+    REQUIRE(readBytes(buffer, 64) == "!\x85G1 X1\nG1");
+    REQUIRE(!buffer.realtimePending());
+    REQUIRE(buffer.read() == -1);
+}
+
+TEST_CASE("batches of complete lines", "rxringbuffer")
+{
+    RxRingBuffer<64> buffer;
+    push(buffer, "G1 X1\nG1 Y2\nG1");
+    REQUIRE(buffer.numberOfLines() == 2);
+    REQUIRE(readLines(buffer, 64) == "G1 X1\nG1 Y2\n");
+    REQUIRE(buffer.numberOfLines() == 0);
+    REQUIRE(readLines(buffer, 64).empty());
+
+    push(buffer, " Z3\nG0 X0\n");
+    REQUIRE(readLines(buffer, 8) == "G1 Z3\n");
+    REQUIRE(readLines(buffer, 3) == "G0 "); // Does not fit, but must not block
+    REQUIRE(readBytes(buffer, 64) == "X0\n");
+    REQUIRE(buffer.numberOfLines() == 0);
+}
+
+TEST_CASE("full buffer drops bytes", "rxringbuffer")
+{
+    RxRingBuffer<8> buffer;
+    push(buffer, "G1 X100");
+    REQUIRE(buffer.push('\n'));
+    REQUIRE(!buffer.push('G'));
+    REQUIRE(buffer.push('!')); // Real-time commands have their own queue
+    REQUIRE(buffer.droppedBytes() == 1);
+    REQUIRE(readBytes(buffer, 64) == "!G1 X100\n");
+}
+
+TEST_CASE("interrupt and main loop on different threads", "rxringbuffer")
+{
+    RxRingBuffer<128> buffer;
+    const size_t numberOfBytes = 2000000;
+
+    // The producer sends lines with a real-time command after every 7th byte
+    std::string expectedLines;
+    std::string expectedRealtime;
+    std::string stream;
+    for (size_t i = 0; stream.size() < numberOfBytes; i++) {
+        char c = (i % 11 == 10) ? '\n' : static_cast<char>('A' + i % 26);
+        stream.push_back(c);
+        expectedLines.push_back(c);
+        if (i % 7 == 6) {
+            char realtime = static_cast<char>(0x90 + i % 16);
+            stream.push_back(realtime);
+            expectedRealtime.push_back(realtime);
+        }
+    }
+
+    std::thread producer([&]() {
+        for (char c : stream) {
+            while (!buffer.push(c)) {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::string lines;
+    std::string realtime;
+    char chunk[32];
+    while (lines.size() + realtime.size() < stream.size()) {
+        size_t count = buffer.readBytes(chunk, sizeof(chunk));
+        if (count == 0) {
+            std::this_thread::yield();
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (isRealtimeCommand(chunk[i])) {
+                realtime.push_back(chunk[i]);
+            }
+            else {
+                lines.push_back(chunk[i]);
+            }
+        }
+    }
+    producer.join();
+
+    REQUIRE(lines == expectedLines);
+    REQUIRE(realtime == expectedRealtime);
+}
+
+static void ignoreWrite(const char *)
+{
+}
+
+TEST_CASE("as serial interface of a GrblInterface", "rxringbuffer")
+{
+    struct Machine {
+        int feedHolds = 0;
+        int commands = 0;
+    } machine;
+
+    RxRingBuffer<128> buffer;
+    GrblInterface grbl(buffer.serialInterface(ignoreWrite), &machine);
+    grbl.cbFeedHold = [](void *instance) {
+        static_cast<Machine *>(instance)->feedHolds++;
+    };
+    grbl.cbProcessCommand = [](void *instance, Command<10> *) {
+        static_cast<Machine *>(instance)->commands++;
+    };
+
+    push(buffer, "G1 X1 F100\nG1 X2!\n");
+    grbl.update();
+    REQUIRE(machine.feedHolds == 1);
+    REQUIRE(machine.commands == 2);
+}
+
+TEST_CASE("real-time commands while the GrblInterface is full", "rxringbuffer")
+{
+    struct Machine {
+        int jogCancels = 0;
+    } machine;
+
+    RxRingBuffer<256> buffer;
+    GrblInterface grbl(buffer.serialInterface(ignoreWrite), &machine);
+    grbl.cbBufferIsFull = [](void *) { return true; };
+    grbl.cbJogCancel = [](void *instance) {
+        static_cast<Machine *>(instance)->jogCancels++;
+    };
+
+    // More line data than the RX buffer of the interface takes, then a jog cancel
+    std::string lines;
+    while (lines.size() < GCGP_RX_BUFFER_SIZE + 64) {
+        lines += "G1 X1 F100\n";
+    }
+    push(buffer, lines);
+    grbl.update();
+    buffer.push('\x85');
+    grbl.update();
+    REQUIRE(machine.jogCancels == 1);
+    REQUIRE(buffer.available() == static_cast<int>(lines.size()) - GCGP_RX_BUFFER_SIZE);
+}
@@ -0,0 +1,179 @@
+#include <GCGP/GrblInterface.h>
+#include <GCGP/Scheduler.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "stringserial.h"
+
+// A clock that only the tasks advance
+struct ScheduledMachine {
+    uint32_t now = 0;
+    std::string log;
+    Scheduler scheduler;
+
+    ScheduledMachine() : scheduler(this)
+    {
+        scheduler.cbMicroseconds = [](void *instance) {
+            return static_cast<ScheduledMachine *>(instance)->now;
+        };
+    }
+};
+
+struct LoggedTask {
+    ScheduledMachine *machine;
+    char name;
+    uint32_t duration;
+    uint32_t budget = 0; // Of the last run
+
+    static void run(void *instance, uint32_t budget)
+    {
+        LoggedTask *self = static_cast<LoggedTask *>(instance);
+        self->machine->log += self->name;
+        self->machine->now += self->duration;
+        self->budget = budget;
+    }
+};
+
+TEST_CASE("higher priorities run first, then earlier deadlines", "scheduler")
+{
+    ScheduledMachine machine;
+    LoggedTask a{&machine, 'a', 10};
+    LoggedTask b{&machine, 'b', 10};
+    LoggedTask c{&machine, 'c', 10};
+    machine.scheduler.add(LoggedTask::run, &a, 0, 1000);
+    machine.scheduler.add(LoggedTask::run, &b, 0, 1000, 100);
+    machine.scheduler.add(LoggedTask::run, &c, 1, 1000);
+
+    REQUIRE(machine.scheduler.tick() == 3);
+    REQUIRE(machine.log == "cba");
+    REQUIRE(machine.scheduler.tick() == 0);
+}
+
+TEST_CASE("the budget ends a tick after the first task", "scheduler")
+{
+    ScheduledMachine machine;
+    LoggedTask slow{&machine, 's', 300};
+    LoggedTask fast{&machine, 'f', 10};
+    machine.scheduler.add(LoggedTask::run, &slow, 1);
+    machine.scheduler.add(LoggedTask::run, &fast, 0);
+
+    REQUIRE(machine.scheduler.tick(200) == 1);
+    REQUIRE(slow.budget == 200);
+    REQUIRE(machine.scheduler.tick(500) == 2);
+    REQUIRE(fast.budget == 200);
+    REQUIRE(machine.log == "ssf");
+    REQUIRE(machine.scheduler.maxTickDuration() == 310);
+}
+
+TEST_CASE("periods, lateness and missed deadlines", "scheduler")
+{
+    ScheduledMachine machine;
+    LoggedTask periodic{&machine, 'p', 0};
+    int index = machine.scheduler.add(LoggedTask::run, &periodic, 0, 100, 20);
+    const SchedulerTask &task = machine.scheduler[index];
+
+    machine.scheduler.tick();
+    machine.now = 50;
+    REQUIRE(machine.scheduler.tick() == 0);
+    machine.now = 110; // 10 late
+    machine.scheduler.tick();
+    REQUIRE(task.missed == 0);
+    REQUIRE(task.due == 200);
+    machine.now = 250; // 50 late
+    machine.scheduler.tick();
+    REQUIRE(task.missed == 1);
+    REQUIRE(task.maxLateness == 50);
+    REQUIRE(task.due == 300);
+
+    // Periods that were missed altogether are skipped
+    machine.now = 720;
+    machine.scheduler.tick();
+    REQUIRE(machine.scheduler.tick() == 0);
+    REQUIRE(task.due == 820);
+    REQUIRE(task.runs == 4);
+}
+
+TEST_CASE("a late run keeps the next period", "scheduler")
+{
+    ScheduledMachine machine;
+    LoggedTask periodic{&machine, 'p', 70};
+    int index = machine.scheduler.add(LoggedTask::run, &periodic, 0, 100);
+    const SchedulerTask &task = machine.scheduler[index];
+
+    machine.scheduler.tick();
+    REQUIRE(task.due == 100);
+    machine.now = 150; // 50 late, the run ends at 220
+    machine.scheduler.tick();
+    REQUIRE(task.due == 200);
+    REQUIRE(machine.scheduler.tick() == 1);
+    REQUIRE(task.maxLateness == 50);
+    REQUIRE(task.due == 300);
+    REQUIRE(task.runs == 3);
+}
+
+TEST_CASE("the clock may wrap around", "scheduler")
+{
+    ScheduledMachine machine;
+    machine.now = UINT32_MAX - 50;
+    LoggedTask periodic{&machine, 'p', 0};
+    int index = machine.scheduler.add(LoggedTask::run, &periodic, 0, 100);
+    machine.scheduler.tick();
+    machine.now = 20;
+    REQUIRE(machine.scheduler.tick() == 0);
+    machine.now = 49;
+    REQUIRE(machine.scheduler.tick() == 1);
+    REQUIRE(machine.scheduler[index].missed == 0);
+}
+
+TEST_CASE("tasks beyond the maximum are not added", "scheduler")
+{
+    ScheduledMachine machine;
+    LoggedTask task{&machine, 't', 0};
+    for (int i = 0; i < GCGP_SCHEDULER_MAX_TASKS; i++) {
+        REQUIRE(machine.scheduler.add(LoggedTask::run, &task, 0) == i);
+    }
+    REQUIRE(machine.scheduler.add(LoggedTask::run, &task, 0) == -1);
+    REQUIRE(machine.scheduler.add(nullptr, &task, 0) == -1);
+}
+
+TEST_CASE("update() stops at its budget of lines or bytes", "scheduler")
+{
+    TestMachine machine;
+    machine.rx = "G0 X1\nG0 X2\n\nG0 X3\n";
+
+    UpdateBudget lines;
+    lines.lines = 2;
+    REQUIRE(machine.grbl.update(lines));
+    REQUIRE(machine.commands == 2);
+
+    UpdateBudget bytes;
+    bytes.bytes = 3; // The empty line and half of the next
+    REQUIRE(machine.grbl.update(bytes));
+    REQUIRE(machine.commands == 2);
+    REQUIRE(!machine.grbl.update());
+    REQUIRE(machine.commands == 3);
+}
+
+TEST_CASE("update() stops at its budget of time", "scheduler")
+{
+    TestMachine machine;
+    machine.grbl.cbProcessCommand = [](void *instance, Command<10> *) {
+        static_cast<TestMachine *>(instance)->commands++;
+        uint32_t start = GCGP_CLOCK_US();
+        while (GCGP_CLOCK_US() - start < 100) {
+        }
+    };
+    machine.rx = "G0 X1\nG0 X2\nG0 X3\n";
+
+    UpdateBudget budget;
+    budget.microseconds = 50;
+    REQUIRE(machine.grbl.update(budget));
+    REQUIRE(machine.commands == 1);
+
+    Scheduler scheduler;
+    scheduler.add(GrblInterface::scheduledUpdate, &machine.grbl, 0);
+    scheduler.tick(50);
+    REQUIRE(machine.commands == 2);
+    scheduler.tick();
+    REQUIRE(machine.commands == 3);
+}
@@ -0,0 +1,161 @@
+#include <GCGP/ServoSimulator.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "testutils.h"
+
+TEST_CASE("plant", "servosimulator")
+{
+    ServoAxisSettings settings;
+    settings.mass = 2.f;
+    settings.damping = 0.f;
+    settings.resolution = 0.f;
+    ServoAxis axis(settings, 0.001f);
+
+    // Without damping, 10 N accelerate 2 kg by 5 m/s^2
+    for (int i = 0; i < 1000; i++) {
+        axis.applyForce(10.f);
+    }
+    REQUIRE(fabsf(axis.velocity() - 5000.f) < 0.5f);
+    REQUIRE(fabsf(axis.position() - 2500.f) < 0.5f);
+
+    // With damping, the velocity tends to force / damping
+    settings.damping = 100.f;
+    axis.configure(settings, 0.001f);
+    axis.setPosition(0.f);
+    for (int i = 0; i < 1000; i++) {
+        axis.applyForce(10.f);
+    }
+    REQUIRE(fabsf(axis.velocity() - 100.f) < 0.01f);
+
+    // The exact integration does not depend on the period
+    ServoAxis fine(settings, 0.0001f);
+    ServoAxis coarse(settings, 0.01f);
+    for (int i = 0; i < 1000; i++) {
+        fine.applyForce(10.f);
+    }
+    for (int i = 0; i < 10; i++) {
+        coarse.applyForce(10.f);
+    }
+    REQUIRE(fabsf(fine.position() - coarse.position()) < 1e-3f);
+}
+
+TEST_CASE("encoder", "servosimulator")
+{
+    ServoAxisSettings settings;
+    settings.resolution = 0.01f;
+    ServoAxis axis(settings, 0.001f);
+    axis.setPosition(1.237f);
+    REQUIRE(fabsf(axis.encoderPosition() - 1.23f) < 1e-5f);
+    axis.setPosition(-0.001f);
+    REQUIRE(fabsf(axis.encoderPosition() + 0.01f) < 1e-5f);
+}
+
+TEST_CASE("step response", "servosimulator")
+{
+    ServoAxisSettings settings;
+    settings.ki = 2000.f;
+    ServoAxis axis(settings, 0.001f);
+
+    // Settles within one count, the integral removes the offset of the encoder
+    float overshoot = 0.f;
+    for (int i = 0; i < 2000; i++) {
+        axis.tick(1.f, 0.f, 0.f);
+        overshoot = fmaxf(overshoot, axis.position() - 1.f);
+    }
+    REQUIRE(fabsf(axis.encoderPosition() - 1.f) <= settings.resolution);
+    REQUIRE(overshoot < 0.2f);
+    REQUIRE(fabsf(axis.velocity()) < 0.1f);
+
+    // A step too large for the drive saturates it. The integral does not grow
+    // meanwhile, so it overshoots like without one.
+    ServoAxisSettings proportional = settings;
+    proportional.ki = 0.f;
+    ServoAxis reference(proportional, 0.001f);
+    axis.setPosition(0.f);
+    REQUIRE(axis.tick(100.f, 0.f, 0.f) == settings.maxForce);
+    float withIntegral = 0.f;
+    float withoutIntegral = 0.f;
+    for (int i = 0; i < 5000; i++) {
+        axis.tick(100.f, 0.f, 0.f);
+        reference.tick(100.f, 0.f, 0.f);
+        withIntegral = fmaxf(withIntegral, axis.position() - 100.f);
+        withoutIntegral = fmaxf(withoutIntegral, reference.position() - 100.f);
+    }
+    REQUIRE(fabsf(axis.encoderPosition() - 100.f) <= settings.resolution);
+    REQUIRE(withIntegral < 1.1f * withoutIntegral);
+}
+
+static ServoSimulatorSettings simulatorSettings(bool feedForward)
+{
+    ServoSimulatorSettings settings;
+    settings.setpoints.servoRate = 2000.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.setpoints.maxRate[i] = 6000.f;
+        ServoAxisSettings &axis = settings.axes[i];
+        if (feedForward) {
+            axis.velocityFeedForward = axis.damping / 1000.f;
+            axis.accelerationFeedForward = axis.mass / 1000.f;
+        }
+        settings.feedback.maxError[i] = 0.02f;
+    }
+    settings.setpoints.acceleration = 1000.f;
+    settings.setpoints.jerk = 50000.f;
+    return settings;
+}
+
+struct Trace {
+    float peakError[GCGP_NUM_AXES] = {};
+    size_t samples = 0;
+    double lastTime = 0.;
+    bool monotonic = true;
+
+    static void record(void *instance, const ServoSample &sample)
+    {
+        Trace *trace = static_cast<Trace *>(instance);
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            trace->peakError[i] = fmaxf(trace->peakError[i], fabsf(sample.error[i]));
+        }
+        trace->monotonic = trace->monotonic && sample.time > trace->lastTime;
+        trace->lastTime = sample.time;
+        trace->samples++;
+    }
+};
+
+static float runJob(bool feedForward, Trace &trace, FeedbackSnapshot &snapshot)
+{
+    ServoSimulator simulator(simulatorSettings(feedForward));
+    simulator.instance = &trace;
+    simulator.cbSample = Trace::record;
+    REQUIRE(simulator.addCommand(parse("G1 X50 Y20 F3000")) == GrblError::None);
+    REQUIRE(simulator.addCommand(parse("G2 X50 Y0 I0 J-10")) == GrblError::None);
+    REQUIRE(simulator.addCommand(parse("G1 X0 Y0")) == GrblError::None);
+    uint64_t ticks = simulator.run(0.5f);
+
+    REQUIRE(trace.samples == ticks);
+    REQUIRE(trace.monotonic);
+    REQUIRE(fabs(simulator.clock().seconds() - ticks / 2000.) < 1e-6);
+    REQUIRE(simulator.monitor.snapshot(snapshot));
+    REQUIRE(snapshot.samples == ticks);
+    REQUIRE(fabsf(simulator.axes[0].encoderPosition()) <= 0.002f);
+    REQUIRE(fabsf(simulator.axes[1].encoderPosition()) <= 0.002f);
+    return snapshot.peakError[0];
+}
+
+TEST_CASE("following error", "servosimulator")
+{
+    Trace feedback;
+    FeedbackSnapshot feedbackSnapshot;
+    float feedbackPeak = runJob(false, feedback, feedbackSnapshot);
+
+    Trace feedForward;
+    FeedbackSnapshot feedForwardSnapshot;
+    float feedForwardPeak = runJob(true, feedForward, feedForwardSnapshot);
+
+    // Without feed-forward, the error is about (velocity * damping + acceleration *
+    // mass) / kp. Feed-forward removes most of it.
+    REQUIRE(feedbackPeak == feedback.peakError[0]);
+    REQUIRE(feedbackPeak > 0.02f);
+    REQUIRE(feedbackSnapshot.alarmAxes != 0);
+    REQUIRE(feedForwardPeak < 0.2f * feedbackPeak);
+    REQUIRE(feedForwardSnapshot.alarmAxes == 0);
+}
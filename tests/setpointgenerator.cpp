@@ -0,0 +1,175 @@
+#include <GCGP/SetpointGenerator.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "testutils.h"
+
+static SetpointSettings testSettings()
+{
+    SetpointSettings settings;
+    settings.servoRate = 10000.f;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.maxRate[i] = 6000.f;
+    }
+    settings.acceleration = 500.f;
+    settings.jerk = 10000.f;
+    return settings;
+}
+
+// Runs the generator until it is idle and checks the limits along the way
+struct Recorder {
+    SetpointGenerator &generator;
+    float maxAxisVelocity = 0.f;
+    float maxVelocity = 0.f;
+    float maxAcceleration = 0.f;
+    float maxJerk = 0.f;
+    size_t ticks = 0;
+
+    void run(size_t maxTicks = 1000000)
+    {
+        float dt = 1.f / generator.settings.servoRate;
+        float acceleration = 0.f;
+        while (!generator.isIdle() && ticks < maxTicks) {
+            const Setpoint &setpoint = generator.tick();
+            maxVelocity = fmaxf(maxVelocity, fabsf(setpoint.pathVelocity));
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                maxAxisVelocity = fmaxf(maxAxisVelocity, fabsf(setpoint.velocity[i]));
+            }
+            maxAcceleration = fmaxf(maxAcceleration, fabsf(setpoint.pathAcceleration));
+            float jerk = (setpoint.pathAcceleration - acceleration) / dt;
+            maxJerk = fmaxf(maxJerk, fabsf(jerk));
+            acceleration = setpoint.pathAcceleration;
+            ticks++;
+        }
+    }
+};
+
+TEST_CASE("s-curve profile", "setpointgenerator")
+{
+    SCurveProfile profile;
+
+    // Reaches velocity and acceleration: 7 phases
+    profile.plan(100.f, 50.f, 500.f, 10000.f);
+    REQUIRE(fabsf(profile.peakVelocity - 50.f) < 1e-4f);
+    REQUIRE(fabsf(profile.phaseEnd[0] - 0.05f) < 1e-6f);
+    float position, velocity, acceleration;
+    profile.evaluate(6, profile.phaseEnd[6] - profile.phaseEnd[5], position, velocity,
+                     acceleration);
+    REQUIRE(fabsf(position - 100.f) < 1e-3f);
+    REQUIRE(fabsf(velocity) < 1e-3f);
+    REQUIRE(fabsf(acceleration) < 1e-2f);
+    REQUIRE(fabsf(profile.duration - (100.f / 50.f + 50.f / 500.f + 0.05f)) < 1e-4f);
+
+    // Too short for the velocity, and for the acceleration
+    for (float distance : { 3.f, 0.1f }) {
+        profile.plan(distance, 50.f, 500.f, 10000.f);
+        REQUIRE(profile.peakVelocity < 50.f);
+        profile.evaluate(6, profile.phaseEnd[6] - profile.phaseEnd[5], position,
+                         velocity, acceleration);
+        REQUIRE(fabsf(position - distance) < 1e-3f * distance);
+        REQUIRE(fabsf(velocity) < 1e-3f);
+    }
+}
+
+TEST_CASE("linear moves stay within the limits", "setpointgenerator")
+{
+    SetpointGenerator generator(testSettings());
+    Recorder recorder{ generator };
+
+    REQUIRE(generator.addCommand(parse("G1 X30 Y40 F1200")) == GrblError::None);
+    REQUIRE(generator.addCommand(parse("G1 X30.1")) == GrblError::None);
+    REQUIRE(generator.addCommand(parse("G0 X0 Y0")) == GrblError::None);
+    recorder.run();
+
+    REQUIRE(generator.isIdle());
+    REQUIRE(generator.setpoint().position[0] == 0.f);
+    REQUIRE(generator.setpoint().velocity[0] == 0.f);
+    REQUIRE(recorder.maxAxisVelocity <= 100.f * 1.001f); // Rapid at 6000 mm/min
+    REQUIRE(recorder.maxAxisVelocity > 99.f);
+    REQUIRE(recorder.maxAcceleration <= 500.f * 1.001f);
+    REQUIRE(recorder.maxJerk <= 10000.f * 1.01f);
+}
+
+TEST_CASE("velocity is the derivative of position", "setpointgenerator")
+{
+    SetpointGenerator generator(testSettings());
+    REQUIRE(generator.addCommand(parse("G1 X10 Y5 Z-2 F3000")) == GrblError::None);
+
+    float dt = 1.f / generator.settings.servoRate;
+    float previous[GCGP_NUM_AXES] = {};
+    for (int tick = 0; tick < 100; tick++) {
+        const Setpoint &setpoint = generator.tick();
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            float velocity = (setpoint.position[i] - previous[i]) / dt;
+            REQUIRE(fabsf(velocity - setpoint.velocity[i]) < 0.5f);
+            previous[i] = setpoint.position[i];
+        }
+    }
+}
+
+TEST_CASE("arcs in all planes", "setpointgenerator")
+{
+    struct Arc {
+        const char *command;
+        int centerAxis; // The center is at 5 on this axis
+        int otherAxis;
+    };
+    const Arc arcs[] = {
+        { "G17 G2 X10 Y0 I5", 0, 1 },
+        { "G18 G3 X10 Z0 I5", 0, 2 },
+        { "G19 G2 Y10 Z0 J5", 1, 2 },
+    };
+
+    for (const Arc &arc : arcs) {
+        SetpointGenerator generator(testSettings());
+        REQUIRE(generator.addCommand(parse("F3000")) == GrblError::None);
+        REQUIRE(generator.addCommand(parse(arc.command)) == GrblError::None);
+
+        float maxDeviation = 0.f;
+        while (!generator.isIdle()) {
+            const Setpoint &setpoint = generator.tick();
+            float d0 = setpoint.position[arc.centerAxis] - 5.f;
+            float d1 = setpoint.position[arc.otherAxis];
+            maxDeviation = fmaxf(maxDeviation, fabsf(sqrtf(d0 * d0 + d1 * d1) - 5.f));
+        }
+        REQUIRE(maxDeviation < 1e-4f);
+        REQUIRE(generator.setpoint().position[arc.centerAxis] == 10.f);
+    }
+}
+
+TEST_CASE("helical full circle", "setpointgenerator")
+{
+    SetpointGenerator generator(testSettings());
+    Recorder recorder{ generator };
+    REQUIRE(generator.addCommand(parse("G3 X0 Y0 Z-1 I2 F6000")) == GrblError::None);
+
+    float minY = 0.f;
+    while (!generator.isIdle()) {
+        minY = fminf(minY, generator.tick().position[1]);
+    }
+    REQUIRE(fabsf(minY + 2.f) < 1e-3f); // Counter-clockwise, around (2, 0)
+    REQUIRE(generator.setpoint().position[2] == -1.f);
+
+    // The centripetal acceleration limits the speed on small arcs
+    REQUIRE(generator.addCommand(parse("G3 X0 Y0 I0.5")) == GrblError::None);
+    recorder.run();
+    REQUIRE(recorder.maxVelocity <= sqrtf(500.f * 0.5f) * 1.001f);
+}
+
+TEST_CASE("long move at a high servo rate", "setpointgenerator")
+{
+    SetpointSettings settings = testSettings();
+    settings.servoRate = 20000.f;
+    SetpointGenerator generator(settings);
+    REQUIRE(generator.addCommand(parse("G1 X100 F5")) == GrblError::None); // 1200 s
+
+    size_t ticks = 0;
+    while (!generator.isIdle() && ticks < 25000000) {
+        const Setpoint &setpoint = generator.tick();
+        if (++ticks == 4000000) { // 200 s
+            REQUIRE(fabsf(setpoint.position[0] - 100.f / 6.f) < 1e-3f);
+        }
+    }
+    REQUIRE(generator.isIdle());
+    REQUIRE(generator.setpoint().position[0] == 100.f);
+    REQUIRE(ticks < 24000200); // 1200 s and the time to accelerate
+}
@@ -0,0 +1,104 @@
+#include <GCGP/Simulator.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+#include "testutils.h"
+
+static SimulatorSettings fastSettings()
+{
+    SimulatorSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.planner.maxRate[i] = 6000.f;
+        settings.planner.acceleration[i] = 1000.f;
+    }
+    return settings;
+}
+
+TEST_CASE("the clock follows the motion profile", "simulator")
+{
+    MachineSimulator simulator;
+    REQUIRE(simulator.sendLine("G21 G90"));
+    REQUIRE(simulator.sendLine("G1 X100 F300"));
+    REQUIRE(simulator.report().time == 0.); // Not executed yet
+    simulator.finish();
+
+    // 5 mm/s with 10 mm/s^2: 0.5 s to accelerate over 1.25 mm, the same to brake
+    const SimulationReport &report = simulator.report();
+    REQUIRE(near(report.time, 0.5 + 97.5 / 5. + 0.5, 1e-4));
+    REQUIRE(report.blocks == 1);
+    REQUIRE(near(report.distance, 100., 1e-4));
+    REQUIRE(report.position[0] == 100.f);
+    REQUIRE(report.lines == 2);
+    REQUIRE(simulator.clock().now == static_cast<uint64_t>(report.time * 1e9 + 0.5));
+}
+
+TEST_CASE("dwell and spindle wait for the motion", "simulator")
+{
+    SimulatorSettings settings;
+    settings.spindleDelay = 2.f;
+    MachineSimulator simulator(settings);
+    REQUIRE(simulator.sendLine("G1 X10 F600"));
+    REQUIRE(simulator.report().time == 0.);
+    REQUIRE(simulator.sendLine("M3 S1000"));
+    double started = simulator.report().time; // The move and the spindle delay
+    REQUIRE(started > 3.);
+    REQUIRE(simulator.spindleOn());
+    REQUIRE(simulator.sendLine("G4 P1.5"));
+    REQUIRE(near(simulator.report().time, started + 1.5, 1e-6));
+    REQUIRE(near(simulator.report().spindleTime, 3.5, 1e-6));
+    REQUIRE(simulator.sendLine("M5"));
+    REQUIRE(!simulator.spindleOn());
+    REQUIRE(simulator.sendLine("M3"));
+    REQUIRE(simulator.sendLine("M2"));
+    REQUIRE(!simulator.spindleOn());
+    REQUIRE(near(simulator.report().dwellTime, 1.5, 1e-6));
+}
+
+TEST_CASE("errors and lines without an answer", "simulator")
+{
+    MachineSimulator simulator;
+    REQUIRE(simulator.sendLine(""));
+    REQUIRE(!simulator.sendLine("G1 X1 Y"));
+    REQUIRE(std::string(simulator.response()).rfind(GCGP_ERROR_MESSAGE, 0) == 0);
+    REQUIRE(!simulator.sendLine(std::string(300, 'X').c_str()));
+    REQUIRE(simulator.sendLine("G1 X1 F100"));
+    REQUIRE(std::string(simulator.response()) == GCGP_OK_MESSAGE);
+    REQUIRE(simulator.report().lines == 3);
+    REQUIRE(simulator.report().errors == 2);
+}
+
+// The host has to wait for space in the planner, so the clock jumps while it streams
+TEST_CASE("streaming more moves than the planner holds", "simulator")
+{
+    MachineSimulator simulator(fastSettings());
+    std::vector<std::string> output;
+    simulator.instance = &output;
+    simulator.cbOutput = [](void *output, const char *line) {
+        static_cast<std::vector<std::string> *>(output)->push_back(line);
+    };
+
+    for (int i = 1; i <= 200; i++) {
+        std::string line = "G1 X" + std::to_string(i % 2 ? 10 : 0) + " Y" +
+                           std::to_string(i * 0.5) + " F3000";
+        REQUIRE(simulator.sendLine(line.c_str()));
+        REQUIRE(simulator.planner.size() <= GCGP_PLANNER_BUFFER_SIZE);
+        if (i == 100) {
+            REQUIRE(simulator.report().time > 0.);
+            REQUIRE(simulator.report().blocks > 50);
+        }
+    }
+    simulator.sendRealtime('?');
+    REQUIRE(output.back().rfind("<Run|MPos:", 0) == 0);
+
+    simulator.finish();
+    REQUIRE(simulator.report().blocks == 200);
+    REQUIRE(simulator.report().position[1] == 100.f);
+    REQUIRE(simulator.report().errors == 0);
+    REQUIRE(output.size() == 202); // The welcome message, the oks and a status report
+    REQUIRE(output.front() == GCGP_WELCOME_MESSAGE);
+
+    simulator.sendRealtime('?');
+    REQUIRE(output.back() == "<Idle|MPos:0.000,100.000,0.000|APos:0.000,100.000,0.000"
+                             "|FS:0.000,0>");
+}
@@ -0,0 +1,134 @@
+#include <GCGP/Planner.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include "testutils.h"
+
+static SoftLimits testLimits()
+{
+    SoftLimits limits;
+    limits.enabled = true;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        limits.min[i] = -100.f;
+        limits.max[i] = 0.f;
+    }
+    return limits;
+}
+
+TEST_CASE("single targets", "softlimits")
+{
+    SoftLimits limits = testLimits();
+    const float inside[] = { -100.f, 0.f, -50.f };
+    const float outside[] = { -100.1f, 0.f, 1.f };
+    const float unknown[] = { NAN, NAN, NAN };
+    REQUIRE(limits.check(inside) == 0);
+    REQUIRE(limits.check(outside) == 0b101);
+    REQUIRE(limits.check(unknown) == 0);
+}
+
+TEST_CASE("batches match single targets", "softlimits")
+{
+    SoftLimits limits = testLimits();
+    CoordinateTransform transform;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        transform.scale[i] = 25.4f;
+        transform.offset[i] = i == 0 ? -50.f : -10.f;
+    }
+
+    // Odd counts also cover the scalar loop after the vectors
+    for (size_t count : { 0, 1, 7, 1001 }) {
+        std::vector<float> axes[GCGP_NUM_AXES];
+        std::vector<float> copies[GCGP_NUM_AXES];
+        const float *program[GCGP_NUM_AXES];
+        float *machine[GCGP_NUM_AXES];
+        for (int i = 0; i < GCGP_NUM_AXES; i++) {
+            for (size_t j = 0; j < count; j++) {
+                axes[i].push_back(static_cast<float>((j * 7 + i * 3) % 11) * 0.5f - 3.f);
+            }
+            copies[i] = axes[i];
+            program[i] = copies[i].data();
+            machine[i] = axes[i].data(); // In place
+        }
+        std::vector<AxisBits> violations(count, 0xFF);
+        size_t violating = limits.transformAndCheck(transform, machine, machine,
+                                                    violations.data(), count);
+
+        size_t expected = 0;
+        for (size_t j = 0; j < count; j++) {
+            float target[GCGP_NUM_AXES];
+            for (int i = 0; i < GCGP_NUM_AXES; i++) {
+                target[i] = program[i][j] * transform.scale[i] + transform.offset[i];
+                REQUIRE(machine[i][j] == target[i]);
+            }
+            REQUIRE(violations[j] == limits.check(target));
+            expected += violations[j] != 0;
+        }
+        REQUIRE(violating == expected);
+        REQUIRE((count < 7 || (expected > 0 && expected < count)));
+    }
+}
+
+TEST_CASE("the transform of the modal state", "softlimits")
+{
+    ModalState state;
+    float position[GCGP_NUM_AXES] = {};
+    Move move;
+    REQUIRE(state.resolve(parse("G20 G10 L2 P1 X-1 Y-2"), position, move) ==
+            GrblError::None);
+    CoordinateTransform transform = state.transform();
+    REQUIRE(transform.scale[0] == 25.4f);
+    REQUIRE(transform.offset[0] == -25.4f);
+    REQUIRE(transform.offset[1] == -50.8f);
+    REQUIRE(transform.offset[2] == 0.f);
+}
+
+TEST_CASE("jogs beyond the travel are rejected", "softlimits")
+{
+    PlannerSettings settings;
+    settings.softLimits = testLimits();
+    Planner planner(settings);
+
+    REQUIRE(planner.addCommand(parse("$J=G91 X-10 F500")) == GrblError::None);
+    REQUIRE(planner.addCommand(parse("$J=G91 X10 F500")) == GrblError::None);
+    REQUIRE(planner.addCommand(parse("$J=G91 X0.5 F500")) ==
+            GrblError::JogTargetExceedsMachineTravelIgnored);
+    REQUIRE(planner.addCommand(parse("$J=G90 Z-101 F500")) ==
+            GrblError::JogTargetExceedsMachineTravelIgnored);
+    REQUIRE(planner.size() == 2);
+
+    // Only jogs are checked, and only if enabled
+    REQUIRE(planner.addCommand(parse("G1 X1 F500")) == GrblError::None);
+    planner.settings.softLimits.enabled = false;
+    REQUIRE(planner.addCommand(parse("$J=G91 X1 F500")) == GrblError::None);
+}
+
+TEST_CASE("jogs leave the modal state unchanged", "softlimits")
+{
+    PlannerSettings settings;
+    settings.softLimits = testLimits();
+    Planner planner(settings);
+
+    REQUIRE(planner.addCommand(parse("$J=G20 G91 X-1 F10")) == GrblError::None);
+    REQUIRE(planner.addCommand(parse("$J=G91 X30 F100")) ==
+            GrblError::JogTargetExceedsMachineTravelIgnored);
+    REQUIRE(planner.modalState.distanceMode == DistanceMode::Absolute);
+    REQUIRE(planner.modalState.lengthUnits == LengthUnits::Metric);
+    REQUIRE(isnan(planner.modalState.feedrate));
+
+    REQUIRE(planner.addCommand(parse("G1 X-5")) ==
+            GrblError::FeedRateHasNotYetBeenSetOrIsNone);
+    REQUIRE(planner.addCommand(parse("G1 X-5 F100")) == GrblError::None);
+    REQUIRE(planner.position()[0] == -5.f);
+}
+
+TEST_CASE("a block that does not fit leaves the modal state unchanged", "softlimits")
+{
+    Planner planner;
+    for (int i = 1; !planner.isFull(); i++) {
+        REQUIRE(planner.addCommand(parse(i % 2 ? "G0 X1" : "G0 X0")) == GrblError::None);
+    }
+    REQUIRE(planner.addCommand(parse("G91 G1 X1 F100")) == GrblError::PlannerBufferFull);
+    REQUIRE(planner.modalState.distanceMode == DistanceMode::Absolute);
+    REQUIRE(isnan(planner.modalState.feedrate));
+}
@@ -0,0 +1,109 @@
+#include <GCGP/StageProfiler.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+#include <string>
+
+static const char *lines[] = {
+    "G1 X10 Y20 F1000", "G2 X10 Y0 I5 J-5", "$J=G91 X1 F100", "G10 L2 P1 X5",
+    "G4 P0.5",          "G81 X1",           "G1 X1.2.3",      "G0 G1 X1",
+    "G2 X10",           "M3 S1000",         "G43.1 X1",       "",
+};
+
+TEST_CASE("parsing in steps is the same as parse()", "stageprofiler")
+{
+    for (const char *line : lines) {
+        INFO(line);
+        Command<10> whole;
+        GrblError wholeError = whole.parse(line, strlen(line));
+
+        Command<10> steps;
+        CommandTokens<10> tokens;
+        GrblError stepsError = tokenizeCommand(tokens, line, strlen(line));
+        if (stepsError == GrblError::None) {
+            stepsError = steps.interpret(tokens);
+        }
+        if (stepsError == GrblError::None) {
+            stepsError = steps.validate();
+        }
+        REQUIRE(stepsError == wholeError);
+        if (wholeError == GrblError::None) {
+            REQUIRE(steps.motionType == whole.motionType);
+            REQUIRE(steps.isJog == whole.isJog);
+            REQUIRE(steps.offsetAction == whole.offsetAction);
+            REQUIRE(steps.hasAxisWords() == whole.hasAxisWords());
+        }
+    }
+}
+
+TEST_CASE("a block with an error skips the stages after it", "stageprofiler")
+{
+    int dispatched = 0;
+    StageProfiler profiler(&dispatched);
+    profiler.cbProcessCommand = [](void *instance, Command<10> *) {
+        (*static_cast<int *>(instance))++;
+    };
+
+    const char *valid = "G1 X10 Y20 F1000";
+    const char *unsupported = "G81 X1"; // Fails while interpreting the words
+    const char *noAxisWords = "G2 F100"; // Fails in the checks across words
+    profiler.addLine(valid, strlen(valid));
+    profiler.addLine(unsupported, strlen(unsupported));
+    profiler.addLine(noAxisWords, strlen(noAxisWords));
+
+    REQUIRE(profiler.blocks() == 3);
+    REQUIRE(profiler.errors() == 2);
+    REQUIRE(dispatched == 1);
+    REQUIRE(profiler.cost(PipelineStage::Tokenize).blocks == 3);
+    REQUIRE(profiler.cost(PipelineStage::Parse).blocks == 3);
+    REQUIRE(profiler.cost(PipelineStage::Validate).blocks == 2);
+    REQUIRE(profiler.cost(PipelineStage::Dispatch).blocks == 1);
+    REQUIRE(profiler.cost(PipelineStage::Respond).blocks == 3);
+    REQUIRE(profiler.total().blocks == 3);
+}
+
+TEST_CASE("the stages add up to the total", "stageprofiler")
+{
+    StageProfiler profiler;
+    for (int i = 0; i < 100; i++) {
+        for (const char *line : lines) {
+            profiler.addLine(line, strlen(line));
+        }
+    }
+
+    uint64_t nanoseconds = 0;
+    uint64_t instructions = 0;
+    for (int i = 0; i < GCGP_NUM_PIPELINE_STAGES; i++) {
+        const StageCost &cost = profiler.cost(static_cast<PipelineStage>(i));
+        nanoseconds += cost.nanoseconds;
+        instructions += cost.counts[static_cast<int>(PerfCounter::Instructions)];
+        REQUIRE(cost.maxNanoseconds * cost.blocks >= cost.nanoseconds);
+    }
+    const StageCost &total = profiler.total();
+    REQUIRE(total.nanoseconds == nanoseconds);
+    REQUIRE(total.counts[static_cast<int>(PerfCounter::Instructions)] == instructions);
+    REQUIRE(total.maxNanoseconds * total.blocks >= total.nanoseconds);
+
+    // Only where the CPU and the kernel let us count
+    if (profiler.countersAvailable()) {
+        const StageCost &tokenize = profiler.cost(PipelineStage::Tokenize);
+        REQUIRE(tokenize.perBlock(PerfCounter::Instructions) > 10.);
+        REQUIRE(total.maxInstructions >= tokenize.maxInstructions);
+    }
+}
+
+TEST_CASE("the table has a row per stage", "stageprofiler")
+{
+    StageProfiler profiler;
+    const char *line = "G1 X1 F100";
+    profiler.addLine(line, strlen(line));
+
+    static std::string output;
+    output.clear();
+    SerialInterface serial;
+    serial.cbWrite = [](const char *str) { output += str; };
+    profiler.print(serial);
+    for (const char *name : {"Tokenize", "Parse", "Validate", "Dispatch", "Respond",
+                             "Total"}) {
+        REQUIRE(output.find(name) != std::string::npos);
+    }
+}
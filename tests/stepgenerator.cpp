@@ -0,0 +1,225 @@
+#include <GCGP/StepGenerator.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include <sstream>
+#include <vector>
+
+#include "testutils.h"
+
+static PlannerSettings testSettings()
+{
+    PlannerSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.maxRate[i] = 6000.f;
+        settings.acceleration[i] = 500.f;
+    }
+    return settings;
+}
+
+struct StepEvent {
+    uint64_t time; // Timer ticks
+    AxisBits stepBits;
+    AxisBits directionBits;
+};
+
+// Runs the step interrupt on a virtual timer until all moves are done, refilling the
+// segments from the planner like the main loop would
+static std::vector<StepEvent> runTimeline(Planner &planner, StepGenerator &stepper)
+{
+    std::vector<StepEvent> timeline;
+    uint64_t time = 0;
+    stepper.prepare(planner);
+    while (stepper.isRunning()) {
+        AxisBits stepBits = stepper.tick();
+        if (stepBits) {
+            timeline.push_back({ time, stepBits, stepper.directionBits() });
+        }
+        time += stepper.period();
+        stepper.prepare(planner);
+    }
+    return timeline;
+}
+
+static std::string dumpTimeline(const std::vector<StepEvent> &timeline)
+{
+    std::ostringstream stream;
+    for (const StepEvent &event : timeline) {
+        stream << event.time << ',' << int(event.stepBits) << ','
+               << int(event.directionBits) << '\n';
+    }
+    return stream.str();
+}
+
+TEST_CASE("step counts match the targets", "stepgenerator")
+{
+    Planner planner(testSettings());
+    StepGenerator stepper;
+
+    const char *commands[] = { "G1 X10 Y5 Z-2 F1200", "G1 X-3.3 Y5.0125", "G0 X0 Y0 Z0",
+                               "G1 Z0.00001", "G1 X0.5 Y-0.25" };
+    const int32_t expected[][3] = {
+        { 800, 400, -160 }, { -264, 401, -160 }, { 0, 0, 0 }, { 0, 0, 0 }, { 40, -20, 0 },
+    };
+    for (size_t i = 0; i < sizeof(commands) / sizeof(commands[0]); i++) {
+        REQUIRE(planner.addCommand(parse(commands[i])) == GrblError::None);
+        std::vector<StepEvent> timeline = runTimeline(planner, stepper);
+        for (int axis = 0; axis < 3; axis++) {
+            REQUIRE(stepper.position()[axis] == expected[i][axis]);
+        }
+        REQUIRE(planner.isEmpty());
+    }
+}
+
+TEST_CASE("every step moves towards the target", "stepgenerator")
+{
+    Planner planner(testSettings());
+    StepGenerator stepper;
+    REQUIRE(planner.addCommand(parse("G1 X10 Y-5 F1200")) == GrblError::None);
+    REQUIRE(planner.addCommand(parse("G1 X0 Y0")) == GrblError::None);
+    std::vector<StepEvent> timeline = runTimeline(planner, stepper);
+
+    int32_t position[2] = { 0, 0 };
+    size_t xSteps = 0;
+    for (const StepEvent &event : timeline) {
+        xSteps += event.stepBits & 1;
+        for (int axis = 0; axis < 2; axis++) {
+            if (event.stepBits & (1 << axis)) {
+                position[axis] += (event.directionBits & (1 << axis)) ? -1 : 1;
+            }
+        }
+        REQUIRE(position[0] >= 0);
+        REQUIRE(position[0] <= 800);
+        REQUIRE(position[1] <= 0);
+        REQUIRE(position[1] >= -400);
+    }
+    REQUIRE(position[0] == 0);
+    REQUIRE(position[1] == 0);
+    REQUIRE(xSteps == 1600);
+}
+
+TEST_CASE("step rate follows the speed profile", "stepgenerator")
+{
+    Planner planner(testSettings());
+    StepGenerator stepper;
+    REQUIRE(planner.addCommand(parse("G1 X100 F1200")) == GrblError::None);
+    std::vector<StepEvent> timeline = runTimeline(planner, stepper);
+    REQUIRE(timeline.size() == 8000);
+
+    // 20 mm/s at 80 steps/mm, reached after 0.4 mm of acceleration at 500 mm/s^2.
+    // The rate is averaged over 100 steps, as single steps jitter by an interrupt.
+    const double timerFrequency = stepper.settings.timerFrequency;
+    double maxRate = 0.;
+    for (size_t i = 100; i < timeline.size(); i++) {
+        double interval = (timeline[i].time - timeline[i - 100].time) / timerFrequency;
+        maxRate = fmax(maxRate, 100. / interval);
+    }
+    REQUIRE(maxRate <= 1600. * 1.01);
+    REQUIRE(maxRate >= 1600. * 0.99);
+
+    double duration = timeline.back().time / timerFrequency;
+    double expected = 100. / 20. + 20. / 500.; // Cruise plus the two ramps
+    REQUIRE(fabs(duration - expected) < 0.01);
+}
+
+TEST_CASE("slow axes are smoothed", "stepgenerator")
+{
+    Planner planner(testSettings());
+    StepGenerator stepper;
+    REQUIRE(planner.addCommand(parse("G1 X10 Y1 F60")) == GrblError::None);
+
+    // At 1 mm/s along the path, X makes 80 * 10 / sqrt(101) steps/s, and the interrupt
+    // runs eight times per step
+    const double timerFrequency = stepper.settings.timerFrequency;
+    const double xRate = 80. * 10. / sqrt(101.);
+    uint32_t expectedPeriod = static_cast<uint32_t>(timerFrequency / xRate / 8. + 0.5);
+    uint32_t cruisePeriod = 0;
+    std::vector<StepEvent> timeline;
+    uint64_t time = 0;
+    stepper.prepare(planner);
+    while (stepper.isRunning()) {
+        AxisBits stepBits = stepper.tick();
+        if (stepBits) {
+            timeline.push_back({ time, stepBits, stepper.directionBits() });
+        }
+        if (stepper.position()[0] == 400) {
+            cruisePeriod = stepper.period();
+        }
+        time += stepper.period();
+        stepper.prepare(planner);
+    }
+    REQUIRE(cruisePeriod >= expectedPeriod - 1);
+    REQUIRE(cruisePeriod <= expectedPeriod + 1);
+
+    std::vector<uint64_t> yTimes;
+    for (const StepEvent &event : timeline) {
+        if (event.stepBits & 2) {
+            yTimes.push_back(event.time);
+        }
+    }
+    REQUIRE(yTimes.size() == 80);
+
+    // During the cruise, the steps of Y are evenly spaced by ten steps of X
+    uint64_t period = static_cast<uint64_t>(timerFrequency * 10. / xRate);
+    for (size_t i = 10; i + 10 < yTimes.size(); i++) {
+        uint64_t interval = yTimes[i] - yTimes[i - 1];
+        REQUIRE(interval > period * 99 / 100);
+        REQUIRE(interval < period * 101 / 100);
+    }
+}
+
+TEST_CASE("direction invert mask", "stepgenerator")
+{
+    Planner planner(testSettings());
+    StepperSettings settings;
+    settings.directionInvertMask = 0b101;
+    StepGenerator stepper(settings);
+    REQUIRE(planner.addCommand(parse("G1 X-1 Y-1 Z-1 F600")) == GrblError::None);
+    std::vector<StepEvent> timeline = runTimeline(planner, stepper);
+
+    REQUIRE(timeline.front().directionBits == 0b010);
+    for (int axis = 0; axis < 3; axis++) {
+        REQUIRE(stepper.position()[axis] == -80);
+    }
+}
+
+TEST_CASE("corexy steps both motors", "stepgenerator")
+{
+    Planner planner(testSettings());
+    CoreXYKinematics coreXY;
+    StepperSettings settings;
+    settings.kinematics = coreXY.kinematics();
+    StepGenerator stepper(settings);
+
+    REQUIRE(planner.addCommand(parse("G1 X10 F1200")) == GrblError::None);
+    runTimeline(planner, stepper);
+    REQUIRE(stepper.position()[0] == 800);
+    REQUIRE(stepper.position()[1] == 800);
+
+    REQUIRE(planner.addCommand(parse("G1 Y5")) == GrblError::None);
+    runTimeline(planner, stepper);
+    REQUIRE(stepper.position()[0] == 1200);
+    REQUIRE(stepper.position()[1] == 400);
+}
+
+TEST_CASE("timeline dump", "stepgenerator")
+{
+    Planner planner(testSettings());
+    StepGenerator stepper;
+    REQUIRE(planner.addCommand(parse("G1 X0.05 F600")) == GrblError::None);
+    std::string dump = dumpTimeline(runTimeline(planner, stepper));
+
+    // Four steps of X, as time in timer ticks, step bits and direction bits
+    std::istringstream stream(dump);
+    std::string line;
+    size_t lines = 0;
+    unsigned long previousTime = 0;
+    while (std::getline(stream, line)) {
+        size_t comma = line.find(',');
+        unsigned long time = std::stoul(line.substr(0, comma));
+        REQUIRE(time > previousTime);
+        REQUIRE(line.substr(comma) == ",1,0");
+        previousTime = time;
+        lines++;
+    }
+    REQUIRE(lines == 4);
+}
@@ -0,0 +1,114 @@
+#ifndef GCGP_TESTS_STRINGSERIAL_H
+#define GCGP_TESTS_STRINGSERIAL_H
+
+#include <GCGP/GrblInterface.h>
+#include <GCGP/Serial.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+// A serial port on in-memory strings instead of a UART: the test appends to rx and
+// reads the answers from tx. Bytes are returned like Arduino's Serial.read(), as
+// unsigned char values, so extended real-time commands are not negative.
+struct StringSerial {
+    std::string rx;
+    size_t rxIndex = 0;
+    std::string tx;
+
+    SerialInterface serialInterface()
+    {
+        return SerialInterface(this, available, peek, read, write);
+    }
+
+    static int available(void *instance)
+    {
+        StringSerial *self = static_cast<StringSerial *>(instance);
+        return static_cast<int>(self->rx.size() - self->rxIndex);
+    }
+
+    static int peek(void *instance)
+    {
+        StringSerial *self = static_cast<StringSerial *>(instance);
+        if (self->rxIndex >= self->rx.size()) {
+            return -1;
+        }
+        return static_cast<unsigned char>(self->rx[self->rxIndex]);
+    }
+
+    static int read(void *instance)
+    {
+        int c = peek(instance);
+        if (c != -1) {
+            static_cast<StringSerial *>(instance)->rxIndex++;
+        }
+        return c;
+    }
+
+    static void write(void *instance, const char *str)
+    {
+        static_cast<StringSerial *>(instance)->tx += str;
+    }
+};
+
+// A GrblInterface talking to in-memory strings instead of a serial port, shared by
+// the tests of the interface. The callbacks log what they are called for in events.
+struct TestMachine : StringSerial {
+    bool idle = true;
+    bool jogging = false;
+    bool bufferFull = false;
+    int commands = 0;
+    std::vector<std::string> events;
+    GrblInterface grbl;
+
+    TestMachine() : grbl(serialInterface(), this)
+    {
+        grbl.cbIsIdle = [](void *instance) {
+            return static_cast<TestMachine *>(instance)->idle;
+        };
+        grbl.cbIsInJogState = [](void *instance) {
+            return static_cast<TestMachine *>(instance)->jogging;
+        };
+        grbl.cbBufferIsFull = [](void *instance) {
+            return static_cast<TestMachine *>(instance)->bufferFull;
+        };
+        grbl.cbProcessCommand = [](void *instance, Command<10> *) {
+            TestMachine *self = static_cast<TestMachine *>(instance);
+            self->commands++;
+            self->events.push_back("command");
+        };
+        grbl.cbJog = [](void *instance, Command<10> *command) {
+            REQUIRE(command->isJog);
+            REQUIRE(command->motionType == MotionType::Feed);
+            static_cast<TestMachine *>(instance)->events.push_back("jog");
+        };
+        grbl.cbJogCancel = [](void *instance) {
+            static_cast<TestMachine *>(instance)->events.push_back("jog cancel");
+        };
+        grbl.cbFeedHold = [](void *instance) {
+            static_cast<TestMachine *>(instance)->events.push_back("feed hold");
+        };
+        grbl.cbSafetyDoor = [](void *instance) {
+            static_cast<TestMachine *>(instance)->events.push_back("safety door");
+        };
+        grbl.cbToggleFloodCoolant = [](void *instance) {
+            static_cast<TestMachine *>(instance)->events.push_back("flood");
+        };
+        grbl.cbToggleMistCoolant = [](void *instance) {
+            static_cast<TestMachine *>(instance)->events.push_back("mist");
+        };
+        grbl.cbOverridesChanged = [](void *instance, const OverrideState *overrides) {
+            static_cast<TestMachine *>(instance)->events.push_back(
+                "overrides " + std::to_string(overrides->feed) + " " +
+                std::to_string(overrides->rapid) + " " +
+                std::to_string(overrides->spindle));
+        };
+        tx.clear(); // Welcome message
+    }
+
+    void send(const std::string &data)
+    {
+        rx += data;
+    }
+};
+
+#endif // GCGP_TESTS_STRINGSERIAL_H
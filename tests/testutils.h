@@ -0,0 +1,28 @@
+#ifndef GCGP_TESTS_TESTUTILS_H
+#define GCGP_TESTS_TESTUTILS_H
+
+#include <GCGP/Command.h>
+#include <catch2/catch_test_macros.hpp>
+#include <math.h>
+#include <string.h>
+
+// A line that must be valid
+inline Command<10> parse(const char *str)
+{
+    Command<10> command;
+    REQUIRE(command.parse(str, strlen(str)) == GrblError::None);
+    return command;
+}
+
+inline bool near(double a, double b, double tolerance = 1e-4)
+{
+    return fabs(a - b) < tolerance;
+}
+
+// Relative to the magnitude of b, for values far from 1
+inline bool nearRelative(double a, double b, double tolerance = 1e-3)
+{
+    return fabs(a - b) <= tolerance * (1. + fabs(b));
+}
+
+#endif // GCGP_TESTS_TESTUTILS_H
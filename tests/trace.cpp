@@ -0,0 +1,128 @@
+#include <GCGP/GrblInterface.h>
+#include <GCGP/Trace.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+
+#include "stringserial.h"
+
+// Built with GCGP_ENABLE_TRACE, see CMakeLists.txt
+static_assert(GCGP_ENABLE_TRACE, "The trace test needs the tracepoints");
+
+// The records as text, e.g. "+Parse -Parse:0"
+static std::string records()
+{
+    std::string text;
+    for (size_t i = 0; i < traceBuffer.size(); i++) {
+        const TraceRecord &record = traceBuffer[i];
+        if (!text.empty()) {
+            text += ' ';
+        }
+        if (record.phase == TracePhase::Begin) {
+            text += '+';
+            text += traceEventName(record.event);
+        }
+        else {
+            text += '-';
+            text += traceEventName(record.event);
+            text += ':' + std::to_string(record.arg);
+        }
+    }
+    return text;
+}
+
+static std::string chromeTrace()
+{
+    std::string json;
+    writeChromeTrace(
+        traceBuffer,
+        [](void *instance, const char *data, size_t length) {
+            static_cast<std::string *>(instance)->append(data, length);
+        },
+        &json);
+    return json;
+}
+
+static size_t count(const std::string &text, const std::string &part)
+{
+    size_t n = 0;
+    for (size_t i = text.find(part); i != std::string::npos; i = text.find(part, i + 1)) {
+        n++;
+    }
+    return n;
+}
+
+TEST_CASE("a line is traced through all stages", "trace")
+{
+    TestMachine machine;
+    traceBuffer.clear(); // Welcome message
+    machine.send("G1 X10 F100\n");
+    machine.grbl.update();
+    REQUIRE(machine.commands == 1);
+    REQUIRE(records() == "+Receive -Receive:12 +Parse +Tokenize -Tokenize:0 +Interpret "
+                         "-Interpret:0 +Validate -Validate:0 -Parse:0 +Callback "
+                         "-Callback:0 +Transmit -Transmit:0");
+}
+
+TEST_CASE("a line with an error ends at the stage that fails", "trace")
+{
+    TestMachine machine;
+    const char *line = "G81 X1"; // Canned cycles are not supported
+    Command<10> command;
+    std::string error = std::to_string(static_cast<int>(command.parse(line, 6)));
+    REQUIRE(error != "0");
+    traceBuffer.clear(); // The welcome message and the parse() above
+
+    machine.send(std::string(line) + "\n");
+    machine.grbl.update();
+    REQUIRE(machine.commands == 0);
+    REQUIRE(records() == "+Receive -Receive:7 +Parse +Tokenize -Tokenize:0 +Interpret "
+                         "-Interpret:" + error + " -Parse:" + error +
+                         " +Transmit -Transmit:" + error);
+}
+
+TEST_CASE("real-time commands and a full buffer are traced", "trace")
+{
+    TestMachine machine;
+    traceBuffer.clear(); // Welcome message
+    machine.send("?");
+    machine.grbl.update();
+    REQUIRE(records() == "+Receive +Realtime +Transmit -Transmit:0 -Realtime:63 "
+                         "-Receive:1");
+
+    traceBuffer.clear();
+    machine.bufferFull = true;
+    machine.send("G0 X1\n");
+    machine.grbl.update();
+    machine.grbl.update(); // Nothing new, so not traced
+    machine.bufferFull = false;
+    machine.grbl.update();
+    REQUIRE(machine.commands == 1);
+    std::string text = records();
+    REQUIRE(text.rfind("+Receive -Receive:6 +BufferFull -BufferFull:0 +Parse", 0) == 0);
+}
+
+TEST_CASE("the Chrome trace has the spans that are complete", "trace")
+{
+    TestMachine machine;
+    traceBuffer.clear(); // Welcome message
+    machine.send("G1 X10 F100\nG1 X20\n");
+    machine.grbl.update();
+    std::string json = chromeTrace();
+    REQUIRE(json.rfind("{\"traceEvents\":[", 0) == 0);
+    REQUIRE(count(json, "\"ph\":\"X\"") == traceBuffer.size() / 2);
+    REQUIRE(count(json, "\"name\":\"Parse\"") == 2);
+    REQUIRE(json.find("\"dropped\":0") != std::string::npos);
+
+    // Once the buffer wraps around, the oldest spans lose their begins
+    for (int i = 0; i < GCGP_TRACE_BUFFER_SIZE; i++) {
+        machine.send("G1 X" + std::to_string(i) + "\n");
+        machine.grbl.update();
+    }
+    REQUIRE(traceBuffer.size() == GCGP_TRACE_BUFFER_SIZE);
+    REQUIRE(traceBuffer.dropped() > 0);
+    json = chromeTrace();
+    size_t spans = count(json, "\"ph\":\"X\"");
+    REQUIRE(spans <= GCGP_TRACE_BUFFER_SIZE / 2);
+    REQUIRE(spans > GCGP_TRACE_BUFFER_SIZE / 2 - 8);
+    REQUIRE(count(json, "\"dur\":-") == 0);
+}
@@ -0,0 +1,155 @@
+#include <GCGP/Simulator.h>
+#include <catch2/catch_test_macros.hpp>
+#include <string>
+#include <vector>
+
+static std::string readController(SerialInterface &serial)
+{
+    std::string result;
+    while (serial.available() > 0) {
+        result += static_cast<char>(serial.read());
+    }
+    return result;
+}
+
+TEST_CASE("bytes take their time on the wire", "virtualuart")
+{
+    VirtualClock clock;
+    UartSettings settings;
+    settings.baudRate = 10000; // 1 ms per byte with 10 bits
+    VirtualUart uart(clock, settings);
+    SerialInterface serial = uart.serial();
+    REQUIRE(uart.byteTime() == 1000000);
+
+    REQUIRE(uart.hostWrite("G1\n", 3) == 3);
+    REQUIRE(serial.available() == 0);
+    REQUIRE(uart.nextArrival() == 1000000);
+    clock.now = 2500000;
+    REQUIRE(readController(serial) == "G1");
+    REQUIRE(uart.nextArrival() == 3000000);
+    clock.now = 3000000;
+    REQUIRE(readController(serial) == "\n");
+    REQUIRE(!uart.pendingToController());
+
+    // Back to the host, starting now
+    serial.println("ok");
+    REQUIRE(uart.hostRead() == -1);
+    clock.now = 6000000;
+    std::string answer;
+    for (int c = uart.hostRead(); c != -1; c = uart.hostRead()) {
+        answer += static_cast<char>(c);
+    }
+    REQUIRE(answer == "ok\n");
+    REQUIRE(uart.isIdle());
+    REQUIRE(uart.lostBytes() == 0);
+}
+
+TEST_CASE("a full receive FIFO overruns", "virtualuart")
+{
+    VirtualClock clock;
+    UartSettings settings;
+    settings.baudRate = 115200;
+    settings.rxFifoDepth = 4;
+    VirtualUart uart(clock, settings);
+    SerialInterface serial = uart.serial();
+
+    uart.hostWrite("ABCDEFGH", 8);
+    clock.now = 6 * uart.byteTime();
+    REQUIRE(readController(serial) == "ABCD"); // E and F arrived while it was full
+    REQUIRE(uart.lostBytes() == 2);
+    clock.now = 8 * uart.byteTime();
+    REQUIRE(readController(serial) == "GH");
+
+    // With flow control, the host waits instead
+    uart.settings.flowControl = true;
+    uart.hostWrite("ABCDEFGH", 8);
+    clock.now = 20 * uart.byteTime();
+    REQUIRE(serial.available() == 4);
+    REQUIRE(readController(serial) == "ABCDEFGH");
+    REQUIRE(uart.lostBytes() == 2);
+}
+
+// Short straight moves that the machine executes faster than 115200 baud can deliver them
+static SimulatorSettings serialLimitedSettings()
+{
+    SimulatorSettings settings;
+    for (int i = 0; i < GCGP_NUM_AXES; i++) {
+        settings.planner.maxRate[i] = 6000.f;
+        settings.planner.acceleration[i] = 2000.f;
+    }
+    settings.uart.baudRate = 115200;
+    settings.uart.hostLatency = 0.001f;
+    return settings;
+}
+
+struct Program {
+    std::vector<std::string> lines;
+    size_t next = 0;
+
+    Program()
+    {
+        for (int i = 1; i <= 300; i++) {
+            lines.push_back("G1 X" + std::to_string(i * 0.1) + " Y" +
+                            std::to_string(i * 0.05) + " F6000");
+        }
+    }
+
+    static const char *nextLine(void *instance)
+    {
+        Program *program = static_cast<Program *>(instance);
+        if (program->next >= program->lines.size()) {
+            return nullptr;
+        }
+        return program->lines[program->next++].c_str();
+    }
+};
+
+static SimulationReport streamProgram(StreamingMode mode)
+{
+    MachineSimulator simulator(serialLimitedSettings());
+    Program program;
+    simulator.instance = &program;
+    simulator.cbNextLine = Program::nextLine;
+    simulator.stream(mode);
+    simulator.finish();
+    REQUIRE(simulator.uart.lostBytes() == 0);
+    return simulator.report();
+}
+
+TEST_CASE("character counting streams faster than send-response", "virtualuart")
+{
+    SimulationReport sendResponse = streamProgram(StreamingMode::SendResponse);
+    SimulationReport counting = streamProgram(StreamingMode::CharacterCounting);
+    REQUIRE(sendResponse.lines == 300);
+    REQUIRE(counting.lines == 300);
+    REQUIRE(sendResponse.errors == 0);
+    REQUIRE(counting.blocks == 300);
+    REQUIRE(counting.position[0] == sendResponse.position[0]);
+
+    // Each line needs its bytes, the answer and the host latency, about 3.4 ms
+    double bytes = 3. + 4. + 4. + 6. + 1. + 3.; // Per line and answer, roughly
+    REQUIRE(sendResponse.time > 300 * (bytes * 10. / 115200. + 0.001));
+    REQUIRE(counting.time < 0.8 * sendResponse.time);
+    REQUIRE(counting.motionTime <= counting.time);
+}
+
+TEST_CASE("errors are reported with their line number", "virtualuart")
+{
+    MachineSimulator simulator(serialLimitedSettings());
+    struct Lines {
+        const char *lines[5] = {"G21", "", "G1 X1 Y", "G1 X1 F100", nullptr};
+        size_t next = 0;
+        std::vector<uint32_t> errors;
+    } lines;
+    simulator.instance = &lines;
+    simulator.cbNextLine = [](void *instance) {
+        Lines *lines = static_cast<Lines *>(instance);
+        return lines->lines[lines->next++];
+    };
+    simulator.cbError = [](void *instance, uint32_t lineNumber, const char *) {
+        static_cast<Lines *>(instance)->errors.push_back(lineNumber);
+    };
+    simulator.stream(StreamingMode::CharacterCounting);
+    REQUIRE(lines.errors == std::vector<uint32_t>{3});
+    REQUIRE(simulator.report().lines == 3);
+}